@@ -0,0 +1,77 @@
+// IMA-ADPCM block codec shared by the downlink framing and the mic uplink in
+// main.ts. Same tables and arithmetic as the firmware's AudioCodec.cpp, so
+// blocks are bit-exact on both ends (tools/imaeval.cpp checks it).
+//
+// Block: predictor (int16 LE) | step index | 00 | nibbles, low nibble first.
+// The header holds the state before the first nibble, so every block decodes
+// on its own.
+
+export const CODEC_IMA_ADPCM = 1;
+
+const IMA_STEP_TABLE = [
+  7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+  50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+  253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+  1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+  3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+  11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+  32767,
+];
+const IMA_INDEX_TABLE = [-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8];
+
+export interface ImaState { predictor: number; index: number; }
+
+// Encode 16-bit LE mono PCM (odd tail sample padded with silence) into one block.
+// State carries across blocks so the stream stays continuous.
+export function imaEncodeBlock(pcm: Uint8Array, state: ImaState): Uint8Array {
+  const view = new DataView(pcm.buffer, pcm.byteOffset, pcm.byteLength);
+  const count = pcm.byteLength >> 1;
+  const nibbleBytes = (count + 1) >> 1;
+  const out = new Uint8Array(4 + nibbleBytes);
+  out[0] = state.predictor & 0xFF; out[1] = (state.predictor >> 8) & 0xFF; out[2] = state.index; out[3] = 0;
+  let { predictor, index } = state;
+  for (let i = 0; i < nibbleBytes * 2; i++) {
+    const sample = i < count ? view.getInt16(i * 2, true) : 0;
+    const step = IMA_STEP_TABLE[index];
+    let diff = sample - predictor;
+    let nibble = 0;
+    if (diff < 0) { nibble = 8; diff = -diff; }
+    if (diff >= step) { nibble |= 4; diff -= step; }
+    if (diff >= step >> 1) { nibble |= 2; diff -= step >> 1; }
+    if (diff >= step >> 2) { nibble |= 1; }
+    // Track the decoder exactly (same arithmetic as imaAdpcmDecodeBlock)
+    let delta = step >> 3;
+    if (nibble & 4) delta += step;
+    if (nibble & 2) delta += step >> 1;
+    if (nibble & 1) delta += step >> 2;
+    predictor += (nibble & 8) ? -delta : delta;
+    predictor = Math.max(-32768, Math.min(32767, predictor));
+    index = Math.max(0, Math.min(88, index + IMA_INDEX_TABLE[nibble]));
+    out[4 + (i >> 1)] |= (i & 1) ? nibble << 4 : nibble;
+  }
+  state.predictor = predictor; state.index = index;
+  return out;
+}
+
+// One IMA-ADPCM block (header holds the state) → 16-bit LE PCM
+export function imaDecodeBlock(block: Uint8Array): Uint8Array | null {
+  if (block.length < 4 || block[2] > 88) return null;
+  let predictor = (block[0] | (block[1] << 8)) << 16 >> 16;
+  let index = block[2];
+  const out = new Uint8Array((block.length - 4) * 4);
+  const view = new DataView(out.buffer);
+  for (let i = 0; i < (block.length - 4) * 2; i++) {
+    const b = block[4 + (i >> 1)];
+    const nibble = (i & 1) ? b >> 4 : b & 0x0F;
+    const step = IMA_STEP_TABLE[index];
+    let delta = step >> 3;
+    if (nibble & 4) delta += step;
+    if (nibble & 2) delta += step >> 1;
+    if (nibble & 1) delta += step >> 2;
+    predictor += (nibble & 8) ? -delta : delta;
+    predictor = Math.max(-32768, Math.min(32767, predictor));
+    index = Math.max(0, Math.min(88, index + IMA_INDEX_TABLE[nibble]));
+    view.setInt16(i * 2, predictor, true);
+  }
+  return out;
+}
@@ -1,6 +1,8 @@
 // deno-lint-ignore-file no-explicit-any require-await
 // deno-lint-ignore no-import-prefix
 import "https://deno.land/std@0.204.0/dotenv/load.ts";
+import { CODEC_IMA_ADPCM, type ImaState, imaEncodeBlock } from "./codec.ts";
+import { decodeMicFrame, UPLINK_CODECS } from "./uplink.ts";
 
 // Deno Edge Server for Jellyberry - WebSocket Proxy to Gemini Live API
 // Deploy to Deno Deploy: deno deploy --project=jellyberry-server main.ts
@@ -129,6 +131,10 @@ interface ClientConnection {
  zenBellCancel?: (() => void) | null; // Cancel function for zen bell streaming
  radioStreamCancel?: (() => void) | null; // Cancel function for radio PCM stream
  radioProcess?: Deno.ChildProcess | null; // ffmpeg process for radio transcoding
+ downlinkCodecs?: string[]; // Codecs the device advertised in "capabilities" (e.g. "ima-adpcm")
+ voiceCodecs?: string[]; // Codecs the device accepts for Gemini speech (A5 5C packets)
+ voiceIma?: ImaState | null; // Encoder state carried across Gemini speech chunks
+ voiceTail?: Uint8Array | null; // Coded speech PCM short of a whole block, waiting for the next part or turnComplete
  deviceStateResolver?: ((state: any) => void) | undefined; // Promise resolver for get_device_state
  pendingModeMessage?: object | null; // Mode command to send to ESP32 after Gemini finishes speaking
  deviceState?: Record<string, unknown>; // Latest device state snapshot from recordingStart
@@ -148,6 +154,10 @@ interface ClientConnection {
  turnAudioChunks?: number; // Audio chunks in current turn
  turnAudioBytes?: number; // PCM bytes sent in current turn
  incomingAudioChunks?: number; // Audio chunks sent FROM ESP32 TO Gemini in current turn
+ micSequence?: number; // Last binary mic frame sequence (gap detection)
+ micFramesLost?: number; // Binary mic frames missing from the sequence this connection
+ micTurnFrames?: number; // Mic frames received as audio this turn
+ micTurnSuppressed?: number; // Mic frames covered by DTX silence markers this turn
 
  // Idle management: timestamp of the last turn the user actually spoke into.
  // Used to suppress Gemini auto-reconnect when the device has been idle a long time.
@@ -1329,6 +1339,149 @@ async function handleActionRequestZenBell(_data: Record<string, unknown>, conn:
   } catch (err) { console.error(`[${conn.deviceId}] Failed to load zen bell:`, err); conn.zenBellCancel = null; }
 }
 
+// ── Ambient / radio downlink framing ─────────────────────────────────────────
+// Legacy:  [A5 5A seq_lo seq_hi] + PCM
+// Codec:   [A5 5B seq_lo seq_hi codec 00] + payload   (firmware AudioCodec.h)
+// IMA-ADPCM payload is one self-contained block (codec.ts): predictor (int16 LE), step
+// index, 00, then nibbles low-first — each packet decodes independently.
+// MP3 (radio only) is the station's bitstream split at arbitrary byte
+// boundaries; the device reassembles frames itself.
+
+const CODEC_MP3 = 2;
+
+// One Gemini speech packet: headerless PCM, or [A5 5C codec flags] + IMA-ADPCM block.
+// VOICE_FLAG_PAD: the sample count was odd, so the block's last nibble is padding.
+const VOICE_FLAG_PAD = 0x01;
+function voicePacket(pcm: Uint8Array, ima: ImaState | null | undefined): Uint8Array {
+  if (!ima) return pcm;
+  const body = imaEncodeBlock(pcm, ima);
+  const packet = new Uint8Array(4 + body.length);
+  packet[0] = 0xA5; packet[1] = 0x5C; packet[2] = CODEC_IMA_ADPCM; packet[3] = (pcm.byteLength >> 1) & 1 ? VOICE_FLAG_PAD : 0;
+  packet.set(body, 4);
+  return packet;
+}
+
+// Gemini speech → device in 40 ms packets. Coded speech goes out in whole blocks
+// whatever the size of Gemini's parts: a part's remainder waits in voiceTail for
+// the next one, so the block boundaries carry no padding mid-turn. endVoiceTurn()
+// sends the turn's last, short block ahead of turnComplete, or drops it after an
+// interrupt; either way the next turn starts from a fresh encoder state.
+const VOICE_CHUNK_BYTES = 1920; // 960 samples
+
+function sendVoice(conn: ClientConnection, pcm: Uint8Array): void {
+  if (!conn.voiceIma) {
+    for (let offset = 0; offset < pcm.length; offset += VOICE_CHUNK_BYTES) {
+      conn.socket.send(pcm.subarray(offset, Math.min(offset + VOICE_CHUNK_BYTES, pcm.length)));
+    }
+    return;
+  }
+  let data = pcm;
+  if (conn.voiceTail?.length) {
+    data = new Uint8Array(conn.voiceTail.length + pcm.length);
+    data.set(conn.voiceTail);
+    data.set(pcm, conn.voiceTail.length);
+  }
+  let offset = 0;
+  for (; offset + VOICE_CHUNK_BYTES <= data.length; offset += VOICE_CHUNK_BYTES) {
+    conn.socket.send(voicePacket(data.subarray(offset, offset + VOICE_CHUNK_BYTES), conn.voiceIma));
+  }
+  conn.voiceTail = data.slice(offset);
+}
+
+function endVoiceTurn(conn: ClientConnection, interrupted: boolean): void {
+  const tail = conn.voiceTail;
+  conn.voiceTail = null;
+  if (!conn.voiceIma) return;
+  if (tail?.length && !interrupted) conn.socket.send(voicePacket(tail, conn.voiceIma));
+  conn.voiceIma = { predictor: 0, index: 0 };
+}
+
+// One ambient/radio packet in the best format the device advertised
+function ambientPacket(pcm: Uint8Array, sequence: number, ima: ImaState | null): Uint8Array {
+  const body = ima ? imaEncodeBlock(pcm, ima) : pcm;
+  const headerLen = ima ? 6 : 4;
+  const packet = new Uint8Array(headerLen + body.length);
+  packet[0] = 0xA5; packet[1] = ima ? 0x5B : 0x5A; packet[2] = sequence & 0xFF; packet[3] = (sequence >> 8) & 0xFF;
+  if (ima) { packet[4] = CODEC_IMA_ADPCM; packet[5] = 0; }
+  packet.set(body, headerLen);
+  return packet;
+}
+
+// Radio relayed as the station's own MP3 bytes: A5 5B seq codec=2 00 | data (firmware Mp3Stream.h)
+function mp3Packet(data: Uint8Array, sequence: number): Uint8Array {
+  const packet = new Uint8Array(6 + data.length);
+  packet[0] = 0xA5; packet[1] = 0x5B; packet[2] = sequence & 0xFF; packet[3] = (sequence >> 8) & 0xFF;
+  packet[4] = CODEC_MP3; packet[5] = 0;
+  packet.set(data, 6);
+  return packet;
+}
+
+function downlinkImaState(conn: ClientConnection): ImaState | null {
+  return conn.downlinkCodecs?.includes("ima-adpcm") ? { predictor: 0, index: 0 } : null;
+}
+
+// ── Binary mic uplink ────────────────────────────────────────────────────────
+// Frames are decoded in uplink.ts and re-wrapped here as the realtimeInput
+// message Gemini expects.
+
+function base64FromBytes(bytes: Uint8Array): string {
+  let s = "";
+  for (let i = 0; i < bytes.length; i += 0x8000) {
+    s += String.fromCharCode(...bytes.subarray(i, i + 0x8000));
+  }
+  return btoa(s);
+}
+
+function sendMicPcm(conn: ClientConnection, pcm: Uint8Array): void {
+  conn.geminiSocket!.send(JSON.stringify({
+    realtimeInput: { audio: { data: base64FromBytes(pcm), mimeType: "audio/pcm;rate=16000" } },
+  }));
+  conn.incomingAudioChunks = (conn.incomingAudioChunks || 0) + 1;
+}
+
+// Returns false if `frame` is not a mic uplink frame (caller falls back to the old path)
+function handleMicFrame(frame: Uint8Array, conn: ClientConnection): boolean {
+  const open = conn.geminiSocket?.readyState === WebSocket.OPEN;
+  return decodeMicFrame(frame, conn, open ? (pcm) => sendMicPcm(conn, pcm) : null);
+}
+
+// ── Download-once ambient clips ──────────────────────────────────────────────
+// requestAmbient with download:true (firmware AmbientClip.h): the whole file goes
+// out once as IMA-ADPCM blocks of 512 samples — ambientClipBegin, one
+// [A5 5E seq_lo seq_hi] + block frame per block, ambientClipEnd. The device
+// loops it locally with a crossfaded seam, so an all-night soundscape costs one
+// download instead of a continuous stream, and finite `loops` complete on the
+// device (no ambientComplete from here).
+
+const CLIP_BLOCK_BYTES = 1024;  // PCM per IMA block (512 samples → 260 bytes)
+
+async function sendAmbientClip(soundName: string, sequence: number, pcm: Uint8Array, conn: ClientConnection, cancelled: () => boolean): Promise<void> {
+  const samples = pcm.byteLength >> 1;
+  const ima: ImaState = { predictor: 0, index: 0 };
+  const blocks: Uint8Array[] = [];
+  for (let offset = 0; offset < samples * 2; offset += CLIP_BLOCK_BYTES) {
+    blocks.push(imaEncodeBlock(pcm.subarray(offset, Math.min(offset + CLIP_BLOCK_BYTES, samples * 2)), ima));
+  }
+  const bytes = blocks.reduce((n, b) => n + b.byteLength, 0);
+  console.log(`[${conn.deviceId}] Sending ambient clip ${soundName} (seq ${sequence}): ${samples} samples, ${pcm.byteLength} → ${bytes} bytes`);
+  conn.socket.send(JSON.stringify({ type: "ambientClipBegin", sound: soundName, sequence, samples, bytes }));
+  // PSRAM writes are cheap, so pace only enough to keep the device's TCP window from overflowing
+  const BLOCKS_PER_BATCH = 16, BATCH_DELAY_MS = 20;
+  for (let i = 0; i < blocks.length; i++) {
+    if (cancelled() || conn.ambientSequence !== sequence || conn.socket.readyState !== WebSocket.OPEN) {
+      console.log(`[${conn.deviceId}] Ambient clip ${soundName} (seq ${sequence}) cancelled at block ${i}/${blocks.length}`);
+      return;
+    }
+    const frame = new Uint8Array(4 + blocks[i].byteLength);
+    frame[0] = 0xA5; frame[1] = 0x5E; frame[2] = sequence & 0xFF; frame[3] = (sequence >> 8) & 0xFF;
+    frame.set(blocks[i], 4);
+    conn.socket.send(frame);
+    if ((i + 1) % BLOCKS_PER_BATCH === 0) { await new Promise(r => setTimeout(r, BATCH_DELAY_MS)); }
+  }
+  conn.socket.send(JSON.stringify({ type: "ambientClipEnd", sound: soundName, sequence }));
+  console.log(`[${conn.deviceId}] Ambient clip ${soundName} sent (${blocks.length} blocks)`);
+}
+
 async function handleActionRequestAmbient(data: Record<string, unknown>, conn: ClientConnection): Promise<void> {
   const soundName = (data.sound || "rain") as string;
   const sequence = (data.sequence as number) || 0;
@@ -1341,17 +1494,20 @@ async function handleActionRequestAmbient(data: Record<string, unknown>, conn: C
     let cancelled = false;
     conn.ambientStreamCancel = () => { cancelled = true; console.log(`[${conn.deviceId}] Cancel flag set for sequence ${sequence}`); };
     const audioData = await Deno.readFile(`./audio/${soundName}.pcm`);
+    if (data.download === true) {
+      // Device loops it from PSRAM and reports completion itself: send it once
+      await sendAmbientClip(soundName, sequence, audioData, conn, () => cancelled);
+      if (conn.ambientSequence === sequence) { conn.ambientStreamCancel = null; }
+      return;
+    }
     console.log(`[${conn.deviceId}] Loaded ${soundName}.pcm (${audioData.byteLength} bytes) - looping...`);
     const CHUNK_SIZE = 1024, CHUNKS_PER_BATCH = 5, BATCH_DELAY_MS = 100;
+    const ima = downlinkImaState(conn);
     let position = 0, chunksInBatch = 0, loopCount = 0;
     while (conn.socket.readyState === WebSocket.OPEN && !cancelled) {
       if (conn.ambientSequence !== sequence) { console.log(`[${conn.deviceId}] Sequence mismatch: streaming ${sequence} but current is ${conn.ambientSequence}, stopping`); break; }
       const chunk = audioData.slice(position, Math.min(position + CHUNK_SIZE, audioData.byteLength));
-      const header = new Uint8Array(4);
-      header[0] = 0xA5; header[1] = 0x5A; header[2] = sequence & 0xFF; header[3] = (sequence >> 8) & 0xFF;
-      const chunkWithHeader = new Uint8Array(header.length + chunk.length);
-      chunkWithHeader.set(header, 0); chunkWithHeader.set(chunk, header.length);
-      try { conn.socket.send(chunkWithHeader); } catch (err) { console.log(`[${conn.deviceId}] Send failed, stopping stream: ${err}`); break; }
+      try { conn.socket.send(ambientPacket(chunk, sequence, ima)); } catch (err) { console.log(`[${conn.deviceId}] Send failed, stopping stream: ${err}`); break; }
       position += CHUNK_SIZE; chunksInBatch++;
       if (cancelled) { console.log(`[${conn.deviceId}] Stream cancelled after chunk ${Math.floor(position / CHUNK_SIZE)}`); break; }
       if (position >= audioData.byteLength) {
@@ -1398,67 +1554,86 @@ async function handleActionRequestRadio(data: Record<string, unknown>, conn: Cli
     let cancelled = false;
     conn.radioStreamCancel = () => { cancelled = true; };
     const CHUNK_SIZE = 1024;
-    const cmd = new Deno.Command("ffmpeg", {
-      args: [
-        "-reconnect", "1",
-        "-reconnect_streamed", "1",
-        "-reconnect_delay_max", "5",
-        "-user_agent", "Mozilla/5.0 (compatible; Jellyberry/1.0)",
-        "-i", streamUrl,
-        "-ar", "24000", "-ac", "1", "-f", "s16le", "pipe:1"
-      ],
-      stdout: "piped",
-      stderr: "piped",  // piped so we can capture errors on early exit
-    });
-    const process = cmd.spawn();
-    conn.radioProcess = process;
-    console.log(`[${conn.deviceId}] ffmpeg spawned for ${stationName}: ${streamUrl}`);
-    // Drain stderr asynchronously — log only on early failure (totalChunks==0) to avoid flooding
-    let stderrTail = "";
-    (async () => {
-      const dec = new TextDecoder();
-      const rdr = process.stderr.getReader();
-      while (true) {
-        const { done, value } = await rdr.read();
-        if (done) break;
-        const chunk = dec.decode(value, { stream: true });
-        // Keep the last 800 chars so we can log ffmpeg's final error message if the stream dies fast
-        stderrTail = (stderrTail + chunk).slice(-800);
+    // One ffmpeg run. MP3 mode stream-copies the station's own frames (no transcode) for the
+    // device's Mp3Stream decoder; otherwise ffmpeg decodes to 24kHz mono PCM (IMA-coded if supported).
+    const relay = async (mp3: boolean): Promise<{ chunks: number; stderrTail: string }> => {
+      const output = mp3
+        ? ["-vn", "-c:a", "copy", "-f", "mp3", "pipe:1"]
+        : ["-ar", "24000", "-ac", "1", "-f", "s16le", "pipe:1"];
+      const cmd = new Deno.Command("ffmpeg", {
+        args: [
+          "-reconnect", "1",
+          "-reconnect_streamed", "1",
+          "-reconnect_delay_max", "5",
+          "-user_agent", "Mozilla/5.0 (compatible; Jellyberry/1.0)",
+          "-i", streamUrl,
+          ...output,
+        ],
+        stdout: "piped",
+        stderr: "piped",  // piped so we can capture errors on early exit
+      });
+      const process = cmd.spawn();
+      conn.radioProcess = process;
+      console.log(`[${conn.deviceId}] ffmpeg spawned for ${stationName}: ${streamUrl}`);
+      // Drain stderr asynchronously — log only on early failure (totalChunks==0) to avoid flooding
+      let stderrTail = "";
+      (async () => {
+        const dec = new TextDecoder();
+        const rdr = process.stderr.getReader();
+        while (true) {
+          const { done, value } = await rdr.read();
+          if (done) break;
+          const chunk = dec.decode(value, { stream: true });
+          // Keep the last 800 chars so we can log ffmpeg's final error message if the stream dies fast
+          stderrTail = (stderrTail + chunk).slice(-800);
+        }
+      })().catch(() => {});
+      let totalChunks = 0;
+      const ima = mp3 ? null : downlinkImaState(conn);
+      console.log(`[${conn.deviceId}] Radio downlink: ${mp3 ? "MP3 relay" : ima ? "IMA-ADPCM" : "PCM"}`);
+      const reader = process.stdout.getReader();
+      let buffer = new Uint8Array(0);
+      while (!cancelled && conn.socket.readyState === WebSocket.OPEN) {
+        const { done, value } = await reader.read();
+        if (done || cancelled) break;
+        const combined = new Uint8Array(buffer.length + value.length);
+        combined.set(buffer, 0); combined.set(value, buffer.length);
+        buffer = combined;
+        while (buffer.length >= CHUNK_SIZE && !cancelled) {
+          const chunk = buffer.slice(0, CHUNK_SIZE);
+          buffer = buffer.slice(CHUNK_SIZE);
+          if (conn.socket.readyState !== WebSocket.OPEN) { cancelled = true; break; }
+          try { conn.socket.send(mp3 ? mp3Packet(chunk, sequence) : ambientPacket(chunk, sequence, ima)); } catch (_err) { cancelled = true; break; }
+          totalChunks++;
+          // Yield to the event loop every chunk so cancellation (stopAmbient) is processed
+          // promptly. Without this, a large ffmpeg read() can produce 20-30 chunks that all
+          // send synchronously before the incoming stopAmbient message is handled, flooding
+          // the ESP32's TCP receive buffer and causing "Failed to send frame".
+          await new Promise(resolve => setTimeout(resolve, 0));
+          if (cancelled) break;
+        }
       }
-    })().catch(() => {});
-    let totalChunks = 0;
-    const reader = process.stdout.getReader();
-    let buffer = new Uint8Array(0);
-    while (!cancelled && conn.socket.readyState === WebSocket.OPEN) {
-      const { done, value } = await reader.read();
-      if (done || cancelled) break;
-      const combined = new Uint8Array(buffer.length + value.length);
-      combined.set(buffer, 0); combined.set(value, buffer.length);
-      buffer = combined;
-      while (buffer.length >= CHUNK_SIZE && !cancelled) {
-        const chunk = buffer.slice(0, CHUNK_SIZE);
-        buffer = buffer.slice(CHUNK_SIZE);
-        const header = new Uint8Array(4);
-        header[0] = 0xA5; header[1] = 0x5A; header[2] = sequence & 0xFF; header[3] = (sequence >> 8) & 0xFF;
-        const chunkWithHeader = new Uint8Array(4 + CHUNK_SIZE);
-        chunkWithHeader.set(header, 0); chunkWithHeader.set(chunk, 4);
-        if (conn.socket.readyState !== WebSocket.OPEN) { cancelled = true; break; }
-        try { conn.socket.send(chunkWithHeader); } catch (_err) { cancelled = true; break; }
-        totalChunks++;
-        // Yield to the event loop every chunk so cancellation (stopAmbient) is processed
-        // promptly. Without this, a large ffmpeg read() can produce 20-30 chunks that all
-        // send synchronously before the incoming stopAmbient message is handled, flooding
-        // the ESP32's TCP receive buffer and causing "Failed to send frame".
-        await new Promise(resolve => setTimeout(resolve, 0));
-        if (cancelled) break;
+      reader.cancel();
+      try { process.kill(); } catch (_) { /* ignore */ }
+      return { chunks: totalChunks, stderrTail };
+    };
+
+    let result = { chunks: 0, stderrTail: "" };
+    if (conn.downlinkCodecs?.includes("mp3")) {
+      result = await relay(true);
+      // AAC/Ogg/HLS stations cannot be stream-copied into MP3: transcode them as before
+      if (result.chunks === 0 && !cancelled && conn.socket.readyState === WebSocket.OPEN) {
+        console.log(`[${conn.deviceId}] ${stationName} is not MP3 — falling back to PCM`);
+        result = await relay(false);
       }
+    } else {
+      result = await relay(false);
     }
-    reader.cancel();
-    try { process.kill(); } catch (_) { /* ignore */ }
+    const totalChunks = result.chunks;
     if (!cancelled && conn.socket.readyState === WebSocket.OPEN) {
       if (totalChunks === 0) {
         // ffmpeg connected but produced no audio — URL is likely dead or incompatible
-        console.error(`[${conn.deviceId}] Radio stream FAILED (0 chunks): ${stationName} — ${stderrTail.trim().split("\n").pop() ?? "no stderr"}`);
+        console.error(`[${conn.deviceId}] Radio stream FAILED (0 chunks): ${stationName} — ${result.stderrTail.trim().split("\n").pop() ?? "no stderr"}`);
         conn.socket.send(JSON.stringify({ type: "radioEnded", stationName, error: true }));
       } else {
         console.log(`[${conn.deviceId}] Radio stream ended: ${stationName} (${totalChunks} chunks)`);
@@ -1479,6 +1654,102 @@ async function handleActionRequestRadio(data: Record<string, unknown>, conn: Cli
   }
 }
 
+// ── Device asset cache ───────────────────────────────────────────────────────
+// Sounds the device keeps on its "assets" flash partition (firmware
+// AssetCache.h). A manifest is pushed on connect; the device requests each
+// missing or stale asset with {action:"requestAsset", name} while idle and
+// receives assetBegin, binary frames [0xA5, 0x5F, ...data], then assetEnd.
+// requestAlarm / requestZenBell / requestAmbient remain the fallback for
+// uncached devices. Soundscapes are QOA assets packed offline with
+// tools/qoapack.cpp (~5:1); a missing .qoa is simply left out of the manifest.
+// "kws" is the wake-word model (firmware KeywordSpotter.h, "JBK1" int8
+// network); without audio/kws.jbk the device has no hands-free start, and a
+// device built with KWS_ENABLED 0 (the default) skips it in the manifest.
+
+const DEVICE_ASSETS: Record<string, string> = {
+  alarm:      "alarm_sound.qoa",
+  zen_bell:   "zen_bell.qoa",
+  rain:       "rain.qoa",
+  ocean:      "ocean.qoa",
+  rainforest: "rainforest.qoa",
+  fire:       "fire.qoa",
+  kws:        "kws.jbk",
+};
+
+interface AssetInfo { version: number; size: number; crc: number; mtime: number; }
+const assetInfoCache = new Map<string, AssetInfo>();
+
+const CRC32_TABLE = (() => {
+  const t = new Uint32Array(256);
+  for (let n = 0; n < 256; n++) {
+    let c = n;
+    for (let k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320 ^ (c >>> 1) : c >>> 1;
+    t[n] = c >>> 0;
+  }
+  return t;
+})();
+
+// CRC-32 (zlib) — matches esp_rom_crc32_le(0, ...) on the device
+function crc32(data: Uint8Array): number {
+  let c = 0xFFFFFFFF;
+  for (let i = 0; i < data.length; i++) c = CRC32_TABLE[(c ^ data[i]) & 0xFF] ^ (c >>> 8);
+  return (c ^ 0xFFFFFFFF) >>> 0;
+}
+
+// Version is the file's mtime in seconds; CRC is recomputed only when that changes
+async function getAssetInfo(name: string): Promise<AssetInfo | null> {
+  const file = DEVICE_ASSETS[name];
+  if (!file) return null;
+  try {
+    const stat = await Deno.stat(`./audio/${file}`);
+    const mtime = stat.mtime?.getTime() ?? 0;
+    const cached = assetInfoCache.get(name);
+    if (cached && cached.mtime === mtime && cached.size === stat.size) return cached;
+    const data = await Deno.readFile(`./audio/${file}`);
+    const info = { version: Math.floor(mtime / 1000), size: data.byteLength, crc: crc32(data), mtime };
+    assetInfoCache.set(name, info);
+    return info;
+  } catch (_) {
+    return null;  // Not present on this server — device keeps using the request path
+  }
+}
+
+async function sendAssetManifest(conn: ClientConnection): Promise<void> {
+  const assets = [];
+  for (const name of Object.keys(DEVICE_ASSETS)) {
+    const info = await getAssetInfo(name);
+    if (info) assets.push({ name, version: info.version, size: info.size, crc: info.crc });
+  }
+  if (assets.length === 0 || conn.socket.readyState !== WebSocket.OPEN) return;
+  conn.socket.send(JSON.stringify({ type: "assetManifest", assets }));
+  console.log(`[${conn.deviceId}] Sent asset manifest: ${assets.map(a => `${a.name} v${a.version}`).join(", ")}`);
+}
+
+async function handleActionRequestAsset(data: Record<string, unknown>, conn: ClientConnection): Promise<void> {
+  const name = data.name as string;
+  const info = await getAssetInfo(name);
+  if (!info) { console.warn(`[${conn.deviceId}] Unknown asset requested: ${name}`); return; }
+  try {
+    const audioData = await Deno.readFile(`./audio/${DEVICE_ASSETS[name]}`);
+    if (crc32(audioData) !== info.crc) { assetInfoCache.delete(name); console.warn(`[${conn.deviceId}] Asset ${name} changed during request - skipped`); return; }
+    console.log(`[${conn.deviceId}] Sending asset ${name} v${info.version} (${audioData.byteLength} bytes)`);
+    conn.socket.send(JSON.stringify({ type: "assetBegin", name, version: info.version, size: info.size, crc: info.crc }));
+    // Paced like the audio streams: the device writes (and erases) flash as chunks arrive
+    const CHUNK_SIZE = 1024, CHUNKS_PER_BATCH = 5, BATCH_DELAY_MS = 100;
+    for (let offset = 0; offset < audioData.byteLength; offset += CHUNK_SIZE) {
+      if (conn.socket.readyState !== WebSocket.OPEN) { console.log(`[${conn.deviceId}] Asset ${name} aborted (socket closed)`); return; }
+      const slice = audioData.subarray(offset, offset + CHUNK_SIZE);
+      const frame = new Uint8Array(slice.byteLength + 2);
+      frame[0] = 0xA5; frame[1] = 0x5F;
+      frame.set(slice, 2);
+      conn.socket.send(frame);
+      if ((offset / CHUNK_SIZE) % CHUNKS_PER_BATCH === 0) { await new Promise(r => setTimeout(r, BATCH_DELAY_MS)); }
+    }
+    conn.socket.send(JSON.stringify({ type: "assetEnd", name }));
+    console.log(`[${conn.deviceId}] Asset ${name} sent`);
+  } catch (err) { console.error(`[${conn.deviceId}] Failed to send asset ${name}:`, err); }
+}
+
 // Maps data.action → handler. Checked before data.type to catch streaming requests first.
 const actionHandlers: Record<string, ActionHandler> = {
   requestAlarm:   handleActionRequestAlarm,
@@ -1487,6 +1758,7 @@ const actionHandlers: Record<string, ActionHandler> = {
   requestAmbient: handleActionRequestAmbient,
   stopAmbient:    handleActionStopAmbient,
   requestRadio:   handleActionRequestRadio,
+  requestAsset:   handleActionRequestAsset,
 };
 
 // Shared radio greeting prompt — identical in two handlers; extracted to avoid drift.
@@ -1528,6 +1800,10 @@ async function handleTypeRecordingStart(data: Record<string, unknown>, conn: Cli
   // suppressing generationComplete if the previous turn never completed cleanly.
   conn.turnCompleteFired = false;
   conn.deviceState = data as Record<string, unknown>;
+  // Silence still held on the device at the end of the last turn is never sent: don't count it as lost
+  conn.micSequence = undefined;
+  conn.micTurnFrames = 0;
+  conn.micTurnSuppressed = 0;
   conn.lastUserActivity = Date.now();
   if (!conn.geminiSocket || conn.geminiSocket.readyState !== WebSocket.OPEN) {
     console.log(`[${conn.deviceId}] recordingStart: Gemini not connected — lazy reconnect`);
@@ -1560,6 +1836,7 @@ async function handleTypeRecordingStart(data: Record<string, unknown>, conn: Cli
   console.log(`[${conn.deviceId}] Device state: SYSTEM: Current device state ${parts.join(". ")}.`);
   if (conn.geminiSocket?.readyState === WebSocket.OPEN) {
     conn.incomingAudioChunks = 0; // Reset counter for new turn
+    endVoiceTurn(conn, true); // Whatever is left of Gemini's last turn is stale now
     conn.userSpeakingActive = true;
     conn.geminiSocket.send(JSON.stringify({ realtimeInput: { activityStart: {} } }));
     console.log(`[${conn.deviceId}] activityStart → Gemini`);
@@ -1571,6 +1848,12 @@ async function handleTypeRecordingStop(_data: Record<string, unknown>, conn: Cli
   // If Gemini is disconnected the flag would otherwise stay stale-true and
   // swallow the generationComplete handler on the next reconnected turn.
   conn.turnCompleteFired = false;
+  const micFrames = (conn.micTurnFrames || 0) + (conn.micTurnSuppressed || 0);
+  if (micFrames > 0 && conn.micTurnSuppressed !== undefined) {
+    const pct = ((conn.micTurnSuppressed || 0) * 100 / micFrames).toFixed(0);
+    console.log(`[${conn.deviceId}] Mic uplink turn: ${micFrames} frames, ${conn.micTurnSuppressed} suppressed by DTX (${pct}%)`);
+    conn.micTurnSuppressed = undefined; // log once per turn (recordingStop can repeat)
+  }
   if (conn.geminiSocket?.readyState === WebSocket.OPEN) {
     // Guard: firmware can emit duplicate recordingStop messages (VAD + timeout race).
     // If we already sent activityEnd for this turn, suppress the duplicate.
@@ -1586,6 +1869,16 @@ async function handleTypeRecordingStop(_data: Record<string, unknown>, conn: Cli
   }
 }
 
+// Sent by the firmware in reply to "ready": downlink codecs it can decode
+async function handleTypeCapabilities(data: Record<string, unknown>, conn: ClientConnection): Promise<void> {
+  const strings = (v: unknown) => Array.isArray(v) ? v.filter((c): c is string => typeof c === "string") : [];
+  conn.downlinkCodecs = strings(data.codecs);
+  conn.voiceCodecs = strings(data.voiceCodecs);
+  conn.voiceIma = conn.voiceCodecs.includes("ima-adpcm") ? { predictor: 0, index: 0 } : null;
+  conn.voiceTail = null;
+  console.log(`[${conn.deviceId}] Device codecs: ambient ${conn.downlinkCodecs.join(", ") || "pcm"}, voice ${conn.voiceCodecs.join(", ") || "pcm"}`);
+}
+
 // Maps data.type → handler. Fallthrough (no match) is forwarded raw to Gemini.
 const typeHandlers: Record<string, TypeHandler> = {
   radioModeActivated:  handleTypeRadioModeActivated,
@@ -1594,6 +1887,7 @@ const typeHandlers: Record<string, TypeHandler> = {
   functionResponse:    handleTypeFunctionResponse,
   recordingStart:      handleTypeRecordingStart,
   recordingStop:       handleTypeRecordingStop,
+  capabilities:        handleTypeCapabilities,
 };
 
 // Handle ESP32 device WebSocket connections
@@ -1608,6 +1902,7 @@ Deno.serve({ port: 8000, hostname: "0.0.0.0" }, (req: Request) => {
  // WebSocket endpoint for ESP32 devices
  if (url.pathname === "/ws" && req.headers.get("upgrade") === "websocket") {
  const { socket, response } = Deno.upgradeWebSocket(req);
+ socket.binaryType = "arraybuffer"; // mic uplink frames arrive as ArrayBuffer
  const deviceId = url.searchParams.get("device_id") || crypto.randomUUID();
  
  const activeConnections = connections.size;
@@ -1630,11 +1925,17 @@ Deno.serve({ port: 8000, hostname: "0.0.0.0" }, (req: Request) => {
  // Send sunrise/sunset times after connection is established
  socket.onopen = () => {
  sendSunriseSunsetData(connection);
+ sendAssetManifest(connection);
  };
  
  // Handle messages from ESP32
  socket.onmessage = async (event) => {
  try {
+ // Binary mic audio (MicUplink.h): re-wrap for Gemini without touching the JSON path
+ if (event.data instanceof ArrayBuffer && handleMicFrame(new Uint8Array(event.data), connection)) {
+ return;
+ }
+
  const data = typeof event.data === "string" ? JSON.parse(event.data) : event.data;
  
  // Log message type for diagnostics (skip binary audio data to reduce noise)
@@ -1698,7 +1999,7 @@ Deno.serve({ port: 8000, hostname: "0.0.0.0" }, (req: Request) => {
  const sessionDuration = connection.geminiConnectedAt 
  ? ((Date.now() - connection.geminiConnectedAt) / 1000).toFixed(1)
  : "N/A";
- const stats = `msgs=${connection.geminiMessageCount || 0}, audio=${connection.audioChunkCount || 0}, duration=${sessionDuration}s`;
+ const stats = `msgs=${connection.geminiMessageCount || 0}, audio=${connection.audioChunkCount || 0}, micLost=${connection.micFramesLost || 0}, duration=${sessionDuration}s`;
  console.log(`[${deviceId}] ESP32 disconnected (${stats})`);
  
  // Cancel all active streams to prevent orphaned processes
@@ -2167,7 +2468,9 @@ Memory: you have persistent memory across sessions. When you learn something wor
  // Notify ESP32 that we're ready
  connection.socket.send(JSON.stringify({ 
  type: "ready",
- message: "Connected to Gemini Live API" 
+ message: "Connected to Gemini Live API",
+ uplinkCodecs: UPLINK_CODECS, // binary mic frames accepted (firmware MicUplink.h)
+ uplinkDtx: true, // silence markers expanded to comfort noise
  }));
 
  // Ghost turn renewal: firmware is in LED_RECONNECTING state (set before session closed).
@@ -2317,6 +2620,11 @@ Memory: you have persistent memory across sessions. When you learn something wor
  return;
  }
  
+ // Gemini stopped mid-answer (user spoke over it): the unsent remainder belongs to the abandoned turn
+ if (json.serverContent?.interrupted) {
+ endVoiceTurn(connection, true);
+ }
+
  // Handle audio in serverContent
  if (json.serverContent?.modelTurn?.parts) {
  for (const part of json.serverContent.modelTurn.parts) {
@@ -2333,25 +2641,12 @@ Memory: you have persistent memory across sessions. When you learn something wor
  // Decode base64 to raw PCM bytes (16-bit little-endian)
  const pcmBytes = Uint8Array.from(atob(base64Audio), c => c.charCodeAt(0));
  
- // Stream raw PCM directly to ESP32 without encoding
+ // Stream to ESP32 as raw PCM, or IMA-ADPCM if the device advertised it (~3.9x fewer bytes)
  // PCM is already 16-bit little-endian mono at 24kHz from Gemini
- const CHUNK_SIZE = 1920; // 960 samples * 2 bytes = 40ms chunks
- 
- let totalBytesSent = 0;
- let chunksInThisPart = 0;
- 
- // Send PCM in fixed-size chunks - no artificial delays
- // Let TCP/WebSocket handle flow control naturally
- for (let offset = 0; offset < pcmBytes.length; offset += CHUNK_SIZE) {
- const chunkEnd = Math.min(offset + CHUNK_SIZE, pcmBytes.length);
- const chunk = pcmBytes.subarray(offset, chunkEnd);
- 
- connection.socket.send(chunk);
- totalBytesSent += chunk.length;
- chunksInThisPart++;
- }
+ // Fixed-size chunks, no artificial delays - TCP/WebSocket handles flow control naturally
+ sendVoice(connection, pcmBytes);
  
- connection.turnAudioBytes = (connection.turnAudioBytes || 0) + totalBytesSent;
+ connection.turnAudioBytes = (connection.turnAudioBytes || 0) + pcmBytes.length; // PCM length, so audioMs stays right when coded
  }
  
  // Thoughts are logged and accumulated for session memory.
@@ -2374,6 +2669,7 @@ Memory: you have persistent memory across sessions. When you learn something wor
  return;
  }
  connection.turnCompleteFired = true;
+ endVoiceTurn(connection, false); // Last partial speech block goes out ahead of turnComplete
  
  const wasUserTurn = connection.userSpokeThisTurn;
  const audioChunks = connection.turnAudioChunks || 0;
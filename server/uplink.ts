@@ -0,0 +1,105 @@
+// Binary mic uplink decode, shared by main.ts and tools/uplinkdecode.ts.
+//
+// [A5 4D stream codec seq_lo seq_hi t0..t3 (capture ms, LE)] + payload
+// (firmware MicUplink.h). Offered in "ready" as uplinkCodecs; the device picks
+// one and every frame names it. The payload is decoded back to PCM, which
+// main.ts re-wraps as the realtimeInput message Gemini expects.
+//
+// Every frame is one 20 ms mic read in every codec. A sequence gap of up to
+// UPLINK_MAX_CONCEAL_FRAMES is filled with that many frames of silence (comfort
+// noise in front of a DTX marker), so the audio Gemini hears keeps its timing.
+// Longer gaps (a stall or reconnect) are only counted.
+//
+// DTX (offered as uplinkDtx): a frame with codec UPLINK_SILENCE stands for
+// `frames` suppressed quiet frames (payload: frames u16, level u16 LE) and
+// consumes that many sequence numbers. It is expanded into comfort noise of
+// the same duration at the room's level.
+
+import { CODEC_IMA_ADPCM, imaDecodeBlock } from "./codec.ts";
+
+const CODEC_PCM16 = 0;
+const CODEC_MULAW = 3;
+const UPLINK_HEADER_BYTES = 10;
+export const UPLINK_CODECS = ["ima-adpcm", "mulaw", "pcm16"];
+export const UPLINK_MAX_CONCEAL_FRAMES = 5;
+const UPLINK_SILENCE = 0xFE;
+export const MIC_FRAME_SAMPLES = 320; // 20 ms at 16 kHz, firmware MIC_FRAME_SIZE
+
+// Per-turn uplink state (ClientConnection carries these fields). A new turn
+// clears micSequence, micTurnFrames and micTurnSuppressed.
+export interface MicUplinkState {
+  deviceId?: string;
+  micSequence?: number; // Last binary mic frame sequence (gap detection)
+  micFramesLost?: number; // Frames missing from the sequence
+  micTurnFrames?: number; // Frames received as audio this turn
+  micTurnSuppressed?: number; // Frames covered by DTX silence markers this turn
+}
+
+// G.711 μ-law → 16-bit LE PCM
+function mulawDecode(data: Uint8Array): Uint8Array {
+  const out = new Uint8Array(data.length * 2);
+  const view = new DataView(out.buffer);
+  for (let i = 0; i < data.length; i++) {
+    const u = ~data[i] & 0xFF;
+    const exponent = (u >> 4) & 7;
+    const magnitude = ((((u & 0x0F) << 3) + 0x84) << exponent) - 0x84;
+    view.setInt16(i * 2, (u & 0x80) ? -magnitude : magnitude, true);
+  }
+  return out;
+}
+
+// White noise with mean |sample| = level (uniform in ±2·level)
+function comfortNoise(samples: number, level: number): Uint8Array {
+  const out = new Uint8Array(samples * 2);
+  const view = new DataView(out.buffer);
+  for (let i = 0; i < samples; i++) {
+    view.setInt16(i * 2, Math.round((Math.random() * 2 - 1) * 2 * level), true);
+  }
+  return out;
+}
+
+// Decode one binary frame into `emit` (16 kHz 16-bit LE PCM, in order). State
+// is tracked even when `emit` is null (Gemini not connected). Returns false if
+// `frame` is not a mic uplink frame (caller falls back to the old path).
+export function decodeMicFrame(frame: Uint8Array, state: MicUplinkState, emit: ((pcm: Uint8Array) => void) | null): boolean {
+  if (frame.length < UPLINK_HEADER_BYTES || frame[0] !== 0xA5 || frame[1] !== 0x4D) return false;
+  const codec = frame[3];
+  const seq = frame[4] | (frame[5] << 8);
+  const payload = frame.subarray(UPLINK_HEADER_BYTES);
+  let lost = 0; // frames missing before this one
+  if (state.micSequence !== undefined && seq !== ((state.micSequence + 1) & 0xFFFF)) {
+    lost = (seq - state.micSequence - 1) & 0xFFFF;
+    state.micFramesLost = (state.micFramesLost || 0) + lost;
+    console.warn(`[${state.deviceId}] Mic uplink gap: ${lost} frame(s) lost before seq ${seq}`);
+  }
+  state.micSequence = seq;
+  const conceal = lost <= UPLINK_MAX_CONCEAL_FRAMES ? lost : 0;
+
+  if (codec === UPLINK_SILENCE) {
+    if (payload.length < 4) return true;
+    const frames = payload[0] | (payload[1] << 8);
+    const level = payload[2] | (payload[3] << 8);
+    state.micSequence = (seq + frames - 1) & 0xFFFF;
+    state.micTurnSuppressed = (state.micTurnSuppressed || 0) + frames;
+    emit?.(comfortNoise((conceal + frames) * MIC_FRAME_SAMPLES, level));
+    return true;
+  }
+  state.micTurnFrames = (state.micTurnFrames || 0) + 1;
+
+  let pcm: Uint8Array | null;
+  if (codec === CODEC_PCM16) pcm = payload;
+  else if (codec === CODEC_IMA_ADPCM) pcm = imaDecodeBlock(payload);
+  else if (codec === CODEC_MULAW) pcm = mulawDecode(payload);
+  else pcm = null;
+  if (!pcm) {
+    console.warn(`[${state.deviceId}] Mic uplink frame ${seq} (codec ${codec}) undecodable — dropped`);
+    return true;
+  }
+  if (!emit) return true;
+  if (conceal > 0) {
+    const silence = new Uint8Array(pcm.length);
+    for (let i = 0; i < conceal; i++) emit(silence);
+  }
+  emit(pcm);
+  return true;
+}
@@ -0,0 +1,198 @@
+#include "AmbientClip.h"
+#include <esp_heap_caps.h>
+
+// Stored size of an IMA clip of `n` samples (the last block holds the remainder)
+static uint32_t clipBytes(uint32_t n) {
+    if (n == 0) return 0;
+    uint32_t blocks = (n + AMBIENT_CLIP_BLOCK_SAMPLES - 1) / AMBIENT_CLIP_BLOCK_SAMPLES;
+    uint32_t last = n - (blocks - 1) * AMBIENT_CLIP_BLOCK_SAMPLES;
+    return (blocks - 1) * AMBIENT_CLIP_BLOCK_BYTES + IMA_ADPCM_HEADER_BYTES + (last + 1) / 2;
+}
+
+bool AmbientClip::begin() {
+    commands = xQueueCreate(4, sizeof(Command));
+    data = (uint8_t*)heap_caps_malloc(AMBIENT_CLIP_MAX_BYTES, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    head = (int16_t*)heap_caps_malloc(AMBIENT_CLIP_XFADE_SAMPLES * sizeof(int16_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    gain = (int16_t*)heap_caps_malloc(AMBIENT_CLIP_XFADE_SAMPLES * sizeof(int16_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!commands || !data || !head || !gain) {
+        Serial.println("[CLIP] No PSRAM for the ambient clip store - ambient sounds will stream");
+        heap_caps_free(data);
+        heap_caps_free(head);
+        heap_caps_free(gain);
+        data = nullptr;
+        return false;
+    }
+    for (int i = 0; i < AMBIENT_CLIP_XFADE_SAMPLES; i++) {
+        gain[i] = (int16_t)lrintf(32767.0f * sinf(0.5f * PI * (i + 0.5f) / AMBIENT_CLIP_XFADE_SAMPLES));
+    }
+    Serial.printf("[CLIP] %u KB ambient clip store in PSRAM\n", AMBIENT_CLIP_MAX_BYTES / 1024);
+    return true;
+}
+
+bool AmbientClip::holds(const char* sound) const {
+    return complete && strcmp(name, sound) == 0;
+}
+
+bool AmbientClip::play(uint8_t loops, uint16_t tag) {
+    if (!commands || !complete) return false;
+    Command c = { loops, true, tag, reqSeq.fetch_add(1, std::memory_order_acq_rel) + 1 };
+    completed.store(-1, std::memory_order_release);
+    if (xQueueSend(commands, &c, 0) != pdTRUE) {
+        doneSeq.store(c.seq, std::memory_order_release);   // never runs
+        return false;
+    }
+    return true;
+}
+
+void AmbientClip::stop() {
+    if (!commands) return;
+    Command c = { 0, false, 0, reqSeq.fetch_add(1, std::memory_order_acq_rel) + 1 };
+    if (xQueueSend(commands, &c, 0) != pdTRUE) {
+        // Queue full of plays: the newest command wins anyway, so clear and retry
+        xQueueReset(commands);
+        xQueueSend(commands, &c, 0);
+    }
+}
+
+bool AmbientClip::takeCompleted(uint16_t* tag) {
+    int32_t t = completed.exchange(-1, std::memory_order_acq_rel);
+    if (t < 0) return false;
+    *tag = (uint16_t)t;
+    return true;
+}
+
+bool AmbientClip::beginDownload(const char* sound, uint16_t sequence, uint32_t n, uint32_t bytes) {
+    if (!data) return false;
+    if (n == 0 || bytes != clipBytes(n) || bytes > AMBIENT_CLIP_MAX_BYTES) {
+        Serial.printf("[CLIP] %s: %u samples / %u bytes does not fit the %u KB store\n",
+                      sound, n, bytes, AMBIENT_CLIP_MAX_BYTES / 1024);
+        return false;
+    }
+    // The store is about to be overwritten: speakerTask must be done reading it.
+    // The download is only requested after the stop landed, so this is a race with a new play().
+    if (active()) {
+        Serial.printf("[CLIP] %s: previous clip still playing - download refused\n", sound);
+        return false;
+    }
+    complete = false;
+    strlcpy(name, sound, sizeof(name));
+    writeSequence = sequence;
+    writeSamples = n;
+    writeBytes = bytes;
+    writePos = 0;
+    writeLastMs = millis();
+    writeActive = true;
+    return true;
+}
+
+bool AmbientClip::write(uint16_t sequence, const uint8_t* src, size_t len) {
+    if (!writeActive || sequence != writeSequence) return false;
+    if (writePos + len > writeBytes) {
+        Serial.printf("[CLIP] %s: more data than announced - download aborted\n", name);
+        abortDownload();
+        return false;
+    }
+    memcpy(data + writePos, src, len);
+    writePos += len;
+    writeLastMs = millis();
+    return true;
+}
+
+bool AmbientClip::finishDownload(uint16_t sequence) {
+    if (!writeActive || sequence != writeSequence) return false;
+    writeActive = false;
+    if (writePos != writeBytes) {
+        Serial.printf("[CLIP] %s: %u of %u bytes received - discarded\n", name, writePos, writeBytes);
+        return false;
+    }
+    samples = writeSamples;
+    xfade = samples >= 2 * AMBIENT_CLIP_XFADE_SAMPLES ? AMBIENT_CLIP_XFADE_SAMPLES : 0;
+    for (uint32_t i = 0; i < xfade; i += AMBIENT_CLIP_BLOCK_SAMPLES) {
+        const uint8_t* b = data + (i / AMBIENT_CLIP_BLOCK_SAMPLES) * AMBIENT_CLIP_BLOCK_BYTES;
+        if (imaAdpcmDecodeBlock(b, AMBIENT_CLIP_BLOCK_BYTES, head + i, AMBIENT_CLIP_BLOCK_SAMPLES) < 0) {
+            Serial.printf("[CLIP] %s: malformed block %u - discarded\n", name, i / AMBIENT_CLIP_BLOCK_SAMPLES);
+            return false;
+        }
+    }
+    complete = true;
+    Serial.printf("[CLIP] %s: %u bytes resident (%.1fs, crossfade %ums)\n",
+                  name, writeBytes, samples / 24000.0f, xfade / 24);
+    return true;
+}
+
+void AmbientClip::abortDownload() {
+    if (!writeActive) return;
+    writeActive = false;
+    Serial.printf("[CLIP] %s download aborted at %u/%u bytes\n", name, writePos, writeBytes);
+}
+
+void AmbientClip::finish() {
+    playing = false;
+    doneSeq.store(cur.seq, std::memory_order_release);
+}
+
+void AmbientClip::poll(AudioRing& ring) {
+    Command c;
+    while (commands && xQueueReceive(commands, &c, 0) == pdTRUE) {
+        if (playing) {
+            // Stopped or restarted mid-clip: drop what is already queued in the ring too
+            ring.flush();
+        }
+        cur = c;
+        block = 0;
+        pass = 0;
+        playing = c.play;
+        if (!playing) doneSeq.store(c.seq, std::memory_order_release);
+    }
+}
+
+void AmbientClip::pump(AudioRing& ring) {
+    poll(ring);
+    if (!playing) return;
+
+    for (int i = 0; i < AMBIENT_CLIP_MAX_BLOCKS; i++) {
+        if (!pumpBlock(ring)) return;
+    }
+}
+
+// One decoded block into the ring. False when the ring is full or the clip has ended.
+bool AmbientClip::pumpBlock(AudioRing& ring) {
+    uint32_t blocks = (samples + AMBIENT_CLIP_BLOCK_SAMPLES - 1) / AMBIENT_CLIP_BLOCK_SAMPLES;
+    if (block >= blocks) {
+        pass++;
+        if (cur.loops && pass >= cur.loops) {
+            completed.store(cur.tag, std::memory_order_release);
+            finish();
+            return false;
+        }
+        block = xfade / AMBIENT_CLIP_BLOCK_SAMPLES;   // the head was already played under the seam
+    }
+
+    uint32_t start = block * AMBIENT_CLIP_BLOCK_SAMPLES;
+    int n = (int)min((uint32_t)AMBIENT_CLIP_BLOCK_SAMPLES, samples - start);
+    int nibbles = (n + 1) & ~1;   // an odd last block decodes one padding sample
+    uint8_t* dst = ring.reserve(nibbles * sizeof(int16_t));
+    if (!dst) return false;   // ring full - next wakeup
+    int16_t* out = (int16_t*)dst;
+    if (imaAdpcmDecodeBlock(data + block * AMBIENT_CLIP_BLOCK_BYTES, IMA_ADPCM_HEADER_BYTES + nibbles / 2,
+                            out, nibbles) < 0) {
+        ring.commit(0);
+        finish();
+        return false;
+    }
+
+    // Seam: fade the tail out against the head fading in, except on a finite clip's last pass
+    bool lastPass = cur.loops && pass + 1 >= cur.loops;
+    uint32_t fadeAt = samples - xfade;
+    if (xfade && !lastPass && start + n > fadeAt) {
+        for (int j = 0; j < n; j++) {
+            if (start + j < fadeAt) continue;
+            uint32_t k = start + j - fadeAt;
+            int32_t v = ((int32_t)out[j] * gain[xfade - 1 - k] + (int32_t)head[k] * gain[k] + (1 << 14)) >> 15;
+            out[j] = (int16_t)(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+        }
+    }
+    block++;
+    ring.commit(n * sizeof(int16_t));
+    return true;
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include "AudioRing.h"
+#include "AudioCodec.h"
+
+// ============== AMBIENT CLIP ==============
+//
+// Download-once ambient loops for sounds that are not in the flash asset cache
+// (meditation bells, and soundscapes until their QOA copy has arrived). The
+// server sends the file once and the device loops it from PSRAM, instead of the
+// server streaming the same loop for hours.
+//
+// DOWNLOAD: the device sends requestAmbient with "download": true. The server
+// answers with
+//
+//   {type:"ambientClipBegin", sound, sequence, samples, bytes}
+//   A5 5E seq_lo seq_hi | IMA-ADPCM block       (one per packet, in order)
+//   {type:"ambientClipEnd", sound, sequence}
+//
+// Every block is a self-contained IMA-ADPCM block (AudioCodec.h) of
+// AMBIENT_CLIP_BLOCK_SAMPLES samples; only the last one may be shorter. Blocks
+// are stored back to back at a fixed stride, so any block can be decoded
+// without the ones before it. A server that does not know "download" simply
+// streams as before, so older servers keep working.
+//
+// One clip is resident at a time. Asking for the same sound again replays it
+// without touching the network. A download overwrites the store, so it is
+// only requested once the previous clip has stopped: the caller stops it and
+// asks from loop() when active() goes false (speakerTask acknowledges within
+// a block). beginDownload() never waits; it refuses while a clip plays.
+//
+// PLAYBACK: pump() runs in speakerTask like AssetPlayer and is then MIX_AMBIENT's
+// producer. The seam is an equal-power crossfade: the last
+// AMBIENT_CLIP_XFADE_SAMPLES of the clip fade out (cos) while the first ones fade
+// in (sin), and the next pass continues after them. Clips shorter than two
+// crossfades loop hard. With a finite loop count the last pass plays out to
+// the end. Completion is then reported by takeCompleted(), replacing the
+// server's ambientComplete message.
+//
+// ==========================================
+
+#ifndef AMBIENT_CLIP_MAX_BYTES
+#define AMBIENT_CLIP_MAX_BYTES (400 * 1024)   // PSRAM, IMA-coded: ~34s of 24kHz audio (ocean, the longest, is 32s)
+#endif
+#ifndef AMBIENT_CLIP_XFADE_SAMPLES
+#define AMBIENT_CLIP_XFADE_SAMPLES 2048       // ~85ms seam crossfade; multiple of AMBIENT_CLIP_BLOCK_SAMPLES
+#endif
+#ifndef AMBIENT_CLIP_STOP_TIMEOUT_MS
+#define AMBIENT_CLIP_STOP_TIMEOUT_MS 1000     // A download waits this long for the old clip to stop, then streams
+#endif
+#ifndef AMBIENT_CLIP_MAX_BLOCKS
+#define AMBIENT_CLIP_MAX_BLOCKS 8             // Blocks decoded per pump() (~170ms of audio)
+#endif
+
+#define AMBIENT_CLIP_BLOCK_SAMPLES 512
+#define AMBIENT_CLIP_BLOCK_BYTES   (IMA_ADPCM_HEADER_BYTES + AMBIENT_CLIP_BLOCK_SAMPLES / 2)
+
+// Binary frame header for clip download data (0xA5 0x5F is asset data)
+#define AMBIENT_CLIP_MAGIC0 0xA5
+#define AMBIENT_CLIP_MAGIC1 0x5E
+
+class AmbientClip {
+public:
+    // Allocate the store in PSRAM. Returns false if there is no room (downloads are then never requested).
+    bool begin();
+    bool ready() const { return data != nullptr; }
+
+    // ── Any task ──
+    // True if a complete download of `name` is resident
+    bool holds(const char* name) const;
+    // Loop the resident clip `loops` times (0 = until stopped). `tag` comes back from takeCompleted().
+    bool play(uint8_t loops, uint16_t tag);
+    void stop();
+    // True from play() until the clip ends or stop() is processed
+    bool active() const { return doneSeq.load(std::memory_order_acquire) != reqSeq.load(std::memory_order_acquire); }
+    // A finite play() ran to the end: returns its tag once
+    bool takeCompleted(uint16_t* tag);
+
+    // ── websocketTask (download) ──
+    // False (caller streams instead) if the clip does not fit or a clip is still playing
+    bool beginDownload(const char* name, uint16_t sequence, uint32_t samples, uint32_t bytes);
+    bool write(uint16_t sequence, const uint8_t* data, size_t len);
+    bool finishDownload(uint16_t sequence);
+    void abortDownload();
+    bool downloading() const { return writeActive; }
+    uint16_t downloadSequence() const { return writeSequence; }
+    uint32_t lastWriteMs() const { return writeLastMs; }
+
+    // ── speakerTask only ──
+    // Same contract as AssetPlayer::poll() / pump()
+    void poll(AudioRing& ring);
+    void pump(AudioRing& ring);
+
+private:
+    struct Command {
+        uint8_t  loops;
+        bool     play;                // false = stop
+        uint16_t tag;
+        uint32_t seq;
+    };
+
+    void finish();
+    bool pumpBlock(AudioRing& ring);
+
+    uint8_t* data = nullptr;          // IMA blocks, AMBIENT_CLIP_BLOCK_BYTES apart
+    int16_t* head = nullptr;          // first AMBIENT_CLIP_XFADE_SAMPLES, decoded (fade-in side of the seam)
+    int16_t* gain = nullptr;          // sin(π/2 · t), Q15; the fade-out side reads it backwards
+    char     name[24] = "";
+    volatile bool complete = false;   // data/samples/name describe a finished download
+    uint32_t samples = 0;
+    uint32_t xfade = 0;               // 0 for clips too short to crossfade
+
+    volatile bool writeActive = false;
+    uint16_t writeSequence = 0;
+    uint32_t writeSamples = 0;
+    uint32_t writeBytes = 0;
+    uint32_t writePos = 0;
+    volatile uint32_t writeLastMs = 0;
+
+    QueueHandle_t commands = nullptr;
+    std::atomic<uint32_t> reqSeq{0};
+    std::atomic<uint32_t> doneSeq{0};
+    std::atomic<int32_t>  completed{-1};
+
+    // Playback cursor (speakerTask)
+    bool     playing = false;
+    Command  cur = {0, false, 0, 0};
+    uint32_t block = 0;
+    uint32_t pass = 0;
+};
@@ -0,0 +1,380 @@
+#include "AssetCache.h"
+#include <esp_rom_crc.h>
+
+static constexpr uint32_t ASSET_MAGIC = 0x4341424A;   // "JBAC"
+static constexpr uint16_t ASSET_LAYOUT = 1;           // bump when AssetIndex changes shape
+static constexpr uint32_t ASSET_SECTOR = 4096;
+
+static uint32_t sectorAlign(uint32_t x) { return (x + ASSET_SECTOR - 1) & ~(ASSET_SECTOR - 1); }
+
+bool AssetCache::begin() {
+    mutex = xSemaphoreCreateMutex();
+    if (!mutex) return false;
+    memset(&index, 0, sizeof(index));
+    part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, ASSET_PARTITION_LABEL);
+    if (!part) {
+        Serial.println("[ASSETS] No \"" ASSET_PARTITION_LABEL "\" partition - using server for all sounds");
+        return false;
+    }
+    if (!loadIndex()) {
+        Serial.println("[ASSETS] Index missing or invalid - starting empty");
+        memset(&index, 0, sizeof(index));
+        return true;
+    }
+    // Drop anything whose data no longer matches its CRC (interrupted erase, flash wear)
+    bool changed = false;
+    for (int i = index.count - 1; i >= 0; i--) {
+        if (!verify(index.entries[i])) {
+            Serial.printf("[ASSETS] %s: CRC mismatch - dropped\n", index.entries[i].name);
+            removeEntry(i);
+            changed = true;
+        }
+    }
+    if (changed) saveIndex();
+    for (int i = 0; i < index.count; i++) {
+        const AssetEntry& e = index.entries[i];
+        Serial.printf("[ASSETS] %s v%u: %u bytes\n", e.name, e.version, e.size);
+    }
+    return true;
+}
+
+bool AssetCache::loadIndex() {
+    if (esp_partition_read(part, 0, &index, sizeof(index)) != ESP_OK) return false;
+    if (index.magic != ASSET_MAGIC || index.layout != ASSET_LAYOUT || index.count > ASSET_MAX_ENTRIES) return false;
+    return esp_rom_crc32_le(0, (const uint8_t*)&index, offsetof(AssetIndex, crc)) == index.crc;
+}
+
+bool AssetCache::saveIndex() {
+    index.magic = ASSET_MAGIC;
+    index.layout = ASSET_LAYOUT;
+    index.crc = esp_rom_crc32_le(0, (const uint8_t*)&index, offsetof(AssetIndex, crc));
+    if (esp_partition_erase_range(part, 0, ASSET_SECTOR) != ESP_OK) return false;
+    return esp_partition_write(part, 0, &index, sizeof(index)) == ESP_OK;
+}
+
+uint32_t AssetCache::dataCrc(uint32_t offset, uint32_t size) {
+    uint8_t buf[512];
+    uint32_t crc = 0;
+    while (size > 0) {
+        uint32_t n = size < sizeof(buf) ? size : sizeof(buf);
+        if (esp_partition_read(part, offset, buf, n) != ESP_OK) return ~crc;   // guaranteed mismatch
+        crc = esp_rom_crc32_le(crc, buf, n);
+        offset += n;
+        size -= n;
+    }
+    return crc;
+}
+
+bool AssetCache::verify(const AssetEntry& e) {
+    if (e.offset < ASSET_SECTOR || e.offset + e.size > part->size) return false;
+    return dataCrc(e.offset, e.size) == e.crc;
+}
+
+int AssetCache::findEntry(const char* name) {
+    for (int i = 0; i < index.count; i++) {
+        if (strncmp(index.entries[i].name, name, ASSET_NAME_LEN) == 0) return i;
+    }
+    return -1;
+}
+
+void AssetCache::removeEntry(int i) {
+    for (int j = i; j < index.count - 1; j++) {
+        index.entries[j] = index.entries[j + 1];
+    }
+    index.count--;
+}
+
+bool AssetCache::lookup(const char* name, AssetEntry* out) {
+    if (!part || xSemaphoreTake(mutex, pdMS_TO_TICKS(100)) != pdTRUE) return false;
+    int i = findEntry(name);
+    if (i >= 0) *out = index.entries[i];
+    xSemaphoreGive(mutex);
+    return i >= 0;
+}
+
+void AssetCache::offer(const char* name, uint32_t version, uint32_t size, uint32_t crc) {
+    if (!part || xSemaphoreTake(mutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
+    int i = findEntry(name);
+    bool current = i >= 0 && index.entries[i].version == version && index.entries[i].crc == crc;
+    bool queued = false;
+    for (int p = 0; p < pendingCount; p++) {
+        if (strncmp(pending[p], name, ASSET_NAME_LEN) == 0) queued = true;
+    }
+    if (current) {
+        Serial.printf("[ASSETS] %s v%u up to date\n", name, version);
+    } else if (size > part->size - ASSET_SECTOR) {
+        Serial.printf("[ASSETS] %s: %u bytes exceeds cache capacity - server only\n", name, size);
+    } else if (!queued && pendingCount < ASSET_MAX_ENTRIES) {
+        strlcpy(pending[pendingCount++], name, ASSET_NAME_LEN);
+        Serial.printf("[ASSETS] %s v%u queued for download (%u bytes)\n", name, version, size);
+    }
+    xSemaphoreGive(mutex);
+}
+
+bool AssetCache::nextDownload(char* name) {
+    if (!part || xSemaphoreTake(mutex, pdMS_TO_TICKS(100)) != pdTRUE) return false;
+    bool have = pendingCount > 0;
+    if (have) {
+        strlcpy(name, pending[0], ASSET_NAME_LEN);
+        for (int p = 0; p < pendingCount - 1; p++) {
+            memcpy(pending[p], pending[p + 1], ASSET_NAME_LEN);
+        }
+        pendingCount--;
+    }
+    xSemaphoreGive(mutex);
+    return have;
+}
+
+bool AssetCache::read(uint32_t offset, void* dst, size_t len) {
+    return part && esp_partition_read(part, offset, dst, len) == ESP_OK;
+}
+
+// ── Download ────────────────────────────────────────────────────────────────
+
+bool AssetCache::beginWrite(const char* name, uint32_t version, uint32_t size, uint32_t crc) {
+    if (!part) return false;
+    if (writeActive) abortWrite();
+    if (size == 0 || size > part->size - ASSET_SECTOR) return false;
+    if (xSemaphoreTake(mutex, pdMS_TO_TICKS(100)) != pdTRUE) return false;
+
+    // The old copy is unindexed before its replacement is written anywhere
+    int old = findEntry(name);
+    if (old >= 0) removeEntry(old);
+
+    // Append after the last entry; when the tail is full, evict everything and
+    // start again from the first data sector (the manifest re-offers the rest)
+    uint32_t end = ASSET_SECTOR;
+    for (int i = 0; i < index.count; i++) {
+        end = max(end, sectorAlign(index.entries[i].offset + index.entries[i].size));
+    }
+    if (end + size > part->size || index.count >= ASSET_MAX_ENTRIES) {
+        Serial.printf("[ASSETS] Cache full - evicting %u entries\n", index.count);
+        index.count = 0;
+        end = ASSET_SECTOR;
+    }
+    bool ok = saveIndex();
+    xSemaphoreGive(mutex);
+    if (!ok) return false;
+
+    memset(&writeEntry, 0, sizeof(writeEntry));
+    strlcpy(writeEntry.name, name, ASSET_NAME_LEN);
+    writeEntry.version = version;
+    writeEntry.offset = end;
+    writeEntry.size = size;
+    writeEntry.crc = crc;
+    writePos = 0;
+    erasedTo = end;
+    writeLastMs = millis();
+    writeActive = true;
+    Serial.printf("[ASSETS] Downloading %s v%u (%u bytes) to 0x%06x\n", name, version, size, end);
+    return true;
+}
+
+bool AssetCache::write(const uint8_t* data, size_t len) {
+    if (!writeActive) return false;
+    if (writePos + len > writeEntry.size) {
+        Serial.printf("[ASSETS] %s: more data than announced - aborting\n", writeEntry.name);
+        abortWrite();
+        return false;
+    }
+    uint32_t at = writeEntry.offset + writePos;
+    // Erase only the sectors this chunk reaches, so the cost is spread across the download
+    uint32_t need = sectorAlign(at + len);
+    if (need > erasedTo) {
+        if (esp_partition_erase_range(part, erasedTo, need - erasedTo) != ESP_OK) {
+            abortWrite();
+            return false;
+        }
+        erasedTo = need;
+    }
+    if (esp_partition_write(part, at, data, len) != ESP_OK) {
+        abortWrite();
+        return false;
+    }
+    writePos += len;
+    writeLastMs = millis();
+    return true;
+}
+
+bool AssetCache::finishWrite() {
+    if (!writeActive) return false;
+    writeActive = false;
+    if (writePos != writeEntry.size) {
+        Serial.printf("[ASSETS] %s: short download (%u/%u bytes)\n", writeEntry.name, writePos, writeEntry.size);
+        return false;
+    }
+    if (!verify(writeEntry)) {
+        Serial.printf("[ASSETS] %s: CRC mismatch after download\n", writeEntry.name);
+        return false;
+    }
+    if (xSemaphoreTake(mutex, pdMS_TO_TICKS(100)) != pdTRUE) return false;
+    index.entries[index.count++] = writeEntry;
+    bool ok = saveIndex();
+    xSemaphoreGive(mutex);
+    Serial.printf("[ASSETS] %s v%u cached (%u bytes)%s\n", writeEntry.name, writeEntry.version,
+                  writeEntry.size, ok ? "" : " - index write FAILED");
+    return ok;
+}
+
+void AssetCache::abortWrite() {
+    if (!writeActive) return;
+    writeActive = false;
+    Serial.printf("[ASSETS] %s: download aborted at %u/%u bytes\n", writeEntry.name, writePos, writeEntry.size);
+}
+
+// ============== ASSET PLAYER ==============
+
+bool AssetPlayer::begin(AssetCache* source) {
+    cache = source;
+    commands = xQueueCreate(4, sizeof(Command));
+    return commands != nullptr;
+}
+
+bool AssetPlayer::start(const AssetEntry& e, bool loop) {
+    if (!commands) return false;
+    Command c = { e.offset, e.size & ~1u, loop, 0, false, 0, 0 };
+    if (c.size == 0) return false;
+
+    // QOA asset? Validate both headers here so a bad entry fails the caller, not the speaker
+    uint8_t head[ASSET_QOA_HEADER_BYTES + QOA_FILE_HEADER_BYTES];
+    uint32_t magic = 0;
+    if (e.size >= sizeof(head) + QOA_FRAME_HEADER_BYTES) {
+        if (!cache->read(e.offset, head, sizeof(head))) return false;
+        memcpy(&magic, head, 4);
+    }
+    if (magic == ASSET_QOA_MAGIC) {
+        uint32_t total = qoaReadFileHeader(head + ASSET_QOA_HEADER_BYTES);
+        memcpy(&c.loopStart, head + 4, 4);
+        memcpy(&c.loopEnd, head + 8, 4);
+        if (c.loopEnd == 0 || c.loopEnd > total) c.loopEnd = total;
+        if (total == 0 || c.loopStart >= c.loopEnd) {
+            Serial.printf("[ASSETS] %s: bad QOA header\n", e.name);
+            return false;
+        }
+        c.qoa = true;
+        c.size = e.size;
+    }
+
+    c.seq = reqSeq.fetch_add(1, std::memory_order_acq_rel) + 1;
+    if (xQueueSend(commands, &c, 0) != pdTRUE) {
+        doneSeq.store(c.seq, std::memory_order_release);   // never runs
+        return false;
+    }
+    return true;
+}
+
+void AssetPlayer::stop() {
+    if (!commands) return;
+    Command c = { 0, 0, false, reqSeq.fetch_add(1, std::memory_order_acq_rel) + 1, false, 0, 0 };
+    if (xQueueSend(commands, &c, 0) != pdTRUE) {
+        // Queue full of starts: the newest command wins anyway, so clear and retry
+        xQueueReset(commands);
+        xQueueSend(commands, &c, 0);
+    }
+}
+
+void AssetPlayer::finish() {
+    cur.size = 0;
+    doneSeq.store(cur.seq, std::memory_order_release);
+}
+
+void AssetPlayer::poll(AudioRing& ring) {
+    Command c;
+    while (commands && xQueueReceive(commands, &c, 0) == pdTRUE) {
+        if (cur.size) {
+            // Stopped or replaced mid-clip: drop what is already queued in the ring too
+            ring.flush();
+        }
+        cur = c;
+        pos = 0;
+        if (c.size == 0) {
+            doneSeq.store(c.seq, std::memory_order_release);
+        } else if (c.qoa && !seekQoa(0)) {
+            finish();
+        }
+    }
+}
+
+void AssetPlayer::pump(AudioRing& ring) {
+    poll(ring);
+    if (cur.size == 0) return;
+
+    for (int i = 0; i < ASSET_PLAY_MAX_CHUNKS; i++) {
+        if (!(cur.qoa ? pumpQoa(ring) : pumpPcm(ring))) return;
+    }
+}
+
+// One ring frame of PCM. False when the ring is full or the clip has ended.
+bool AssetPlayer::pumpPcm(AudioRing& ring) {
+    if (pos >= cur.size) {
+        if (!cur.loop) {
+            finish();
+            return false;
+        }
+        pos = 0;
+    }
+    size_t n = min((uint32_t)ASSET_PLAY_CHUNK, cur.size - pos);
+    uint8_t* dst = ring.reserve(n);
+    if (!dst) return false;   // ring full - next wakeup
+    if (!cache->read(cur.offset + pos, dst, n)) {
+        memset(dst, 0, n);
+        pos = cur.size;
+        cur.loop = false;
+    } else {
+        pos += n;
+    }
+    ring.commit(n);
+    return true;
+}
+
+// Position the QOA cursor at `sample`: read that frame's header and LMS state,
+// then drop the samples before it within the frame as they are decoded.
+bool AssetPlayer::seekQoa(uint32_t sample) {
+    uint32_t frame = sample / QOA_FRAME_LEN;
+    uint32_t at = cur.offset + ASSET_QOA_HEADER_BYTES + QOA_FILE_HEADER_BYTES + frame * QOA_MONO_FRAME_BYTES;
+    uint8_t header[QOA_FRAME_HEADER_BYTES];
+    if (at + sizeof(header) > cur.offset + cur.size || !cache->read(at, header, sizeof(header))) return false;
+    frameLeft = qoaReadFrameHeader(header, 24000, &lms);
+    if (frameLeft == 0) return false;
+    pos = at + sizeof(header);
+    samplePos = frame * QOA_FRAME_LEN;
+    skip = sample - samplePos;
+    return true;
+}
+
+// One ring frame of decoded QOA. False when the ring is full or the clip has ended.
+bool AssetPlayer::pumpQoa(AudioRing& ring) {
+    if (samplePos >= cur.loopEnd) {
+        if (!cur.loop || !seekQoa(cur.loopStart)) {
+            finish();
+            return false;
+        }
+    }
+    if (frameLeft == 0 && !seekQoa(samplePos)) {   // next frame (frame-aligned, so no skip)
+        finish();
+        return false;
+    }
+
+    int slices = min(ASSET_QOA_SLICES, (frameLeft + QOA_SLICE_LEN - 1) / QOA_SLICE_LEN);
+    uint8_t* dst = ring.reserve(slices * QOA_SLICE_LEN * sizeof(int16_t));
+    if (!dst) return false;   // ring full - next wakeup
+    if (!cache->read(pos, sliceBuf, slices * QOA_SLICE_BYTES)) {
+        ring.commit(0);
+        finish();
+        return false;
+    }
+    int16_t* out = (int16_t*)dst;
+    qoaDecodeSlices(&lms, sliceBuf, slices, out);
+    pos += slices * QOA_SLICE_BYTES;
+
+    // Trim the last slice's padding, anything past the loop end, and a pending seek skip
+    int n = min(slices * QOA_SLICE_LEN, frameLeft);
+    n = (int)min((uint32_t)n, cur.loopEnd - samplePos);
+    frameLeft -= min(slices * QOA_SLICE_LEN, frameLeft);
+    samplePos += n;
+    int drop = (int)min(skip, (uint32_t)n);
+    skip -= drop;
+    if (drop > 0) memmove(out, out + drop, (n - drop) * sizeof(int16_t));
+    ring.commit((n - drop) * sizeof(int16_t));
+    return true;
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <esp_partition.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include "AudioRing.h"
+#include "AudioCodec.h"
+
+// ============== ASSET CACHE ==============
+//
+// Local copies of sounds the server streams on request: the alarm, the
+// Pomodoro zen bell and the ambient soundscapes (rain, ocean, rainforest,
+// fire), all as QOA. A cached sound plays
+// from flash. It then starts at once, costs no downlink, and still works
+// with the WebSocket down. If it is not cached, the old server request is
+// used as the fallback.
+//
+// STORAGE: "assets" data partition (partitions_4MB.csv). Sector 0 holds the
+// index; asset data follows, each entry starting on a sector boundary:
+//
+//   AssetIndex { magic, layout, count, entries[ASSET_MAX_ENTRIES], crc }
+//   AssetEntry { name, version, offset, size, crc }
+//
+// Every entry's data is checked against its CRC-32 at boot and after each
+// download. A bad entry is dropped from the index and fetched again. If the
+// index itself is bad (wrong magic, layout or CRC, e.g. power lost while it
+// was being rewritten), the whole cache starts out empty.
+//
+// FILLING: on connect the server pushes an assetManifest {name, version, size,
+// crc}. Each asset that is missing or stale is requested one at a time (loop()
+// waits until the device is idle). The server answers with assetBegin, a
+// series of binary frames with the A5 5F header, and assetEnd. Sectors are
+// erased lazily as the write cursor reaches them. Nothing is recorded in the
+// index until the CRC of the written data matches.
+//
+// PLAYBACK: AssetPlayer reads the entry straight from flash into a mixer ring
+// in speakerTask. No RAM copy of the asset is kept.
+//
+// FORMATS: an entry is either raw 24kHz mono 16-bit PCM or a QOA asset (~5:1,
+// packed offline by tools/qoapack.cpp; every sound the server offers now):
+//
+//   "JBQ1" | loopStart | loopEnd | reserved   (uint32 LE, samples; loopEnd 0 = end)
+//   standard mono 24kHz QOA file
+//
+// A looping QOA asset plays from 0 to loopEnd, then seeks to loopStart, so a
+// soundscape can have an intro that is not repeated.
+//
+// SIZE: the six sounds take 1.19 MB of the 1.31 MB partition (each entry
+// rounded up to a sector, plus the index), leaving 128 KB for the "kws"
+// model; app0 gets the rest of the 4 MB flash. Raw PCM would need 0.51 MB
+// more for the alarm and bell alone.
+//
+// The "kws" entry is not a sound: it is the wake-word model, loaded into RAM
+// by audioTask (KeywordSpotter.h).
+//
+// ==========================================
+
+#ifndef ASSET_PARTITION_LABEL
+#define ASSET_PARTITION_LABEL "assets"
+#endif
+#ifndef ASSET_MAX_ENTRIES
+#define ASSET_MAX_ENTRIES 8
+#endif
+#ifndef ASSET_NAME_LEN
+#define ASSET_NAME_LEN 16
+#endif
+#ifndef ASSET_DOWNLOAD_TIMEOUT_MS
+#define ASSET_DOWNLOAD_TIMEOUT_MS 10000   // Abort a download after this long without data
+#endif
+#ifndef ASSET_PLAY_CHUNK
+#define ASSET_PLAY_CHUNK 2048             // Bytes per ring frame (≤ AUDIO_RING_MAX_FRAME)
+#endif
+#ifndef ASSET_PLAY_MAX_CHUNKS
+#define ASSET_PLAY_MAX_CHUNKS 4           // Flash reads per pump() (~170ms of audio)
+#endif
+#ifndef ASSET_QOA_SLICES
+#define ASSET_QOA_SLICES 48               // QOA slices decoded per ring frame (960 samples, 384 B of flash)
+#endif
+
+#define ASSET_QOA_MAGIC        0x3151424A // "JBQ1"
+#define ASSET_QOA_HEADER_BYTES 16
+
+// Binary frame header for asset download data (0xA5 0x5A is ambient audio)
+#define ASSET_CHUNK_MAGIC0 0xA5
+#define ASSET_CHUNK_MAGIC1 0x5F
+
+struct AssetEntry {
+    char     name[ASSET_NAME_LEN];
+    uint32_t version;                 // server-assigned (file mtime)
+    uint32_t offset;                  // from partition start, sector aligned
+    uint32_t size;                    // bytes of PCM or QOA asset data (see FORMATS)
+    uint32_t crc;                     // CRC-32 (zlib polynomial) of the data
+};
+
+class AssetCache {
+public:
+    // Find the partition, load the index and verify every entry. Returns false
+    // if the partition is missing (the cache then stays empty and unused).
+    bool begin();
+    bool ready() const { return part != nullptr; }
+
+    // ── Any task ──
+    // Copy a valid entry. Returns false if the asset is not cached.
+    bool lookup(const char* name, AssetEntry* out);
+    // Queue a download if the cached copy is missing or differs from the manifest.
+    void offer(const char* name, uint32_t version, uint32_t size, uint32_t crc);
+    // Next asset to request from the server (removed from the queue). False if none.
+    bool nextDownload(char* name);
+    bool read(uint32_t offset, void* dst, size_t len);
+
+    // ── websocketTask (download) ──
+    bool beginWrite(const char* name, uint32_t version, uint32_t size, uint32_t crc);
+    bool write(const uint8_t* data, size_t len);
+    bool finishWrite();
+    void abortWrite();
+    bool writing() const { return writeActive; }
+    uint32_t lastWriteMs() const { return writeLastMs; }
+
+private:
+    struct AssetIndex {
+        uint32_t   magic;
+        uint16_t   layout;
+        uint16_t   count;
+        AssetEntry entries[ASSET_MAX_ENTRIES];
+        uint32_t   crc;               // over everything above
+    };
+
+    bool     loadIndex();
+    bool     saveIndex();
+    bool     verify(const AssetEntry& e);
+    uint32_t dataCrc(uint32_t offset, uint32_t size);
+    int      findEntry(const char* name);
+    void     removeEntry(int i);
+
+    const esp_partition_t* part = nullptr;
+    SemaphoreHandle_t mutex = nullptr;
+    AssetIndex index;
+
+    char     pending[ASSET_MAX_ENTRIES][ASSET_NAME_LEN];
+    uint8_t  pendingCount = 0;
+
+    volatile bool writeActive = false;
+    AssetEntry writeEntry;
+    uint32_t writePos = 0;
+    uint32_t erasedTo = 0;            // partition offset erased so far for this download
+    volatile uint32_t writeLastMs = 0;
+};
+
+// ============== ASSET PLAYER ==============
+//
+// Streams a cached asset into a mixer ring. start() / stop() post a command
+// and return at once. pump() runs in speakerTask, the ring's consumer, before
+// each render. So while a clip plays, speakerTask is also the ring's single
+// producer, and the WebSocket handler must not write to the same voice
+// (see the routing in webSocketEvent). One player per voice: assetPlayer
+// (MIX_ALARM) and ambientPlayer (MIX_AMBIENT).
+//
+// QOA assets are decoded ASSET_QOA_SLICES at a time straight into the
+// reserved ring frame; the only working set is one 384-byte slice buffer.
+//
+// ==========================================
+
+class AssetPlayer {
+public:
+    bool begin(AssetCache* source);
+
+    // ── Any task ──
+    bool start(const AssetEntry& e, bool loop);
+    void stop();
+    // True from start() until the clip ends or stop() is processed
+    bool active() const { return doneSeq.load(std::memory_order_acquire) != reqSeq.load(std::memory_order_acquire); }
+
+    // ── speakerTask only ──
+    // Apply pending start/stop commands (a replaced or stopped clip flushes the ring)
+    void poll(AudioRing& ring);
+    // poll(), then refill the ring
+    void pump(AudioRing& ring);
+
+private:
+    struct Command {
+        uint32_t offset;
+        uint32_t size;                // 0 = stop
+        bool     loop;
+        uint32_t seq;
+        bool     qoa;
+        uint32_t loopStart;           // QOA only, samples
+        uint32_t loopEnd;             // QOA only, samples (exclusive)
+    };
+
+    void finish();
+    bool pumpPcm(AudioRing& ring);
+    bool pumpQoa(AudioRing& ring);
+    bool seekQoa(uint32_t sample);
+
+    AssetCache* cache = nullptr;
+    QueueHandle_t commands = nullptr;
+    std::atomic<uint32_t> reqSeq{0};
+    std::atomic<uint32_t> doneSeq{0};
+    Command  cur = {0, 0, false, 0, false, 0, 0};
+    uint32_t pos = 0;                 // PCM: byte offset; QOA: flash offset of the next slice
+
+    // QOA decode cursor (speakerTask)
+    QoaLms   lms;
+    uint32_t samplePos = 0;           // next sample to decode
+    int      frameLeft = 0;           // samples left in the current frame
+    uint32_t skip = 0;                // decoded samples to drop after a mid-frame seek
+    uint8_t  sliceBuf[ASSET_QOA_SLICES * QOA_SLICE_BYTES];
+};
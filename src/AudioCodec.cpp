@@ -0,0 +1,179 @@
+#include "AudioCodec.h"
+
+static const int16_t IMA_STEP_TABLE[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767
+};
+
+static const int8_t IMA_INDEX_TABLE[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+static inline int16_t imaExpand(uint8_t nibble, int32_t& predictor, int32_t& index) {
+    int32_t step = IMA_STEP_TABLE[index];
+    int32_t diff = step >> 3;
+    if (nibble & 4) diff += step;
+    if (nibble & 2) diff += step >> 1;
+    if (nibble & 1) diff += step >> 2;
+    predictor += (nibble & 8) ? -diff : diff;
+    if (predictor > 32767) predictor = 32767;
+    else if (predictor < -32768) predictor = -32768;
+    index += IMA_INDEX_TABLE[nibble];
+    if (index < 0) index = 0;
+    else if (index > 88) index = 88;
+    return (int16_t)predictor;
+}
+
+int imaAdpcmDecodeBlock(const uint8_t* in, size_t len, int16_t* out, size_t outMax) {
+    if (len < IMA_ADPCM_HEADER_BYTES) return -1;
+    int32_t predictor = (int16_t)(in[0] | (in[1] << 8));
+    int32_t index = in[2];
+    if (index > 88) return -1;
+    const uint8_t* nibbles = in + IMA_ADPCM_HEADER_BYTES;
+    size_t bytes = len - IMA_ADPCM_HEADER_BYTES;
+    if (bytes * 2 > outMax) return -1;
+
+    for (size_t i = 0; i < bytes; i++) {
+        uint8_t b = nibbles[i];
+        *out++ = imaExpand(b & 0x0F, predictor, index);
+        *out++ = imaExpand(b >> 4, predictor, index);
+    }
+    return (int)(bytes * 2);
+}
+
+static inline uint8_t imaCompress(int32_t sample, int32_t& predictor, int32_t& index) {
+    int32_t step = IMA_STEP_TABLE[index];
+    int32_t diff = sample - predictor;
+    uint8_t nibble = 0;
+    if (diff < 0) { nibble = 8; diff = -diff; }
+    if (diff >= step) { nibble |= 4; diff -= step; }
+    if (diff >= step >> 1) { nibble |= 2; diff -= step >> 1; }
+    if (diff >= step >> 2) nibble |= 1;
+    imaExpand(nibble, predictor, index);   // track the decoder exactly
+    return nibble;
+}
+
+size_t imaAdpcmEncodeBlock(const int16_t* in, size_t n, ImaAdpcmState* st, uint8_t* out) {
+    int32_t predictor = st->predictor;
+    int32_t index = st->index;
+    out[0] = predictor & 0xFF;
+    out[1] = (predictor >> 8) & 0xFF;
+    out[2] = (uint8_t)index;
+    out[3] = 0;
+    uint8_t* nibbles = out + IMA_ADPCM_HEADER_BYTES;
+    size_t pairs = n / 2;
+    for (size_t i = 0; i < pairs; i++) {
+        uint8_t lo = imaCompress(in[2 * i], predictor, index);
+        uint8_t hi = imaCompress(in[2 * i + 1], predictor, index);
+        nibbles[i] = lo | (hi << 4);
+    }
+    if (n & 1) {
+        uint8_t lo = imaCompress(in[n - 1], predictor, index);
+        nibbles[pairs++] = lo | (imaCompress(0, predictor, index) << 4);
+    }
+    st->predictor = predictor;
+    st->index = index;
+    return IMA_ADPCM_HEADER_BYTES + pairs;
+}
+
+// ── G.711 μ-law ──────────────────────────────────────────────────────────────
+
+void mulawEncode(const int16_t* in, size_t n, uint8_t* out) {
+    for (size_t i = 0; i < n; i++) {
+        int32_t x = in[i];
+        uint8_t sign = 0;
+        if (x < 0) { sign = 0x80; x = -x; }
+        if (x > 32635) x = 32635;
+        x += 0x84;                                        // bias: every segment starts on a power of two
+        int32_t exponent = (31 - __builtin_clz(x)) - 7;   // x >= 0x84, so 0..7
+        int32_t mantissa = (x >> (exponent + 3)) & 0x0F;
+        out[i] = ~(sign | (exponent << 4) | mantissa);
+    }
+}
+
+// ── QOA ──────────────────────────────────────────────────────────────────────
+
+// round(scalefactor × {0.75, -0.75, 2.5, -2.5, 4.5, -4.5, 7, -7}), scalefactor = round((s + 1)^2.75)
+static const int16_t QOA_DEQUANT_TABLE[16][8] = {
+    {1, -1, 3, -3, 5, -5, 7, -7},
+    {5, -5, 18, -18, 32, -32, 49, -49},
+    {16, -16, 53, -53, 95, -95, 147, -147},
+    {34, -34, 113, -113, 203, -203, 315, -315},
+    {63, -63, 210, -210, 378, -378, 588, -588},
+    {104, -104, 345, -345, 621, -621, 966, -966},
+    {158, -158, 528, -528, 950, -950, 1477, -1477},
+    {228, -228, 760, -760, 1368, -1368, 2128, -2128},
+    {316, -316, 1053, -1053, 1895, -1895, 2947, -2947},
+    {422, -422, 1405, -1405, 2529, -2529, 3934, -3934},
+    {548, -548, 1828, -1828, 3290, -3290, 5117, -5117},
+    {696, -696, 2320, -2320, 4176, -4176, 6496, -6496},
+    {868, -868, 2893, -2893, 5207, -5207, 8099, -8099},
+    {1064, -1064, 3548, -3548, 6386, -6386, 9933, -9933},
+    {1286, -1286, 4288, -4288, 7718, -7718, 12005, -12005},
+    {1536, -1536, 5120, -5120, 9216, -9216, 14336, -14336}
+};
+
+static inline uint64_t readBE64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) v = (v << 8) | p[i];
+    return v;
+}
+
+uint32_t qoaReadFileHeader(const uint8_t* in) {
+    uint64_t h = readBE64(in);
+    if ((uint32_t)(h >> 32) != 0x716f6166) return 0;   // "qoaf"
+    return (uint32_t)h;
+}
+
+int qoaReadFrameHeader(const uint8_t* in, uint32_t sampleRate, QoaLms* lms) {
+    uint64_t h = readBE64(in);
+    uint32_t channels = (uint32_t)(h >> 56);
+    uint32_t rate     = (uint32_t)(h >> 32) & 0xFFFFFF;
+    uint32_t samples  = (uint32_t)(h >> 16) & 0xFFFF;
+    if (channels != 1 || rate != sampleRate || samples == 0 || samples > QOA_FRAME_LEN) return 0;
+    uint64_t history = readBE64(in + 8);
+    uint64_t weights = readBE64(in + 16);
+    for (int i = 0; i < 4; i++) {
+        lms->history[i] = (int16_t)(history >> 48);
+        lms->weights[i] = (int16_t)(weights >> 48);
+        history <<= 16;
+        weights <<= 16;
+    }
+    return (int)samples;
+}
+
+void qoaDecodeSlices(QoaLms* lms, const uint8_t* in, int slices, int16_t* out) {
+    int32_t* h = lms->history;
+    int32_t* w = lms->weights;
+    for (int s = 0; s < slices; s++) {
+        uint64_t slice = readBE64(in + s * QOA_SLICE_BYTES);
+        const int16_t* dequant = QOA_DEQUANT_TABLE[slice >> 60];
+        slice <<= 4;
+        for (int i = 0; i < QOA_SLICE_LEN; i++) {
+            int32_t predicted = (w[0] * h[0] + w[1] * h[1] + w[2] * h[2] + w[3] * h[3]) >> 13;
+            int32_t residual = dequant[slice >> 61];
+            int32_t sample = predicted + residual;
+            if (sample > 32767) sample = 32767;
+            else if (sample < -32768) sample = -32768;
+            *out++ = (int16_t)sample;
+            slice <<= 3;
+
+            // Sign-LMS weight update, then shift the history
+            int32_t delta = residual >> 4;
+            w[0] += h[0] < 0 ? -delta : delta;
+            w[1] += h[1] < 0 ? -delta : delta;
+            w[2] += h[2] < 0 ? -delta : delta;
+            w[3] += h[3] < 0 ? -delta : delta;
+            h[0] = h[1];
+            h[1] = h[2];
+            h[2] = h[3];
+            h[3] = sample;
+        }
+    }
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <Arduino.h>
+
+// ============== AUDIO CODEC ==============
+//
+// Compressed downlink for ambient / radio / meditation streams and Gemini
+// speech. The original packets (A5 5A seq_lo seq_hi + raw PCM, headerless
+// PCM for speech) are still accepted. Coded packets carry a codec byte:
+//
+//   A5 5B seq_lo seq_hi codec 00 | payload      ambient / radio
+//   A5 5C codec flags | payload                 Gemini speech
+//
+// The device lists its codecs in a "capabilities" message when the server
+// sends "ready" ("codecs" for ambient, "voiceCodecs" for speech). The server
+// uses a codec only if the device listed it, so older firmware keeps
+// receiving plain PCM.
+//
+// IMA-ADPCM payload, one self-contained block per packet (~3.9:1):
+//
+//   predictor (int16 LE) | step index (uint8) | 00 | nibbles, low nibble first
+//
+// Speech blocks are whole 40ms frames except the last of a turn, which the
+// server sends just before turnComplete (after an interrupt it is never sent).
+// VOICE_FLAG_PAD marks a block whose sample count was odd: its last nibble is
+// padding and is not played, so a turn plays exactly the samples Gemini sent.
+//
+// The header holds the decoder state before the first nibble. Every packet
+// therefore decodes on its own, and a dropped or stale-sequence packet never
+// desynchronises the next one. Decoding is integer-only and bit-exact with
+// the reference IMA algorithm (same step/index tables and rounding).
+//
+// MP3 (codec 2, radio only) is the station's own bitstream, split at
+// arbitrary byte boundaries. It is not self-contained per packet; see
+// Mp3Stream.h.
+//
+// The mic uplink (MicUplink.h) uses the same codec numbers. It adds G.711
+// μ-law (codec 3): one byte per sample, 2:1, stateless. The uplink encodes
+// IMA-ADPCM with the block layout above, one block per mic frame.
+//
+// =========================================
+
+#define AMBIENT_MAGIC_PCM    0x5A     // A5 5A: 4-byte header, raw PCM
+#define AMBIENT_MAGIC_CODEC  0x5B     // A5 5B: 6-byte header with codec byte
+#define VOICE_MAGIC_CODEC    0x5C     // A5 5C: 4-byte header with codec and flags bytes
+#define VOICE_FLAG_PAD       0x01     // A5 5C flags: drop the block's last decoded sample
+
+enum StreamCodec : uint8_t {
+    CODEC_PCM16     = 0,
+    CODEC_IMA_ADPCM = 1,
+    CODEC_MP3       = 2,   // Radio relay only, decoded by Mp3Stream
+    CODEC_MULAW     = 3,   // Mic uplink only (G.711 μ-law)
+};
+
+#define IMA_ADPCM_HEADER_BYTES 4
+
+// Decode one IMA-ADPCM block into out (mono 16-bit). Returns samples written,
+// or -1 if the block is malformed or would exceed outMax.
+int imaAdpcmDecodeBlock(const uint8_t* in, size_t len, int16_t* out, size_t outMax);
+
+struct ImaAdpcmState {
+    int32_t predictor;
+    int32_t index;
+};
+
+// Encode n samples into one block (an odd tail is padded with silence) and
+// advance st, so consecutive blocks stay continuous. Returns bytes written:
+// IMA_ADPCM_HEADER_BYTES + (n + 1) / 2.
+size_t imaAdpcmEncodeBlock(const int16_t* in, size_t n, ImaAdpcmState* st, uint8_t* out);
+
+// G.711 μ-law, one byte per sample
+void mulawEncode(const int16_t* in, size_t n, uint8_t* out);
+
+// ── QOA ("Quite OK Audio", qoaformat.org) ──
+//
+// Fixed 3.2 bits/sample (5:1 against 16-bit PCM), used for the soundscape
+// assets cached in flash. A file is an 8-byte header ("qoaf", total samples,
+// big-endian) followed by frames of up to 256 slices × 20 samples. Each frame
+// starts with its own LMS predictor state. Decoding can therefore begin at any
+// frame, and a loop point costs one frame-header read instead of decoding
+// from the start. Mono frames are a fixed size, except the last one.
+
+#define QOA_FILE_HEADER_BYTES   8
+#define QOA_FRAME_HEADER_BYTES  24    // mono: frame header (8) + LMS history/weights (16)
+#define QOA_SLICE_LEN           20
+#define QOA_SLICE_BYTES         8
+#define QOA_SLICES_PER_FRAME    256
+#define QOA_FRAME_LEN           (QOA_SLICES_PER_FRAME * QOA_SLICE_LEN)
+#define QOA_MONO_FRAME_BYTES    (QOA_FRAME_HEADER_BYTES + QOA_SLICES_PER_FRAME * QOA_SLICE_BYTES)
+
+struct QoaLms {
+    int32_t history[4];
+    int32_t weights[4];
+};
+
+// Total samples from a file header, or 0 if it is not a QOA file.
+uint32_t qoaReadFileHeader(const uint8_t* in);
+// Parse a mono frame header into lms. Returns the frame's sample count, or 0
+// if the frame is not mono / not sampleRate.
+int qoaReadFrameHeader(const uint8_t* in, uint32_t sampleRate, QoaLms* lms);
+// Decode `slices` consecutive slices into slices × QOA_SLICE_LEN samples.
+void qoaDecodeSlices(QoaLms* lms, const uint8_t* in, int slices, int16_t* out);
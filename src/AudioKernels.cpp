@@ -0,0 +1,74 @@
+#include "AudioKernels.h"
+#include <math.h>
+
+#ifdef ARDUINO
+#include <esp_attr.h>
+#else
+#define IRAM_ATTR
+#endif
+
+// Kept in IRAM: runs for every downlink frame and must not stall on a flash cache miss
+IRAM_ATTR uint32_t monoToStereoQ14(const int16_t* in, int16_t* out, int n, int16_t gainQ14) {
+    uint32_t levelSum = 0;
+    uint32_t* outPairs = (uint32_t*)out;
+    const int32_t g = gainQ14;
+
+    for (int i = 0; i < n; i++) {
+        int32_t x = in[i];
+        levelSum += (uint32_t)(x < 0 ? -x : x);
+
+        int32_t y = (x * g + (1 << 13)) >> 14;
+        if (y > 32767) y = 32767;
+        else if (y < -32768) y = -32768;
+
+        // L and R are identical — one 32-bit store writes the stereo pair
+        uint32_t s = (uint16_t)y;
+        outPairs[i] = s | (s << 16);
+    }
+    return levelSum;
+}
+
+// Q15 twiddles of the largest transform, cos and sin(2πn / 2^FFT_MAX_BITS)
+static struct FftTwiddles {
+    int16_t cosT[(1 << FFT_MAX_BITS) / 2];
+    int16_t sinT[(1 << FFT_MAX_BITS) / 2];
+    FftTwiddles() {
+        for (int n = 0; n < (1 << FFT_MAX_BITS) / 2; n++) {
+            cosT[n] = (int16_t)lroundf(32767.0f * cosf(2.0f * (float)M_PI * n / (1 << FFT_MAX_BITS)));
+            sinT[n] = (int16_t)lroundf(32767.0f * sinf(2.0f * (float)M_PI * n / (1 << FFT_MAX_BITS)));
+        }
+    }
+} twiddles;
+
+void fftQ15(int32_t* re, int32_t* im, int bits, bool inverse, FftScale scale) {
+    const int n = 1 << bits;
+    for (int i = 1, j = 0; i < n; i++) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j |= bit;
+        if (i < j) {
+            int32_t t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+    const int shift = scale == FFT_UNSCALED ? 0 : 1;
+    const int32_t round = scale == FFT_HALVE_ROUND ? 1 : 0;
+    for (int size = 2; size <= n; size <<= 1) {
+        int half = size >> 1;
+        int step = (1 << FFT_MAX_BITS) / size;
+        for (int j = 0; j < half; j++) {
+            int64_t wr = twiddles.cosT[j * step];
+            int64_t wi = inverse ? twiddles.sinT[j * step] : -twiddles.sinT[j * step];
+            for (int a = j; a < n; a += size) {
+                int b = a + half;
+                int32_t tr = (int32_t)((re[b] * wr - im[b] * wi) >> 15);
+                int32_t ti = (int32_t)((re[b] * wi + im[b] * wr) >> 15);
+                int32_t ar = re[a], ai = im[a];
+                re[a] = (ar + tr + round) >> shift;
+                im[a] = (ai + ti + round) >> shift;
+                re[b] = (ar - tr + round) >> shift;
+                im[b] = (ai - ti + round) >> shift;
+            }
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ============== AUDIO KERNELS ==============
+//
+// Fixed-point inner loops shared by the playback and mic paths. Integer-only
+// so they never touch the FPU on CORE_1 (shared with websocketTask) and
+// produce identical output on target and host.
+//
+// Gain format is Q1.14 in an int16: 16384 = unity, 32767 ≈ 2.0 (the top of the
+// volume range). Products are rounded half-up and saturated to int16.
+//
+// Scalar on purpose. monoToStereoQ14 sees 24k samples/s, once per 512-frame
+// speaker block. Even at 20 cycles a sample (the [PLAYBACK] log's mix= figure
+// covers the whole render, this kernel included) that is 0.2% of CORE_1.
+// An ESP32-S3 PIE version
+// (ee.vmul.s16) would need 16-byte-aligned buffers and a tail loop, and its
+// rounding would have to be proven identical on hardware. That is not worth
+// it for that share of the core. tools/kernelbench.cpp checks the kernel
+// against its formula over every input and times it on the host.
+//
+// fftQ15 and log2Q8 are the one copy of the spectral kernels that the echo
+// canceller, noise suppressor, mic AGC and keyword spotter share. Each caller
+// picks the scaling its headroom needs; aeceval, nseval, agceval and kwseval
+// exercise them through their callers.
+//
+// ==========================================
+
+#define FFT_MAX_BITS 9          // 512 points, the largest transform (NS_FFT, KWS_WINDOW)
+
+// Per-stage scaling of fftQ15
+enum FftScale : uint8_t {
+    FFT_UNSCALED,               // grows up to 2^bits: the caller keeps the int32 headroom
+    FFT_HALVE,                  // x >> 1 every stage (total 2^-bits), truncating
+    FFT_HALVE_ROUND,            // (x + 1) >> 1 every stage (total 2^-bits)
+};
+
+// In-place radix-2 DIT on 2^bits complex int32 values in natural order, with
+// Q15 twiddles (one 512-point table, strided for shorter transforms).
+// Forward is e^-i, inverse e^+i; neither divides by the length unless
+// `scale` says so. Products are rounded down (>> 15).
+void fftQ15(int32_t* re, int32_t* im, int bits, bool inverse, FftScale scale);
+
+// log2(v + 1) in Q8, linear between powers of two: never above the true
+// value and at most 0.09 (0.26 dB of an energy) below it
+static inline int32_t log2Q8(uint64_t v) {
+    v += 1;
+    int msb = 63 - __builtin_clzll(v);
+    uint32_t frac = msb >= 8 ? (uint32_t)(v >> (msb - 8)) & 0xFF : (uint32_t)(v << (8 - msb)) & 0xFF;
+    return msb * 256 + (int32_t)frac;
+}
+
+// Convert a float volume multiplier (0.0 – 2.0) to Q1.14
+static inline int16_t volumeToQ14(float volume) {
+    if (volume <= 0.0f) return 0;
+    int32_t q = (int32_t)(volume * 16384.0f + 0.5f);
+    return (int16_t)(q > 32767 ? 32767 : q);
+}
+
+// Fused playback stage — one pass over the frame:
+//   out[2i] = out[2i+1] = sat16((in[i] * gainQ14 + 2^13) >> 14)
+// Returns sum(|in[i]|) (pre-gain) for the LED level meter.
+// out must hold 2 * n samples and be 4-byte aligned.
+uint32_t monoToStereoQ14(const int16_t* in, int16_t* out, int n, int16_t gainQ14);
@@ -0,0 +1,236 @@
+#include "AudioMixer.h"
+#include "AudioKernels.h"
+
+bool AudioMixer::begin() {
+    const size_t sizes[MIX_UI] = {
+        AUDIO_RING_BYTES,        // MIX_VOICE
+        AUDIO_RING_BYTES,        // MIX_AMBIENT
+        MIX_ALARM_RING_BYTES     // MIX_ALARM
+    };
+    for (int v = 0; v < MIX_UI; v++) {
+        if (!voices[v].ring.begin(sizes[v])) {
+            Serial.printf("AudioMixer: ring %d allocation failed\n", v);
+            return false;
+        }
+    }
+    return tones.begin();
+}
+
+void AudioMixer::setConsumer(TaskHandle_t task) {
+    for (int v = 0; v < MIX_NUM_VOICES; v++) {
+        voices[v].ring.setConsumer(task);
+    }
+    tones.setConsumer(task);
+}
+
+void AudioMixer::setGain(MixVoice v, float gain) {
+    voices[v].gainQ14 = volumeToQ14(gain);
+}
+
+void AudioMixer::flush(MixVoice v) {
+    if (v == MIX_UI) tones.stop();
+    voices[v].ring.flush();
+    voices[v].flushRequested.store(true, std::memory_order_release);
+}
+
+void AudioMixer::flushAll() {
+    for (int v = 0; v < MIX_NUM_VOICES; v++) {
+        flush((MixVoice)v);
+    }
+}
+
+// ── speakerTask ─────────────────────────────────────────────────────────────
+
+void AudioMixer::dropCurrent(Voice& vc) {
+    if (vc.cur) vc.ring.release();
+    vc.cur = nullptr;
+    vc.curLeft = 0;
+    vc.padLeft = 0;
+}
+
+int AudioMixer::available(MixVoice v, uint32_t nowMs) {
+    Voice& vc = voices[v];
+    if (vc.flushRequested.exchange(false, std::memory_order_acq_rel)) {
+        dropCurrent(vc);
+        if (v == MIX_VOICE) plc.reset();
+        if (v == MIX_AMBIENT) drift.reset();
+    }
+    if (v == MIX_UI) return tones.active() ? MIX_BLOCK_FRAMES : 0;
+    uint32_t bufferedBytes = vc.ring.payloadBytes();
+    if (v == MIX_VOICE && jitter) {
+        if (vc.curLeft == 0 && vc.padLeft == 0 && bufferedBytes == 0) {
+            // Ran dry mid-stream: keep the speaker fed with concealment while it lasts.
+            // Concealed samples advance the playout clock, so the jitter buffer only
+            // returns to buffering once the concealment has faded out and the DMA drained.
+            jitter->onEmpty(nowMs);
+            return jitter->isPlaying() ? plc.remaining() : 0;
+        }
+        if (jitter->hold(nowMs, JitterBuffer::bytesToMs(bufferedBytes))) return 0;
+    }
+    return vc.curLeft + vc.padLeft + (int)(bufferedBytes / sizeof(int16_t));
+}
+
+bool AudioMixer::nextFrame(MixVoice v) {
+    Voice& vc = voices[v];
+    size_t len = 0;
+    const uint8_t* frame = vc.ring.peek(&len, 0);
+    if (!frame) return false;
+
+    vc.cur = (const int16_t*)frame;
+    vc.curLeft = (int)(len / sizeof(int16_t));
+
+    if (v == MIX_VOICE && jitter && vc.curLeft > 0) {
+        // Jitter buffer time-stretch: only ever acts on silent frames
+        uint32_t sum = 0;
+        for (int i = 0; i < vc.curLeft; i++) {
+            int32_t x = vc.cur[i];
+            sum += (uint32_t)(x < 0 ? -x : x);
+        }
+        int adj = jitter->stretch(JitterBuffer::bytesToMs(vc.ring.payloadBytes()),
+                                  (int32_t)(sum / vc.curLeft), vc.curLeft);
+        if (adj < 0) vc.curLeft += adj;
+        else         vc.padLeft = adj;
+    }
+    return true;
+}
+
+int32_t AudioMixer::accumulate(int32_t* acc, const int16_t* src, int n, int32_t g, int32_t step) {
+    for (int i = 0; i < n; i++) {
+        acc[i] += ((int32_t)src[i] * (g >> 8) + (1 << 13)) >> 14;
+        g += step;
+    }
+    return g;
+}
+
+int AudioMixer::mixVoice(MixVoice v, int32_t* acc, int n, int32_t g0, int32_t g1) {
+    Voice& vc = voices[v];
+    // Linear gain ramp across the block in Q14.8
+    int32_t g = g0 << 8;
+    const int32_t step = ((g1 - g0) << 8) / n;
+    int produced = 0;
+
+    if (v == MIX_UI) {
+        produced = tones.render(toneBuf, n);
+        accumulate(acc, toneBuf, produced, g, step);
+        vc.samplesPlayed += produced;
+        return produced;
+    }
+
+    while (produced < n) {
+        if (vc.curLeft > 0 && v == MIX_AMBIENT) {
+            // Always through the resampler — at ratio 1.0 it passes samples through unchanged
+            int used = 0;
+            int take = drift.process(vc.cur, vc.curLeft, rsBuf, n - produced, &used);
+            g = accumulate(acc + produced, rsBuf, take, g, step);
+            vc.cur += used;
+            vc.curLeft -= used;
+            produced += take;
+            continue;
+        }
+        if (vc.curLeft > 0) {
+            int take = min(vc.curLeft, n - produced);
+            const int16_t* src = vc.cur;
+            if (v == MIX_VOICE) {
+                if (plc.pendingBlend()) {
+                    // First real audio after a concealed gap — crossfade a copy, the ring frame stays untouched
+                    take = min(take, PLC_XFADE_SAMPLES);
+                    memcpy(plcBuf, src, take * sizeof(int16_t));
+                    plc.blend(plcBuf, take);
+                    src = plcBuf;
+                }
+                plc.push(src, take);
+            }
+            g = accumulate(acc + produced, src, take, g, step);
+            vc.cur += take;
+            vc.curLeft -= take;
+            produced += take;
+            continue;
+        }
+        if (vc.padLeft > 0) {
+            // Inserted silence — nothing to add, just advance
+            int take = min(vc.padLeft, n - produced);
+            vc.padLeft -= take;
+            produced += take;
+            g += step * take;
+            continue;
+        }
+        if (vc.cur) {
+            vc.ring.release();
+            vc.cur = nullptr;
+        }
+        if (nextFrame(v)) continue;
+        if (v == MIX_VOICE && jitter && jitter->isPlaying()) {
+            // Ring ran dry mid-block — extrapolate the last pitch period
+            int take = plc.conceal(plcBuf, n - produced);
+            if (take == 0) break;
+            g = accumulate(acc + produced, plcBuf, take, g, step);
+            produced += take;
+            continue;
+        }
+        break;
+    }
+    // Release a fully consumed frame now so the producer gets the space back
+    if (vc.cur && vc.curLeft == 0 && vc.padLeft == 0) {
+        vc.ring.release();
+        vc.cur = nullptr;
+    }
+    vc.samplesPlayed += produced;
+    return produced;
+}
+
+int AudioMixer::render(int16_t* stereoOut, int maxFrames, int16_t masterQ14, uint32_t* levelSum) {
+    if (maxFrames > MIX_BLOCK_FRAMES) maxFrames = MIX_BLOCK_FRAMES;
+    uint32_t now = millis();
+
+    int avail[MIX_NUM_VOICES];
+    int n = 0;
+    for (int v = 0; v < MIX_NUM_VOICES; v++) {
+        avail[v] = available((MixVoice)v, now);
+        // Block length follows the longest-running voice so a lone stream is never
+        // padded with gaps; shorter voices are zero-filled for the remainder.
+        if (avail[v] > n) n = avail[v];
+    }
+    if (n > maxFrames) n = maxFrames;
+    if (n == 0) return 0;
+
+    if (avail[MIX_VOICE] > 0) lastSpeechMs = now;
+    const bool speaking = lastSpeechMs != 0 && (now - lastSpeechMs) < MIX_DUCK_HOLD_MS;
+
+    memset(mixAcc, 0, n * sizeof(int32_t));
+    for (int v = 0; v < MIX_NUM_VOICES; v++) {
+        Voice& vc = voices[v];
+
+        // Ducking envelope: ambient dips under Gemini speech, everything else stays at unity
+        int32_t duckTarget = (v == MIX_AMBIENT && speaking) ? (int32_t)(MIX_DUCK_LEVEL * 16384.0f) : 16384;
+        int32_t duckPrev = vc.duckQ14;
+        if (vc.duckQ14 < duckTarget)      vc.duckQ14 = min(duckTarget, vc.duckQ14 + MIX_DUCK_STEP_Q14);
+        else if (vc.duckQ14 > duckTarget) vc.duckQ14 = max(duckTarget, vc.duckQ14 - MIX_DUCK_STEP_Q14);
+
+        if (avail[v] == 0) continue;
+
+        if (v == MIX_AMBIENT) {
+            if (driftControl.load(std::memory_order_relaxed)) {
+                uint32_t fillMs = JitterBuffer::bytesToMs(vc.ring.payloadBytes()) + vc.curLeft / 24;
+                drift.steer(fillMs, n);
+            } else {
+                drift.hold();
+            }
+        }
+
+        int32_t g0 = (vc.gainQ14 * duckPrev) >> 14;
+        int32_t g1 = (vc.gainQ14 * vc.duckQ14) >> 14;
+        int produced = mixVoice((MixVoice)v, mixAcc, n, g0, g1);
+        if (v == MIX_VOICE && jitter && produced > 0) {
+            jitter->onPlayed(now, produced);
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        int32_t s = mixAcc[i];
+        if (s > 32767) s = 32767;
+        else if (s < -32768) s = -32768;
+        mixMono[i] = (int16_t)s;
+    }
+    *levelSum = monoToStereoQ14(mixMono, stereoOut, n, masterQ14);
+    return n;
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include "AudioRing.h"
+#include "JitterBuffer.h"
+#include "LossConcealer.h"
+#include "DriftResampler.h"
+#include "ToneSynth.h"
+
+// ============== AUDIO MIXER ==============
+//
+// Software mixer in front of I2S_NUM_1. Each streamed source has its own
+// AudioRing so Gemini speech, ambient/radio, alarms and UI tones can overlap
+// instead of tearing each other down:
+//
+//   MIX_VOICE    Gemini speech (headerless packets)        — jitter-buffered,
+//                                                            gaps concealed (LossConcealer)
+//   MIX_AMBIENT  ambient / radio / meditation bells (A5 5A) — ducked under voice,
+//                                                            radio drift-resampled (DriftResampler)
+//   MIX_ALARM    alarm + zen bell (headerless, isPlayingAlarm)
+//   MIX_UI       locally generated tones (chimes, shutdown melody) — no ring,
+//                                                            synthesised at mix time (ToneSynth)
+//
+// speakerTask is the ONLY task that touches I2S_NUM_1: it calls render() for one
+// DMA buffer (MIX_BLOCK_FRAMES) at a time and writes the result. Other tasks
+// push audio into a ring, flush a voice, or requestSilence() — they never call
+// i2s_write / i2s_zero_dma_buffer themselves, so no speaker mutex is needed.
+//
+// Mixing is Q1.14 fixed point: per-voice gain × ducking envelope, summed in
+// int32, saturated, then the master volume is applied by monoToStereoQ14().
+// Gain changes are ramped across the block to avoid zipper noise.
+//
+// =========================================
+
+enum MixVoice : uint8_t { MIX_VOICE, MIX_AMBIENT, MIX_ALARM, MIX_UI, MIX_NUM_VOICES };
+
+#ifndef MIX_BLOCK_FRAMES
+#define MIX_BLOCK_FRAMES 512          // One speaker DMA buffer (dma_buf_len)
+#endif
+#ifndef MIX_ALARM_RING_BYTES
+#define MIX_ALARM_RING_BYTES (32 * 1024)
+#endif
+#ifndef MIX_DUCK_LEVEL
+#define MIX_DUCK_LEVEL 0.25f          // Ambient gain while Gemini is speaking
+#endif
+#ifndef MIX_DUCK_STEP_Q14
+#define MIX_DUCK_STEP_Q14 1536        // Max envelope change per block (~230ms full swing)
+#endif
+#ifndef MIX_DUCK_HOLD_MS
+#define MIX_DUCK_HOLD_MS 400          // Keep ducking this long after speech stops
+#endif
+
+class AudioMixer {
+public:
+    // Allocate one ring per streamed voice and the tone synth. Returns false on allocation failure.
+    bool begin();
+
+    // Task woken by any voice's producer (speakerTask).
+    void setConsumer(TaskHandle_t task);
+
+    // Gemini voice is steered by the jitter buffer (hold / stretch / playout clock)
+    void attachJitterBuffer(JitterBuffer* jb) { jitter = jb; }
+
+    // Producer access for the WebSocket handler (single producer per ring, not MIX_UI)
+    AudioRing& ring(MixVoice v) { return voices[v].ring; }
+
+    // Play a note sequence on MIX_UI. Safe from any task; returns immediately.
+    bool playTone(const ToneSequence* seq) { return tones.play(seq); }
+
+    // Per-voice gain (0.0 – 2.0), applied before the master volume
+    void setGain(MixVoice v, float gain);
+
+    // Drop everything buffered for a voice / all voices. Safe from any task.
+    void flush(MixVoice v);
+    void flushAll();
+
+    // Steer the ambient voice's resampler from its ring fill (live radio). Safe from any task.
+    void setDriftControl(bool on) { driftControl.store(on, std::memory_order_relaxed); }
+
+    // Ask speakerTask to zero the speaker DMA on its next pass. Safe from any task.
+    void requestSilence() { silenceRequested.store(true, std::memory_order_release); }
+    bool takeSilenceRequest() { return silenceRequested.exchange(false, std::memory_order_acq_rel); }
+
+    // ── speakerTask only ──
+    // Mix up to maxFrames into interleaved stereo. Returns frames produced (0 = all voices idle).
+    // levelSum receives sum(|mono mix|) for the LED meter.
+    int render(int16_t* stereoOut, int maxFrames, int16_t masterQ14, uint32_t* levelSum);
+    // Block until any producer commits, or wait ticks elapse
+    void waitForData(TickType_t wait) { ulTaskNotifyTake(pdTRUE, wait); }
+
+    // Diagnostics
+    uint32_t framesPlayed(MixVoice v) const { return voices[v].samplesPlayed; }
+    bool     isDucking() const { return voices[MIX_AMBIENT].duckQ14 < 16384; }
+    bool     isToneActive() { return tones.active(); }   // speakerTask only
+    const LossConcealer& concealer() const { return plc; }
+    const DriftResampler& resampler() const { return drift; }
+
+private:
+    struct Voice {
+        AudioRing ring;
+        const int16_t* cur = nullptr;      // in-place read cursor into the peeked frame
+        int      curLeft = 0;              // samples left in that frame
+        int      padLeft = 0;              // inserted silence still to emit (jitter stretch)
+        volatile int16_t gainQ14 = 16384;
+        int32_t  duckQ14 = 16384;          // current ducking envelope
+        std::atomic<bool> flushRequested{false};
+        uint32_t samplesPlayed = 0;
+    };
+
+    int  available(MixVoice v, uint32_t nowMs);
+    bool nextFrame(MixVoice v);
+    int  mixVoice(MixVoice v, int32_t* acc, int n, int32_t g0, int32_t g1);
+    static int32_t accumulate(int32_t* acc, const int16_t* src, int n, int32_t g, int32_t step);
+    void dropCurrent(Voice& vc);
+
+    Voice voices[MIX_NUM_VOICES];
+    JitterBuffer* jitter = nullptr;
+    LossConcealer plc;                     // MIX_VOICE only
+    DriftResampler drift;                  // MIX_AMBIENT only
+    ToneSynth tones;                       // MIX_UI only
+    std::atomic<bool> driftControl{false};
+    std::atomic<bool> silenceRequested{false};
+    uint32_t lastSpeechMs = 0;
+
+    int32_t mixAcc[MIX_BLOCK_FRAMES];
+    int16_t mixMono[MIX_BLOCK_FRAMES];
+    int16_t plcBuf[MIX_BLOCK_FRAMES];      // concealment output / crossfaded voice samples
+    int16_t rsBuf[MIX_BLOCK_FRAMES];       // resampled ambient samples
+    int16_t toneBuf[MIX_BLOCK_FRAMES];     // synthesised UI samples
+};
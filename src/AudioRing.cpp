@@ -0,0 +1,175 @@
+#include "AudioRing.h"
+#include <esp_heap_caps.h>
+
+bool AudioRing::begin(size_t capacityBytes) {
+    // Round down to a power of two (see AUDIO_RING_BYTES)
+    uint32_t size = 1;
+    while ((size << 1) <= capacityBytes) size <<= 1;
+    if (size < 2 * frameBytes(AUDIO_RING_MAX_FRAME)) {
+        Serial.printf("AudioRing: capacity %u too small\n", (unsigned)capacityBytes);
+        return false;
+    }
+
+    buf = (uint8_t*)heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!buf) {
+        Serial.println("AudioRing: PSRAM unavailable - falling back to internal RAM");
+        buf = (uint8_t*)heap_caps_malloc(size, MALLOC_CAP_8BIT);
+    }
+    if (!buf) {
+        return false;
+    }
+    cap = size;
+    Serial.printf("AudioRing: %u KB allocated\n", (unsigned)(cap / 1024));
+    return true;
+}
+
+// ── Producer ─────────────────────────────────────────────────────────────────
+
+uint8_t* AudioRing::reserve(size_t len) {
+    if (!buf || len == 0 || len > AUDIO_RING_MAX_FRAME) return nullptr;
+
+    uint32_t need = frameBytes(len);
+    uint32_t h = head.load(std::memory_order_relaxed);
+    uint32_t t = tail.load(std::memory_order_acquire);
+    uint32_t off = offset(h);
+    uint32_t skip = (cap - off < need) ? cap - off : 0;
+
+    if ((h - t) + skip + need > cap) return nullptr;
+
+    if (skip) {
+        // Not yet visible to the consumer — it only reads below head
+        uint32_t marker = WRAP_MARKER;
+        memcpy(buf + off, &marker, 4);
+    }
+    reservedSkip = skip;
+    reservedLen = len;
+    return buf + offset(h + skip) + HEADER_BYTES;
+}
+
+void AudioRing::commit(size_t len) {
+    if (!buf || len == 0 || len > reservedLen) return;
+
+    uint32_t pos = head.load(std::memory_order_relaxed) + reservedSkip;
+    uint32_t hdr = (uint32_t)len;
+    memcpy(buf + offset(pos), &hdr, 4);
+
+    // Count before publishing so frames() never underflows when the consumer is fast
+    payloadWritten.fetch_add(hdr, std::memory_order_relaxed);
+    uint32_t depth = framesWritten.fetch_add(1, std::memory_order_relaxed) + 1
+                     - framesRead.load(std::memory_order_relaxed);
+    if (depth > peakFrames) peakFrames = depth;
+
+    head.store(pos + frameBytes(len), std::memory_order_release);
+    reservedLen = 0;
+    reservedSkip = 0;
+
+    if (consumer) xTaskNotifyGive(consumer);
+}
+
+bool AudioRing::write(const uint8_t* data, size_t len, uint32_t timeoutMs) {
+    if (len == 0 || len > AUDIO_RING_MAX_FRAME) return false;
+
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(timeoutMs);
+    while (true) {
+        uint8_t* dst = reserve(len);
+        if (!dst && timeout) {
+            // Register before the retry: a release() in between either shows up
+            // in the retry or finds the waiter and notifies
+            waiter.store(xTaskGetCurrentTaskHandle());
+            dst = reserve(len);
+        }
+        if (dst) {
+            waiter.store(nullptr);
+            memcpy(dst, data, len);
+            commit(len);
+            return true;
+        }
+        TickType_t waited = xTaskGetTickCount() - start;
+        if (waited >= timeout) {
+            waiter.store(nullptr);
+            return false;
+        }
+        ulTaskNotifyTake(pdTRUE, timeout - waited);
+    }
+}
+
+// ── Consumer ─────────────────────────────────────────────────────────────────
+
+void AudioRing::applyFlush() {
+    if (!flushPending.exchange(false, std::memory_order_acquire)) return;
+
+    uint32_t target = flushTarget.load(std::memory_order_acquire);
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    uint32_t dropped = 0;
+    uint32_t droppedBytes = 0;
+    // Walk headers rather than jumping straight to target so framesRead stays exact
+    while ((int32_t)(target - t) > 0) {
+        uint32_t hdr = readHeader(t);
+        if (hdr == WRAP_MARKER) {
+            t += cap - offset(t);
+        } else {
+            t += frameBytes(hdr);
+            dropped++;
+            droppedBytes += hdr;
+        }
+    }
+    payloadRead.fetch_add(droppedBytes, std::memory_order_relaxed);
+    framesRead.fetch_add(dropped, std::memory_order_relaxed);
+    tail.store(t);
+    wakeProducer();
+}
+
+const uint8_t* AudioRing::peek(size_t* len, TickType_t wait) {
+    if (!buf) return nullptr;
+
+    applyFlush();
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (head.load(std::memory_order_acquire) == t) {
+        if (wait == 0) return nullptr;
+        ulTaskNotifyTake(pdTRUE, wait);
+        applyFlush();
+        t = tail.load(std::memory_order_relaxed);
+        if (head.load(std::memory_order_acquire) == t) return nullptr;
+    }
+
+    uint32_t hdr = readHeader(t);
+    if (hdr == WRAP_MARKER) {
+        t += cap - offset(t);
+        tail.store(t, std::memory_order_release);
+        hdr = readHeader(t);
+    }
+
+    peekedBytes = frameBytes(hdr);
+    peekedLen = hdr;
+    *len = hdr;
+    return buf + offset(t) + HEADER_BYTES;
+}
+
+void AudioRing::release() {
+    if (!peekedBytes) return;
+    payloadRead.fetch_add(peekedLen, std::memory_order_relaxed);
+    framesRead.fetch_add(1, std::memory_order_relaxed);
+    tail.store(tail.load(std::memory_order_relaxed) + peekedBytes);
+    peekedBytes = 0;
+    wakeProducer();
+}
+
+void AudioRing::wakeProducer() {
+    // Only a producer blocked in write() has registered; commit-only producers cost nothing
+    TaskHandle_t w = waiter.exchange(nullptr);
+    if (w) xTaskNotifyGive(w);
+}
+
+// ── Any task ─────────────────────────────────────────────────────────────────
+
+void AudioRing::flush() {
+    if (!buf) return;
+    flushTarget.store(head.load(std::memory_order_acquire), std::memory_order_relaxed);
+    // After head: commit() counts a frame before publishing it, so every frame
+    // below the target is in these (plus at most one still being committed)
+    flushFrames.store(framesWritten.load(std::memory_order_acquire), std::memory_order_relaxed);
+    flushPayload.store(payloadWritten.load(std::memory_order_acquire), std::memory_order_relaxed);
+    flushPending.store(true, std::memory_order_release);
+    if (consumer) xTaskNotifyGive(consumer);
+}
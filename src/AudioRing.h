@@ -0,0 +1,127 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// ============== AUDIO RING ==============
+//
+// Lock-free single-producer / single-consumer byte ring for downlink audio.
+// Replaces the old FreeRTOS audioOutputQueue of fixed 2 KB AudioChunk slots,
+// which copied every packet three times (payload → stack chunk → queue →
+// audioTask) and padded 1 KB ambient packets to 2 KB.
+//
+// PRODUCER (websocketTask, WStype_BIN):  reserve() → memcpy payload → commit()
+// CONSUMER (speakerTask):                peek() → process in place → release()
+// ANY TASK:                              flush() — drops everything committed
+//                                        so far; applied lazily by the consumer,
+//                                        but frames()/bytesUsed()/payloadBytes()
+//                                        leave the flushed frames out at once
+//
+// A producer that finds the ring full in write() sleeps on a task
+// notification until the consumer releases a frame (or applies a flush).
+//
+// The mic side uses one too: micRing carries MicFrames from micCaptureTask
+// to audioTask (see MicCapture.h).
+//
+// Layout: variable-length frames, each a 4-byte length header followed by the
+// payload padded to 4 bytes (keeps int16 samples aligned). A frame never
+// straddles the end of the buffer — if it does not fit, a WRAP marker is
+// written and the frame starts again at offset 0. head/tail are monotonic byte
+// counters (wrap at 2^32); only the producer moves head, only the consumer
+// moves tail, so no locks are needed.
+//
+// Storage lives in PSRAM when available (falls back to internal RAM).
+//
+// =======================================
+
+// Total ring capacity in bytes (rounded down to a power of two so the monotonic
+// head/tail counters map onto the buffer across their 2^32 wrap).
+// 64 KB ≈ 1.4s of 24kHz mono PCM — same audio depth as the old 30-slot queue
+// without the per-slot padding.
+#ifndef AUDIO_RING_BYTES
+#define AUDIO_RING_BYTES (64 * 1024)
+#endif
+
+// Largest single frame accepted by reserve() — matches the old AudioChunk::data
+#ifndef AUDIO_RING_MAX_FRAME
+#define AUDIO_RING_MAX_FRAME 2048
+#endif
+
+class AudioRing {
+public:
+    // Allocate storage. Returns false on allocation failure.
+    bool begin(size_t capacityBytes = AUDIO_RING_BYTES);
+
+    // Task to wake (xTaskNotifyGive) when a frame is committed or a flush is requested.
+    void setConsumer(TaskHandle_t task) { consumer = task; }
+
+    // ── Producer side (single task) ──
+    // Returns a write pointer for a frame of `len` bytes, or nullptr if the ring is full.
+    uint8_t* reserve(size_t len);
+    // Publish the frame obtained from the last reserve(). len must be <= the reserved size.
+    void commit(size_t len);
+    // Copy-in helper: reserve + memcpy + commit. On a full ring, blocks for up to timeoutMs
+    // (backpressure to TCP), woken by the consumer as it frees space. Returns false if the
+    // ring stayed full. Uses the calling task's notification while it waits.
+    bool write(const uint8_t* data, size_t len, uint32_t timeoutMs);
+
+    // ── Consumer side (single task) ──
+    // Returns a pointer to the oldest frame (valid until release()), or nullptr if empty
+    // after waiting up to `wait` ticks for a producer notification.
+    const uint8_t* peek(size_t* len, TickType_t wait = 0);
+    // Drop the frame returned by the last peek().
+    void release();
+
+    // ── Any task ──
+    // Discard every frame committed before this call. Frames committed afterwards are kept.
+    void flush();
+
+    // Depth as the consumer will see it: a flush not yet applied already counts as done
+    uint32_t frames() const    { return framesWritten.load(std::memory_order_acquire) - consumed(framesRead, flushFrames); }
+    uint32_t bytesUsed() const { return head.load(std::memory_order_acquire) - consumed(tail, flushTarget); }
+    // Audio payload bytes buffered (excludes frame headers, padding and wrap gaps)
+    uint32_t payloadBytes() const { return payloadWritten.load(std::memory_order_acquire) - consumed(payloadRead, flushPayload); }
+    size_t   capacity() const  { return cap; }
+    uint32_t maxFramesSeen() const { return peakFrames; }
+
+private:
+    static constexpr uint32_t HEADER_BYTES = 4;
+    static constexpr uint32_t WRAP_MARKER  = 0xFFFFFFFFu;
+
+    static uint32_t frameBytes(uint32_t len) { return HEADER_BYTES + ((len + 3u) & ~3u); }
+    uint32_t offset(uint32_t pos) const { return pos & (cap - 1); }
+    uint32_t readHeader(uint32_t pos) const { uint32_t v; memcpy(&v, buf + offset(pos), 4); return v; }
+    void     applyFlush();
+    void     wakeProducer();
+    // A read-side counter, moved up to its flush snapshot while a flush is pending
+    uint32_t consumed(const std::atomic<uint32_t>& read, const std::atomic<uint32_t>& atFlush) const {
+        uint32_t r = read.load(std::memory_order_acquire);
+        if (!flushPending.load(std::memory_order_acquire)) return r;
+        uint32_t f = atFlush.load(std::memory_order_relaxed);
+        return (int32_t)(f - r) > 0 ? f : r;
+    }
+
+    uint8_t* buf = nullptr;
+    uint32_t cap = 0;
+    TaskHandle_t consumer = nullptr;
+    std::atomic<TaskHandle_t> waiter{nullptr};  // producer blocked in write(), if any
+
+    std::atomic<uint32_t> head{0};           // producer-owned write position
+    std::atomic<uint32_t> tail{0};           // consumer-owned read position
+    std::atomic<uint32_t> framesWritten{0};
+    std::atomic<uint32_t> framesRead{0};
+    std::atomic<uint32_t> payloadWritten{0};
+    std::atomic<uint32_t> payloadRead{0};
+    std::atomic<uint32_t> flushTarget{0};    // head snapshot taken by flush()
+    std::atomic<uint32_t> flushFrames{0};    // framesWritten at that flush
+    std::atomic<uint32_t> flushPayload{0};   // payloadWritten at that flush
+    std::atomic<bool>     flushPending{false};
+
+    uint32_t reservedSkip = 0;   // producer: bytes skipped by a WRAP marker in the pending reserve
+    uint32_t reservedLen  = 0;   // producer: size requested by the pending reserve
+    uint32_t peekedBytes  = 0;   // consumer: footprint of the frame handed out by peek()
+    uint32_t peekedLen    = 0;   // consumer: payload length of that frame
+    uint32_t peakFrames   = 0;   // producer: high-water mark for diagnostics
+};
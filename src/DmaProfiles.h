@@ -0,0 +1,56 @@
+#pragma once
+
+#include <Arduino.h>
+
+// ============== DMA PROFILES ==============
+//
+// Named I2S buffering profiles, switched at runtime on mode entry/exit:
+//
+//   TALK    conversation (recording, waiting, Gemini speaking, window) and idle.
+//           Shallow speaker queue so interrupts and barge-in are heard at once;
+//           speaker refilled on every DMA buffer; short mic DMA buffers so VAD
+//           sees each 10ms of audio as soon as it is captured.
+//   STREAM  radio / ambient / meditation with no conversation in progress.
+//           Deep speaker queue to ride out network stalls; speakerTask sleeps
+//           and refills half the queue per wakeup; long mic DMA buffers.
+//
+// The speaker DMA ring is installed once at SPK_DMA_BUF_COUNT buffers (the
+// deepest profile) and never reinstalled — a profile only changes how many of
+// those buffers speakerTask keeps filled, so switching is glitch-free. Going
+// from STREAM to TALK simply stops refilling until the queue drains to the
+// new depth.
+//
+// The microphone driver is reinstalled with the profile's buffer length, but
+// only by micCaptureTask (its sole reader) while nothing is being recorded.
+//
+// =========================================
+
+enum DmaProfileId : uint8_t { DMA_PROFILE_TALK, DMA_PROFILE_STREAM, DMA_PROFILE_COUNT };
+
+struct DmaProfile {
+    const char* name;
+    uint8_t  spkQueueBufs;     // speaker DMA buffers kept filled (latency ≈ bufs × 21.3ms)
+    uint8_t  spkRefillBufs;    // refill once this many buffers are free (wakeup batching)
+    uint16_t micBufLen;        // mic DMA buffer length in frames (16kHz)
+    uint8_t  micBufCount;
+};
+
+static const DmaProfile DMA_PROFILES[DMA_PROFILE_COUNT] = {
+    // name      spkQueue spkRefill micLen micCount
+    { "TALK",    4,       1,        160,   8 },    //  ~85ms out, ~47 wakeups/s, 10ms mic buffers
+    { "STREAM",  12,      6,        512,   8 },    // ~256ms out,  ~8 wakeups/s, 32ms mic buffers
+};
+
+// micCaptureTask's read buffer: longest micBufLen above
+#define MIC_DMA_BUF_LEN_MAX 512
+
+// Speaker DMA ring: deepest profile
+#ifndef SPK_DMA_BUF_COUNT
+#define SPK_DMA_BUF_COUNT 12
+#endif
+
+// Log wakeups/s and output latency once per second from speakerTask.
+// Boot default only: 'd' on the serial console toggles it at runtime.
+#ifndef DMA_PROFILE_MEASURE
+#define DMA_PROFILE_MEASURE 0
+#endif
@@ -0,0 +1,80 @@
+#include "DriftResampler.h"
+
+void DriftResampler::reset() {
+    for (int i = 0; i < 4; i++) taps[i] = 0;
+    pendingAdvance = 3;
+    frac = 0;
+    hold();
+    fillAvg = -1.0f;
+    integral = 0.0f;
+}
+
+void DriftResampler::hold() {
+    stepDelta = 0;
+    ratioPpm = 0.0f;
+}
+
+// Catmull-Rom between x1 and x2 at t (Q15)
+static inline int16_t catmullRom(const int16_t* x, int32_t t) {
+    int32_t x0 = x[0], x1 = x[1], x2 = x[2], x3 = x[3];
+    int32_t a = 3 * (x1 - x2) + x3 - x0;
+    int32_t b = 2 * x0 - 5 * x1 + 4 * x2 - x3;
+    int32_t c = x2 - x0;
+    int32_t v = (int32_t)(((int64_t)a * t) >> 15) + b;
+    v = (int32_t)(((int64_t)v * t) >> 15) + c;
+    v = (int32_t)(((int64_t)v * t) >> 16);   // includes the 1/2
+    int32_t y = x1 + v;
+    if (y > 32767) y = 32767;
+    else if (y < -32768) y = -32768;
+    return (int16_t)y;
+}
+
+int DriftResampler::process(const int16_t* in, int inCount, int16_t* out, int outMax, int* consumed) {
+    int used = 0;
+    int produced = 0;
+    const int64_t step = (int64_t)0x100000000LL + stepDelta;
+
+    while (produced < outMax) {
+        while (pendingAdvance > 0) {
+            if (used == inCount) {
+                *consumed = used;
+                return produced;
+            }
+            taps[0] = taps[1];
+            taps[1] = taps[2];
+            taps[2] = taps[3];
+            taps[3] = in[used++];
+            pendingAdvance--;
+        }
+        out[produced++] = frac ? catmullRom(taps, (int32_t)(frac >> 17)) : taps[1];
+
+        uint64_t f = (uint64_t)frac + (uint64_t)step;
+        pendingAdvance = (int)(f >> 32);
+        frac = (uint32_t)f;
+    }
+    *consumed = used;
+    return produced;
+}
+
+void DriftResampler::steer(uint32_t fillMs, int frames) {
+    const float dt = frames / 24000.0f;
+    if (fillAvg < 0.0f) {
+        fillAvg = (float)fillMs;
+    } else {
+        fillAvg += ((float)fillMs - fillAvg) * (dt * 1000.0f / DRIFT_FILTER_MS);
+    }
+
+    // Over target → consume faster (positive ppm). Integrator clamped so it alone
+    // can never exceed the ratio limit (anti-windup).
+    float err = fillAvg - DRIFT_TARGET_MS;
+    integral += err * dt;
+    const float iMax = DRIFT_MAX_PPM / DRIFT_KI;
+    if (integral > iMax) integral = iMax;
+    else if (integral < -iMax) integral = -iMax;
+
+    float p = DRIFT_KP * err + DRIFT_KI * integral;
+    if (p > DRIFT_MAX_PPM) p = DRIFT_MAX_PPM;
+    else if (p < -DRIFT_MAX_PPM) p = -DRIFT_MAX_PPM;
+    ratioPpm = p;
+    stepDelta = (int32_t)(p * 4294.967296f);   // 2^32 / 1e6
+}
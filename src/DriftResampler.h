@@ -0,0 +1,69 @@
+#pragma once
+
+#include <Arduino.h>
+
+// ============== DRIFT RESAMPLER ==============
+//
+// Asynchronous sample-rate converter for the ambient mixer voice. Live radio
+// is paced by the upstream station's clock (server/main.ts forwards ffmpeg
+// output as it arrives) while the speaker is paced by the ESP32's I2S clock.
+// A few hundred ppm of difference slowly fills the ambient ring until writes
+// block ("Blocked on ring for 100ms+"), or drains it into underruns.
+//
+// RESAMPLING (speakerTask, sample path): 4-tap Catmull-Rom interpolation with a
+// Q32 phase accumulator, so the ratio resolves to well below 1 ppm. At ratio
+// 1.0 the phase never moves and the output is bit-identical to the input
+// (two samples of delay). Fixed point, no allocation.
+//
+// CONTROL (once per mixer block): the ring fill is low-pass filtered and a PI
+// loop steers the ratio so the fill settles on DRIFT_TARGET_MS. The ratio is
+// limited to ±DRIFT_MAX_PPM — 1000 ppm is 1.7 cents, far below audible pitch
+// change. Ambient loops from files are paced by device backpressure (the
+// server sends faster than real time and blocks on TCP), so they have no
+// drift to correct — the controller is only enabled for radio.
+//
+// ==============================================
+
+#ifndef DRIFT_TARGET_MS
+#define DRIFT_TARGET_MS 400       // Ring fill the controller settles on (ambient ring holds ~1.3s)
+#endif
+#ifndef DRIFT_MAX_PPM
+#define DRIFT_MAX_PPM 1000        // Ratio limit
+#endif
+#ifndef DRIFT_FILTER_MS
+#define DRIFT_FILTER_MS 2000      // Fill low-pass time constant (packets arrive in bursts)
+#endif
+#ifndef DRIFT_KP
+#define DRIFT_KP 8.0f             // ppm per ms of fill error
+#endif
+#ifndef DRIFT_KI
+#define DRIFT_KI 0.02f            // ppm per ms·s of accumulated error (ζ ≈ 0.9, settles in minutes)
+#endif
+
+class DriftResampler {
+public:
+    // Clear interpolation history and controller state (new stream).
+    void reset();
+
+    // Resample from in[0..inCount) into out[0..outMax). *consumed receives input
+    // samples used. Returns output samples written; stops early when input runs out.
+    int process(const int16_t* in, int inCount, int16_t* out, int outMax, int* consumed);
+
+    // Update the ratio from the current buffer fill. frames = output samples since last call.
+    void steer(uint32_t fillMs, int frames);
+    // Return to ratio 1.0 (controller disabled).
+    void hold();
+
+    float ppm() const       { return ratioPpm; }
+    float fillMs() const    { return fillAvg; }
+
+private:
+    int16_t  taps[4] = {0, 0, 0, 0};   // x[-1], x[0], x[1], x[2] around the output phase
+    int      pendingAdvance = 3;       // input samples to shift in before the next output
+    uint32_t frac = 0;                 // Q32 phase between taps[1] and taps[2]
+    int32_t  stepDelta = 0;            // step = 1 + stepDelta / 2^32
+
+    float    fillAvg = -1.0f;          // < 0 until the first steer() after reset
+    float    integral = 0.0f;          // ms·s
+    float    ratioPpm = 0.0f;
+};
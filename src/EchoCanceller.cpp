@@ -0,0 +1,401 @@
+#include "EchoCanceller.h"
+#include "AudioKernels.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ARDUINO
+#include <esp_heap_caps.h>
+#endif
+
+#define AEC_REF_MASK     (AEC_REF_RING_SAMPLES - 1)
+#define AEC_ENV_LAGS     ((AEC_MIN_DELAY_MS + AEC_MAX_DELAY_MS) * 16 / AEC_BLOCK)
+#define AEC_ENV_LEAD     (AEC_MIN_DELAY_MS * 16 / AEC_BLOCK)
+#define AEC_ENV_WINDOW   (AEC_ENV_HISTORY - AEC_ENV_LAGS)
+#define AEC_DELTA        (AEC_FFT * 180 * 180)   // regularises the step below ~180 rms of reference
+#define AEC_DT_HOLD      10       // frames without adaptation after near-end speech
+
+static_assert((AEC_REF_RING_SAMPLES & AEC_REF_MASK) == 0, "AEC_REF_RING_SAMPLES must be a power of two");
+static_assert(AEC_ENV_WINDOW >= 32, "AEC_ENV_HISTORY too short for the delay range");
+
+static inline int16_t sat16(int32_t v) {
+    return (int16_t)(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+}
+
+// ── Reference ────────────────────────────────────────────────────────────────
+
+bool EchoReference::begin() {
+    size_t bytes = AEC_REF_RING_SAMPLES * sizeof(int16_t);
+#ifdef ARDUINO
+    ring = (int16_t*)heap_caps_calloc(1, bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!ring) ring = (int16_t*)heap_caps_calloc(1, bytes, MALLOC_CAP_8BIT);
+#else
+    ring = (int16_t*)calloc(1, bytes);
+#endif
+    // Low-pass at 7 kHz for the 48 kHz prototype (24k zero-stuffed ×2, taken ÷3), Hann-windowed sinc
+    const float fc = 7000.0f / 48000.0f;
+    for (int n = 0; n < AEC_DECIM_TAPS; n++) {
+        float t = n - (AEC_DECIM_TAPS - 1) / 2.0f;
+        float sinc = t == 0 ? 2 * fc : sinf(2 * (float)M_PI * fc * t) / ((float)M_PI * t);
+        float win = 0.5f - 0.5f * cosf(2 * (float)M_PI * (n + 0.5f) / AEC_DECIM_TAPS);
+        coefs[n] = (int16_t)lroundf(2 * 32767.0f * sinc * win);
+    }
+    memset(hist, 0, sizeof(hist));
+    return ring != nullptr;
+}
+
+void EchoReference::write(const int16_t* stereo, int frames, uint32_t playPos) {
+    if (!ring || frames <= 0) return;
+    uint32_t h = head.load(std::memory_order_relaxed);
+    int32_t gap = (int32_t)(playPos - h);
+    if (!started || gap > AEC_REF_SLACK || gap < -AEC_REF_SLACK) {
+        // Not a continuation: silence until this block, then a fresh decimator
+        if (started && gap > 0) {
+            uint32_t fill = gap > AEC_REF_RING_SAMPLES ? AEC_REF_RING_SAMPLES : (uint32_t)gap;
+            for (uint32_t i = 0; i < fill; i++) ring[(playPos - fill + i) & AEC_REF_MASK] = 0;
+        }
+        h = playPos;
+        memset(hist, 0, sizeof(hist));
+        phase = 0;
+        started = true;
+    }
+
+    // 24k → 16k: outputs 2t and 2t+1 fall on inputs 3t and 3t+1 (even / odd taps)
+    for (int i = 0; i < frames; i++) {
+        memmove(hist + 1, hist, sizeof(hist) - sizeof(hist[0]));
+        hist[0] = (int16_t)(((int32_t)stereo[2 * i] + stereo[2 * i + 1]) >> 1);
+        if (phase < 2) {
+            int32_t acc = 0;
+            for (int j = 0; j < AEC_DECIM_TAPS / 2; j++) acc += (int32_t)coefs[2 * j + phase] * hist[j];
+            ring[h & AEC_REF_MASK] = sat16((acc + (1 << 14)) >> 15);
+            h++;
+        }
+        phase = phase == 2 ? 0 : phase + 1;
+    }
+    head.store(h, std::memory_order_release);
+}
+
+void EchoReference::cut(uint32_t pos) {
+    if ((int32_t)(head.load(std::memory_order_relaxed) - pos) > 0) {
+        head.store(pos, std::memory_order_release);
+    }
+}
+
+void EchoReference::read(uint32_t pos, int16_t* out, int n) const {
+    uint32_t h = head.load(std::memory_order_acquire);
+    for (int i = 0; i < n; i++) {
+        int32_t age = (int32_t)(h - (pos + i));
+        out[i] = (ring && age > 0 && age <= AEC_REF_RING_SAMPLES) ? ring[(pos + i) & AEC_REF_MASK] : 0;
+    }
+}
+
+// ── Canceller ────────────────────────────────────────────────────────────────
+
+void EchoCanceller::begin(const EchoReference* reference) {
+    ref = reference;
+    reset();
+}
+
+void EchoCanceller::clearFilter() {
+    memset(refPrev, 0, sizeof(refPrev));
+    memset(xRe, 0, sizeof(xRe));
+    memset(xIm, 0, sizeof(xIm));
+    memset(wRe, 0, sizeof(wRe));
+    memset(wIm, 0, sizeof(wIm));
+    memset(power, 0, sizeof(power));
+    xHead = 0;
+    constrainNext = 0;
+    refActiveBlocks = 0;
+    echoMicEnergy = echoErrEnergy = 0;
+    erleQ8 = 0;
+    isConverged = false;
+    convergedFrames = 0;
+    holdFrames = 0;
+    divergedFrames = 0;
+}
+
+void EchoCanceller::reset() {
+    clearFilter();
+    micStarted = false;
+    delayBlocks = 0;
+    candidate = 0;
+    candidateHits = 0;
+    envHead = envCount = 0;
+    memset(lagScore, 0, sizeof(lagScore));
+    errFloor = 0;
+    nearEndNow = false;
+    nearEndBits = 0;
+    bargeFrames = 0;
+}
+
+// Forward unscaled (16-bit input stays under 2^23), inverse halved every
+// stage (total 1/AEC_FFT), so inverse(forward(x)) == x
+void EchoCanceller::fft(int32_t* re, int32_t* im, bool inverse) const {
+    fftQ15(re, im, AEC_FFT_BITS, inverse, inverse ? FFT_HALVE_ROUND : FFT_UNSCALED);
+}
+
+// One AEC_BLOCK of mic (in place) against the aligned reference block.
+// Returns true if the block may hold near-end speech (adaptation paused).
+bool EchoCanceller::block(int16_t* pcm, const int16_t* r, bool adapt, int64_t* micE, int64_t* errE) {
+    int64_t refE = 0;
+    for (int n = 0; n < AEC_BLOCK; n++) refE += (int32_t)r[n] * r[n];
+    if (refE > 0) {
+        refActiveBlocks = AEC_PARTITIONS + 2;
+    } else if (refActiveBlocks > 0) {
+        refActiveBlocks--;
+    }
+    int64_t m = 0;
+    for (int n = 0; n < AEC_BLOCK; n++) m += (int32_t)pcm[n] * pcm[n];
+    *micE += m;
+    if (refActiveBlocks == 0) {
+        // Every partition and refPrev are silent: the echo estimate is zero
+        *errE += m;
+        return false;
+    }
+
+    // Newest reference spectrum (overlap-save: previous block | this block)
+    for (int n = 0; n < AEC_BLOCK; n++) {
+        fRe[n] = refPrev[n];
+        fRe[AEC_BLOCK + n] = r[n];
+    }
+    memset(fIm, 0, sizeof(fIm));
+    memcpy(refPrev, r, sizeof(refPrev));
+    fft(fRe, fIm, false);
+    xHead = (xHead + AEC_PARTITIONS - 1) % AEC_PARTITIONS;
+    for (int k = 0; k < AEC_BINS; k++) {
+        xRe[xHead][k] = fRe[k];
+        xIm[xHead][k] = fIm[k];
+        int64_t p = (int64_t)fRe[k] * fRe[k] + (int64_t)fIm[k] * fIm[k];
+        power[k] += (p - power[k]) >> 3;
+    }
+
+    // Echo estimate Y = Σ W_p · X_p, back to time domain (last half is valid)
+    for (int k = 0; k < AEC_BINS; k++) {
+        int64_t accRe = 0, accIm = 0;
+        for (int p = 0, x = xHead; p < AEC_PARTITIONS; p++, x = x + 1 == AEC_PARTITIONS ? 0 : x + 1) {
+            int64_t wr = wRe[p][k], wi = wIm[p][k];
+            accRe += wr * xRe[x][k] - wi * xIm[x][k];
+            accIm += wr * xIm[x][k] + wi * xRe[x][k];
+        }
+        fRe[k] = (int32_t)(accRe >> 16);
+        fIm[k] = (int32_t)(accIm >> 16);
+        if (k > 0 && k < AEC_FFT / 2) {
+            fRe[AEC_FFT - k] = fRe[k];
+            fIm[AEC_FFT - k] = -fIm[k];
+        }
+    }
+    fft(fRe, fIm, true);
+
+    int64_t e2 = 0;
+    for (int n = 0; n < AEC_BLOCK; n++) {
+        int16_t e = sat16(pcm[n] - fRe[AEC_BLOCK + n]);
+        pcm[n] = e;
+        e2 += (int32_t)e * e;
+    }
+    *errE += e2;
+
+    // Possible near-end speech: a converged filter that suddenly leaves 9 dB
+    // more than its ERLE predicts. Adaptation pauses at once.
+    int64_t expected = m >> (erleQ8 > 0 ? (erleQ8 * 85) >> 16 : 0);   // m / 2^(erle / 3.01 dB)
+    bool nearEndBlock = isConverged && e2 > expected * 8 && e2 > errFloor * 4;
+    if (nearEndBlock) holdFrames = AEC_DT_HOLD;   // stop adapting now, not at the end of the frame
+    if (!adapt || nearEndBlock) return nearEndBlock;
+
+    // NLMS: W_p += mu · E · conj(X_p) / (P + delta), E from the error block zero-padded in front
+    memset(fRe, 0, AEC_BLOCK * sizeof(int32_t));
+    for (int n = 0; n < AEC_BLOCK; n++) fRe[AEC_BLOCK + n] = pcm[n];
+    memset(fIm, 0, sizeof(fIm));
+    fft(fRe, fIm, false);
+    for (int k = 0; k < AEC_BINS; k++) {
+        int64_t den = power[k] + AEC_DELTA;
+        int64_t gr = ((int64_t)fRe[k] * AEC_MU_Q15 << 9) / den;   // mu · E / P, Q24
+        int64_t gi = ((int64_t)fIm[k] * AEC_MU_Q15 << 9) / den;
+        gr = gr > INT32_MAX ? INT32_MAX : (gr < INT32_MIN ? INT32_MIN : gr);
+        gi = gi > INT32_MAX ? INT32_MAX : (gi < INT32_MIN ? INT32_MIN : gi);
+        for (int p = 0, x = xHead; p < AEC_PARTITIONS; p++, x = x + 1 == AEC_PARTITIONS ? 0 : x + 1) {
+            int64_t xr = xRe[x][k], xi = xIm[x][k];
+            int64_t wr = wRe[p][k] + ((gr * xr + gi * xi) >> 8);
+            int64_t wi = wIm[p][k] + ((gi * xr - gr * xi) >> 8);
+            wRe[p][k] = (int32_t)(wr > (1 << 30) ? (1 << 30) : (wr < -(1 << 30) ? -(1 << 30) : wr));
+            wIm[p][k] = (int32_t)(wi > (1 << 30) ? (1 << 30) : (wi < -(1 << 30) ? -(1 << 30) : wi));
+        }
+    }
+
+    // Gradient constraint for one partition per block, round robin: its
+    // impulse response may only span AEC_BLOCK taps (the rest is circular
+    // wrap-around that the unconstrained update lets build up)
+    int c = constrainNext;
+    constrainNext = constrainNext + 1 == AEC_PARTITIONS ? 0 : constrainNext + 1;
+    for (int k = 0; k < AEC_BINS; k++) {
+        fRe[k] = wRe[c][k];
+        fIm[k] = wIm[c][k];
+        if (k > 0 && k < AEC_FFT / 2) {
+            fRe[AEC_FFT - k] = wRe[c][k];
+            fIm[AEC_FFT - k] = -wIm[c][k];
+        }
+    }
+    fft(fRe, fIm, true);
+    memset(fRe + AEC_BLOCK, 0, AEC_BLOCK * sizeof(int32_t));
+    memset(fIm, 0, sizeof(fIm));
+    fft(fRe, fIm, false);
+    for (int k = 0; k < AEC_BINS; k++) {
+        wRe[c][k] = fRe[k];
+        wIm[c][k] = fIm[k];
+    }
+    return false;
+}
+
+// Lag of the reference envelope that best explains the mic envelope
+void EchoCanceller::trackDelay() {
+    if (envCount < AEC_ENV_HISTORY) return;
+    const int newest = envHead;   // one past the newest entry
+    float mSum = 0, mSq = 0;
+    for (int j = 0; j < AEC_ENV_WINDOW; j++) {
+        float v = micEnv[(newest + AEC_ENV_HISTORY - 1 - j) % AEC_ENV_HISTORY];
+        mSum += v;
+        mSq += v * v;
+    }
+    float mVar = mSq - mSum * mSum / AEC_ENV_WINDOW;
+    if (mVar < AEC_ENV_WINDOW * 256.0f * 256.0f) return;   // under 1 bit (3 dB) of movement: no information
+
+    // Correlation per lag, smoothed over frames (~0.3s) so one loud syllable does not decide
+    for (int lag = 0; lag <= AEC_ENV_LAGS; lag++) {
+        float rSum = 0, rSq = 0, cross = 0;
+        for (int j = 0; j < AEC_ENV_WINDOW; j++) {
+            float mv = micEnv[(newest + AEC_ENV_HISTORY - 1 - j) % AEC_ENV_HISTORY];
+            float rv = refEnv[(newest + AEC_ENV_HISTORY - 1 - j - lag) % AEC_ENV_HISTORY];
+            rSum += rv;
+            rSq += rv * rv;
+            cross += mv * rv;
+        }
+        float rVar = rSq - rSum * rSum / AEC_ENV_WINDOW;
+        float corr = rVar < AEC_ENV_WINDOW * 256.0f * 256.0f ? 0 : (cross - mSum * rSum / AEC_ENV_WINDOW) / sqrtf(mVar * rVar);
+        lagScore[lag] += (corr - lagScore[lag]) * (1.0f / 16);
+    }
+    int best = -1;
+    float bestCorr = 0.5f, currentCorr = 0;
+    const int current = delayBlocks + AEC_ENV_LEAD;
+    for (int lag = 0; lag <= AEC_ENV_LAGS; lag++) {
+        if (lag >= current - 1 && lag <= current + 1 && lagScore[lag] > currentCorr) currentCorr = lagScore[lag];
+        if (lagScore[lag] > bestCorr) {
+            bestCorr = lagScore[lag];
+            best = lag;
+        }
+    }
+    // Only a clearly better peak, found again and again, moves the delay
+    if (best < 0 || bestCorr < currentCorr + 0.1f) {
+        candidateHits = 0;
+        return;
+    }
+
+    int lagBlocks = best - AEC_ENV_LEAD;
+    candidateHits = lagBlocks == candidate ? candidateHits + 1 : 1;
+    candidate = lagBlocks;
+    // The filter's lead absorbs a block of error; beyond that, realign
+    if (candidateHits >= AEC_DELAY_CONFIRM && abs(lagBlocks - delayBlocks) > 1) {
+        realign(lagBlocks);
+        candidateHits = 0;
+    }
+}
+
+// Move to a new delay without losing what the filter learned: the weights
+// shift by the difference in partitions, and the reference history is read
+// again from the timeline at the new alignment
+void EchoCanceller::realign(int newDelay) {
+    int shift = newDelay - delayBlocks;   // > 0: the echo now sits that many partitions earlier
+    delayBlocks = newDelay;
+    for (int p = 0; p < AEC_PARTITIONS; p++) {
+        int from = shift > 0 ? p + shift : AEC_PARTITIONS - 1 - p + shift;
+        int to = shift > 0 ? p : AEC_PARTITIONS - 1 - p;
+        for (int k = 0; k < AEC_BINS; k++) {
+            bool keep = from >= 0 && from < AEC_PARTITIONS;
+            wRe[to][k] = keep ? wRe[from][k] : 0;
+            wIm[to][k] = keep ? wIm[from][k] : 0;
+        }
+    }
+
+    // Newest partition = the block before micPos, as block() would have seen it
+    int16_t prev[AEC_BLOCK], cur[AEC_BLOCK];
+    uint32_t start = micPos - (delayBlocks - AEC_LEAD_BLOCKS + 1) * AEC_BLOCK;
+    refActiveBlocks = 0;
+    xHead = 0;
+    for (int p = 0; p < AEC_PARTITIONS; p++) {
+        ref->read(start - (p + 1) * AEC_BLOCK, prev, AEC_BLOCK);
+        ref->read(start - p * AEC_BLOCK, cur, AEC_BLOCK);
+        if (p == 0) memcpy(refPrev, cur, sizeof(refPrev));
+        for (int n = 0; n < AEC_BLOCK; n++) {
+            fRe[n] = prev[n];
+            fRe[AEC_BLOCK + n] = cur[n];
+            if (cur[n]) refActiveBlocks = AEC_PARTITIONS + 2;
+        }
+        memset(fIm, 0, sizeof(fIm));
+        fft(fRe, fIm, false);
+        for (int k = 0; k < AEC_BINS; k++) {
+            xRe[p][k] = fRe[k];
+            xIm[p][k] = fIm[k];
+        }
+    }
+}
+
+void EchoCanceller::process(int16_t* pcm, int n, uint32_t capturePos) {
+    if (!micStarted || abs((int32_t)(capturePos - micPos)) > AEC_REF_SLACK) {
+        micPos = capturePos;   // first frame, or samples were lost
+        micStarted = true;
+    }
+
+    int16_t r[AEC_BLOCK];
+    int64_t micE = 0, errE = 0;
+    int nearBlocks = 0, blocks = 0;
+    for (int b = 0; b + AEC_BLOCK <= n; b += AEC_BLOCK, blocks++) {
+        uint32_t pos = micPos + b;
+        int16_t* blk = pcm + b;
+
+        // Envelopes for the delay search, taken before cancellation
+        int64_t e = 0;
+        for (int i = 0; i < AEC_BLOCK; i++) e += (int32_t)blk[i] * blk[i];
+        micEnv[envHead] = log2Q8((uint64_t)e);
+        ref->read(pos + AEC_ENV_LEAD * AEC_BLOCK, r, AEC_BLOCK);
+        e = 0;
+        for (int i = 0; i < AEC_BLOCK; i++) e += (int32_t)r[i] * r[i];
+        refEnv[envHead] = log2Q8((uint64_t)e);
+        envHead = (envHead + 1) % AEC_ENV_HISTORY;
+        if (envCount < AEC_ENV_HISTORY) envCount++;
+
+        ref->read(pos - (delayBlocks - AEC_LEAD_BLOCKS) * AEC_BLOCK, r, AEC_BLOCK);
+        if (block(blk, r, holdFrames == 0, &micE, &errE)) nearBlocks++;
+    }
+    micPos += n;
+
+    // Noise floor of the output: follows dips at once, rises ~1 dB per second
+    int64_t perBlock = blocks ? errE / blocks : 0;
+    errFloor = (perBlock < errFloor || errFloor == 0) ? perBlock : errFloor + (errFloor >> 8) + 1;
+
+    // Barge-in evidence is stricter than the adaptation freeze: the filter has
+    // been converged for a second, and the frame's residual is within 6 dB of
+    // the mic and 6 dB above the floor. Echo-only frames rarely pass both,
+    // speech over the echo mostly does.
+    bool active = refActiveBlocks > 0;
+    convergedFrames = isConverged ? (convergedFrames < 50 ? convergedFrames + 1 : 50) : 0;
+    nearEndNow = active && convergedFrames >= 50 && errE * 4 > micE && perBlock > errFloor * 4;
+    if (nearBlocks) {
+        // held by block()
+    } else if (holdFrames > 0) {
+        holdFrames--;
+    } else if (active && micE > 0) {
+        // Echo only: track ERLE
+        echoMicEnergy += (micE - echoMicEnergy) >> 4;
+        echoErrEnergy += (errE - echoErrEnergy) >> 4;
+        erleQ8 = ((log2Q8((uint64_t)echoMicEnergy) - log2Q8((uint64_t)echoErrEnergy)) * 771) >> 8;   // 10·log10(2) = 3.01
+        // Hysteresis: near-end speech that slips past detection must not switch detection off
+        if (erleQ8 >= AEC_CONVERGED_DB * 256) isConverged = true;
+        else if (erleQ8 < AEC_CONVERGED_DB * 128) isConverged = false;
+        // A filter that adds energy for half a second has diverged
+        divergedFrames = errE > micE * 2 ? divergedFrames + 1 : 0;
+        if (divergedFrames > 25) clearFilter();
+    }
+
+    nearEndBits = (uint16_t)(((nearEndBits << 1) | (nearEndNow ? 1 : 0)) & 0x3FF);
+    bargeFrames = __builtin_popcount(nearEndBits);
+
+    if (active) trackDelay();
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// ============== ECHO CANCELLER ==============
+//
+// Removes the speaker's own output from the mic, so the user can talk over a
+// Gemini response (barge-in) and the conversation VAD / uplink hear only them.
+//
+// REFERENCE (EchoReference): speakerTask hands every block it writes to
+// I2S_NUM_1 (after volume, exactly as played) to write(). The block is
+// decimated 24k → 16k (polyphase FIR, 7 kHz cutoff) and stored on a timeline
+// of 16 kHz samples since boot (aecTimelinePos), at the time the block will
+// be heard: now + the audio already queued in the DMA. Blocks that follow on
+// within AEC_REF_SLACK are stored back to back, so write-time jitter does not
+// tear the reference. Time the speaker was idle reads back as zeros.
+//
+// ALIGNMENT: audioTask places each mic frame on the same timeline from its
+// capture time, with the same continuity rule. What is left is a constant
+// offset: the acoustic path plus both DMA latencies. The delay search
+// correlates 4ms log-energy envelopes of mic and reference over 0.5s for
+// lags of -AEC_MIN_DELAY_MS..AEC_MAX_DELAY_MS, smoothing each lag's score
+// over ~0.3s of frames. A new lag is adopted once the same peak has beaten
+// the current one clearly AEC_DELAY_CONFIRM times in a row. The learned
+// weights are shifted along with it, so nothing is relearned.
+//
+// FILTER: partitioned-block frequency-domain NLMS (overlap-save, 64-sample
+// blocks, 128-point FFT). AEC_PARTITIONS partitions cover 64ms of echo tail,
+// starting AEC_LEAD_BLOCKS before the estimated delay. The signal path is
+// integer-only: AudioKernels' Q15 FFT (forward unscaled, inverse scaled 1/128),
+// int32 spectra and Q16 int32 weights. The step is normalised per bin by the
+// smoothed reference power. The gradient constraint (AEC_BLOCK taps per
+// partition) costs two FFTs, so it is applied to one partition per block in
+// turn, as Speex's MDF does: a block costs five FFTs whatever the tail
+// length. Only the delay search, once per frame, uses floats.
+//
+// DOUBLE TALK: the filter counts as converged once it cancels
+// AEC_CONVERGED_DB of echo, and until it drops below half of that. While
+// converged, a block whose residual is 9 dB above what the running ERLE
+// predicts is near-end speech: adaptation stops at once and for 10 frames
+// after. A frame is a near-end frame when the speaker plays, the filter has
+// been converged for 1s, the frame cancelled less than 6 dB and its residual
+// is 6 dB above the output noise floor. AEC_BARGE_FRAMES near-end frames out
+// of the last 10 are a barge-in. A filter whose output carries twice the mic
+// energy for 0.5s has diverged and is reset.
+//
+// Pure C++ with no Arduino dependencies: tools/aeceval.cpp runs it on the
+// host against recorded speaker/mic pairs.
+//
+// =========================================
+
+#ifndef AEC_PARTITIONS
+#define AEC_PARTITIONS       16       // × 4ms blocks = 64ms echo tail
+#endif
+#ifndef AEC_LEAD_BLOCKS
+#define AEC_LEAD_BLOCKS      2        // tail starts 8ms before the estimated delay
+#endif
+#ifndef AEC_MIN_DELAY_MS
+#define AEC_MIN_DELAY_MS     32       // timestamps may put the reference late by up to this
+#endif
+#ifndef AEC_MAX_DELAY_MS
+#define AEC_MAX_DELAY_MS     160
+#endif
+#ifndef AEC_DELAY_CONFIRM
+#define AEC_DELAY_CONFIRM    5
+#endif
+#ifndef AEC_MU_Q15
+#define AEC_MU_Q15           1638     // NLMS step 0.05 (~0.8 / AEC_PARTITIONS)
+#endif
+#ifndef AEC_CONVERGED_DB
+#define AEC_CONVERGED_DB     10
+#endif
+#ifndef AEC_BARGE_FRAMES
+#define AEC_BARGE_FRAMES     6        // near-end frames out of 10 for a barge-in (120ms)
+#endif
+#ifndef AEC_REF_RING_SAMPLES
+#define AEC_REF_RING_SAMPLES 16384    // ~1s of reference (power of two)
+#endif
+#ifndef AEC_REF_SLACK
+#define AEC_REF_SLACK        160      // 10ms: closer than this to the previous block = contiguous
+#endif
+
+#define AEC_BLOCK            64
+#define AEC_FFT              128
+#define AEC_FFT_BITS         7
+#define AEC_BINS             (AEC_FFT / 2 + 1)
+static_assert(AEC_FFT == 1 << AEC_FFT_BITS, "AEC_FFT_BITS");
+#define AEC_DECIM_TAPS       36       // 48 kHz prototype, 18 taps per phase
+#define AEC_ENV_HISTORY      128      // 4ms envelope blocks kept for the delay search (512ms)
+
+// Position on the shared 16 kHz timeline of a time from esp_timer_get_time()
+static inline uint32_t aecTimelinePos(int64_t us) { return (uint32_t)(us * 16 / 1000); }
+
+class EchoReference {
+public:
+    // Allocate the ring. False on allocation failure (the canceller then sees silence).
+    bool begin();
+
+    // ── speakerTask ──
+    // One rendered block, interleaved stereo 24 kHz, first heard at timeline position playPos
+    void write(const int16_t* stereo, int frames, uint32_t playPos);
+    // The DMA was zeroed: nothing from pos on will be heard
+    void cut(uint32_t pos);
+
+    // ── audioTask ──
+    // n samples of the timeline from pos (zeros where nothing was played)
+    void read(uint32_t pos, int16_t* out, int n) const;
+
+private:
+    int16_t* ring = nullptr;
+    std::atomic<uint32_t> head{0};     // timeline position one past the newest sample
+    bool     started = false;
+    int16_t  coefs[AEC_DECIM_TAPS];    // Q15, gain 2 (zero stuffing)
+    int16_t  hist[AEC_DECIM_TAPS / 2]; // last 24 kHz input samples, newest first
+    uint32_t phase = 0;                // input samples mod 3
+};
+
+class EchoCanceller {
+public:
+    void begin(const EchoReference* reference);
+    // Forget the echo path (filter, delay) — e.g. after the speaker hardware changed
+    void reset();
+
+    // Cancel echo from one mic frame in place. n must be a multiple of AEC_BLOCK.
+    // capturePos: timeline position of the frame's first sample.
+    void process(int16_t* pcm, int n, uint32_t capturePos);
+
+    bool  bargeIn() const      { return bargeFrames >= AEC_BARGE_FRAMES; }
+    bool  nearEnd() const      { return nearEndNow; }
+    bool  converged() const    { return isConverged; }
+    bool  speakerActive() const { return refActiveBlocks > 0; }
+    float erleDb() const       { return erleQ8 / 256.0f; }
+    int   delayMs() const      { return delayBlocks * AEC_BLOCK / 16; }
+
+private:
+    void  fft(int32_t* re, int32_t* im, bool inverse) const;
+    bool  block(int16_t* pcm, const int16_t* r, bool adapt, int64_t* micE, int64_t* errE);
+    void  trackDelay();
+    void  realign(int newDelay);
+    void  clearFilter();
+
+    const EchoReference* ref = nullptr;
+
+    // Filter state
+    int16_t  refPrev[AEC_BLOCK];                  // previous reference block (overlap-save)
+    int32_t  xRe[AEC_PARTITIONS][AEC_BINS];       // reference spectra, newest at xHead
+    int32_t  xIm[AEC_PARTITIONS][AEC_BINS];
+    int      xHead = 0;
+    int      constrainNext = 0;                   // partition whose gradient is constrained next
+    int32_t  wRe[AEC_PARTITIONS][AEC_BINS];       // weights, Q16
+    int32_t  wIm[AEC_PARTITIONS][AEC_BINS];
+    int64_t  power[AEC_BINS];                     // smoothed |X|^2
+    int32_t  fRe[AEC_FFT];                        // FFT scratch
+    int32_t  fIm[AEC_FFT];
+    int      refActiveBlocks = 0;                 // > 0 while reference energy is inside the filter span
+
+    // Alignment
+    uint32_t micPos = 0;
+    bool     micStarted = false;
+    int      delayBlocks = 0;                     // reference read at micPos - delay (+ lead)
+    int      candidate = 0;
+    int      candidateHits = 0;
+    int16_t  micEnv[AEC_ENV_HISTORY];             // log2 energy, Q8, per 4ms block
+    int16_t  refEnv[AEC_ENV_HISTORY];
+    float    lagScore[(AEC_MIN_DELAY_MS + AEC_MAX_DELAY_MS) / 4 + 1];
+    int      envHead = 0;
+    int      envCount = 0;
+
+    // Double talk / convergence
+    int64_t  echoMicEnergy = 0;                   // smoothed over echo-only frames
+    int64_t  echoErrEnergy = 0;
+    int32_t  erleQ8 = 0;
+    bool     isConverged = false;                 // ERLE reached AEC_CONVERGED_DB, not yet below half of it
+    int      convergedFrames = 0;
+    int      holdFrames = 0;
+    int      divergedFrames = 0;
+    int64_t  errFloor = 0;                        // output noise floor, per block
+    bool     nearEndNow = false;
+    uint16_t nearEndBits = 0;                     // last 10 frames
+    int      bargeFrames = 0;
+};
@@ -0,0 +1,113 @@
+#include "Endpointer.h"
+#include <math.h>
+
+static const float LP_ALPHA = 0.0937f;    // 1 - exp(-2π · 250 / 16000)
+static const float MIN_FLOOR = 16.0f;     // energy floor never drops below (digital silence)
+
+void Endpointer::FloorTracker::reset(float e) {
+    for (int i = 0; i < EP_FLOOR_BLOCKS; i++) blockMin[i] = e;
+    curMin = e;
+    block = 0;
+    frames = 0;
+    floor = e;
+}
+
+void Endpointer::FloorTracker::add(float e) {
+    if (e < MIN_FLOOR) e = MIN_FLOOR;
+    if (e < curMin) curMin = e;
+    if (++frames == EP_FLOOR_BLOCK_LEN) {
+        blockMin[block] = curMin;
+        block = (block + 1) % EP_FLOOR_BLOCKS;
+        frames = 0;
+        curMin = e;
+    }
+    float m = curMin;
+    for (int i = 0; i < EP_FLOOR_BLOCKS; i++) {
+        if (blockMin[i] < m) m = blockMin[i];
+    }
+    floor = m;
+}
+
+void Endpointer::begin(uint32_t silenceMs) {
+    noSpeechMs = silenceMs;
+    primed = false;
+    beginTurn();
+}
+
+void Endpointer::beginTurn() {
+    history = 0;
+    started = false;
+    gapFrames = 0;
+}
+
+uint32_t Endpointer::hangoverMs() const {
+    if (pauses < EP_LEARN_PAUSES) return noSpeechMs;
+    float h = pauseMean + EP_PAUSE_K * pauseDev;
+    if (h < pauseMax + EP_PAUSE_MARGIN_MS) h = pauseMax + EP_PAUSE_MARGIN_MS;
+    if (h < EP_MIN_HANGOVER_MS) h = EP_MIN_HANGOVER_MS;
+    if (h > noSpeechMs) h = noSpeechMs;
+    return (uint32_t)h;
+}
+
+bool Endpointer::process(const int16_t* pcm, size_t n) {
+    if (n == 0) return false;
+    float eBand = 0, eHigh = 0;
+    int crossings = 0;
+    for (size_t i = 0; i < n; i++) {
+        float x = pcm[i];
+        lp += LP_ALPHA * (x - lp);
+        float b = x - lp;                  // speech band: DC, hum and rumble removed
+        float h = x - prevX;               // high band: +6 dB/octave tilt
+        eBand += b * b;
+        eHigh += h * h;
+        if ((b < 0) != (prevB < 0)) crossings++;
+        prevX = x;
+        prevB = b;
+    }
+    eBand /= n;
+    eHigh /= n;
+    float zcr = (float)crossings / n;
+
+    if (!primed) {
+        // First frame since boot: assume it is room noise (the user has just pressed the button)
+        band.reset(eBand < MIN_FLOOR ? MIN_FLOOR : eBand);
+        high.reset(eHigh < MIN_FLOOR ? MIN_FLOOR : eHigh);
+        primed = true;
+    }
+    band.add(eBand);
+    high.add(eHigh);
+
+    bool voiced = eBand > band.floor * EP_SNR;
+    bool unvoiced = eHigh > high.floor * EP_SNR && zcr > EP_FRICATIVE_ZCR;
+    history = (history << 1) | (voiced || unvoiced);
+
+    if (!(history & 1)) {
+        if (started) gapFrames++;
+        return false;
+    }
+
+    // A speech frame right after a pause must be a real onset again (3 of 5),
+    // a frame inside a word just continues
+    uint32_t gapMs = gapFrames * EP_FRAME_MS;
+    bool onset = __builtin_popcount(history & 0x1F) >= 3;
+    if (!started) {
+        if (!onset) return false;
+        started = true;
+        gapFrames = 0;
+        return true;
+    }
+    if (gapMs >= EP_MIN_PAUSE_MS) {
+        if (!onset) {
+            gapFrames++;
+            return false;
+        }
+        // The speaker resumed after a pause: learn its length
+        float p = (float)gapMs;
+        pauseDev += (fabsf(p - pauseMean) - pauseDev) * 0.125f;
+        pauseMean += (p - pauseMean) * 0.125f;
+        pauseMax = p > pauseMax ? p : pauseMax - (pauseMax - pauseMean) * 0.125f;
+        pauses++;
+    }
+    gapFrames = 0;
+    return true;
+}
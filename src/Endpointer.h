@@ -0,0 +1,112 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ============== ENDPOINTER ==============
+//
+// Decides when the user has finished speaking. audioTask feeds it every 20ms
+// mic frame while recording. It replaces the fixed rule "3 frames with mean
+// |sample| above VAD_THRESHOLD, then VAD_SILENCE_MS of nothing":
+//
+//   Features  speech-band energy (DC and rumble removed by a 250 Hz high-pass),
+//             high-band energy (first difference) and zero-crossing rate.
+//   Floors    each band tracks its own noise floor by minimum statistics: the
+//             lowest frame energy of the last ~2s. Gaps between words keep it
+//             on the room noise, and a fan or a louder room is learned within
+//             2s instead of being taken for speech.
+//   Speech    the speech band EP_SNR above its floor (voiced), or the high band
+//             EP_SNR above its floor with a high crossing rate (s, f, sh).
+//   Onset     3 of the last 5 frames are speech, so a tap or click is not.
+//   Hangover  how long silence must last to end the turn, learned from the
+//             mid-turn pauses after which the speaker carried on talking:
+//             the larger of EMA mean + EP_PAUSE_K × EMA deviation and the
+//             recent longest pause + EP_PAUSE_MARGIN_MS. It is clamped to
+//             EP_MIN_HANGOVER_MS..the old fixed window. A pause longer than
+//             the hangover ends the turn and is never seen, so the learned
+//             value only applies after EP_LEARN_PAUSES pauses; until then the
+//             old window applies. The statistics persist across turns: a brisk
+//             speaker converges to ~650ms, one who pauses to think keeps
+//             nearly the full window.
+//
+// Until the first onset of a turn the window stays at the old fixed value,
+// so a user who has not started talking yet is not cut off.
+//
+// loop() ends the turn when millis() - lastVoiceActivityTime > silenceMs().
+// audioTask refreshes lastVoiceActivityTime whenever process() returns true.
+//
+// Pure C++ with no Arduino dependencies: tools/epeval.cpp replays labeled
+// recordings through it on the host.
+//
+// =========================================
+
+#ifndef EP_SNR
+#define EP_SNR                 6.0f    // frame energy / noise floor to count as speech (~8 dB)
+#endif
+#ifndef EP_FRICATIVE_ZCR
+#define EP_FRICATIVE_ZCR       0.30f   // zero crossings per sample for an unvoiced frame
+#endif
+#ifndef EP_MIN_HANGOVER_MS
+#define EP_MIN_HANGOVER_MS     400
+#endif
+#ifndef EP_PAUSE_K
+#define EP_PAUSE_K             2.5f    // hangover = pause mean + K × pause deviation
+#endif
+#ifndef EP_PAUSE_MARGIN_MS
+#define EP_PAUSE_MARGIN_MS     300     // hangover >= recent longest pause + margin
+#endif
+#ifndef EP_MIN_PAUSE_MS
+#define EP_MIN_PAUSE_MS        120     // shorter gaps are dips inside a word, not pauses
+#endif
+#ifndef EP_LEARN_PAUSES
+#define EP_LEARN_PAUSES        4       // pauses seen before the learned hangover is trusted
+#endif
+
+#define EP_FRAME_MS        20          // one MIC_FRAME_SIZE frame at 16 kHz
+#define EP_FLOOR_BLOCKS    10          // minimum statistics: 10 blocks...
+#define EP_FLOOR_BLOCK_LEN 10          // ...of 10 frames = 2s
+
+class Endpointer {
+public:
+    // silenceMs: the old fixed window (VAD_SILENCE_MS). It is the no-speech timeout and the hangover ceiling.
+    void begin(uint32_t silenceMs);
+
+    // New recording: onset not yet seen. Noise floors and pause statistics carry over.
+    void beginTurn();
+
+    // One frame of 16 kHz mono audio. True while the user is speaking.
+    bool process(const int16_t* pcm, size_t n);
+
+    // Silence that ends the turn right now (no-speech timeout before the first onset)
+    uint32_t silenceMs() const { return started ? hangoverMs() : noSpeechMs; }
+    uint32_t hangoverMs() const;
+    bool     speechStarted() const { return started; }
+    uint32_t pausesLearned() const { return pauses; }
+
+private:
+    struct FloorTracker {
+        float blockMin[EP_FLOOR_BLOCKS];
+        float curMin;
+        int   block;
+        int   frames;
+        float floor;
+        void  reset(float e);
+        void  add(float e);
+    };
+
+    uint32_t noSpeechMs = 1200;
+    FloorTracker band;
+    FloorTracker high;
+    float    lp = 0;               // 250 Hz one-pole low-pass (subtracted: high-pass)
+    float    prevX = 0;
+    float    prevB = 0;
+    bool     primed = false;
+
+    uint8_t  history = 0;          // speech-frame bits, newest in bit 0
+    bool     started = false;
+    uint32_t gapFrames = 0;        // non-speech frames since the last speech frame
+    float    pauseMean = 300.0f;   // ms, EMA of mid-turn pauses
+    float    pauseDev = 100.0f;    // ms, EMA of |pause - mean|
+    float    pauseMax = 0;         // ms, longest recent pause, decaying toward the mean
+    uint32_t pauses = 0;
+};
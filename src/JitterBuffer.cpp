@@ -0,0 +1,91 @@
+#include "JitterBuffer.h"
+
+// ── websocketTask ────────────────────────────────────────────────────────────
+
+void JitterBuffer::onPacket(uint32_t nowMs, size_t pcmBytes) {
+    if (lastArrival == 0 || (nowMs - lastArrival) > JB_STREAM_GAP_MS) {
+        // New stream: restart the media clock and let the estimate decay so a
+        // link that has recovered earns back latency over a few responses
+        streamId++;
+        streamStart = nowMs;
+        mediaBytes = 0;
+        lastDurationMs = 0;
+        lateEstimate *= 0.75f;
+    } else {
+        // RFC 3550 interarrival jitter: D = arrival spacing − media spacing
+        float d = (float)(nowMs - lastArrival) - (float)lastDurationMs;
+        jitter = jitter + (fabsf(d) - jitter) / 16.0f;
+
+        // Lateness against the stream's media clock = prebuffer this packet needed
+        float late = (float)(nowMs - streamStart) - (float)bytesToMs(mediaBytes);
+        if (late > lateEstimate) lateEstimate = late;  // fast attack
+
+        if (ranDry && dryStreamId == streamId) {
+            underrunCount++;
+        }
+    }
+    ranDry = false;
+
+    lastDurationMs = bytesToMs(pcmBytes);
+    mediaBytes += pcmBytes;
+    lastArrival = nowMs;
+    updateTarget();
+}
+
+void JitterBuffer::updateTarget() {
+    float t = JB_MIN_MS + lateEstimate;
+    if (t > JB_MAX_MS) t = JB_MAX_MS;
+    target = (uint32_t)t;
+}
+
+// ── speakerTask ──────────────────────────────────────────────────────────────
+
+bool JitterBuffer::hold(uint32_t nowMs, uint32_t bufferedMs) {
+    if (playing) return false;
+    if (bufferedMs == 0) return true;
+
+    // Stall: the stream ended (or paused) before reaching target — play what we have
+    if (bufferedMs >= target || (nowMs - lastArrival) >= JB_STALL_MS) {
+        playing = true;
+        playoutDeadline = nowMs;
+        insertedPending = 0;
+        return false;
+    }
+    return true;
+}
+
+int JitterBuffer::stretch(uint32_t bufferedMs, int32_t level, int numSamples) {
+    if (!playing || level >= JB_SILENCE_LEVEL) return 0;
+
+    // Grow: below target — pad this silent frame by half its length
+    if (bufferedMs + JB_HYST_MS < target) {
+        int add = numSamples / 2;
+        insertedPending += add;
+        insertedTotal += add;
+        return add;
+    }
+    // Shrink: above target — give back silence we inserted earlier, never natural pauses
+    if (bufferedMs > target + JB_HYST_MS && insertedPending > 0) {
+        int drop = min(numSamples / 2, (int)insertedPending);
+        insertedPending -= drop;
+        droppedTotal += drop;
+        return -drop;
+    }
+    return 0;
+}
+
+void JitterBuffer::onPlayed(uint32_t nowMs, int numSamples) {
+    // speakerTask never queues more than the DMA profile's depth, so the deadline
+    // never runs more than dmaMs ahead of now
+    if ((int32_t)(nowMs - playoutDeadline) > 0) playoutDeadline = nowMs;
+    playoutDeadline += numSamples / 24;
+    if ((int32_t)(playoutDeadline - nowMs) > (int32_t)dmaMs) playoutDeadline = nowMs + dmaMs;
+}
+
+void JitterBuffer::onEmpty(uint32_t nowMs) {
+    if (!playing || (int32_t)(nowMs - playoutDeadline) <= 0) return;
+    // DMA has played everything we gave it — rebuffer before the next frame
+    playing = false;
+    dryStreamId = streamId;
+    ranDry = true;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <Arduino.h>
+
+// ============== JITTER BUFFER ==============
+//
+// Adaptive playout delay for Gemini voice. Replaces the hand-tuned "wait for
+// N packets" start condition with a target measured from the stream itself.
+//
+// ESTIMATE (websocketTask, onPacket): every packet's arrival is compared with
+// its position on the stream's media clock (cumulative PCM duration since the
+// first packet). Positive lateness is exactly how much prebuffer would have
+// been needed to play that packet without a gap. The peak is tracked with a
+// fast attack; each new stream decays it so a good link earns back latency.
+// RFC 3550 inter-arrival jitter is also kept for the [STREAM] log.
+//
+// PLAYOUT (speakerTask): holds a new stream until the ring holds targetMs of
+// audio (or arrivals stall), then plays. While playing, silent frames are
+// time-stretched: extra silence is inserted when the buffer is below target,
+// and previously inserted silence is dropped again once it is above target —
+// speech frames and natural pauses are never altered.
+//
+// Underruns are counted when the I2S DMA ran dry mid-stream (a packet of the
+// same stream arrives after the playout clock passed its deadline).
+//
+// Ambient, radio and alarm streams bypass the jitter buffer — they are paced
+// by server backpressure and start on the fixed prebuffer as before.
+//
+// ==========================================
+
+#ifndef JB_MIN_MS
+#define JB_MIN_MS 60            // Floor for the target — one or two Gemini packets
+#endif
+#ifndef JB_MAX_MS
+#define JB_MAX_MS 600           // Ceiling for the target on very bad links
+#endif
+#ifndef JB_STALL_MS
+#define JB_STALL_MS 200         // Start anyway if no packet for this long (short responses)
+#endif
+#ifndef JB_STREAM_GAP_MS
+#define JB_STREAM_GAP_MS 500    // Arrival gap that marks a new stream
+#endif
+#ifndef JB_HYST_MS
+#define JB_HYST_MS 40           // Dead band around the target before stretching
+#endif
+#ifndef JB_SILENCE_LEVEL
+#define JB_SILENCE_LEVEL 150    // Mean |sample| below which a frame may be stretched
+#endif
+#ifndef JB_DMA_MS
+#define JB_DMA_MS 128           // Default audio held by the speaker DMA queue (see setDmaMs)
+#endif
+
+class JitterBuffer {
+public:
+    // ── websocketTask ──
+    // Record a Gemini packet of pcmBytes (24kHz 16-bit mono) arriving at nowMs.
+    void onPacket(uint32_t nowMs, size_t pcmBytes);
+
+    // ── speakerTask ──
+    // True while a new stream should keep buffering. bufferedMs = audio waiting in the ring.
+    bool hold(uint32_t nowMs, uint32_t bufferedMs);
+    // Samples to add (>0, insert silence) or remove (<0) for a frame of numSamples at level.
+    int stretch(uint32_t bufferedMs, int32_t level, int numSamples);
+    // numSamples were handed to I2S at nowMs — advances the playout clock.
+    void onPlayed(uint32_t nowMs, int numSamples);
+    // Ring was empty at nowMs — returns to buffering once the DMA has drained.
+    void onEmpty(uint32_t nowMs);
+    // Depth of the speaker DMA queue for the active DMA profile (caps the playout clock).
+    void setDmaMs(uint32_t ms) { dmaMs = ms; }
+
+    uint32_t targetMs() const   { return target; }
+    float    jitterMs() const   { return jitter; }
+    uint32_t underruns() const  { return underrunCount; }
+    uint32_t stretchedInMs() const  { return insertedTotal / 24; }
+    uint32_t stretchedOutMs() const { return droppedTotal / 24; }
+    bool     isPlaying() const  { return playing; }
+
+    static uint32_t bytesToMs(uint32_t bytes) { return bytes / 48; }  // 24kHz × 2 bytes
+
+private:
+    void updateTarget();
+
+    // Producer state
+    volatile uint32_t lastArrival = 0;     // also read by hold() for the stall check
+    uint32_t streamStart = 0;
+    uint32_t mediaBytes = 0;       // media clock: audio received in this stream
+    uint32_t lastDurationMs = 0;
+    float    lateEstimate = 0.0f;  // smoothed peak lateness (ms)
+    volatile float    jitter = 0.0f;
+    volatile uint32_t target = JB_MIN_MS;
+    volatile uint32_t underrunCount = 0;
+    volatile uint32_t streamId = 0;
+
+    // Consumer state
+    volatile bool playing = false;
+    volatile bool ranDry = false;          // DMA drained while playing — next packet of same stream = underrun
+    volatile uint32_t dryStreamId = 0;
+    uint32_t playoutDeadline = 0;          // millis() at which DMA runs out of audio
+    uint32_t dmaMs = JB_DMA_MS;
+    int32_t  insertedPending = 0;          // samples of inserted silence not yet given back
+    uint32_t insertedTotal = 0;
+    uint32_t droppedTotal = 0;
+};
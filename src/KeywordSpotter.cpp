@@ -0,0 +1,458 @@
+#include "KeywordSpotter.h"
+#include "AudioKernels.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ARDUINO
+#include <esp_heap_caps.h>
+#endif
+
+// The PIE dot8 reads whole 16-byte blocks, up to 16 bytes past its operands
+#define KWS_READ_SLACK 16
+
+// Weights and activations are read on every inference: internal RAM first
+static void* kwsAlloc(size_t n) {
+    n += KWS_READ_SLACK;
+#ifdef ARDUINO
+    void* p = heap_caps_malloc(n, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    return p ? p : heap_caps_malloc(n, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+#else
+    return malloc(n);
+#endif
+}
+
+static void kwsFree(void* p) {
+#ifdef ARDUINO
+    heap_caps_free(p);
+#else
+    free(p);
+#endif
+}
+
+static inline size_t pad4(size_t n) { return (n + 3) & ~(size_t)3; }
+
+// ── Frontend ─────────────────────────────────────────────────────────────────
+
+static float hzToMel(float f) { return 2595.0f * log10f(1.0f + f / 700.0f); }
+static float melToHz(float m) { return 700.0f * (powf(10.0f, m / 2595.0f) - 1.0f); }
+
+void KwsFrontend::begin(int bands) {
+    nBands = bands;
+    for (int n = 0; n < KWS_WINDOW; n++) {
+        window[n] = (int16_t)lroundf(32767.0f * (0.5f - 0.5f * cosf(2.0f * (float)M_PI * n / KWS_WINDOW)));
+    }
+    for (int i = 0; i < 256; i++) {
+        log2Frac[i] = (uint8_t)lroundf(256.0f * log2f(1.0f + i / 256.0f));
+    }
+
+    // bands + 2 edges evenly spaced in mel; band j rises from edge j to j + 1
+    // and falls to j + 2
+    float edges[KWS_MAX_BANDS + 2];
+    float lo = hzToMel(125.0f), hi = hzToMel(7500.0f);
+    for (int j = 0; j < bands + 2; j++) {
+        edges[j] = melToHz(lo + (hi - lo) * j / (bands + 1));
+    }
+    for (int k = 0; k < KWS_BINS; k++) {
+        float f = (float)k * KWS_SAMPLE_RATE / KWS_WINDOW;
+        binBand[k] = -1;
+        binWeight[k] = 0;
+        for (int j = 0; j <= bands; j++) {
+            if (f >= edges[j] && f < edges[j + 1]) {
+                binBand[k] = (int8_t)j;
+                binWeight[k] = (uint16_t)lroundf(32767.0f * (f - edges[j]) / (edges[j + 1] - edges[j]));
+                break;
+            }
+        }
+    }
+    reset();
+}
+
+void KwsFrontend::reset() {
+    memset(tail, 0, sizeof(tail));
+}
+
+void KwsFrontend::process(const int16_t* hop, int16_t* logQ8) {
+    const int keep = KWS_WINDOW - KWS_HOP;
+    for (int n = 0; n < keep; n++) re[n] = tail[n];
+    for (int n = 0; n < KWS_HOP; n++) re[keep + n] = hop[n];
+    for (int n = 0; n < keep; n++) tail[n] = (int16_t)re[KWS_HOP + n];
+
+    for (int n = 0; n < KWS_WINDOW; n++) {
+        re[n] = ((int32_t)re[n] * window[n]) >> 15;
+        im[n] = 0;
+    }
+    // Halved every stage so the bins stay 16-bit (total scale 1/512)
+    fftQ15(re, im, KWS_FFT_BITS, false, FFT_HALVE);
+
+    uint64_t acc[KWS_MAX_BANDS + 1] = {0};
+    for (int k = 0; k < KWS_BINS; k++) {
+        int j = binBand[k];
+        if (j < 0) continue;
+        uint64_t p = (uint64_t)(re[k] * re[k]) + (uint64_t)(im[k] * im[k]);
+        uint64_t w = binWeight[k];
+        acc[j] += p * w;                       // rising slope of band j
+        if (j > 0) acc[j - 1] += p * (32767 - w);  // falling slope of band j - 1
+    }
+
+    // log2 in Q8 of the Q15-weighted sums
+    for (int j = 0; j < nBands; j++) {
+        uint64_t v = acc[j] + 1;
+        int msb = 63 - __builtin_clzll(v);
+        uint32_t frac = msb >= 8 ? (uint32_t)(v >> (msb - 8)) & 0xFF : (uint32_t)(v << (8 - msb)) & 0xFF;
+        logQ8[j] = (int16_t)((msb - 15) * 256 + log2Frac[frac]);
+    }
+}
+
+// ── Model ────────────────────────────────────────────────────────────────────
+
+static inline int32_t dot8Portable(const int8_t* a, const int8_t* b, int n) {
+    int32_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    for (; i < n; i++) s0 += a[i] * b[i];
+    return s0 + s1 + s2 + s3;
+}
+
+#if defined(CONFIG_IDF_TARGET_ESP32S3) && defined(KWS_PIE)
+// Opt-in (KWS_PIE): this kernel has not yet been assembled or run on a
+// device. Build it once with KWS_PIE, check load() settles on "PIE", then
+// compare kwseval scores against the portable build before turning it on.
+//
+// 16 MACs per EE.VMULAS.S8.ACCX into the 40-bit ACCX. Rows start anywhere
+// (a kernel row at kx0, an input pixel), so each operand is read as aligned
+// blocks: EE.LD.128.USAR.IP latches the pointer's offset in SAR_BYTE and
+// EE.SRC.Q.QUP shifts the last two blocks into the 16 bytes at the pointer.
+// Each load is followed by its own shift, so one SAR_BYTE serves both
+// streams. audioTask is the only PIE user, so q0-q5 and ACCX need no saving.
+//
+// Must stay a noinline leaf: the compiler is not told about q0-q5, ACCX or
+// SAR_BYTE, so it must not interleave a caller's code with the asm, and the
+// function calls nothing. The loop counts down in a register and branches
+// back instead of using LOOPNEZ, so it never touches LBEG/LEND/LCOUNT and
+// cannot break a zero-overhead loop the caller is inside.
+__attribute__((noinline)) static int32_t dot8Pie(const int8_t* a, const int8_t* b, int n) {
+    int blocks = n >> 4;
+    int32_t s = 0;
+    if (blocks) {
+        const int8_t* pa = a;
+        const int8_t* pb = b;
+        int left = blocks;
+        asm volatile(
+            "ee.zero.accx\n"
+            "ee.ld.128.usar.ip q0, %[pa], 16\n"
+            "ee.ld.128.usar.ip q2, %[pb], 16\n"
+            "1:\n"
+            "ee.ld.128.usar.ip q1, %[pa], 16\n"
+            "ee.src.q.qup q4, q0, q1\n"
+            "ee.ld.128.usar.ip q3, %[pb], 16\n"
+            "ee.src.q.qup q5, q2, q3\n"
+            "ee.vmulas.s8.accx q4, q5\n"
+            "addi %[left], %[left], -1\n"
+            "bnez %[left], 1b\n"
+            "ee.srs.accx %[s], %[zero], 0\n"
+            : [pa] "+r"(pa), [pb] "+r"(pb), [left] "+r"(left), [s] "=&r"(s)
+            : [zero] "r"(0)
+            : "memory");
+    }
+    int done = blocks << 4;
+    return s + dot8Portable(a + done, b + done, n - done);
+}
+
+static bool usePie = false;
+
+// Every offset of both operands against the portable loop; any difference
+// (an assembler or silicon surprise) keeps the portable kernel
+static bool pieAgrees() {
+    static int8_t x[96 + KWS_READ_SLACK], y[96 + KWS_READ_SLACK];
+    uint32_t r = 0x12345678;
+    for (size_t i = 0; i < sizeof(x); i++) {
+        r = r * 1664525u + 1013904223u;
+        x[i] = (int8_t)(r >> 24);
+        y[i] = (int8_t)(r >> 16);
+    }
+    x[0] = y[0] = -128;   // the extremes
+    x[1] = -128;
+    y[1] = 127;
+    static const int lengths[] = { 1, 15, 16, 17, 31, 32, 47, 64, 80 };
+    for (int oa = 0; oa < 16; oa++) {
+        for (int ob = 0; ob < 16; ob++) {
+            for (int n : lengths) {
+                if (dot8Pie(x + oa, y + ob, n) != dot8Portable(x + oa, y + ob, n)) return false;
+            }
+        }
+    }
+    return true;
+}
+
+static inline int32_t dot8(const int8_t* a, const int8_t* b, int n) {
+    return usePie ? dot8Pie(a, b, n) : dot8Portable(a, b, n);
+}
+#else
+static const bool usePie = false;
+static inline int32_t dot8(const int8_t* a, const int8_t* b, int n) { return dot8Portable(a, b, n); }
+#endif
+
+static inline int8_t requant(int32_t acc, int32_t mult, int8_t shift, bool relu) {
+    int total = 31 + shift;
+    int64_t v = ((int64_t)acc * mult + ((int64_t)1 << (total - 1))) >> total;
+    int64_t lo = relu ? 0 : -128;
+    if (v < lo) v = lo;
+    if (v > 127) v = 127;
+    return (int8_t)v;
+}
+
+void KeywordSpotter::unload() {
+    if (model) kwsFree(model);
+    if (arena) kwsFree(arena);
+    model = nullptr;
+    arena = nullptr;
+    layerCount = 0;
+    macCount = 0;
+}
+
+bool KeywordSpotter::load(const uint8_t* blob, size_t len) {
+    unload();
+    err = nullptr;
+    KwsModelHeader h;
+    if (len < sizeof(h)) err = "truncated header";
+    else {
+        memcpy(&h, blob, sizeof(h));
+        if (h.magic != KWS_MODEL_MAGIC || h.version != KWS_MODEL_VERSION) err = "not a JBK1 model";
+        else if (h.layers < 1 || h.layers > KWS_MAX_LAYERS) err = "layer count";
+        else if (h.frames < 1 || h.frames > KWS_MAX_FRAMES || h.bands < 1 || h.bands > KWS_MAX_BANDS) err = "input shape";
+        else if (h.classes < 2 || h.classes > KWS_MAX_CLASSES || h.keyword >= h.classes) err = "classes";
+        else if (!(h.threshold > 0.0f && h.threshold <= 1.0f) || !(h.outScale > 0.0f)) err = "threshold / scale";
+    }
+    if (err) return false;
+
+    model = (uint8_t*)kwsAlloc(len);
+    if (!model) {
+        err = "out of memory";
+        return false;
+    }
+    memcpy(model, blob, len);
+    hdr = h;
+    hdr.name[sizeof(hdr.name) - 1] = '\0';
+
+    size_t pos = sizeof(KwsModelHeader);
+    int H = h.frames, W = h.bands, C = 1;
+    size_t maxBytes = (size_t)H * W;
+    uint32_t macs = 0;
+    for (int i = 0; i < h.layers && !err; i++) {
+        Layer& l = layers[i];
+        if (pos + sizeof(KwsLayerHeader) > len) { err = "truncated layer"; break; }
+        memcpy(&l.h, model + pos, sizeof(KwsLayerHeader));
+        pos += sizeof(KwsLayerHeader);
+        l.inH = H; l.inW = W; l.inC = C;
+
+        size_t wCount = 0;
+        switch (l.h.type) {
+            case KWS_CONV:
+            case KWS_DWCONV:
+                if (!l.h.kh || !l.h.kw || !l.h.sh || !l.h.sw) { err = "kernel / stride"; break; }
+                l.outH = (H + l.h.sh - 1) / l.h.sh;
+                l.outW = (W + l.h.sw - 1) / l.h.sw;
+                l.outC = l.h.type == KWS_CONV ? l.h.outC : C;
+                wCount = l.h.type == KWS_CONV ? (size_t)l.outC * l.h.kh * l.h.kw * C : (size_t)l.h.kh * l.h.kw * C;
+                macs += (uint32_t)(l.outH * l.outW * wCount);
+                break;
+            case KWS_AVGPOOL:
+                l.outH = 1; l.outW = 1; l.outC = C;
+                break;
+            case KWS_FC:
+                l.outH = 1; l.outW = 1; l.outC = l.h.outC;
+                wCount = (size_t)l.outC * H * W * C;
+                macs += (uint32_t)wCount;
+                break;
+            default:
+                err = "unknown layer type";
+        }
+        if (err) break;
+        if (l.outC < 1 || l.outC > KWS_MAX_CHANNELS) { err = "channel count"; break; }
+
+        l.weights = nullptr; l.bias = nullptr; l.mult = nullptr; l.shift = nullptr;
+        if (l.h.type != KWS_AVGPOOL) {
+            size_t need = pad4(wCount) + 8 * (size_t)l.outC + pad4(l.outC);
+            if (pos + need > len) { err = "truncated parameters"; break; }
+            l.weights = (const int8_t*)(model + pos);   pos += pad4(wCount);
+            l.bias    = (const int32_t*)(model + pos);  pos += 4 * (size_t)l.outC;
+            l.mult    = (const int32_t*)(model + pos);  pos += 4 * (size_t)l.outC;
+            l.shift   = (const int8_t*)(model + pos);   pos += pad4(l.outC);
+            for (int c = 0; c < l.outC; c++) {
+                if (l.shift[c] < -30 || l.shift[c] > 31) { err = "requant shift"; break; }
+            }
+        }
+        H = l.outH; W = l.outW; C = l.outC;
+        size_t bytes = (size_t)H * W * C;
+        if (bytes > maxBytes) maxBytes = bytes;
+    }
+    if (!err && pos != len) err = "trailing bytes";
+    if (!err && (layers[h.layers - 1].h.type != KWS_FC || C != h.classes)) err = "last layer must be FC with one output per class";
+    if (!err) {
+        arenaHalf = pad4(maxBytes);
+        arena = (int8_t*)kwsAlloc(2 * arenaHalf);
+        if (!arena) err = "out of memory";
+    }
+    if (err) {
+        const char* e = err;
+        unload();
+        err = e;
+        return false;
+    }
+
+    layerCount = h.layers;
+    macCount = macs;
+#if defined(CONFIG_IDF_TARGET_ESP32S3) && defined(KWS_PIE)
+    usePie = pieAgrees();
+#endif
+    frontend.begin(h.bands);
+    reset();
+    return true;
+}
+
+const char* KeywordSpotter::kernel() const {
+    return usePie ? "PIE" : "portable";
+}
+
+void KeywordSpotter::reset() {
+    hopFill = 0;
+    hopsSinceReset = 0;
+    hits = 0;
+    frontend.reset();
+}
+
+void KeywordSpotter::runLayer(const Layer& l, const int8_t* in, int8_t* out) {
+    const bool relu = l.h.relu != 0;
+    switch (l.h.type) {
+        case KWS_CONV:
+        case KWS_DWCONV: {
+            int kh = l.h.kh, kw = l.h.kw;
+            int padT = ((l.outH - 1) * l.h.sh + kh - l.inH) / 2;
+            int padL = ((l.outW - 1) * l.h.sw + kw - l.inW) / 2;
+            if (padT < 0) padT = 0;
+            if (padL < 0) padL = 0;
+            int32_t acc[KWS_MAX_CHANNELS];
+            for (int oy = 0; oy < l.outH; oy++) {
+                int iy0 = oy * l.h.sh - padT;
+                int ky0 = iy0 < 0 ? -iy0 : 0;
+                int ky1 = l.inH - iy0 < kh ? l.inH - iy0 : kh;
+                for (int ox = 0; ox < l.outW; ox++) {
+                    int ix0 = ox * l.h.sw - padL;
+                    int kx0 = ix0 < 0 ? -ix0 : 0;
+                    int kx1 = l.inW - ix0 < kw ? l.inW - ix0 : kw;
+                    int8_t* o = out + ((size_t)oy * l.outW + ox) * l.outC;
+                    if (l.h.type == KWS_CONV) {
+                        // [kx0, kx1) × inC is contiguous in both the input row and the kernel row
+                        int run = (kx1 - kx0) * l.inC;
+                        for (int oc = 0; oc < l.outC; oc++) {
+                            int32_t a = l.bias[oc];
+                            for (int ky = ky0; ky < ky1; ky++) {
+                                a += dot8(l.weights + (((size_t)oc * kh + ky) * kw + kx0) * l.inC,
+                                          in + ((size_t)(iy0 + ky) * l.inW + ix0 + kx0) * l.inC, run);
+                            }
+                            o[oc] = requant(a, l.mult[oc], l.shift[oc], relu);
+                        }
+                    } else {
+                        int C = l.inC;
+                        for (int c = 0; c < C; c++) acc[c] = l.bias[c];
+                        for (int ky = ky0; ky < ky1; ky++) {
+                            for (int kx = kx0; kx < kx1; kx++) {
+                                const int8_t* x = in + ((size_t)(iy0 + ky) * l.inW + ix0 + kx) * C;
+                                const int8_t* w = l.weights + ((size_t)ky * kw + kx) * C;
+                                for (int c = 0; c < C; c++) acc[c] += w[c] * x[c];
+                            }
+                        }
+                        for (int c = 0; c < C; c++) o[c] = requant(acc[c], l.mult[c], l.shift[c], relu);
+                    }
+                }
+            }
+            break;
+        }
+        case KWS_AVGPOOL: {
+            int n = l.inH * l.inW;
+            for (int c = 0; c < l.inC; c++) {
+                int32_t s = 0;
+                for (int p = 0; p < n; p++) s += in[(size_t)p * l.inC + c];
+                out[c] = (int8_t)((s + (s >= 0 ? n / 2 : -n / 2)) / n);
+            }
+            break;
+        }
+        case KWS_FC: {
+            int inN = l.inH * l.inW * l.inC;
+            for (int oc = 0; oc < l.outC; oc++) {
+                int32_t a = l.bias[oc] + dot8(l.weights + (size_t)oc * inN, in, inN);
+                out[oc] = requant(a, l.mult[oc], l.shift[oc], relu);
+            }
+            break;
+        }
+    }
+}
+
+float KeywordSpotter::infer() {
+    int8_t* a = arena;
+    int8_t* b = arena + arenaHalf;
+    int start = (featHead + KWS_MAX_FRAMES - hdr.frames) % KWS_MAX_FRAMES;
+    for (int t = 0; t < hdr.frames; t++) {
+        memcpy(a + (size_t)t * hdr.bands, features[(start + t) % KWS_MAX_FRAMES], hdr.bands);
+    }
+    for (int i = 0; i < layerCount; i++) {
+        runLayer(layers[i], a, b);
+        int8_t* t = a; a = b; b = t;
+    }
+
+    float m = a[0];
+    for (int c = 1; c < hdr.classes; c++) if (a[c] > m) m = a[c];
+    float sum = 0, kw = 0;
+    for (int c = 0; c < hdr.classes; c++) {
+        float e = expf((a[c] - m) * hdr.outScale);
+        sum += e;
+        if (c == hdr.keyword) kw = e;
+    }
+    inferCount++;
+    return kw / sum;
+}
+
+void KeywordSpotter::hop(const int16_t* pcm) {
+    int16_t logQ8[KWS_MAX_BANDS];
+    frontend.process(pcm, logQ8);
+    int8_t* row = features[featHead];
+    for (int b = 0; b < hdr.bands; b++) {
+        int64_t v = ((int64_t)(logQ8[b] - hdr.featOffset) * hdr.featScale) >> 16;
+        row[b] = (int8_t)(v < -128 ? -128 : v > 127 ? 127 : v);
+    }
+    featHead = (featHead + 1) % KWS_MAX_FRAMES;
+    hopsSinceReset++;
+}
+
+bool KeywordSpotter::push(const int16_t* pcm, size_t n) {
+    if (!model) return false;
+    bool detected = false;
+    while (n > 0) {
+        size_t take = KWS_HOP - hopFill < n ? KWS_HOP - hopFill : n;
+        memcpy(hopBuf + hopFill, pcm, take * sizeof(int16_t));
+        hopFill += take;
+        pcm += take;
+        n -= take;
+        if (hopFill < KWS_HOP) break;
+        hopFill = 0;
+
+        hop(hopBuf);
+        if (refractoryHops) refractoryHops--;
+        if (hopsSinceReset < hdr.frames || hopsSinceReset % KWS_INFER_EVERY) continue;
+
+        score = infer();
+        hits = score >= hdr.threshold ? hits + 1 : 0;
+        if (hits >= KWS_TRIGGER_COUNT && !refractoryHops) {
+            detected = true;
+            hits = 0;
+            refractoryHops = KWS_REFRACTORY_MS / (KWS_HOP * 1000 / KWS_SAMPLE_RATE);
+        }
+    }
+    return detected;
+}
@@ -0,0 +1,150 @@
+#include "LossConcealer.h"
+
+static constexpr int PLC_ANALYSIS = PLC_MAX_LAG + PLC_CORR_WIN;
+static constexpr int PLC_HOLD_SAMPLES = PLC_HOLD_MS * 24;
+static constexpr int PLC_TOTAL_SAMPLES = (PLC_HOLD_MS + PLC_FADE_MS) * 24;
+static_assert((PLC_HISTORY & (PLC_HISTORY - 1)) == 0, "PLC_HISTORY must be a power of two");
+static_assert(PLC_HISTORY >= PLC_ANALYSIS + PLC_MAX_LAG / 4, "PLC_HISTORY too small for analysis window");
+
+void LossConcealer::reset() {
+    histPos = 0;
+    periodLen = 0;
+    periodPos = 0;
+    generated = 0;
+    xfadeLeft = 0;
+    state = IDLE;
+}
+
+void LossConcealer::push(const int16_t* samples, int n) {
+    // A gap that was never concealed (silence gate) needs no crossfade
+    if (state != IDLE && generated == 0) state = IDLE;
+    for (int i = 0; i < n; i++) {
+        history[histPos & (PLC_HISTORY - 1)] = samples[i];
+        histPos++;
+    }
+}
+
+bool LossConcealer::analyse() {
+    if (histPos < (uint32_t)PLC_ANALYSIS) return false;
+
+    // Linearise the tail of the history: x[PLC_ANALYSIS - 1] is the last played sample
+    int16_t* x = scratch;
+    const uint32_t start = histPos - PLC_ANALYSIS;
+    for (int i = 0; i < PLC_ANALYSIS; i++) {
+        x[i] = history[(start + i) & (PLC_HISTORY - 1)];
+    }
+    const int16_t* win = x + PLC_ANALYSIS - PLC_CORR_WIN;
+
+    uint32_t level = 0;
+    for (int i = 0; i < PLC_CORR_WIN; i++) {
+        int32_t s = win[i];
+        level += (uint32_t)(s < 0 ? -s : s);
+    }
+    if (level / PLC_CORR_WIN < PLC_MIN_LEVEL) return false;
+
+    // Normalised autocorrelation c² / E(lagged), compared without sqrt.
+    // Coarse pass: every other lag, every other sample.
+    int bestLag = PLC_MIN_LAG;
+    float bestScore = -1.0f;
+    for (int lag = PLC_MIN_LAG; lag <= PLC_MAX_LAG; lag += 2) {
+        const int16_t* past = win - lag;
+        int64_t c = 0, e = 1;
+        for (int i = 0; i < PLC_CORR_WIN; i += 2) {
+            c += (int32_t)win[i] * past[i];
+            e += (int32_t)past[i] * past[i];
+        }
+        if (c <= 0) continue;
+        float score = (float)c * (float)c / (float)e;
+        if (score > bestScore) { bestScore = score; bestLag = lag; }
+    }
+    // Fine pass: neighbours of the coarse peak at full rate
+    int coarse = bestLag;
+    bestScore = -1.0f;
+    for (int lag = coarse - 1; lag <= coarse + 1; lag++) {
+        if (lag < PLC_MIN_LAG || lag > PLC_MAX_LAG) continue;
+        const int16_t* past = win - lag;
+        int64_t c = 0, e = 1;
+        for (int i = 0; i < PLC_CORR_WIN; i++) {
+            c += (int32_t)win[i] * past[i];
+            e += (int32_t)past[i] * past[i];
+        }
+        if (c <= 0) continue;
+        float score = (float)c * (float)c / (float)e;
+        if (score > bestScore) { bestScore = score; bestLag = lag; }
+    }
+
+    // Last period, with its final quarter overlap-added onto the samples one
+    // period earlier so wrapping from period[P-1] to period[0] is continuous
+    const int P = bestLag;
+    const int L = P / 4;
+    const int16_t* last = x + PLC_ANALYSIS - P;
+    for (int i = 0; i < P; i++) period[i] = last[i];
+    for (int i = 0; i < L; i++) {
+        int32_t w = ((i + 1) << 15) / (L + 1);
+        int32_t a = last[P - L + i];
+        int32_t b = last[-L + i];
+        period[P - L + i] = (int16_t)((a * (32768 - w) + b * w) >> 15);
+    }
+    periodLen = P;
+    periodPos = 0;
+    return true;
+}
+
+int16_t LossConcealer::nextSample() {
+    int32_t g = 32768;
+    if (generated >= PLC_TOTAL_SAMPLES) {
+        g = 0;
+    } else if (generated > PLC_HOLD_SAMPLES) {
+        g = (int32_t)(((int64_t)(PLC_TOTAL_SAMPLES - generated) << 15) / (PLC_TOTAL_SAMPLES - PLC_HOLD_SAMPLES));
+    }
+    int32_t s = periodLen ? period[periodPos] : 0;
+    if (periodLen && ++periodPos >= periodLen) periodPos = 0;
+    generated++;
+    return (int16_t)((s * g) >> 15);
+}
+
+int LossConcealer::remaining() {
+    if (state == IDLE) {
+        generated = 0;
+        if (analyse()) {
+            state = CONCEALING;
+            eventCount++;
+        } else {
+            state = EXHAUSTED;
+        }
+    }
+    if (state != CONCEALING) return 0;
+    int left = PLC_TOTAL_SAMPLES - generated;
+    if (left <= 0) {
+        state = EXHAUSTED;
+        return 0;
+    }
+    return left;
+}
+
+int LossConcealer::conceal(int16_t* out, int n) {
+    int left = remaining();
+    if (n > left) n = left;
+    for (int i = 0; i < n; i++) {
+        out[i] = nextSample();
+    }
+    concealedTotal += n;
+    return n;
+}
+
+void LossConcealer::blend(int16_t* samples, int n) {
+    if (!pendingBlend()) return;
+    if (xfadeLeft == 0) xfadeLeft = PLC_XFADE_SAMPLES;
+    if (n > xfadeLeft) n = xfadeLeft;
+    for (int i = 0; i < n; i++) {
+        // Weight of the real signal rises 1/(N+1) … N/(N+1)
+        int32_t w = ((PLC_XFADE_SAMPLES - xfadeLeft + 1) << 15) / (PLC_XFADE_SAMPLES + 1);
+        int32_t c = nextSample();
+        samples[i] = (int16_t)(((int32_t)samples[i] * w + c * (32768 - w)) >> 15);
+        xfadeLeft--;
+    }
+    if (xfadeLeft == 0) {
+        state = IDLE;
+        generated = 0;
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <Arduino.h>
+
+// ============== LOSS CONCEALER ==============
+//
+// Packet-loss concealment for Gemini voice. When the voice ring runs dry
+// mid-utterance the mixer used to stop producing samples, so the speaker DMA
+// fell silent abruptly (a click, then a gap). The concealer instead keeps the
+// waveform going for up to PLC_HOLD_MS + PLC_FADE_MS:
+//
+//   1. On the first missing sample, the pitch period of the last played audio
+//      is found by normalised autocorrelation (coarse search at half rate,
+//      refined at full rate — one-off cost per underrun).
+//   2. The last period is repeated, with its end overlap-added onto the audio
+//      one period earlier so the loop point is seamless.
+//   3. Output is held at full level for PLC_HOLD_MS, then ramps to zero over
+//      PLC_FADE_MS. After that the mixer stops producing voice samples and the
+//      jitter buffer sees the underrun as before.
+//   4. When real audio returns, the first PLC_XFADE_SAMPLES are crossfaded from
+//      the (continuing) concealment signal into the real signal.
+//
+// Unvoiced or near-silent history (< PLC_MIN_LEVEL) is not concealed — the
+// end of every response would otherwise grow a synthetic tail.
+//
+// speakerTask only (called from AudioMixer::render).
+//
+// ============================================
+
+#ifndef PLC_HISTORY
+#define PLC_HISTORY 1024          // Played-sample history (power of two, > 2 × PLC_MAX_LAG + PLC_CORR_WIN)
+#endif
+#ifndef PLC_MIN_LAG
+#define PLC_MIN_LAG 60            // 400 Hz @ 24kHz
+#endif
+#ifndef PLC_MAX_LAG
+#define PLC_MAX_LAG 384           // 62.5 Hz @ 24kHz
+#endif
+#ifndef PLC_CORR_WIN
+#define PLC_CORR_WIN 256          // Correlation window (~10.7ms)
+#endif
+#ifndef PLC_HOLD_MS
+#define PLC_HOLD_MS 10            // Full-level extrapolation before fading
+#endif
+#ifndef PLC_FADE_MS
+#define PLC_FADE_MS 50            // Linear fade to silence
+#endif
+#ifndef PLC_XFADE_SAMPLES
+#define PLC_XFADE_SAMPLES 96      // 4ms crossfade back into real audio
+#endif
+#ifndef PLC_MIN_LEVEL
+#define PLC_MIN_LEVEL 150         // Mean |sample| below which history is treated as silence
+#endif
+
+class LossConcealer {
+public:
+    // Forget history and any concealment in progress (voice flushed).
+    void reset();
+
+    // Real samples handed to the mixer — feeds the pitch history.
+    void push(const int16_t* samples, int n);
+
+    // Samples of concealment still available for the current gap (0 = nothing to conceal).
+    // The first call of a gap runs the pitch analysis.
+    int  remaining();
+    // Generate up to n concealment samples. Returns samples written.
+    int  conceal(int16_t* out, int n);
+
+    // True when real audio follows a concealed gap and must be crossfaded in.
+    bool pendingBlend() const { return state != IDLE && generated > 0; }
+    // Crossfade up to PLC_XFADE_SAMPLES of the n real samples in place (call before push()).
+    void blend(int16_t* samples, int n);
+
+    uint32_t events() const      { return eventCount; }
+    uint32_t concealedMs() const { return concealedTotal / 24; }
+
+private:
+    enum State : uint8_t { IDLE, CONCEALING, EXHAUSTED };
+
+    bool    analyse();
+    int16_t nextSample();
+
+    int16_t  history[PLC_HISTORY];
+    int16_t  scratch[PLC_MAX_LAG + PLC_CORR_WIN];   // linearised analysis window
+    uint32_t histPos = 0;                  // total samples pushed (write index = histPos & mask)
+    int16_t  period[PLC_MAX_LAG];          // loop-smoothed last pitch period
+    int      periodLen = 0;
+    int      periodPos = 0;
+    int      generated = 0;                // samples generated in this gap
+    int      xfadeLeft = 0;
+    State    state = IDLE;
+
+    uint32_t eventCount = 0;
+    uint32_t concealedTotal = 0;
+};
@@ -0,0 +1,82 @@
+#include "MicAgc.h"
+#include "AudioKernels.h"
+#include <math.h>
+
+static inline int16_t sat16(int64_t v) {
+    return (int16_t)(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+}
+
+static inline int32_t dbToQ8(float db) { return (int32_t)lroundf(db / 6.0206f * 256.0f); }
+
+void MicAgc::begin() {
+    for (int i = 0; i < 256; i++) {
+        exp2Frac[i] = (uint16_t)lroundf(32768.0f * exp2f(i / 256.0f));
+    }
+    targetQ8  = 15 * 256 + dbToQ8(AGC_TARGET_DBFS);
+    minGainQ8 = dbToQ8(AGC_MIN_GAIN_DB);
+    maxGainQ8 = dbToQ8(AGC_MAX_GAIN_DB);
+    attackQ8  = dbToQ8(AGC_ATTACK_DB_PER_S * AGC_FRAME_MS / 1000.0f);
+    releaseQ8 = dbToQ8(AGC_RELEASE_DB_PER_S * AGC_FRAME_MS / 1000.0f);
+    gateQ8    = dbToQ8(AGC_GATE_DB);
+    if (attackQ8 < 1) attackQ8 = 1;
+    if (releaseQ8 < 1) releaseQ8 = 1;
+    reset();
+}
+
+void MicAgc::reset() {
+    gainQ8 = dbToQ8(AGC_INITIAL_GAIN_DB);
+    int shift = (gainQ8 >> 8) + 1;   // exp2Frac is Q15, the gain Q16
+    gainQ16 = shift >= 0 ? (uint32_t)exp2Frac[gainQ8 & 0xFF] << shift : exp2Frac[gainQ8 & 0xFF] >> -shift;
+    primed = false;
+    speechPrimed = false;
+}
+
+void MicAgc::process(const int32_t* raw, int16_t* out, int n) {
+    if (n <= 0) return;
+    int64_t sumSq = 0;
+    int32_t peak = 0;
+    for (int i = 0; i < n; i++) {
+        int32_t s = raw[i] >> 8;
+        sumSq += (int64_t)s * s;
+        int32_t a = s < 0 ? -s : s;
+        if (a > peak) peak = a;
+    }
+    int32_t level = log2Q8((uint64_t)(sumSq / n)) / 2;   // log2 RMS in 24-bit units, Q8
+
+    // Noise floor: follows dips at once, rises 1/256 octave per frame (~1.2 dB/s)
+    if (!primed || level < floorQ8) floorQ8 = level;
+    else floorQ8++;
+    primed = true;
+
+    if (!held && level > floorQ8 + gateQ8) {
+        // Speech level: rises within ~80ms, falls over ~300ms, so syllables don't pump the gain
+        if (!speechPrimed) speechQ8 = level;
+        speechQ8 += (level - speechQ8) >> (level > speechQ8 ? 2 : 4);
+        speechPrimed = true;
+        // Output RMS in 16-bit units = input RMS / 256 × gain
+        int32_t want = targetQ8 - (speechQ8 - 8 * 256);
+        if (want < minGainQ8) want = minGainQ8;
+        if (want > maxGainQ8) want = maxGainQ8;
+        if (want < gainQ8) gainQ8 = want > gainQ8 - attackQ8 ? want : gainQ8 - attackQ8;
+        else gainQ8 = want < gainQ8 + releaseQ8 ? want : gainQ8 + releaseQ8;
+    }
+    int shift = (gainQ8 >> 8) + 1;
+    uint32_t g = shift >= 0 ? (uint32_t)exp2Frac[gainQ8 & 0xFF] << shift : exp2Frac[gainQ8 & 0xFF] >> -shift;
+
+    // Limiter: peak × gain must stay within AGC_CEILING
+    uint64_t maxG = peak > 0 ? ((uint64_t)AGC_CEILING << 24) / (uint32_t)peak : UINT32_MAX;
+    if (g > maxG) {
+        g = (uint32_t)maxG;
+        limited++;
+    }
+
+    // Ramp from the last frame's gain when that is safe too, else step down now
+    uint32_t g0 = gainQ16 <= maxG ? gainQ16 : g;
+    int64_t step = (((int64_t)g - g0) << 8) / n;   // Q24 per sample
+    int64_t gi = (int64_t)g0 << 8;
+    for (int i = 0; i < n; i++) {
+        gi += step;
+        out[i] = sat16(((int64_t)(raw[i] >> 8) * (gi >> 8) + (1 << 23)) >> 24);
+    }
+    gainQ16 = g;
+}
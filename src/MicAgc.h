@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ============== MIC AGC ==============
+//
+// Turns the INMP441's 24-bit samples into the 16-bit stream everything else
+// uses, at a steady level. initI2SMic captures 32-bit slots: the mic shifts
+// out 24 bits MSB first and leaves the rest of the slot undriven, so the
+// sample is the top 24 bits (raw >> 8) and the low byte is thrown away.
+// audioTask passes every frame through one MicAgc before the echo canceller,
+// so the uplink, the endpointer, the VADs, the VU meter and the wake word
+// all see the same normalised audio.
+//
+// GAIN is in log2 (Q8) relative to the mic's top 16 bits: 0 dB is the 24-bit
+// full scale mapped onto the 16-bit full scale, and the old fixed ×16 is
+// 24 dB. The speech level is smoothed (rises within ~80ms, falls over
+// ~300ms) so single syllables don't pump the gain, and the gain moves toward
+// the one that would put that level at AGC_TARGET_DBFS: down at
+// AGC_ATTACK_DB_PER_S, up at AGC_RELEASE_DB_PER_S. The gain is kept within
+// AGC_MIN_GAIN_DB..AGC_MAX_GAIN_DB.
+//
+// GATE: only frames AGC_GATE_DB above the noise floor move the gain. The
+// floor follows dips at once and rises ~1.2 dB/s. Pauses and a quiet room
+// therefore hold the last speech gain instead of pulling the noise up. While
+// hold() is set (the speaker is playing), no frame moves the gain at all, so
+// the echo does not duck the user and the echo canceller sees a fixed path.
+//
+// LIMITER: the frame's peak is known before any of it is written. If the
+// gain would take the peak past AGC_CEILING, that frame alone is cut to fit
+// (a door slam costs its own 20ms, not the next seconds of speech). Nothing
+// ever clips. Otherwise the gain ramps linearly across the frame, so changes
+// make no zipper noise.
+//
+// Integer-only: int64 sample × Q16 gain, with log2/exp2 through small tables.
+//
+// Pure C++ with no Arduino dependencies: tools/agceval.cpp drives it with
+// synthetic level sweeps on the host.
+//
+// =========================================
+
+#ifndef AGC_TARGET_DBFS
+#define AGC_TARGET_DBFS        -20      // speech RMS the output is steered to (mean |x| ~2600)
+#endif
+#ifndef AGC_INITIAL_GAIN_DB
+#define AGC_INITIAL_GAIN_DB    24       // the old fixed ×16
+#endif
+#ifndef AGC_MIN_GAIN_DB
+#define AGC_MIN_GAIN_DB        -20      // someone shouting into the mic
+#endif
+#ifndef AGC_MAX_GAIN_DB
+#define AGC_MAX_GAIN_DB        42       // quiet talker across the room
+#endif
+#ifndef AGC_ATTACK_DB_PER_S
+#define AGC_ATTACK_DB_PER_S    40
+#endif
+#ifndef AGC_RELEASE_DB_PER_S
+#define AGC_RELEASE_DB_PER_S   10
+#endif
+#ifndef AGC_GATE_DB
+#define AGC_GATE_DB            10
+#endif
+#ifndef AGC_CEILING
+#define AGC_CEILING            29000    // limiter: no output sample beyond this (-1 dBFS)
+#endif
+
+#define AGC_FRAME_MS           20       // one MIC_FRAME_SIZE at 16 kHz
+
+class MicAgc {
+public:
+    void begin();
+    // Back to AGC_INITIAL_GAIN_DB with a fresh noise floor
+    void reset();
+
+    // n raw 32-bit I2S words in, n normalised samples out
+    void process(const int32_t* raw, int16_t* out, int n);
+    // Freeze the gain (the limiter still acts) — while the speaker plays
+    void hold(bool on)         { held = on; }
+
+    float    gainDb() const     { return gainQ8 * 6.0206f / 256.0f; }
+    float    floorDbfs() const  { return (floorQ8 - 23 * 256) * 6.0206f / 256.0f; }
+    uint32_t limitedFrames() const { return limited; }
+
+private:
+    uint16_t exp2Frac[256];       // 2^(i/256), Q15
+    int32_t  targetQ8 = 0;        // log2 of the target RMS in 16-bit units, Q8
+    int32_t  minGainQ8 = 0;
+    int32_t  maxGainQ8 = 0;
+    int32_t  attackQ8 = 0;        // per frame
+    int32_t  releaseQ8 = 0;
+    int32_t  gateQ8 = 0;
+
+    int32_t  gainQ8 = 0;          // log2 gain over the top 16 bits, Q8
+    uint32_t gainQ16 = 0;         // the gain the last frame ended on, linear Q16
+    int32_t  floorQ8 = 0;         // log2 RMS of the noise floor in 24-bit units, Q8
+    int32_t  speechQ8 = 0;        // smoothed log2 RMS of the gated frames, Q8
+    bool     primed = false;
+    bool     speechPrimed = false;
+    bool     held = false;
+    uint32_t limited = 0;
+};
@@ -0,0 +1,50 @@
+#include "MicCapture.h"
+#include <string.h>
+
+void MicCapture::reset() {
+    fill = 0;
+    lastEndUs = 0;
+    lostWords = 0;
+}
+
+size_t MicCapture::push(const int32_t* words, size_t n, int64_t endUs) {
+    size_t take = MIC_CAPTURE_FRAME - fill;
+    if (take > n) take = n;
+    memcpy(cur.raw + fill, words, take * sizeof(int32_t));
+    fill += take;
+    if (fill == MIC_CAPTURE_FRAME) {
+        // The words after this frame were captured after it
+        cur.endUs = endUs - (int64_t)(n - take) * 1000000 / MIC_CAPTURE_RATE;
+        if (lastEndUs) {
+            int64_t d = cur.endUs - lastEndUs - MIC_CAPTURE_FRAME_US;
+            int32_t dev = (int32_t)(d < 0 ? -d : d);
+            jitterSum += dev;
+            jitterCount++;
+            if (dev > jitterMax) jitterMax = dev;
+        }
+        lastEndUs = cur.endUs;
+    }
+    return take;
+}
+
+void MicCapture::next(bool delivered) {
+    if (delivered) captured++;
+    else dropped++;
+    fill = 0;
+}
+
+void MicCapture::overflow(size_t words) {
+    lostWords += (uint32_t)(words + fill);
+    dropped += lostWords / MIC_CAPTURE_FRAME;
+    lostWords %= MIC_CAPTURE_FRAME;
+    fill = 0;
+    lastEndUs = 0;
+}
+
+void MicCapture::clearStats() {
+    captured = 0;
+    dropped = 0;
+    jitterSum = 0;
+    jitterCount = 0;
+    jitterMax = 0;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ============== MIC CAPTURE ==============
+//
+// Cuts the mic's DMA buffers into the MIC_FRAME_SIZE frames the rest of the
+// firmware works on, and stamps each frame with the time its last sample was
+// captured. micCaptureTask (main.cpp) is the sole reader of I2S_NUM_0: it
+// wakes on every I2S_EVENT_RX_DONE, takes what the DMA has filled, pushes it
+// through here and writes each finished frame into micRing (an AudioRing),
+// which audioTask drains at its own pace. A burst of downlink or playback
+// work on CORE_1 only deepens the ring; it no longer leaves the DMA unread.
+//
+// TIME: the task reads right after RX_DONE, so the last word it gets was
+// captured at about the read time, and a frame that ends w words before that
+// ended w / 16 kHz earlier. The error is the task's wake latency. JITTER is
+// how far consecutive stamps stray from MIC_CAPTURE_FRAME_US apart.
+//
+// DROPS: when the DMA queue overflows (I2S_EVENT_RX_Q_OVF) the driver has
+// thrown its oldest buffer away. The partial frame goes with it, so no frame
+// joins audio across a gap, and the lost audio is counted in frames. A frame
+// the ring has no room for is counted too.
+//
+// Pure C++ with no Arduino dependencies: tools/capsim.cpp runs it under
+// simulated task timing on the host.
+//
+// =========================================
+
+#ifndef MIC_RING_BYTES
+#define MIC_RING_BYTES         (32 * 1024)   // micRing: 25 frames (500ms) of 32-bit mic words
+#endif
+
+#define MIC_CAPTURE_FRAME      320      // one MIC_FRAME_SIZE
+#define MIC_CAPTURE_RATE       16000    // AUDIO_SAMPLE_RATE
+#define MIC_CAPTURE_FRAME_US   (MIC_CAPTURE_FRAME * 1000000LL / MIC_CAPTURE_RATE)
+
+// One frame as it travels through micRing
+struct MicFrame {
+    int64_t endUs;                      // capture time of the last sample (esp_timer clock)
+    int32_t raw[MIC_CAPTURE_FRAME];     // 32-bit I2S words, as MicAgc takes them
+};
+
+class MicCapture {
+public:
+    // Drop the partial frame (the DMA was reinstalled); statistics are kept
+    void reset();
+
+    // Take up to n words of a DMA read whose last word was captured at endUs.
+    // Returns the words taken; once ready(), hand frame() on and call next().
+    size_t push(const int32_t* words, size_t n, int64_t endUs);
+    bool ready() const                { return fill == MIC_CAPTURE_FRAME; }
+    const MicFrame& frame() const     { return cur; }
+    // Start the next frame. delivered = false: the ring had no room for this one.
+    void next(bool delivered);
+    // The driver dropped `words` of audio before the next push
+    void overflow(size_t words);
+
+    // Since the last clearStats()
+    uint32_t framesCaptured() const   { return captured; }
+    uint32_t framesDropped() const    { return dropped; }
+    int32_t  jitterMeanUs() const     { return jitterCount ? (int32_t)(jitterSum / jitterCount) : 0; }
+    int32_t  jitterMaxUs() const      { return jitterMax; }
+    void clearStats();
+
+private:
+    MicFrame cur;
+    size_t   fill = 0;
+    int64_t  lastEndUs = 0;       // stamp of the previous frame, 0 after a gap
+    uint32_t lostWords = 0;       // dropped audio not yet a whole frame
+
+    uint32_t captured = 0;
+    uint32_t dropped = 0;
+    int64_t  jitterSum = 0;
+    uint32_t jitterCount = 0;
+    int32_t  jitterMax = 0;
+};
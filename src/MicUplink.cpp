@@ -0,0 +1,104 @@
+#include "MicUplink.h"
+
+static const char* const CODEC_NAMES[] = { "pcm16", "ima-adpcm", nullptr, "mulaw" };
+
+uint8_t uplinkCodecFromName(const char* name) {
+    for (uint8_t c = 0; c < sizeof(CODEC_NAMES) / sizeof(CODEC_NAMES[0]); c++) {
+        if (CODEC_NAMES[c] && strcmp(CODEC_NAMES[c], name) == 0) return c;
+    }
+    return UPLINK_CODEC_NONE;
+}
+
+const char* uplinkCodecName(uint8_t codec) {
+    return codec < sizeof(CODEC_NAMES) / sizeof(CODEC_NAMES[0]) ? CODEC_NAMES[codec] : nullptr;
+}
+
+uint8_t uplinkChooseCodec(uint32_t offered) {
+    static const uint8_t bySize[] = { CODEC_IMA_ADPCM, CODEC_MULAW, CODEC_PCM16 };
+    if (offered & (1u << MIC_UPLINK_CODEC)) return MIC_UPLINK_CODEC;
+    for (uint8_t c : bySize) {
+        if (offered & (1u << c)) return c;
+    }
+    return UPLINK_CODEC_NONE;
+}
+
+size_t MicUplink::encode(uint8_t codec, const int16_t* pcm, size_t samples) {
+    uint8_t* out = buf + UPLINK_HEADER_BYTES;
+    if (samples > MIC_FRAME_SIZE) samples = MIC_FRAME_SIZE;
+    switch (codec) {
+        case CODEC_IMA_ADPCM:
+            return imaAdpcmEncodeBlock(pcm, samples, &ima, out);
+        case CODEC_MULAW:
+            mulawEncode(pcm, samples, out);
+            return samples;
+        default:
+            memcpy(out, pcm, samples * sizeof(int16_t));
+            return samples * sizeof(int16_t);
+    }
+}
+
+// ── DTX ──────────────────────────────────────────────────────────────────────
+
+void MicDtx::reset() {
+    heldCount = 0;
+    hangover = DTX_HANGOVER_FRAMES;
+    run = 0;
+    runLevelSum = 0;
+    seen = 0;
+    suppressed = 0;
+}
+
+bool MicDtx::hold(const int16_t* pcm, uint32_t captureMs) {
+    int32_t sum = 0;
+    for (int i = 0; i < MIC_FRAME_SIZE; i++) sum += abs(pcm[i]);
+    int32_t level = sum / MIC_FRAME_SIZE;
+    seen++;
+
+    // Noise floor: falls within a few frames, creeps up with a ~2.5s time constant,
+    // so speech barely moves it but a louder room is learned
+    int32_t levelQ4 = level << 4;
+    if (levelQ4 < floorQ4) floorQ4 -= (floorQ4 - levelQ4) >> 2;
+    else floorQ4 += (levelQ4 - floorQ4) >> 7;
+    int32_t threshold = min((floorQ4 * DTX_FLOOR_MARGIN_Q4) >> 8, (int32_t)VAD_THRESHOLD);
+
+    if (level >= threshold) {
+        hangover = DTX_HANGOVER_FRAMES;
+        return false;
+    }
+    if (hangover > 0) {
+        hangover--;
+        return false;
+    }
+
+    // Quiet: keep it for a possible onset; the oldest held frame joins the run
+    if (heldCount == DTX_ONSET_FRAMES) {
+        if (run == 0) runFirstMs = heldMs[heldHead];
+        run++;
+        runLevelSum += heldLevel[heldHead];
+        suppressed++;
+        heldHead = (heldHead + 1) % DTX_ONSET_FRAMES;
+        heldCount--;
+    }
+    int slot = (heldHead + heldCount) % DTX_ONSET_FRAMES;
+    memcpy(held[slot], pcm, sizeof(held[slot]));
+    heldMs[slot] = captureMs;
+    heldLevel[slot] = (uint16_t)level;
+    heldCount++;
+    return true;
+}
+
+uint16_t MicDtx::takeRun(bool flush, uint16_t* level, uint32_t* firstMs) {
+    if (run == 0 || (!flush && run < DTX_MAX_RUN_FRAMES)) return 0;
+    uint16_t n = run;
+    *level = (uint16_t)(runLevelSum / n);
+    *firstMs = runFirstMs;
+    run = 0;
+    runLevelSum = 0;
+    return n;
+}
+
+const int16_t* MicDtx::heldFrame(int i, uint32_t* captureMs) const {
+    int slot = (heldHead + i) % DTX_ONSET_FRAMES;
+    *captureMs = heldMs[slot];
+    return held[slot];
+}
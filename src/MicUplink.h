@@ -0,0 +1,167 @@
+#pragma once
+
+#include <Arduino.h>
+#include "Config.h"
+#include "AudioCodec.h"
+
+// ============== MIC UPLINK ==============
+//
+// Microphone frames go to the server as binary WebSocket messages instead of
+// Base64 inside a realtimeInput JSON text message:
+//
+//   A5 4D | stream | codec | seq_lo seq_hi | t0 t1 t2 t3 | payload
+//
+//   stream  UPLINK_STREAM_MIC (the only stream so far)
+//   codec   StreamCodec (AudioCodec.h), see below
+//   seq     +1 per frame, wraps at 65536; a gap on the server is a lost frame
+//   t       millis() when the frame's last sample was captured (MicFrame::endUs) (LE)
+//
+// One frame is always one mic frame (MIC_FRAME_SIZE samples, 20ms at 16 kHz)
+// in every codec, so sequence gaps count in frames and the server can fill a
+// lost frame with exactly that much silence:
+//
+//   pcm16      CODEC_PCM16      640 bytes   256 kbps
+//   mulaw      CODEC_MULAW      320 bytes   128 kbps   G.711, stateless
+//   ima-adpcm  CODEC_IMA_ADPCM  164 bytes   ~66 kbps   one self-contained block
+//
+// An IMA block carries the decoder state in its header, so a lost frame never
+// corrupts the next one. The encoder state still runs on across frames.
+//
+// The server decodes back to PCM and re-wraps it as realtimeInput for Gemini.
+// It lists the codecs it can decode as "uplinkCodecs" in its ready message.
+// The device picks MIC_UPLINK_CODEC if it is listed, otherwise the smallest
+// listed codec. Until then, or with an older server, sendAudioChunk() keeps
+// sending the JSON form.
+//
+// The frame is built in one preallocated buffer: encode() writes straight
+// into the payload and seal() fills in the header. No heap traffic in audioTask.
+//
+// DTX (discontinuous transmission, if the ready message has "uplinkDtx": true):
+// MicDtx holds back frames below the tracked noise floor. A run of them goes
+// out as one silence marker instead:
+//
+//   A5 4D | stream | UPLINK_SILENCE | seq | t | frames u16 | level u16
+//
+// The marker consumes `frames` sequence numbers, so the server still sees
+// gaps, and it expands the marker into that much comfort noise at `level`
+// (mean |sample|). Speech is protected on both sides:
+//   - Tail: DTX_HANGOVER_FRAMES after the last loud frame are always sent.
+//   - Onset: the last DTX_ONSET_FRAMES held frames are sent, not suppressed,
+//     when the silence ends, because soft consonants sit below the floor.
+// A long pause is reported every DTX_MAX_RUN_FRAMES, so the server never
+// lags the device by more than that.
+//
+// =========================================
+
+#define UPLINK_MAGIC0       0xA5
+#define UPLINK_MAGIC1       0x4D
+#define UPLINK_HEADER_BYTES 10
+#define UPLINK_STREAM_MIC   0
+
+#ifndef UPLINK_MAX_PAYLOAD
+#define UPLINK_MAX_PAYLOAD  (MIC_FRAME_SIZE * sizeof(int16_t))   // one 20ms PCM16 frame
+#endif
+#ifndef MIC_UPLINK_CODEC
+#define MIC_UPLINK_CODEC    CODEC_IMA_ADPCM   // preferred when the server offers it
+#endif
+
+#define UPLINK_CODEC_NONE   0xFF              // server has no binary uplink: JSON form
+#define UPLINK_SILENCE      0xFE              // codec byte of a DTX silence marker
+
+#ifndef DTX_HANGOVER_FRAMES
+#define DTX_HANGOVER_FRAMES 10                // 200ms sent after the last loud frame
+#endif
+#ifndef DTX_ONSET_FRAMES
+#define DTX_ONSET_FRAMES    3                 // 60ms of held frames sent ahead of an onset
+#endif
+#ifndef DTX_MAX_RUN_FRAMES
+#define DTX_MAX_RUN_FRAMES  50                // a pause is reported at least every second
+#endif
+#ifndef DTX_FLOOR_MARGIN_Q4
+#define DTX_FLOOR_MARGIN_Q4 32                // quiet = below 2x the noise floor (and below VAD_THRESHOLD)
+#endif
+
+// "pcm16" / "mulaw" / "ima-adpcm" ↔ StreamCodec; UPLINK_CODEC_NONE / nullptr if unknown
+uint8_t     uplinkCodecFromName(const char* name);
+const char* uplinkCodecName(uint8_t codec);
+// The codec to use given the server's offer (bit 1 << codec per listed codec)
+uint8_t     uplinkChooseCodec(uint32_t offered);
+
+class MicUplink {
+public:
+    // Encode `samples` of PCM into the payload. Returns the payload length.
+    size_t encode(uint8_t codec, const int16_t* pcm, size_t samples);
+
+    // Write the header for `len` payload bytes and advance the sequence.
+    // Returns the whole frame; *frameLen gets its size.
+    const uint8_t* seal(uint8_t stream, uint8_t codec, size_t len, uint32_t captureMs, size_t* frameLen) {
+        buf[0] = UPLINK_MAGIC0;
+        buf[1] = UPLINK_MAGIC1;
+        buf[2] = stream;
+        buf[3] = codec;
+        buf[4] = seq & 0xFF;
+        buf[5] = seq >> 8;
+        buf[6] = captureMs & 0xFF;
+        buf[7] = (captureMs >> 8) & 0xFF;
+        buf[8] = (captureMs >> 16) & 0xFF;
+        buf[9] = captureMs >> 24;
+        seq++;
+        *frameLen = UPLINK_HEADER_BYTES + len;
+        return buf;
+    }
+
+    // A DTX marker for `frames` suppressed frames; the first was captured at captureMs
+    const uint8_t* sealSilence(uint16_t frames, uint16_t level, uint32_t captureMs, size_t* frameLen) {
+        uint8_t* p = buf + UPLINK_HEADER_BYTES;
+        p[0] = frames & 0xFF;
+        p[1] = frames >> 8;
+        p[2] = level & 0xFF;
+        p[3] = level >> 8;
+        const uint8_t* frame = seal(UPLINK_STREAM_MIC, UPLINK_SILENCE, 4, captureMs, frameLen);
+        seq += frames - 1;
+        return frame;
+    }
+
+private:
+    uint8_t  buf[UPLINK_HEADER_BYTES + UPLINK_MAX_PAYLOAD];
+    uint16_t seq = 0;
+    ImaAdpcmState ima = {0, 0};
+};
+
+class MicDtx {
+public:
+    // New turn: clear the counters and arm the hangover, so a turn always starts on air
+    void reset();
+
+    // Classify one frame. True = held back. False = send it now, after the
+    // silence marker (takeRun) and the held onset frames.
+    bool hold(const int16_t* pcm, uint32_t captureMs);
+
+    // Suppressed frames due for a marker: every pending one when `flush`,
+    // otherwise only once DTX_MAX_RUN_FRAMES have built up. 0 if none.
+    uint16_t takeRun(bool flush, uint16_t* level, uint32_t* firstMs);
+
+    // Held onset frames, oldest first
+    int heldFrames() const { return heldCount; }
+    const int16_t* heldFrame(int i, uint32_t* captureMs) const;
+    void clearHeld() { heldCount = 0; }
+
+    // This turn
+    uint32_t framesSeen() const       { return seen; }
+    uint32_t framesSuppressed() const { return suppressed; }
+
+private:
+    int16_t  held[DTX_ONSET_FRAMES][MIC_FRAME_SIZE];
+    uint32_t heldMs[DTX_ONSET_FRAMES];
+    uint16_t heldLevel[DTX_ONSET_FRAMES];
+    int      heldHead = 0;
+    int      heldCount = 0;
+
+    int32_t  floorQ4 = (VAD_THRESHOLD / 4) << 4;   // noise floor, mean |sample| in Q4; kept across turns
+    int      hangover = DTX_HANGOVER_FRAMES;
+    uint16_t run = 0;
+    uint32_t runLevelSum = 0;
+    uint32_t runFirstMs = 0;
+    uint32_t seen = 0;
+    uint32_t suppressed = 0;
+};
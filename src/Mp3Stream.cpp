@@ -0,0 +1,163 @@
+#include "Mp3Stream.h"
+#include <esp_heap_caps.h>
+#include "libhelix-mp3/mp3dec.h"
+
+static void* allocAudio(size_t bytes) {
+    void* p = heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    return p ? p : heap_caps_malloc(bytes, MALLOC_CAP_8BIT);
+}
+
+bool Mp3Stream::begin() {
+    in     = (uint8_t*)allocAudio(MP3_INBUF_BYTES);
+    pcm    = (int16_t*)allocAudio(2 * MP3_MAX_FRAME_SAMPLES * sizeof(int16_t));
+    hist   = (int16_t*)allocAudio((MP3_RS_TAPS + MP3_MAX_FRAME_SAMPLES) * sizeof(int16_t));
+    outBuf = (int16_t*)allocAudio(MP3_OUT_MAX_SAMPLES * sizeof(int16_t));
+    if (!in || !pcm || !hist || !outBuf) {
+        Serial.println("Mp3Stream: buffer allocation failed");
+        return false;
+    }
+    decoder = MP3InitDecoder();
+    if (!decoder) {
+        Serial.println("Mp3Stream: decoder allocation failed");
+        return false;
+    }
+    return true;
+}
+
+void Mp3Stream::reset() {
+    if (decoder) {
+        // Fresh decoder state: the old stream's bit reservoir, IMDCT overlap and
+        // synthesis history must not leak into the new one. Freed first so the
+        // new blocks can reuse the same heap space.
+        MP3FreeDecoder((HMP3Decoder)decoder);
+        decoder = MP3InitDecoder();
+        if (!decoder) Serial.println("Mp3Stream: decoder allocation failed");
+    }
+    inLen = 0;
+    inRate = 0;
+    inChannels = 0;
+    histLen = 0;
+    pos = 0;
+}
+
+bool Mp3Stream::push(const uint8_t* data, size_t len) {
+    if (!decoder) return false;
+    if (inLen + len > MP3_INBUF_BYTES) {
+        inLen = 0;
+        if (len > MP3_INBUF_BYTES) return false;
+        memcpy(in, data, len);
+        inLen = len;
+        return false;
+    }
+    memcpy(in + inLen, data, len);
+    inLen += len;
+    return true;
+}
+
+// Windowed-sinc prototype for this input rate, split into phases; each phase normalised to unity DC gain
+void Mp3Stream::configure(uint32_t rate) {
+    inRate = rate;
+    histLen = 0;
+    pos = 0;
+    step = (uint32_t)(((uint64_t)rate << 16) / 24000);
+    if (rate == 24000) return;
+
+    const float fc = 0.45f * (float)min(rate, (uint32_t)24000) / (float)rate;   // cycles per input sample
+    const float center = MP3_RS_TAPS / 2 - 1;
+    for (int p = 0; p < MP3_RS_PHASES; p++) {
+        float taps[MP3_RS_TAPS];
+        float sum = 0;
+        for (int k = 0; k < MP3_RS_TAPS; k++) {
+            float t = k - center - (float)p / MP3_RS_PHASES;
+            float x = 2.0f * fc * t;
+            float sinc = fabsf(x) < 1e-6f ? 1.0f : sinf(PI * x) / (PI * x);
+            float w = 0.42f + 0.5f * cosf(PI * t / (MP3_RS_TAPS / 2)) + 0.08f * cosf(2.0f * PI * t / (MP3_RS_TAPS / 2));   // Blackman
+            taps[k] = sinc * w;
+            sum += taps[k];
+        }
+        for (int k = 0; k < MP3_RS_TAPS; k++) {
+            coeffs[p][k] = (int16_t)lrintf(taps[k] / sum * 16384.0f);
+        }
+    }
+}
+
+int Mp3Stream::resample(int16_t* dst) {
+    int n = 0;
+    while (n < MP3_OUT_MAX_SAMPLES) {
+        int i = pos >> 16;
+        if (i + MP3_RS_TAPS > histLen) break;
+        const int16_t* c = coeffs[(pos & 0xFFFF) >> (16 - 6)];   // 64 phases = top 6 fraction bits
+        const int16_t* x = hist + i;
+        int32_t acc = 0;
+        for (int k = 0; k < MP3_RS_TAPS; k++) acc += c[k] * x[k];
+        acc = (acc + (1 << 13)) >> 14;
+        dst[n++] = (int16_t)(acc > 32767 ? 32767 : (acc < -32768 ? -32768 : acc));
+        pos += step;
+    }
+    // Keep the unread tail as history for the next frame
+    int used = min((int)(pos >> 16), histLen);
+    memmove(hist, hist + used, (histLen - used) * sizeof(int16_t));
+    histLen -= used;
+    pos -= (uint32_t)used << 16;
+    return n;
+}
+
+int Mp3Stream::decode(const int16_t** out) {
+    if (!decoder) return 0;
+    size_t consumed = 0;
+    int produced = 0;
+
+    while (produced == 0) {
+        int sync = MP3FindSyncWord(in + consumed, (int)(inLen - consumed));
+        if (sync < 0) {
+            // No header anywhere - keep the last 3 bytes in case one straddles the next packet
+            consumed = inLen > 3 ? inLen - 3 : 0;
+            break;
+        }
+        consumed += sync;
+        unsigned char* p = in + consumed;
+        int left = (int)(inLen - consumed);
+        int err = MP3Decode((HMP3Decoder)decoder, &p, &left, pcm, 0);
+        if (err == ERR_MP3_INDATA_UNDERFLOW) break;              // frame not complete yet
+        if (err == ERR_MP3_MAINDATA_UNDERFLOW) {                 // bit reservoir still filling
+            consumed = p - in;
+            continue;
+        }
+        if (err != ERR_MP3_NONE) {                               // false sync or corrupt frame
+            errors++;
+            consumed++;
+            continue;
+        }
+        consumed = p - in;
+
+        MP3FrameInfo info;
+        MP3GetLastFrameInfo((HMP3Decoder)decoder, &info);
+        if (info.samprate < 16000 || info.nChans < 1 || info.nChans > 2) {
+            errors++;
+            continue;
+        }
+        if ((uint32_t)info.samprate != inRate) configure(info.samprate);
+        inChannels = info.nChans;
+        frames++;
+
+        // Downmix into the converter's input (or straight to the output at 24 kHz)
+        int n = info.outputSamps / info.nChans;
+        if (n > MP3_MAX_FRAME_SAMPLES) continue;
+        if (histLen + n > MP3_RS_TAPS + MP3_MAX_FRAME_SAMPLES) histLen = 0;   // never expected; drop history rather than overrun
+        int16_t* mono = (inRate == 24000) ? outBuf : hist + histLen;
+        for (int i = 0; i < n; i++) {
+            mono[i] = info.nChans == 2 ? (int16_t)(((int32_t)pcm[2 * i] + pcm[2 * i + 1]) >> 1) : pcm[i];
+        }
+        if (inRate == 24000) {
+            produced = n;
+        } else {
+            histLen += n;
+            produced = resample(outBuf);
+        }
+    }
+
+    memmove(in, in + consumed, inLen - consumed);
+    inLen -= consumed;
+    *out = outBuf;
+    return produced;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <Arduino.h>
+
+// ============== MP3 STREAM ==============
+//
+// Radio relayed as the station's own MP3 frames instead of server-transcoded
+// PCM. The server runs ffmpeg with "-c:a copy -f mp3" (no transcode), then
+// frames the elementary stream like coded ambient audio:
+//
+//   A5 5B seq_lo seq_hi 02 00 | MP3 bytes      (CODEC_MP3, AudioCodec.h)
+//
+// Packet boundaries are arbitrary. push() appends the bytes and decode()
+// returns one MP3 frame at a time, already converted for MIX_AMBIENT:
+//
+//   Helix fixed-point decoder → downmix to mono → polyphase FIR to 24 kHz
+//
+// The rate converter is a 32-tap Blackman-windowed sinc with 64 phases. Its
+// cutoff sits at 0.9 × the lower Nyquist, so 44.1/48 kHz stations are
+// band-limited before decimation instead of aliasing (a 15 kHz tone at
+// 44.1 kHz lands 80+ dB down). At 24 kHz the stage is bypassed.
+// Any remaining clock drift is handled by the ambient DriftResampler, the
+// same as for PCM radio.
+//
+// Runs in websocketTask (CORE_1); about 1–2 ms per 26 ms frame on the S3.
+// MPEG-1/2 layer III at 16–48 kHz, mono or stereo.
+//
+// =========================================
+
+#ifndef MP3_INBUF_BYTES
+#define MP3_INBUF_BYTES 4096          // Compressed bytes held between packets (≥ 2 max frames)
+#endif
+#ifndef MP3_RS_TAPS
+#define MP3_RS_TAPS 32
+#endif
+#ifndef MP3_RS_PHASES
+#define MP3_RS_PHASES 64              // Must stay 64: the phase is the top 6 fraction bits
+#endif
+
+#define MP3_MAX_FRAME_SAMPLES 1152    // Per channel, MPEG-1 layer III
+#define MP3_OUT_MAX_SAMPLES   1024    // 24 kHz output per frame (16 kHz MPEG-2 frame → 864)
+
+class Mp3Stream {
+public:
+    // Create the decoder and buffers (PSRAM when available). Returns false on failure.
+    bool begin();
+    bool ready() const { return decoder != nullptr; }
+
+    // New stream: drop buffered bytes, bit reservoir and resampler history.
+    // The decoder is freed and re-created; ready() is false if that fails.
+    void reset();
+
+    // Append compressed bytes. Returns false if they did not fit; the buffer is
+    // then cleared and decoding resynchronises on the next frame header.
+    bool push(const uint8_t* data, size_t len);
+
+    // Decode the next complete frame. *out points at 24 kHz mono samples, valid
+    // until the next call. Returns the sample count, 0 when more input is needed.
+    int decode(const int16_t** out);
+
+    // Diagnostics
+    uint32_t sourceRate() const     { return inRate; }
+    uint8_t  sourceChannels() const { return inChannels; }
+    uint32_t framesDecoded() const  { return frames; }
+    uint32_t decodeErrors() const   { return errors; }
+
+private:
+    void configure(uint32_t rate);
+    int  resample(int16_t* dst);
+
+    void*    decoder = nullptr;       // HMP3Decoder
+    uint8_t* in = nullptr;            // compressed bytes
+    size_t   inLen = 0;
+    int16_t* pcm = nullptr;           // decoder output, interleaved
+    int16_t* hist = nullptr;          // mono input to the rate converter (history + new frame)
+    int      histLen = 0;
+    int16_t* outBuf = nullptr;
+
+    uint32_t inRate = 0;
+    uint8_t  inChannels = 0;
+    uint32_t step = 0;                // input samples per output sample, Q16.16
+    uint32_t pos = 0;                 // read position in hist, Q16.16
+    int16_t  coeffs[MP3_RS_PHASES][MP3_RS_TAPS];   // Q14
+
+    uint32_t frames = 0;
+    uint32_t errors = 0;
+};
@@ -0,0 +1,159 @@
+#include "NoiseSuppressor.h"
+#include "AudioKernels.h"
+#include <math.h>
+#include <string.h>
+
+#define NS_LOG_MAX   INT16_MAX
+
+static inline int16_t sat16(int32_t v) {
+    return (int16_t)(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+}
+
+void NoiseSuppressor::begin() {
+    for (int n = 0; n < NS_WINDOW; n++) {
+        window[n] = (int16_t)lroundf(32767.0f * (0.5f - 0.5f * cosf(2.0f * (float)M_PI * n / NS_WINDOW)));
+    }
+    for (int i = 0; i < 256; i++) {
+        exp2Frac[i] = (uint16_t)lroundf(32768.0f * exp2f(i / 256.0f));
+    }
+    gainFloor = (int16_t)lroundf(32767.0f * powf(10.0f, -NS_MAX_ATTENUATION_DB / 20.0f));
+    reset();
+}
+
+void NoiseSuppressor::reset() {
+    memset(prevHop, 0, sizeof(prevHop));
+    memset(ola, 0, sizeof(ola));
+    memset(smoothed, 0, sizeof(smoothed));
+    memset(prior, 0, sizeof(prior));
+    for (int k = 0; k < NS_BINS; k++) {
+        curMin[k] = NS_LOG_MAX;
+        windowMin[k] = NS_LOG_MAX;
+        for (int s = 0; s < NS_MINSTAT_SUBWINDOWS; s++) subMin[s][k] = NS_LOG_MAX;
+    }
+    subIndex = 0;
+    subHops = 0;
+    primed = false;
+    reductionQ8 = 0;
+}
+
+// Unscaled both ways: the caller divides the inverse by NS_FFT. Windowed
+// 16-bit input stays under 2^24 forward. The inverse of a spectrum that came
+// from such input stays under NS_FFT × the output amplitude at every stage.
+void NoiseSuppressor::fft(int32_t* re, int32_t* im, bool inverse) const {
+    fftQ15(re, im, NS_FFT_BITS, inverse, FFT_UNSCALED);
+}
+
+void NoiseSuppressor::suppress(int32_t* re, int32_t* im) {
+    for (int k = 0; k < NS_BINS; k++) {
+        int64_t p = (int64_t)re[k] * re[k] + (int64_t)im[k] * im[k];
+
+        // Noise: minimum of the smoothed periodogram, plus the bias
+        smoothed[k] = primed ? smoothed[k] + ((p - smoothed[k]) >> 3) : p;
+        int16_t ls = log2Q8((uint64_t)smoothed[k]);
+        if (ls < curMin[k]) curMin[k] = ls;
+        int32_t noiseLog = (windowMin[k] < curMin[k] ? windowMin[k] : curMin[k]) + NS_NOISE_BIAS_Q8;
+
+        // Posterior SNR γ = |X|² / noise, Q8
+        int32_t dl = log2Q8((uint64_t)p) - noiseLog;
+        if (dl < -8 * 256) dl = -8 * 256;
+        if (dl > 14 * 256) dl = 14 * 256;
+        int shift = (dl >> 8) - 7;
+        uint32_t gamma = shift >= 0 ? (uint32_t)exp2Frac[dl & 0xFF] << shift : exp2Frac[dl & 0xFF] >> -shift;
+
+        // Decision-directed a-priori SNR ξ = 0.98·G²γ(previous hop) + 0.02·max(γ - 1, 0), Q8
+        uint32_t post = gamma > 256 ? gamma - 256 : 0;
+        uint32_t xi = (prior[k] * 251 + post * 5) >> 8;
+
+        // Wiener G = ξ / (1 + ξ) = 1 - 1 / (1 + ξ), Q15
+        int32_t g = 32768 - (int32_t)((256u << 15) / (xi + 256));
+        if (g < gainFloor) g = gainFloor;
+        if (g > 32767) g = 32767;
+        prior[k] = (uint32_t)((((uint64_t)g * g) >> 15) * gamma >> 15);
+
+        re[k] = (int32_t)(((int64_t)re[k] * g) >> 15);
+        im[k] = (int32_t)(((int64_t)im[k] * g) >> 15);
+    }
+    primed = true;
+
+    // Minimum statistics bookkeeping: close a subwindow every NS_MINSTAT_HOPS
+    if (++subHops == NS_MINSTAT_HOPS) {
+        subHops = 0;
+        memcpy(subMin[subIndex], curMin, sizeof(curMin));
+        subIndex = (subIndex + 1) % NS_MINSTAT_SUBWINDOWS;
+        for (int k = 0; k < NS_BINS; k++) {
+            int16_t m = subMin[0][k];
+            for (int s = 1; s < NS_MINSTAT_SUBWINDOWS; s++) {
+                if (subMin[s][k] < m) m = subMin[s][k];
+            }
+            windowMin[k] = m;
+            curMin[k] = NS_LOG_MAX;
+        }
+    }
+}
+
+void NoiseSuppressor::process(int16_t* pcm) {
+    // Hop A: previous hop | first half of the frame. Hop B: the whole frame.
+    int64_t inE = 0;
+    for (int n = 0; n < NS_WINDOW; n++) {
+        int16_t a = n < NS_HOP ? prevHop[n] : pcm[n - NS_HOP];
+        zRe[n] = ((int32_t)a * window[n] + (1 << 14)) >> 15;
+        zIm[n] = ((int32_t)pcm[n] * window[n] + (1 << 14)) >> 15;
+        inE += (int32_t)pcm[n] * pcm[n];
+    }
+    memset(zRe + NS_WINDOW, 0, (NS_FFT - NS_WINDOW) * sizeof(int32_t));
+    memset(zIm + NS_WINDOW, 0, (NS_FFT - NS_WINDOW) * sizeof(int32_t));
+    memcpy(prevHop, pcm + NS_FRAME - NS_HOP, sizeof(prevHop));
+    fft(zRe, zIm, false);
+
+    // Split the two real hops: A = (Z[k] + Z*[N-k]) / 2, B = (Z[k] - Z*[N-k]) / 2i
+    for (int k = 0; k < NS_BINS; k++) {
+        int nk = (NS_FFT - k) & (NS_FFT - 1);
+        aRe[k] = (zRe[k] + zRe[nk]) >> 1;
+        aIm[k] = (zIm[k] - zIm[nk]) >> 1;
+        bRe[k] = (zIm[k] + zIm[nk]) >> 1;
+        bIm[k] = (zRe[nk] - zRe[k]) >> 1;
+    }
+    suppress(aRe, aIm);
+    suppress(bRe, bIm);
+
+    // Back into one spectrum, A + iB, and one inverse: A comes out real, B imaginary
+    for (int k = 0; k < NS_BINS; k++) {
+        zRe[k] = aRe[k] - bIm[k];
+        zIm[k] = aIm[k] + bRe[k];
+        if (k > 0 && k < NS_FFT / 2) {
+            zRe[NS_FFT - k] = aRe[k] + bIm[k];
+            zIm[NS_FFT - k] = bRe[k] - aIm[k];
+        }
+    }
+    fft(zRe, zIm, true);
+
+    // Overlap-add (kept at NS_FFT scale). After each hop, the first NS_HOP
+    // samples have all their contributions: they are the output.
+    int64_t outE = 0;
+    for (int h = 0; h < 2; h++) {
+        const int32_t* y = h == 0 ? zRe : zIm;
+        for (int n = 0; n < NS_FFT; n++) ola[n] += y[n];
+        for (int n = 0; n < NS_HOP; n++) {
+            int16_t s = sat16((ola[n] + (1 << (NS_FFT_BITS - 1))) >> NS_FFT_BITS);
+            pcm[h * NS_HOP + n] = s;
+            outE += (int32_t)s * s;
+        }
+        memmove(ola, ola + NS_HOP, (NS_FFT - NS_HOP) * sizeof(int32_t));
+        memset(ola + NS_FFT - NS_HOP, 0, NS_HOP * sizeof(int32_t));
+    }
+
+    int32_t dbQ8 = ((log2Q8((uint64_t)inE) - log2Q8((uint64_t)outE)) * 771) >> 8;   // 10·log10(2) = 3.01
+    reductionQ8 += (dbQ8 - reductionQ8) >> 5;
+}
+
+int NoiseSuppressor::noiseLevel() const {
+    // Parseval: Σ|X|² over all bins = NS_FFT · Σ(x·w)², and Σw² = 0.375 · NS_WINDOW for Hann
+    double sum = 0;
+    for (int k = 0; k < NS_BINS; k++) {
+        int16_t m = windowMin[k] < curMin[k] ? windowMin[k] : curMin[k];
+        if (m == NS_LOG_MAX) return 0;
+        sum += (k == 0 || k == NS_FFT / 2 ? 1 : 2) * exp2((m + NS_NOISE_BIAS_Q8) / 256.0);
+    }
+    double variance = sum / (NS_FFT * 0.375 * NS_WINDOW);
+    return (int)lround(0.8 * sqrt(variance));   // mean |x| of Gaussian noise ≈ 0.8σ
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ============== NOISE SUPPRESSOR ==============
+//
+// Takes steady background noise (fans, fridges, extractor hoods, traffic)
+// out of the mic stream before anything listens to it. audioTask runs it on
+// every MIC_FRAME_SIZE frame after the echo canceller, so the uplink, the
+// endpointer, the conversation VAD, the VU meter, the pre-roll and the wake
+// word all see the cleaned audio. The output is the input delayed by
+// NS_HOP (10ms).
+//
+// ANALYSIS: two 10ms hops per frame. Each hop's 20ms periodic Hann window
+// (which sums to one at 50% overlap, so no synthesis window is needed) is
+// zero-padded to a 512-point FFT. The two real hops of a frame share one
+// complex FFT (first hop in the real part, second in the imaginary part), and
+// the two filtered spectra share one inverse, so a frame costs two FFTs. The
+// padding holds the spread of the gains, which is overlap-added into the
+// following hops.
+//
+// NOISE: minimum statistics (Martin). The periodogram is smoothed per bin
+// over ~80ms. Its minimum over NS_MINSTAT_SUBWINDOWS × NS_MINSTAT_HOPS hops
+// (~1.5s), plus a fixed bias, is the noise estimate. Speech rarely holds a
+// bin up for that long, so no voice detector is needed and a changed noise
+// is followed within that window. Tracked as log2 in Q8, so the minimum
+// search is on int16 and the bias is a plain offset.
+//
+// GAIN: Wiener, with the a-priori SNR from the decision-directed rule
+// (Ephraim-Malah, smoothing 0.98), which keeps musical noise down. Gains are
+// Q15 and never below NS_MAX_ATTENUATION_DB, so the noise that remains keeps
+// its character instead of pumping.
+//
+// Everything on the signal path is integer: Q15 window, twiddles and gains,
+// int32 spectra with int64 products, and one 32-bit division per bin.
+// audioTask counts the cycles of every frame and logs them against
+// NS_CYCLE_BUDGET every 30s. The budget is advisory: an overrun is logged
+// ("OVER BUDGET") and nothing degrades at run time. Reusing the previous
+// hop's gains on the frame after an overrun was tried in nseval: the two
+// FFTs are most of a frame, so it saved only ~13%, and it halved the
+// attenuation in speech pauses (14 -> 7 dB). An overrun calls for retuning
+// (NS_FFT, the hop), not a per-frame fallback.
+//
+// Pure C++ with no Arduino dependencies: tools/nseval.cpp runs it on the
+// host over speech and noise recordings.
+//
+// =========================================
+
+#ifndef NS_MAX_ATTENUATION_DB
+#define NS_MAX_ATTENUATION_DB  15       // gain floor
+#endif
+#ifndef NS_MINSTAT_SUBWINDOWS
+#define NS_MINSTAT_SUBWINDOWS  8
+#endif
+#ifndef NS_MINSTAT_HOPS
+#define NS_MINSTAT_HOPS        19       // hops per subwindow: 8 × 19 × 10ms ≈ 1.5s of minimum search
+#endif
+#ifndef NS_NOISE_BIAS_Q8
+#define NS_NOISE_BIAS_Q8       192      // log2 Q8 from the smoothed minimum up to the mean noise (+2.3 dB)
+#endif
+#ifndef NS_CYCLE_BUDGET
+#define NS_CYCLE_BUDGET        240000   // per 20ms frame: 5% of a 240 MHz core (advisory, logged)
+#endif
+
+#define NS_FRAME               320      // one MIC_FRAME_SIZE
+#define NS_HOP                 160
+#define NS_WINDOW              320
+#define NS_FFT                 512
+#define NS_FFT_BITS            9
+#define NS_BINS                (NS_FFT / 2 + 1)
+
+class NoiseSuppressor {
+public:
+    void begin();
+    // Forget the noise estimate and the audio in flight
+    void reset();
+
+    // Suppress noise in one NS_FRAME frame, in place. The frame that comes
+    // out is the input NS_HOP samples earlier.
+    void process(int16_t* pcm);
+
+    // Noise taken out of the last frames (smoothed), in dB
+    float reductionDb() const  { return reductionQ8 / 256.0f; }
+    // Estimated noise level as a mean absolute sample value, for logs
+    int   noiseLevel() const;
+
+private:
+    void fft(int32_t* re, int32_t* im, bool inverse) const;
+    // Gains for one hop's spectrum (bins 0..NS_FFT/2), applied in place
+    void suppress(int32_t* re, int32_t* im);
+
+    int16_t  window[NS_WINDOW];                   // periodic Hann, Q15
+    uint16_t exp2Frac[256];                       // 2^(i/256), Q15
+    int16_t  gainFloor = 0;                       // Q15
+
+    int16_t  prevHop[NS_HOP];                     // last hop of the previous frame
+    int32_t  ola[NS_FFT];                         // overlap-add of the filtered hops
+    int32_t  zRe[NS_FFT];                         // FFT scratch
+    int32_t  zIm[NS_FFT];
+    int32_t  aRe[NS_BINS];                        // half spectra of the two hops
+    int32_t  aIm[NS_BINS];
+    int32_t  bRe[NS_BINS];
+    int32_t  bIm[NS_BINS];
+
+    // Per bin
+    int64_t  smoothed[NS_BINS];                   // smoothed periodogram
+    int16_t  subMin[NS_MINSTAT_SUBWINDOWS][NS_BINS];  // log2 Q8 minimum of each finished subwindow
+    int16_t  curMin[NS_BINS];                     // of the subwindow in progress
+    int16_t  windowMin[NS_BINS];                  // over the finished subwindows
+    uint32_t prior[NS_BINS];                      // G²·γ of the previous hop, Q8 (decision-directed)
+
+    int      subIndex = 0;
+    int      subHops = 0;
+    bool     primed = false;
+    int32_t  reductionQ8 = 0;
+};
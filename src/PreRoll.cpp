@@ -0,0 +1,52 @@
+#include "PreRoll.h"
+#include <esp_heap_caps.h>
+
+bool PreRoll::begin() {
+    size_t bytes = PREROLL_SAMPLES * sizeof(int16_t);
+    buf = (int16_t*)heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!buf) {
+        Serial.println("PreRoll: PSRAM unavailable - falling back to internal RAM");
+        buf = (int16_t*)heap_caps_malloc(bytes, MALLOC_CAP_8BIT);
+    }
+    if (!buf) {
+        return false;
+    }
+    head = 0;
+    count = 0;
+    Serial.printf("PreRoll: %u ms (%u KB) allocated\n", (unsigned)PREROLL_MS, (unsigned)(bytes / 1024));
+    return true;
+}
+
+void PreRoll::push(const int16_t* pcm, size_t n, uint32_t nowMs) {
+    if (!buf || n == 0) return;
+    if (n > PREROLL_SAMPLES) {
+        pcm += n - PREROLL_SAMPLES;
+        n = PREROLL_SAMPLES;
+    }
+    size_t first = min(n, (size_t)PREROLL_SAMPLES - head);
+    memcpy(buf + head, pcm, first * sizeof(int16_t));
+    memcpy(buf, pcm + first, (n - first) * sizeof(int16_t));
+    head = (head + n) % PREROLL_SAMPLES;
+    count = min(count + n, (size_t)PREROLL_SAMPLES);
+    lastMs = nowMs;
+}
+
+size_t PreRoll::beginDrain(uint32_t nowMs) {
+    if (!buf || (int32_t)(nowMs - lastMs) > PREROLL_STALE_MS) {
+        count = 0;
+    }
+    count -= count % MIC_FRAME_SIZE;   // the oldest partial frame is dropped
+    return count / MIC_FRAME_SIZE;
+}
+
+bool PreRoll::popFrame(int16_t* out, uint32_t* captureMs) {
+    if (count < MIC_FRAME_SIZE) return false;
+    size_t tail = (head + PREROLL_SAMPLES - count) % PREROLL_SAMPLES;
+    size_t first = min((size_t)MIC_FRAME_SIZE, (size_t)PREROLL_SAMPLES - tail);
+    memcpy(out, buf + tail, first * sizeof(int16_t));
+    memcpy(out + first, buf, (MIC_FRAME_SIZE - first) * sizeof(int16_t));
+    count -= MIC_FRAME_SIZE;
+    // Samples still buffered after this frame were captured after its last sample
+    *captureMs = lastMs - (uint32_t)(count * 1000 / AUDIO_SAMPLE_RATE);
+    return true;
+}
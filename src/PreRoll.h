@@ -0,0 +1,62 @@
+#pragma once
+
+#include <Arduino.h>
+#include "Config.h"
+
+// ============== PRE-ROLL ==============
+//
+// The last PREROLL_MS of microphone audio from before a recording starts.
+// Recording begins only after the touch pad has been debounced and the first
+// i2s_read of the turn has returned. In the conversation window, it begins
+// after the frame that tripped conversationVADDetected has been read and
+// discarded. Without pre-roll, the start of the first word is lost.
+//
+// While no recording is running, audioTask takes every mic frame and
+// pushes every gained sample here (except while a response is playing, when
+// the ring is cleared so that no echo is sent). On the first frame of a turn,
+// audioTask sends the recordingStart state, then drains the ring through
+// sendAudioChunk ahead of the live frame. The server sees the pre-roll as the
+// start of the turn; DTX turns its silent frames into markers.
+//
+// Only whole MIC_FRAME_SIZE frames are sent. The oldest partial frame is
+// dropped, and every frame keeps the capture time of its last sample. Audio
+// that stopped arriving more than PREROLL_STALE_MS before the turn started is
+// not continuous with it and is discarded.
+//
+// Used by audioTask only (no locking). Storage is in PSRAM when available.
+//
+// =========================================
+
+#ifndef PREROLL_MS
+#define PREROLL_MS        500
+#endif
+#ifndef PREROLL_STALE_MS
+#define PREROLL_STALE_MS  200
+#endif
+
+#define PREROLL_FRAME_MS  (MIC_FRAME_SIZE * 1000 / AUDIO_SAMPLE_RATE)
+#define PREROLL_SAMPLES   ((PREROLL_MS / PREROLL_FRAME_MS) * MIC_FRAME_SIZE)
+
+class PreRoll {
+public:
+    // Allocate storage. Returns false on allocation failure (pre-roll is then disabled).
+    bool begin();
+
+    // Append n samples; nowMs is the capture time of the last one.
+    void push(const int16_t* pcm, size_t n, uint32_t nowMs);
+    void clear() { count = 0; }
+
+    // Start draining for a turn whose first live frame was captured at nowMs.
+    // Returns the number of whole frames popFrame() will return.
+    size_t beginDrain(uint32_t nowMs);
+    // Oldest whole frame (MIC_FRAME_SIZE samples) and its capture time. False when empty.
+    bool popFrame(int16_t* out, uint32_t* captureMs);
+
+    size_t samples() const { return count; }
+
+private:
+    int16_t* buf = nullptr;
+    size_t   head = 0;       // next write index
+    size_t   count = 0;      // buffered samples, newest ending at head
+    uint32_t lastMs = 0;     // capture time of the newest sample
+};
@@ -0,0 +1,142 @@
+#include "ToneSynth.h"
+
+static constexpr int     TONE_SAMPLE_RATE = 24000;
+static constexpr int     TONE_SAMPLES_PER_MS = TONE_SAMPLE_RATE / 1000;
+static constexpr int     TONE_TABLE_BITS = 8;
+static constexpr int     TONE_TABLE_SIZE = 1 << TONE_TABLE_BITS;
+static constexpr int32_t ENV_ONE = 1 << 30;
+
+// One sine cycle in Q15, plus a guard entry so interpolation never wraps
+static int16_t sineTable[TONE_TABLE_SIZE + 1];
+
+bool ToneSynth::begin() {
+    for (int i = 0; i <= TONE_TABLE_SIZE; i++) {
+        sineTable[i] = (int16_t)lroundf(sinf(2.0f * PI * i / TONE_TABLE_SIZE) * 32767.0f);
+    }
+    queue = xQueueCreate(TONE_QUEUE_LEN, sizeof(Request));
+    return queue != nullptr;
+}
+
+bool ToneSynth::play(const ToneSequence* s) {
+    if (!queue || !s || s->count == 0) return false;
+    Request req = { s, epoch.load(std::memory_order_acquire) };
+    if (xQueueSend(queue, &req, 0) != pdTRUE) return false;
+    if (consumer) xTaskNotifyGive(consumer);
+    return true;
+}
+
+void ToneSynth::stop() {
+    epoch.fetch_add(1, std::memory_order_acq_rel);
+    if (consumer) xTaskNotifyGive(consumer);
+}
+
+// ── speakerTask ─────────────────────────────────────────────────────────────
+
+bool ToneSynth::nextSequence() {
+    Request req;
+    const uint32_t now = epoch.load(std::memory_order_acquire);
+    while (queue && xQueueReceive(queue, &req, 0) == pdTRUE) {
+        if (req.epoch != now) continue;      // queued before the last stop()
+        seq = req.seq;
+        seqEpoch = req.epoch;
+        noteIndex = 0;
+        startNote();
+        return true;
+    }
+    seq = nullptr;
+    return false;
+}
+
+bool ToneSynth::active() {
+    if (seq && seqEpoch != epoch.load(std::memory_order_acquire)) seq = nullptr;
+    return seq || (queue && uxQueueMessagesWaiting(queue) > 0);
+}
+
+void ToneSynth::startNote() {
+    const ToneNote& note = seq->notes[noteIndex];
+    noteLeft = note.durationMs * TONE_SAMPLES_PER_MS;
+    releaseAt = min((int)seq->envelope.releaseMs * TONE_SAMPLES_PER_MS, noteLeft);
+    phase = 0;
+    phaseInc = (uint32_t)(((uint64_t)note.freqHz << 32) / TONE_SAMPLE_RATE);
+    amplitude = note.freqHz ? note.amplitude : 0;
+    env = 0;
+    enterStage(ATTACK);
+}
+
+void ToneSynth::enterStage(Stage s) {
+    const ToneEnvelope& e = seq->envelope;
+    stage = s;
+    switch (s) {
+        case ATTACK:
+            stageLeft = e.attackMs * TONE_SAMPLES_PER_MS;
+            if (stageLeft == 0) {
+                env = ENV_ONE;
+                enterStage(DECAY);
+                return;
+            }
+            envStep = (ENV_ONE - env) / stageLeft;
+            break;
+        case DECAY: {
+            const int32_t target = (int32_t)e.sustainQ15 << 15;
+            stageLeft = e.decayMs * TONE_SAMPLES_PER_MS;
+            if (stageLeft == 0) {
+                env = target;
+                enterStage(SUSTAIN);
+                return;
+            }
+            envStep = (target - env) / stageLeft;
+            break;
+        }
+        case SUSTAIN:
+            stageLeft = 0;
+            envStep = 0;
+            break;
+        case RELEASE:
+            stageLeft = releaseAt;
+            envStep = stageLeft ? -env / stageLeft : 0;
+            break;
+    }
+}
+
+int ToneSynth::render(int16_t* out, int n) {
+    int produced = 0;
+    if (seq && seqEpoch != epoch.load(std::memory_order_acquire)) seq = nullptr;
+
+    while (produced < n) {
+        if (!seq && !nextSequence()) break;
+        if (noteLeft == 0) {
+            if (++noteIndex >= seq->count) {
+                seq = nullptr;
+            } else {
+                startNote();
+            }
+            continue;
+        }
+
+        int take = min(noteLeft, n - produced);
+        for (int i = 0; i < take; i++) {
+            if (noteLeft == releaseAt && stage != RELEASE) {
+                enterStage(RELEASE);
+            } else if (stageLeft == 0 && (stage == ATTACK || stage == DECAY)) {
+                enterStage((Stage)(stage + 1));
+            }
+            env += envStep;
+            if (env > ENV_ONE) env = ENV_ONE;
+            else if (env < 0) env = 0;
+            if (stageLeft > 0) stageLeft--;
+
+            // Table index from the top 8 phase bits, Q15 interpolation weight from the next 15
+            const uint32_t idx = phase >> (32 - TONE_TABLE_BITS);
+            const int32_t frac = (int32_t)((phase >> (32 - TONE_TABLE_BITS - 15)) & 0x7FFF);
+            const int32_t a = sineTable[idx];
+            const int32_t wave = a + (((sineTable[idx + 1] - a) * frac) >> 15);
+            const int32_t level = (amplitude * (env >> 15)) >> 15;
+            out[produced + i] = (int16_t)((wave * level) >> 15);
+
+            phase += phaseInc;
+            noteLeft--;
+        }
+        produced += take;
+    }
+    return produced;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+
+// ============== TONE SYNTH ==============
+//
+// Wavetable synthesizer for UI sounds (volume chime, shutdown melody). Feeds
+// the mixer's MIX_UI voice. It replaces the old approach, which filled a PCM
+// buffer with one sin() call per sample and then blocked the caller in
+// i2s_write.
+//
+// A sound is a const ToneSequence: a list of notes plus one ADSR envelope
+// applied to each note. play() only posts a pointer to a queue, so it returns
+// in microseconds from any task. speakerTask renders the samples block by
+// block as part of the mix:
+//
+//   - 256-entry Q15 sine table, linearly interpolated
+//   - Q32 phase accumulator (frequency resolution ~6 µHz)
+//   - Envelope stages are linear ramps, stepped in Q30
+//
+// Sequences must have static storage duration: the queue holds pointers.
+// stop() works like AudioRing::flush(): sequences queued before the call are
+// dropped, sequences queued after it still play.
+//
+// ========================================
+
+#ifndef TONE_QUEUE_LEN
+#define TONE_QUEUE_LEN 4          // Sequences waiting behind the one playing
+#endif
+
+struct ToneNote {
+    uint16_t freqHz;              // 0 = rest
+    uint16_t durationMs;          // includes the release
+    int16_t  amplitude;           // peak sample value
+};
+
+struct ToneEnvelope {
+    uint16_t attackMs;
+    uint16_t decayMs;
+    int16_t  sustainQ15;          // level after decay (32767 = peak)
+    uint16_t releaseMs;           // taken from the end of each note
+};
+
+struct ToneSequence {
+    const ToneNote* notes;
+    uint8_t         count;
+    ToneEnvelope    envelope;
+};
+
+class ToneSynth {
+public:
+    // Build the wavetable and create the request queue. Returns false on allocation failure.
+    bool begin();
+
+    // Task woken when a sequence is queued (speakerTask).
+    void setConsumer(TaskHandle_t task) { consumer = task; }
+
+    // ── Any task ──
+    // Queue a sequence. Never blocks. Returns false if the queue is full.
+    bool play(const ToneSequence* seq);
+    // Drop the playing sequence and everything queued so far.
+    void stop();
+
+    // ── speakerTask only ──
+    // True while a sequence is playing or queued
+    bool active();
+    // Render up to n mono samples. Returns samples written (0 when idle).
+    int  render(int16_t* out, int n);
+
+private:
+    enum Stage : uint8_t { ATTACK, DECAY, SUSTAIN, RELEASE };
+
+    struct Request {
+        const ToneSequence* seq;
+        uint32_t epoch;               // stop() count when queued
+    };
+
+    bool nextSequence();
+    void startNote();
+    void enterStage(Stage s);
+
+    QueueHandle_t queue = nullptr;
+    TaskHandle_t consumer = nullptr;
+    std::atomic<uint32_t> epoch{0};
+    uint32_t seqEpoch = 0;
+
+    const ToneSequence* seq = nullptr;
+    uint8_t  noteIndex = 0;
+    uint32_t phase = 0;
+    uint32_t phaseInc = 0;
+    int32_t  amplitude = 0;
+    int      noteLeft = 0;            // samples left in the current note
+    int      releaseAt = 0;           // noteLeft value at which release starts
+
+    Stage    stage = ATTACK;
+    int32_t  env = 0;                 // Q30
+    int32_t  envStep = 0;             // Q30 per sample
+    int      stageLeft = 0;
+};
@@ -9,6 +9,7 @@
 #include <freertos/task.h>
 #include <esp_task_wdt.h>
 #include <esp_heap_caps.h>
+#include <esp_timer.h>
 #include <Preferences.h>
 #include <time.h>
 #include "Config.h"
@@ -17,6 +18,17 @@
 #include "EyeAnimationVisualizer.h"
 #include "ws_handler.h"
 #include "LedModes.h"
+#include "AudioMixer.h"
+#include "AudioKernels.h"
+#include "DmaProfiles.h"
+#include "MicUplink.h"
+#include "Endpointer.h"
+#include "PreRoll.h"
+#include "KeywordSpotter.h"
+#include "EchoCanceller.h"
+#include "NoiseSuppressor.h"
+#include "MicAgc.h"
+#include "MicCapture.h"
 
 // Debug logging macro - controlled by Config.h DEBUG_LOGS flag
 #ifdef DEBUG_LOGS
@@ -48,12 +60,24 @@ bool isWebSocketConnected = false;
 volatile bool recordingActive = false;
 volatile bool isPlayingResponse = false;
 volatile bool isPlayingAmbient = false; // Track ambient sound playback separately
+volatile uint8_t uplinkCodec = UPLINK_CODEC_NONE;  // Binary mic frame codec, from ready.uplinkCodecs (see MicUplink.h)
+volatile bool uplinkDtx = false;                   // Server expands DTX silence markers (ready.uplinkDtx)
 bool isPlayingAlarm = false; // Track alarm sound playback
 volatile bool turnComplete = false; // Track when Gemini has finished its turn
 volatile bool responseInterrupted = false; // Flag to ignore audio after interrupt - volatile: read by audio/websocket tasks
 bool shutdownSoundPlayed = false; // Flag to prevent repeated shutdown sounds during reconnection
 uint32_t recordingStartTime = 0;
 uint32_t lastVoiceActivityTime = 0;
+Endpointer endpointer;                              // audioTask only (see Endpointer.h)
+PreRoll preRoll;                                    // audioTask only (see PreRoll.h)
+#if KWS_ENABLED
+KeywordSpotter keywordSpotter;                      // audioTask only (see KeywordSpotter.h)
+#endif
+EchoReference echoReference;                        // written by speakerTask, read by audioTask (see EchoCanceller.h)
+EchoCanceller echoCanceller;                        // audioTask only
+NoiseSuppressor noiseSuppressor;                    // audioTask only (see NoiseSuppressor.h)
+MicAgc micAgc;                                      // audioTask only (see MicAgc.h)
+volatile uint32_t endpointSilenceMs = VAD_SILENCE_MS;  // Silence that ends the turn, refreshed by audioTask every frame
 volatile uint32_t lastAudioChunkTime = 0;      // Track when we last received ANY audio chunk
 volatile uint32_t lastGeminiAudioTime = 0;     // Track when we last received a Gemini (non-ambient) chunk — used for drain detection during radio overlap
 ConvState convState = ConvState::IDLE;   // Main-loop UX state machine (not cross-task)
@@ -63,18 +87,23 @@ uint32_t webSocketSendFailures = 0; // Count send failures
 // NOTE: lastWiFiCheck is declared as a static local inside loop() - no global needed.
 int32_t lastRSSI = 0; // Track signal strength changes
 bool firstAudioChunk = true;
-volatile float volumeMultiplier = 0.30f;  // Volume control - volatile: read by audioTask, written by main/WS task
-volatile int32_t currentAudioLevel = 0;  // Current audio amplitude - volatile: written by audioTask, read by ledTask
+volatile float volumeMultiplier = 0.30f;  // Volume control - volatile: read by speakerTask, written by main/WS task
+volatile int32_t currentAudioLevel = 0;  // Current audio amplitude - volatile: written by speakerTask (playback) and audioTask (mic), read by ledTask
 volatile float smoothedAudioLevel = 0.0f;  // Smoothed audio level - volatile: written by ledTask
 volatile bool conversationMode = false;  // Track if we're in conversation window
 uint32_t conversationWindowStart = 0;  // Timestamp when conversation window opened
 volatile bool recordingStartSent = false;    // Track if recordingStart state message has been sent for current recording
 
 // ---- I2S_NUM_0 ownership ----
-// audioTask is the SOLE caller of i2s_read(I2S_NUM_0). Other tasks must NOT call it directly.
-// Results are shared via these two volatile values:
+// micCaptureTask is the SOLE caller of i2s_read(I2S_NUM_0). Other tasks must NOT call it directly.
+// It commits frames to micRing; audioTask processes them and shares results via these volatile values:
 volatile int32_t ambientMicRows = 0; // Pre-computed VU row count; LED renderer reads this
 volatile bool conversationVADDetected = false; // audioTask sets this when VAD fires during conv. window
+#if KWS_ENABLED
+volatile bool wakeWordDetected = false;        // audioTask sets this when the keyword spotter fires; loop() starts recording
+#endif
+volatile bool kwsReloadRequested = true;       // (Re)load the wake-word model from the asset cache (boot, after a download)
+volatile bool bargeInDetected = false;         // audioTask sets this when the user talks over a Gemini response; loop() interrupts it
 
 // Audio level delay buffer for LED sync.
 // Size 1: reads the value just written — no artificial delay.
@@ -87,15 +116,47 @@ int audioBufferIndex = 0;
 TaskHandle_t websocketTaskHandle = NULL;
 TaskHandle_t ledTaskHandle = NULL;
 TaskHandle_t audioTaskHandle = NULL;
+TaskHandle_t speakerTaskHandle = NULL;
+TaskHandle_t micCaptureTaskHandle = NULL;
+
+// Speaker output (see speakerTask)
+#ifndef TASK_STACK_SPEAKER
+#define TASK_STACK_SPEAKER 4096
+#endif
+#ifndef SPK_DMA_BUF_LEN
+#define SPK_DMA_BUF_LEN 512       // Frames per DMA buffer — one mixer block
+#endif
+#define SPK_DMA_BUF_BYTES (SPK_DMA_BUF_LEN * 4)   // 16-bit stereo
+static_assert(SPK_DMA_BUF_LEN == MIX_BLOCK_FRAMES, "speakerTask writes one mixer block per DMA buffer");
+QueueHandle_t i2sSpeakerEventQueue = NULL;   // I2S_NUM_1 driver events (TX_DONE per DMA buffer)
+SpeakerStats speakerStats;
+volatile DmaProfileId requestedDmaProfile = DMA_PROFILE_TALK;  // set by updateDmaProfile(), applied by speakerTask/micCaptureTask
+DmaProfileId micDmaProfile = DMA_PROFILE_TALK;                 // profile I2S_NUM_0 is installed with (micCaptureTask)
+volatile bool dmaMeasure = DMA_PROFILE_MEASURE;                // speakerTask's [DMA] log; 'd' on the serial console toggles it
+
+// Mic capture (see micCaptureTask)
+#ifndef TASK_STACK_MIC_CAPTURE
+#define TASK_STACK_MIC_CAPTURE 3072
+#endif
+QueueHandle_t i2sMicEventQueue = NULL;       // I2S_NUM_0 driver events (RX_DONE per DMA buffer)
+AudioRing micRing;                           // written by micCaptureTask, read by audioTask (see MicCapture.h)
+MicCapture micCapture;                       // micCaptureTask only
 
 // Audio processing (raw PCM - no codec needed)
 
 // Audio buffers
-QueueHandle_t audioOutputQueue; // Queue for playback audio
-// Audio queue size: 30 packets = ~1.2s buffer
-// Provides good jitter tolerance with paced delivery
+AudioMixer audioMixer; // One SPSC frame ring per source, mixed by speakerTask (see AudioMixer.h)
+JitterBuffer jitterBuffer; // Adaptive playout delay for Gemini voice (see JitterBuffer.h)
+AssetCache assetCache;   // Alarm / zen bell / soundscapes cached on the "assets" flash partition (see AssetCache.h)
+AssetPlayer assetPlayer; // Streams a cached asset into MIX_ALARM from speakerTask
+AssetPlayer ambientPlayer; // Loops a cached soundscape into MIX_AMBIENT from speakerTask
+static volatile uint16_t localAmbientSequence = 0;  // ambientSound.sequence that ambientPlayer is playing
+AmbientClip ambientClip; // Download-once ambient loops in PSRAM, crossfaded into MIX_AMBIENT from speakerTask
+static volatile bool clipDownloadPending = false;     // startAmbientSound stopped the clip; loop() requests once it is off
+static volatile uint32_t clipDownloadPendingSince = 0;
+Mp3Stream mp3Stream;     // Decodes relayed MP3 radio into MIX_AMBIENT (websocketTask, see Mp3Stream.h)
+// Voice/ambient ring size: AUDIO_RING_BYTES (default 64 KB ≈ 1.4s of 24kHz mono, see AudioRing.h)
 // Tuning: Increase for more buffer (higher latency), decrease for lower latency (more underruns)
-// AUDIO_QUEUE_SIZE is defined in Config.h
 
 volatile LEDMode currentLEDMode = LED_IDLE;  // Start directly in idle mode
 bool isAmbientVUMode = false;  // Toggle for ambient sound VU meter mode
@@ -115,9 +176,6 @@ MoonState moonState = {"", 0, 0.0, 0, false};
 // LED mutex for thread-safe access
 SemaphoreHandle_t ledMutex = NULL;
 
-// I2S speaker mutex - prevents audioTask and tone functions writing I2S_NUM_1 simultaneously
-SemaphoreHandle_t i2sSpeakerMutex = NULL;
-
 // WebSocket send mutex - serialises all sendTXT calls across websocketTask, audioTask, and loop()
 // Without this, concurrent sends from different tasks corrupt the TCP frame buffer and cause disconnects.
 SemaphoreHandle_t wsSendMutex = NULL;
@@ -126,7 +184,7 @@ SemaphoreHandle_t wsSendMutex = NULL;
 SemaphoreHandle_t recordingMutex = NULL;
 
 // Ambient sound state
-AmbientSound ambientSound = {"", false, 0, 0, 0};
+AmbientSound ambientSound = {"", false, 0, 0, 0, 0};
 
 // Pomodoro timer state
 PomodoroState pomodoroState = {PomodoroState::FOCUS, 0, 25 * 60, 0, 0, false, false, 25, 5, 15, false, 0, 0};
@@ -155,11 +213,13 @@ void onWebSocketEvent(WStype_t type, uint8_t * payload, size_t length);
 void websocketTask(void * parameter);
 void ledTask(void * parameter);
 void audioTask(void * parameter);
+void speakerTask(void * parameter);
+void micCaptureTask(void * parameter);
 void updateLEDs();
 bool initI2SMic();
 bool initI2SSpeaker();
-bool detectVoiceActivity(int16_t* samples, size_t count);
-void sendAudioChunk(uint8_t* data, size_t length);
+void sendAudioChunk(uint8_t* data, size_t length, uint32_t captureMs);
+void resetMicUplinkTurn();
 void playZenBell();
 void playShutdownSound();
 void playVolumeChime();
@@ -167,16 +227,19 @@ void clearAudioAndLEDs();  // Helper to clear audio buffers and LEDs
 void escapeToIdle();          // Universal long-press teardown: stop all modes, start recording
 // Loop sub-tasks (defined just before loop())
 static void checkAlarms();
+static void serviceAssetCache();
+static void serviceAmbientClip();
 static void handleFlashAnimations();
 static void handlePomodoroTick();
 static void handleAmbientCompletion();
 static void resumeRadioStream();
+static void requestAmbient(bool download);
 
 // ============== HELPER FUNCTIONS ==============
 
 // Helper function to clear audio buffers and LEDs (called during mode transitions)
 void clearAudioAndLEDs() {
- // Drain audio queue and mutex-guarded zero — replaces old triple-zero workaround
+ // Drain audio ring and mutex-guarded zero — replaces old triple-zero workaround
  drainAudioAndSilence(200);
  
  // Clear LED buffer with mutex protection
@@ -207,8 +270,7 @@ void escapeToIdle() {
         String stopMsg;
         serializeJson(stopDoc, stopMsg);
         wsSendMessage(stopMsg);
-        AudioChunk dummy;
-        while (xQueueReceive(audioOutputQueue, &dummy, 0) == pdTRUE) {}
+        audioMixer.flushAll();
         i2sZeroSafe();
         isPlayingAmbient = false;
         ambientSound.active = false;
@@ -260,6 +322,7 @@ void escapeToIdle() {
         xSemaphoreGive(recordingMutex);
     }
     currentLEDMode = LED_RECORDING;
+    updateDmaProfile();
 }
 
 // ============== DAY/NIGHT BRIGHTNESS CONTROL ==============
@@ -345,13 +408,6 @@ void setup() {
  while (true) { delay(1000); } // Hard halt - nothing is safe without the mutex
  }
 
- // Create I2S speaker mutex to prevent audioTask and tone functions writing I2S_NUM_1 simultaneously
- i2sSpeakerMutex = xSemaphoreCreateMutex();
- if (i2sSpeakerMutex == NULL) {
- Serial.println("FATAL: Failed to create I2S speaker mutex - halting!");
- while (true) { delay(1000); }
- }
-
  // Create WebSocket send mutex - serialises sendTXT across all tasks to prevent frame corruption
  wsSendMutex = xSemaphoreCreateMutex();
  if (wsSendMutex == NULL) {
@@ -407,18 +463,34 @@ void setup() {
     }
     Serial.println("================================\n");
 
-    // Create audio queue
-    Serial.println("Creating audio queue...");
+    // Create audio mixer (one ring per source)
+    Serial.println("Creating audio mixer...");
     Serial.flush();
-    audioOutputQueue = xQueueCreate(AUDIO_QUEUE_SIZE, sizeof(AudioChunk));
-    if (!audioOutputQueue) {
-        Serial.println("Failed to create audio queue");
+    if (!audioMixer.begin()) {
+        Serial.println("Failed to create audio mixer");
         currentLEDMode = LED_ERROR;
         return;
     }
-    Serial.println("Audio queue created");
+    if (!micRing.begin(MIC_RING_BYTES)) {
+        Serial.println("Failed to create mic ring");
+        currentLEDMode = LED_ERROR;
+        return;
+    }
+    audioMixer.attachJitterBuffer(&jitterBuffer);
+    Serial.println("Audio mixer created");
     Serial.flush();
     
+    // Local copies of alarm / zen bell / soundscapes (optional - the server streams them otherwise)
+    assetCache.begin();
+    assetPlayer.begin(&assetCache);
+    ambientPlayer.begin(&assetCache);
+    ambientClip.begin();
+    
+    // MP3 radio decoder (only advertised to the server if this succeeds)
+    if (!mp3Stream.begin()) {
+        Serial.println("MP3 decoder unavailable - radio will stream as PCM");
+    }
+    
     // Raw PCM streaming - no codec initialization needed
     Serial.println("Audio pipeline: Raw PCM (16-bit, 16kHz mic  24kHz speaker)");
 
@@ -429,6 +501,16 @@ void setup() {
         return;
     }
     Serial.println("Microphone initialized");
+    endpointer.begin(VAD_SILENCE_MS);
+    if (!preRoll.begin()) {
+        Serial.println("Pre-roll allocation failed - recordings start at the trigger");
+    }
+    if (!echoReference.begin()) {
+        Serial.println("Echo reference allocation failed - no barge-in during responses");
+    }
+    echoCanceller.begin(&echoReference);
+    noiseSuppressor.begin();
+    micAgc.begin();
 
     if (!initI2SSpeaker()) {
         Serial.println("Speaker init failed");
@@ -542,6 +624,11 @@ void setup() {
     xTaskCreatePinnedToCore(websocketTask, "WebSocket", TASK_STACK_WEBSOCKET, NULL, 3, &websocketTaskHandle, CORE_1);
     xTaskCreatePinnedToCore(ledTask,         "LEDs",      TASK_STACK_LED,       NULL, 1, &ledTaskHandle,       CORE_0);  // Priority 1 for smooth animation
     xTaskCreatePinnedToCore(audioTask,       "Audio",     TASK_STACK_AUDIO,     NULL, 2, &audioTaskHandle,     CORE_1);
+    // Mic capture on the other core, above the LEDs: it only wakes per DMA buffer, so
+    // the downlink and playback on CORE_1 can never leave the mic DMA unread
+    xTaskCreatePinnedToCore(micCaptureTask,  "MicCapture", TASK_STACK_MIC_CAPTURE, NULL, 5, &micCaptureTaskHandle, CORE_0);
+    // Speaker output above WebSocket: it only wakes per DMA buffer and must never miss a refill
+    xTaskCreatePinnedToCore(speakerTask,     "Speaker",   TASK_STACK_SPEAKER,   NULL, 4, &speakerTaskHandle,   CORE_1);
     Serial.println("Tasks created on dual cores");
     
     // Initialize watchdog timer with 30-second timeout
@@ -689,12 +776,7 @@ static void checkAlarms() {
                             isPlayingResponse = true;
                             firstAudioChunk = true;
                             lastAudioChunkTime = millis();
-                            JsonDocument alarmDoc;
-                            alarmDoc["action"] = "requestAlarm";
-                            String alarmMsg;
-                            serializeJson(alarmDoc, alarmMsg);
-                            DEBUG_PRINTLN(" Requesting alarm sound from server");
-                            wsSendMessage(alarmMsg);
+                            startAlarmSound();
                             
                             break;
                         }
@@ -719,12 +801,7 @@ static void checkAlarms() {
                         isPlayingResponse = true;
                         firstAudioChunk = true;
                         lastAudioChunkTime = millis();
-                        JsonDocument alarmDoc;
-                        alarmDoc["action"] = "requestAlarm";
-                        String alarmMsg;
-                        serializeJson(alarmDoc, alarmMsg);
-                        DEBUG_PRINTLN(" Requesting alarm sound from server");
-                        wsSendMessage(alarmMsg);
+                        startAlarmSound();
                         
                         break;
                     }
@@ -735,6 +812,74 @@ static void checkAlarms() {
     }
 }
 
+// Fetch assets the server's manifest marked missing or stale, one at a time and
+// only while nothing is playing (flash erases briefly stall both cores).
+static void serviceAssetCache() {
+    static uint32_t requestedAt = 0;
+    static bool wasWriting = false;
+    
+    if (assetCache.writing()) {
+        wasWriting = true;
+        if ((int32_t)(millis() - assetCache.lastWriteMs()) > ASSET_DOWNLOAD_TIMEOUT_MS) {
+            assetCache.abortWrite();
+        }
+        return;
+    }
+    if (wasWriting) {
+        wasWriting = false;
+        requestedAt = 0;  // Finished (or failed) - the next one may go now
+    }
+    if (requestedAt != 0 && (int32_t)(millis() - requestedAt) < ASSET_DOWNLOAD_TIMEOUT_MS) return;
+    requestedAt = 0;
+    
+    bool idle = isWebSocketConnected && convState == ConvState::IDLE && !conversationMode &&
+                !recordingActive && !isPlayingResponse && !isPlayingAmbient &&
+                !alarmState.ringing && !assetPlayer.active();
+    if (!idle) return;
+    
+    char name[ASSET_NAME_LEN];
+    if (!assetCache.nextDownload(name)) return;
+    JsonDocument doc;
+    doc["action"] = "requestAsset";
+    doc["name"] = name;
+    String msg;
+    serializeJson(doc, msg);
+    wsSendMessage(msg);
+    requestedAt = millis();
+    Serial.printf("[ASSETS] Requested %s\n", name);
+}
+
+static void serviceAmbientClip() {
+    // Download deferred by startAmbientSound until speakerTask has stopped the previous clip
+    if (clipDownloadPending) {
+        if (!ambientSound.active) {
+            clipDownloadPending = false;
+        } else if (!ambientClip.active()) {
+            clipDownloadPending = false;
+            requestAmbient(true);
+        } else if ((int32_t)(millis() - clipDownloadPendingSince) > AMBIENT_CLIP_STOP_TIMEOUT_MS) {
+            clipDownloadPending = false;
+            Serial.println("[CLIP] Previous clip did not stop - streaming instead");
+            streamAmbientSound();
+        }
+    }
+    // Download superseded by a newer sound, or stalled: drop it (a stalled current one falls back to streaming)
+    if (ambientClip.downloading()) {
+        bool current = ambientSound.active && ambientClip.downloadSequence() == ambientSound.sequence;
+        if (!current) {
+            ambientClip.abortDownload();
+        } else if ((int32_t)(millis() - ambientClip.lastWriteMs()) > ASSET_DOWNLOAD_TIMEOUT_MS) {
+            ambientClip.abortDownload();
+            streamAmbientSound();
+        }
+    }
+    // A finite clip (meditation bell × loops) finished on the device: same as the server's ambientComplete
+    uint16_t sequence;
+    if (ambientClip.takeCompleted(&sequence) && ambientSound.active && sequence == ambientSound.sequence) {
+        handleAmbientComplete(ambientSound.name, sequence);
+    }
+}
+
 static void handleFlashAnimations() {
     // Handle non-blocking Pomodoro flash animation
     if (pomodoroState.flashing && (int32_t)(millis() - pomodoroState.flashStartTime) >= 200) {
@@ -851,6 +996,7 @@ static void handleAmbientCompletion() {
         isPlayingResponse = false;
         ambientSound.active = false;
         ambientSound.name[0] = '\0';
+        updateDmaProfile();
     }
 }
 
@@ -888,6 +1034,15 @@ void loop() {
     static uint32_t lastWiFiCheck = 0;
     static uint32_t lastBrightnessCheck = 0;
 
+    // Serial debug toggles
+    while (Serial.available()) {
+        char c = Serial.read();
+        if (c == 'd') {
+            dmaMeasure = !dmaMeasure;
+            Serial.printf("[DMA] Measurement %s\n", dmaMeasure ? "on" : "off");
+        }
+    }
+
     // Log mode changes
     {
         static LEDMode lastLoggedMode = (LEDMode)-1;
@@ -927,6 +1082,8 @@ void loop() {
     }
     
     checkAlarms();
+    serviceAssetCache();
+    serviceAmbientClip();
     
     // Ignore touch pads for first 5 seconds after boot to avoid false triggers
     static const uint32_t bootIgnoreTime = 5000;
@@ -1047,18 +1204,15 @@ const uint32_t BUTTON2_LONG_PRESS = LONG_PRESS_MS;
                 currentLEDMode = LED_SEA_GOOSEBERRY;
             } else if (modeToCheck == LED_SEA_GOOSEBERRY) {
                 // Switch to Rain ambient sound
-                // CRITICAL: Flush audio queue to prevent stale VU audio from playing
-                AudioChunk dummy;
-                while (xQueueReceive(audioOutputQueue, &dummy, 0) == pdTRUE) {
-                    // Drain all queued audio packets
-                }
+                // CRITICAL: Flush audio ring to prevent stale VU audio from playing
+                audioMixer.flushAll();
                 
                 // Clear I2S hardware buffer
                 i2sZeroSafe();
                 
                 // Set drain period to discard any stale packets still in flight
                 ambientSound.drainUntil = millis() + 500;  // 500ms drain window
-                Serial.println("Flushed audio queue for clean Jelly->Rain transition");
+                Serial.println("Flushed audio ring for clean Jelly->Rain transition");
                 
                 currentAmbientSoundType = SOUND_RAIN;  // Start with rain
                 strlcpy(ambientSound.name, "rain", sizeof(ambientSound.name));
@@ -1071,17 +1225,8 @@ const uint32_t BUTTON2_LONG_PRESS = LONG_PRESS_MS;
                 Serial.printf("MODE: Rain (seq %d)\n", ambientSound.sequence);
                 // Show marquee first
                 currentLEDMode = LED_AMBIENT;
-                // Request ambient audio from server immediately
-                {
-                    JsonDocument ambientDoc;
-                    ambientDoc["action"] = "requestAmbient";
-                    ambientDoc["sound"] = ambientSound.name;
-                    ambientDoc["sequence"] = ambientSound.sequence;
-                    String ambientMsg;
-                    serializeJson(ambientDoc, ambientMsg);
-                    Serial.printf("Ambient audio request: %s (seq %d)\n", ambientMsg.c_str(), ambientSound.sequence);
-                    wsSendMessage(ambientMsg);
-                }
+                // Start ambient audio immediately (flash copy or server stream)
+                startAmbientSound();
             } else if (modeToCheck == LED_AMBIENT) {
                 // Stop ambient sound and enter Radio discovery mode
                 DEBUG_PRINTLN(" Mode transition: AMBIENT  RADIO (cleaning up...)");
@@ -1168,10 +1313,7 @@ const uint32_t BUTTON2_LONG_PRESS = LONG_PRESS_MS;
                 ambientSound.drainUntil = millis() + 2000;
 
                 // Clear audio buffers
-                {
-                    AudioChunk dummy;
-                    while (xQueueReceive(audioOutputQueue, &dummy, 0) == pdTRUE) {}
-                }
+                audioMixer.flushAll();
                 i2sZeroSafe();
 
                 // Clear LED buffer
@@ -1250,10 +1392,7 @@ const uint32_t BUTTON2_LONG_PRESS = LONG_PRESS_MS;
                 DEBUG_PRINT(" Volume: %.0f%%  10%% for meditation\n", meditationState.savedVolume * 100);
 
                 // Flush any in-flight audio (e.g. zen bell still draining from Pomodoro)
-                {
-                    AudioChunk dummy;
-                    while (xQueueReceive(audioOutputQueue, &dummy, 0) == pdTRUE) {}
-                }
+                audioMixer.flushAll();
                 i2sZeroSafe();
 
                 // Request ROOT chakra audio immediately
@@ -1263,17 +1402,9 @@ const uint32_t BUTTON2_LONG_PRESS = LONG_PRESS_MS;
                 isPlayingResponse = false;
                 firstAudioChunk = true;
                 lastAudioChunkTime = millis();
-                {
-                    JsonDocument meditationReqDoc;
-                    meditationReqDoc["action"] = "requestAmbient";
-                    meditationReqDoc["sound"] = "bell001";
-                    meditationReqDoc["loops"] = 8;
-                    meditationReqDoc["sequence"] = ++ambientSound.sequence;
-                    String meditationReqMsg;
-                    serializeJson(meditationReqDoc, meditationReqMsg);
-                    Serial.printf("Meditation starting: %s (seq %d)\n", meditationReqMsg.c_str(), ambientSound.sequence);
-                    wsSendMessage(meditationReqMsg);
-                }
+                ambientSound.sequence++;
+                Serial.printf("Meditation starting: bell001 (seq %d)\n", ambientSound.sequence);
+                startAmbientSound(8);
                 meditationState.streaming = true;
                 Serial.println("Meditation breathing and audio started (ROOT chakra)");
                 currentLEDMode = LED_MEDITATION;
@@ -1360,6 +1491,7 @@ const uint32_t BUTTON2_LONG_PRESS = LONG_PRESS_MS;
                 // Return to IDLE
                 currentLEDMode = LED_IDLE;
             }
+            updateDmaProfile();  // Entering or leaving a streaming mode
         }
         
         // Display-only modes: Button 1 disabled (button 2 advances to next mode)
@@ -1417,17 +1549,8 @@ const uint32_t BUTTON2_LONG_PRESS = LONG_PRESS_MS;
             lastAudioChunkTime = millis();
             currentLEDMode = LED_AMBIENT;
             
-            // Request new sound from server immediately
-            {
-                JsonDocument ambientCycleDoc;
-                ambientCycleDoc["action"] = "requestAmbient";
-                ambientCycleDoc["sound"] = ambientSound.name;
-                ambientCycleDoc["sequence"] = ambientSound.sequence;
-                String ambientCycleMsg;
-                serializeJson(ambientCycleDoc, ambientCycleMsg);
-                Serial.printf("Ambient audio request: %s (seq %d)\n", ambientCycleMsg.c_str(), ambientSound.sequence);
-                wsSendMessage(ambientCycleMsg);
-            }
+            // Start new sound immediately (flash copy or server stream)
+            startAmbientSound();
             }
         }
         
@@ -1448,6 +1571,7 @@ const uint32_t BUTTON2_LONG_PRESS = LONG_PRESS_MS;
                         DEBUG_PRINTLN("Pomodoro button pressed - recording + VU active");
                     }
                     xSemaphoreGive(recordingMutex);
+                    updateDmaProfile();
                 }
             }
         }
@@ -1475,12 +1599,9 @@ const uint32_t BUTTON2_LONG_PRESS = LONG_PRESS_MS;
             // Clear I2S hardware buffer
             i2sZeroSafe();
             
-            // Flush the software audio queue (removes buffered packets)
-            AudioChunk dummy;
-            while (xQueueReceive(audioOutputQueue, &dummy, 0) == pdTRUE) {
-                // Drain all queued audio packets
-            }
-            Serial.printf("Flushed audio queue for clean transition\n");
+            // Flush the software audio ring (removes buffered packets)
+            audioMixer.flushAll();
+            Serial.printf("Flushed audio ring for clean transition\n");
             
             // Set drain period to discard any stale packets still in flight
             ambientSound.drainUntil = millis() + 500;  // 500ms drain window
@@ -1493,27 +1614,17 @@ const uint32_t BUTTON2_LONG_PRESS = LONG_PRESS_MS;
                 Serial.printf("Advanced to chakra %d (%s) - breathing continues\n", 
                              meditationState.currentChakra, CHAKRA_NAMES[meditationState.currentChakra]);
                 
-                // Request new chakra sound (bell001, bell002, ..., bell007)
-                char soundName[16];
-                sprintf(soundName, "bell%03d", meditationState.currentChakra + 1);
-                
-                JsonDocument reqDoc;
-                reqDoc["action"] = "requestAmbient";
-                reqDoc["sound"] = soundName;
-                reqDoc["loops"] = 8;
-                reqDoc["sequence"] = ++ambientSound.sequence;
-                String reqMsg;
-                serializeJson(reqDoc, reqMsg);
-                wsSendMessage(reqMsg);
-                
-                strlcpy(ambientSound.name, soundName, sizeof(ambientSound.name));
+                // Start new chakra sound (bell001, bell002, ..., bell007)
+                sprintf(ambientSound.name, "bell%03d", meditationState.currentChakra + 1);
+                ambientSound.sequence++;
                 ambientSound.active = true;
                 isPlayingAmbient = true;  // Re-enable playback for new sound
                 isPlayingResponse = false;
                 firstAudioChunk = true;
                 lastAudioChunkTime = millis();
+                startAmbientSound(8);
                 
-                Serial.printf("Chakra advance complete: %s ready to stream\n", soundName);
+                Serial.printf("Chakra advance complete: %s started\n", ambientSound.name);
             } else {
                 // At final chakra - complete meditation
                 Serial.println("At CROWN chakra - meditation complete");
@@ -1525,11 +1636,8 @@ const uint32_t BUTTON2_LONG_PRESS = LONG_PRESS_MS;
                 // Clear I2S hardware buffer
                 i2sZeroSafe();
                 
-                // Flush software audio queue
-                AudioChunk dummy;
-                while (xQueueReceive(audioOutputQueue, &dummy, 0) == pdTRUE) {
-                    // Drain all queued packets
-                }
+                // Flush software audio ring
+                audioMixer.flushAll();
                 
                 // Clear meditation state completely
                 meditationState.active = false;
@@ -1561,6 +1669,7 @@ const uint32_t BUTTON2_LONG_PRESS = LONG_PRESS_MS;
                 // Return to idle
                 currentLEDMode = LED_IDLE;
             }
+            updateDmaProfile();
         }
         // Interrupt feature: START button during active playback stops audio and starts recording
         // Only interrupt if we've received audio recently (INTERRUPT_AUDIO_TIMEOUT_MS) and turn is not complete
@@ -1568,15 +1677,15 @@ const uint32_t BUTTON2_LONG_PRESS = LONG_PRESS_MS;
         // Guard !isPlayingAmbient: radio/ambient streams set isPlayingResponse=true via the
         // prebuffer check, but they are NOT interruptible Gemini responses. Without this guard
         // the interrupt handler fires during radio (if turnComplete==false), calls
-        // i2s_zero_dma_buffer without the i2sSpeakerMutex while audioTask is inside i2s_write,
-        // corrupting the DMA descriptor chain and triggering a Guru Meditation crash.
+        // i2sZeroSafe mid-stream and cuts the radio for no reason.
         else if (!meditationHandled && currentLEDMode != LED_MEDITATION && startRisingEdge &&
             isPlayingResponse && !isPlayingAmbient && !turnComplete &&
             (int32_t)(millis() - lastAudioChunkTime) < INTERRUPT_AUDIO_TIMEOUT_MS) {
             DEBUG_PRINTLN("  Interrupted response - starting new recording");
             responseInterrupted = true;  // Flag to ignore remaining audio chunks
             isPlayingResponse = false;
-            i2sZeroSafe();  // Mutex-guarded — Gemini speech may be mid-write in audioTask
+            audioMixer.flush(MIX_VOICE);  // Drop the rest of the response; ambient keeps its ring
+            i2sZeroSafe();  // Deferred to speakerTask — Gemini speech may be mid-write
             tideState.active = false;
             moonState.active = false;
             if (xSemaphoreTake(recordingMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
@@ -1626,11 +1735,11 @@ const uint32_t BUTTON2_LONG_PRESS = LONG_PRESS_MS;
             wsSendMessage(stopMsg);
             DEBUG_PRINTLN(" Sent stop alarm request to server");
             
-            // Stop I2S output - let buffered audio drain naturally
-            i2sZeroSafe();  // Mutex-guarded — alarm PCM may be mid-write in audioTask
-            
-            // Don't clear the queue - let audio task handle cleanup naturally
-            // (clearing queue while audio task is active causes crashes)
+            // Drop buffered alarm PCM and silence I2S. Both are deferred to speakerTask,
+            // so other voices (ambient, UI tones) are left untouched.
+            assetPlayer.stop();
+            audioMixer.flush(MIX_ALARM);
+            i2sZeroSafe();
             
             // Restore previous mode
             DEBUG_PRINT("  Restoring previous mode: %d (recording=%d, playing=%d)\n", 
@@ -1667,6 +1776,7 @@ const uint32_t BUTTON2_LONG_PRESS = LONG_PRESS_MS;
             }
             
             playVolumeChime();  // Confirmation beep
+            updateDmaProfile();  // Recording may have resumed
             lastDebounceTime = millis();
             return;  // Consume button press - don't trigger other handlers
         }
@@ -1707,8 +1817,8 @@ const uint32_t BUTTON2_LONG_PRESS = LONG_PRESS_MS;
                 serializeJson(stopDoc, stopMsg);
                 wsSendMessage(stopMsg);
             }
-            // Drain local audio queue and silence I2S
-            { AudioChunk dummy; while (xQueueReceive(audioOutputQueue, &dummy, 0) == pdTRUE) {} }
+            // Drain local audio ring and silence I2S
+            audioMixer.flushAll();
             // Early check: if recording started during stopAmbient send, skip pause
             if (recordingActive) {
                 Serial.println("Radio: recording started before pause - skipping");
@@ -1816,11 +1926,67 @@ const uint32_t BUTTON2_LONG_PRESS = LONG_PRESS_MS;
         lastDebounceTime = millis();
     }
     
+#if KWS_ENABLED
+    // Hands-free start: audioTask heard the wake word. Accepted from the same
+    // idle states PAD1 starts a recording from, and in the follow-up window.
+    if (wakeWordDetected) {
+        wakeWordDetected = false;
+        bool idleMode = currentLEDMode == LED_IDLE || currentLEDMode == LED_MOON || currentLEDMode == LED_TIDE ||
+                        currentLEDMode == LED_TIMER || currentLEDMode == LED_CONVERSATION_WINDOW;
+        if (isWebSocketConnected && idleMode && !recordingActive && !isPlayingResponse && !alarmState.ringing &&
+            (convState == ConvState::IDLE || convState == ConvState::WINDOW)) {
+            Serial.printf("Wake word \"%s\" - starting recording\n", keywordSpotter.keyword());
+            conversationMode = false;
+            conversationVADDetected = false;
+            tideState.active = false;
+            moonState.active = false;
+            if (xSemaphoreTake(recordingMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
+                if (!recordingActive) {
+                    responseInterrupted = false;
+                    recordingActive = true;
+                    recordingStartTime = millis();
+                    lastVoiceActivityTime = millis();
+                    transitionConvState(ConvState::RECORDING);
+                }
+                xSemaphoreGive(recordingMutex);
+            }
+            currentLEDMode = LED_RECORDING;
+        }
+    }
+#endif
+
+    // Barge-in: audioTask heard the user talk over a Gemini response (echo canceller).
+    // Same as interrupting with PAD1, also while the last of a finished turn plays out.
+    if (bargeInDetected) {
+        bargeInDetected = false;
+        if (isWebSocketConnected && isPlayingResponse && !isPlayingAmbient && !recordingActive && !alarmState.ringing) {
+            Serial.println("Barge-in - interrupting response and starting recording");
+            responseInterrupted = true;  // Flag to ignore remaining audio chunks
+            isPlayingResponse = false;
+            audioMixer.flush(MIX_VOICE);  // Drop the rest of the response; ambient keeps its ring
+            i2sZeroSafe();  // Deferred to speakerTask — Gemini speech may be mid-write
+            conversationMode = false;
+            conversationVADDetected = false;
+            tideState.active = false;
+            moonState.active = false;
+            if (xSemaphoreTake(recordingMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
+                if (!recordingActive) {
+                    recordingActive = true;
+                    recordingStartTime = millis();
+                    lastVoiceActivityTime = millis();
+                    transitionConvState(ConvState::RECORDING);
+                }
+                xSemaphoreGive(recordingMutex);
+            }
+            currentLEDMode = LED_RECORDING;
+        }
+    }
+
     // Auto-stop on silence (VAD)
     // Mutex-protected to prevent race with button handlers.
     // Only send recordingStop if mutex was acquired — prevents double-fire if mutex times out
     // and recordingActive is not cleared, which would cause a second VAD trigger next iteration.
-    if (recordingActive && (int32_t)(millis() - lastVoiceActivityTime) > VAD_SILENCE_MS) {
+    if (recordingActive && (int32_t)(millis() - lastVoiceActivityTime) > (int32_t)endpointSilenceMs) {
         bool stopped = false;
         if (xSemaphoreTake(recordingMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
             recordingActive = false;
@@ -1950,7 +2116,7 @@ const uint32_t BUTTON2_LONG_PRESS = LONG_PRESS_MS;
         if (convState == ConvState::WAITING) {
             transitionConvState(ConvState::PLAYING);
         }
-        uint32_t queueDepth = uxQueueMessagesWaiting(audioOutputQueue);
+        uint32_t queueDepth = audioMixer.ring(MIX_VOICE).frames();
         // Mixed mode (radio + Gemini): radio keeps lastAudioChunkTime and queue populated,
         // so use Gemini-specific timer and skip queue-depth check.
         bool noNewPackets = isPlayingAmbient
@@ -2022,8 +2188,8 @@ const uint32_t BUTTON2_LONG_PRESS = LONG_PRESS_MS;
                 // speaking, phaseStartTime was set to 0 (waiting). Now that audio is done, start it.
                 if (meditationState.active && meditationState.phaseStartTime == 0 && !meditationState.streaming) {
                     meditationState.phaseStartTime = 0; // Stays 0 until first audio chunk arrives
-                    // Flush any residual Gemini audio still in queue
-                    { AudioChunk dummy; while (xQueueReceive(audioOutputQueue, &dummy, 0) == pdTRUE) {} }
+                    // Flush any residual Gemini audio still in the ring
+                    audioMixer.flushAll();
                     i2sZeroSafe();
                     strlcpy(ambientSound.name, "bell001", sizeof(ambientSound.name));
                     ambientSound.active = true;
@@ -2031,17 +2197,12 @@ const uint32_t BUTTON2_LONG_PRESS = LONG_PRESS_MS;
                     isPlayingResponse = false;
                     firstAudioChunk = true;
                     lastAudioChunkTime = millis();
-                    JsonDocument meditationReqDoc;
-                    meditationReqDoc["action"] = "requestAmbient";
-                    meditationReqDoc["sound"] = "bell001";
-                    meditationReqDoc["loops"] = 8;
-                    meditationReqDoc["sequence"] = ++ambientSound.sequence;
-                    String meditationReqMsg;
-                    serializeJson(meditationReqDoc, meditationReqMsg);
-                    Serial.printf("Meditation deferred start: %s (seq %d)\n", meditationReqMsg.c_str(), ambientSound.sequence);
-                    wsSendMessage(meditationReqMsg);
+                    ambientSound.sequence++;
+                    Serial.printf("Meditation deferred start: bell001 (seq %d)\n", ambientSound.sequence);
+                    startAmbientSound(8);
                     meditationState.streaming = true;
                     Serial.println("Meditation breathing and audio started (ROOT chakra, deferred)");
+                    updateDmaProfile();
                 }
 
                 // If Gemini's verbal response set currentLEDMode to a transient state (AUDIO_REACTIVE
@@ -2336,22 +2497,38 @@ const uint32_t BUTTON2_LONG_PRESS = LONG_PRESS_MS;
     
     delay(10);
 }// ============== I2S INITIALIZATION ==============
+// Pick the I2S buffering profile for the current mode (see DmaProfiles.h).
+// Conversation always wins; streaming modes get deep buffers only while nobody is talking.
+void updateDmaProfile() {
+    DmaProfileId p = DMA_PROFILE_TALK;
+    if (convState == ConvState::IDLE && !recordingActive && !conversationMode &&
+        (radioState.active || ambientSound.active || meditationState.active)) {
+        p = DMA_PROFILE_STREAM;
+    }
+    if (p != requestedDmaProfile) {
+        requestedDmaProfile = p;
+        Serial.printf("[DMA] Profile -> %s\n", DMA_PROFILES[p].name);
+    }
+}
+
 bool initI2SMic() {
  i2s_config_t i2s_config = {
  .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX),
  .sample_rate = AUDIO_SAMPLE_RATE,
- .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
+ .bits_per_sample = I2S_BITS_PER_SAMPLE_32BIT,  // INMP441: 24 bits MSB-aligned in a 32-bit slot, MicAgc takes it to 16
  .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT,
  .communication_format = I2S_COMM_FORMAT_STAND_I2S,
  .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
- .dma_buf_count = 8,
- .dma_buf_len = 512,
+ .dma_buf_count = DMA_PROFILES[micDmaProfile].micBufCount,
+ .dma_buf_len = DMA_PROFILES[micDmaProfile].micBufLen,
  .use_apll = false,
  .tx_desc_auto_clear = false,
  .fixed_mclk = 0
  };
 
- if (i2s_driver_install(I2S_NUM_0, &i2s_config, 0, NULL) != ESP_OK) return false;
+ // Event queue: one I2S_EVENT_RX_DONE per filled DMA buffer drives micCaptureTask,
+ // plus I2S_EVENT_RX_Q_OVF when the driver had to drop its oldest buffer.
+ if (i2s_driver_install(I2S_NUM_0, &i2s_config, DMA_PROFILES[micDmaProfile].micBufCount + 4, &i2sMicEventQueue) != ESP_OK) return false;
 
  i2s_pin_config_t pin_config = {
  .bck_io_num = I2S_MIC_SCK_PIN,
@@ -2371,14 +2548,16 @@ bool initI2SSpeaker() {
  .channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT,
  .communication_format = I2S_COMM_FORMAT_STAND_I2S,
  .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
- .dma_buf_count = 6,  // Reduced from 16: 6x512/24000 = ~128ms pipeline (was 682ms)
- .dma_buf_len = 512,  // Reduced from 1024 to sync LEDs with voice
+ .dma_buf_count = SPK_DMA_BUF_COUNT,  // Deepest DMA profile; speakerTask keeps only the active profile's depth filled
+ .dma_buf_len = SPK_DMA_BUF_LEN,  // Reduced from 1024 to sync LEDs with voice
  .use_apll = true, // Use APLL for more accurate sample rate
- .tx_desc_auto_clear = true,
+ .tx_desc_auto_clear = true, // Unwritten buffers play silence — also keeps TX_DONE ticking while idle
  .fixed_mclk = 0
  };
 
- if (i2s_driver_install(I2S_NUM_1, &i2s_config, 0, NULL) != ESP_OK) return false;
+ // Event queue: one I2S_EVENT_TX_DONE per completed DMA buffer drives speakerTask.
+ // Deep enough to hold every buffer retired while a batching profile sleeps.
+ if (i2s_driver_install(I2S_NUM_1, &i2s_config, SPK_DMA_BUF_COUNT + 4, &i2sSpeakerEventQueue) != ESP_OK) return false;
 
  i2s_pin_config_t pin_config = {
  .bck_io_num = I2S_SPEAKER_BCLK_PIN,
@@ -2390,350 +2569,682 @@ bool initI2SSpeaker() {
  return i2s_set_pin(I2S_NUM_1, &pin_config) == ESP_OK;
 }
 
-// ============== VOICE ACTIVITY DETECTION ==============
-bool detectVoiceActivity(int16_t* samples, size_t count) {
- int32_t sum = 0;
- for (size_t i = 0; i < count; i++) {
- sum += abs(samples[i]);
- }
- int32_t avgAmplitude = sum / count;
-
- // Require 3 consecutive frames above threshold before treating as real speech.
- // A single 20ms spike from ambient noise / tap will NOT reset the silence timer.
- // 3 frames * 20ms = 60ms of sustained audio required.
- static int consecutiveFrames = 0;
- if (avgAmplitude > VAD_THRESHOLD) {
- consecutiveFrames++;
- if (consecutiveFrames >= 3) {
-  lastVoiceActivityTime = millis();
-  return true;
- }
- } else {
- consecutiveFrames = 0;
- }
- return false;
+// ============== WAKE WORD ==============
+// Everything that touches the keyword spotter is fenced by KWS_ENABLED
+// (KeywordSpotter.h); built out, audioTask only logs that once at boot.
+#if KWS_ENABLED
+// Load (or drop) the keyword spotter's model from the asset cache. audioTask only.
+void loadWakeWordModel() {
+    AssetEntry e;
+    if (!assetCache.lookup(KWS_ASSET_NAME, &e)) {
+        keywordSpotter.unload();
+        Serial.println("[KWS] No wake-word model cached - hands-free start off");
+        return;
+    }
+    uint8_t* blob = (uint8_t*)heap_caps_malloc(e.size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!blob) blob = (uint8_t*)heap_caps_malloc(e.size, MALLOC_CAP_8BIT);
+    if (!blob || !assetCache.read(e.offset, blob, e.size)) {
+        Serial.printf("[KWS] Could not read the model (%u bytes)\n", e.size);
+    } else if (keywordSpotter.load(blob, e.size)) {
+        Serial.printf("[KWS] Wake word \"%s\" loaded: %u MACs per inference (%s dot8)\n",
+                      keywordSpotter.keyword(), keywordSpotter.macs(), keywordSpotter.kernel());
+    } else {
+        Serial.printf("[KWS] Model rejected: %s\n", keywordSpotter.error());
+    }
+    if (blob) heap_caps_free(blob);
 }
 
-// ============== AUDIO PROCESSING TASK ==============
-void audioTask(void * parameter) {
-    int16_t inputBuffer[MIC_FRAME_SIZE];  // For microphone recording (320 samples = 20ms @ 16kHz)
-    // Allocate stereoBuffer on heap to reduce stack pressure
-    static int16_t* stereoBuffer = nullptr;
-    if (!stereoBuffer) {
-        stereoBuffer = (int16_t*)heap_caps_malloc(1920 * sizeof(int16_t), MALLOC_CAP_8BIT);
-        if (!stereoBuffer) {
-            Serial.println("CRITICAL: Failed to allocate stereoBuffer - rebooting");
-            esp_restart();
+// Feed one mic frame to the spotter, if it has a model, and keep its CPU share in view
+void listenForWakeWord(const int16_t* pcm, size_t samples) {
+    static StageStats stats;
+    if (!keywordSpotter.ready()) return;
+    int64_t t0 = esp_timer_get_time();
+    bool hit = keywordSpotter.push(pcm, samples);
+    bool full = stats.add((uint32_t)(esp_timer_get_time() - t0));
+    if (hit && !wakeWordDetected) {
+        wakeWordDetected = true;  // loop() checks this flag
+        Serial.printf("[KWS] \"%s\" detected (score %.2f)\n", keywordSpotter.keyword(), keywordSpotter.lastScore());
+    }
+    if (full) {
+        Serial.printf("[KWS] %.1f%% of a core over 30s, %u inferences so far\n",
+                      stats.corePercent(), keywordSpotter.inferences());
+        stats.clear();
+    }
+}
+
+// Frames that are not listened to break the word: start over on the next one
+void pauseWakeWord() {
+    keywordSpotter.reset();
+}
+#else
+void loadWakeWordModel() {
+    Serial.println("[KWS] Wake word built out (KWS_ENABLED 0) - hands-free start off");
+}
+
+void listenForWakeWord(const int16_t*, size_t) {}
+void pauseWakeWord() {}
+#endif
+
+// ============== ECHO CANCELLATION ==============
+// Cancel the speaker's echo from one gained mic frame whose last sample was
+// captured at endUs, and flag a barge-in when the user talks over a Gemini response.
+// audioTask only: every mic frame goes through here, so the canceller's timeline
+// stays continuous.
+void cancelEcho(int16_t* pcm, int64_t endUs) {
+    static StageStats stats;
+    static uint32_t echoFrames = 0;
+    int64_t t0 = esp_timer_get_time();
+    echoCanceller.process(pcm, MIC_FRAME_SIZE, aecTimelinePos(endUs) - MIC_FRAME_SIZE);
+    bool full = stats.add((uint32_t)(esp_timer_get_time() - t0));
+    if (echoCanceller.speakerActive()) echoFrames++;
+    if (echoCanceller.bargeIn() && isPlayingResponse && !isPlayingAmbient && !bargeInDetected) {
+        bargeInDetected = true;  // loop() checks this flag
+        Serial.printf("[AEC] Barge-in (ERLE %.1f dB, delay %d ms)\n", echoCanceller.erleDb(), echoCanceller.delayMs());
+    }
+    if (full) {
+        if (echoFrames > 0) {
+            Serial.printf("[AEC] ERLE %.1f dB%s, delay %d ms, echo in %u%% of frames, %.1f%% of a core over 30s\n",
+                          echoCanceller.erleDb(), echoCanceller.converged() ? "" : " (converging)",
+                          echoCanceller.delayMs(), echoFrames * 100 / stats.frames, stats.corePercent());
         }
+        stats.clear();
+        echoFrames = 0;
     }
-    size_t bytes_read = 0;
-    static uint32_t lastDebug = 0;
-    AudioChunk playbackChunk;
+}
+
+// ============== NOISE SUPPRESSION ==============
+// Take steady background noise out of one echo-cancelled mic frame (the frame
+// comes out 10ms late) and keep its cycles in view. audioTask only, on CORE_1.
+// NS_CYCLE_BUDGET is advisory (see NoiseSuppressor.h): an overrun is only logged.
+void suppressNoise(int16_t* pcm) {
+    static StageStats stats;
+    uint32_t c0 = ESP.getCycleCount();
+    noiseSuppressor.process(pcm);
+    if (stats.add(ESP.getCycleCount() - c0)) {
+        Serial.printf("[NS] noise ~%d, %.1f dB removed, %u cycles/frame (max %u, budget %u)%s\n",
+                      noiseSuppressor.noiseLevel(), noiseSuppressor.reductionDb(), stats.mean(), stats.peak,
+                      (unsigned)NS_CYCLE_BUDGET, stats.mean() > NS_CYCLE_BUDGET ? " - OVER BUDGET" : "");
+        stats.clear();
+    }
+}
+
+// ============== MIC FRAME ==============
+// One raw 32-bit mic frame, whose last sample was captured at endUs, to the
+// 16-bit audio everything downstream uses: AGC (held while the speaker plays,
+// so the echo neither ducks the user nor moves under the canceller), echo
+// canceller, noise suppressor. audioTask only, once per frame from micRing.
+void processMicFrame(const int32_t* raw, int16_t* pcm, int64_t endUs) {
+    static StageStats stats;
+    int64_t t0 = esp_timer_get_time();
+    micAgc.hold(echoCanceller.speakerActive());
+    micAgc.process(raw, pcm, MIC_FRAME_SIZE);
+    bool full = stats.add((uint32_t)(esp_timer_get_time() - t0));
+    cancelEcho(pcm, endUs);
+    suppressNoise(pcm);
+    if (full) {
+        Serial.printf("[AGC] gain %.1f dB, noise floor %.1f dBFS, limiter %u frames, %.1f%% of a core over 30s\n",
+                      micAgc.gainDb(), micAgc.floorDbfs(), micAgc.limitedFrames(), stats.corePercent());
+        stats.clear();
+    }
+}
+
+// ============== MIC CAPTURE TASK ==============
+// Sole reader of I2S_NUM_0. The driver posts I2S_EVENT_RX_DONE each time the DMA
+// fills a mic buffer (every 10ms on TALK, 32ms on STREAM); this task takes that
+// buffer at once, cuts it into frames (MicCapture.h) and commits them to micRing
+// for audioTask. That is all it does, so it sits on CORE_0 above the LEDs, away
+// from the downlink, playback and mic processing on CORE_1.
+// It also applies mic DMA profile changes (while nothing depends on the mic
+// stream) and reinstalls the driver if the DMA stops delivering.
+void micCaptureTask(void * parameter) {
+    static int32_t dmaWords[MIC_DMA_BUF_LEN_MAX];
+    uint32_t silentWaits = 0;
+    uint32_t lastLog = millis();
     
-    while(1) {
-        bool processedAudio = false;
-        
-        // PRIORITY 1: Process playback queue
-        // First call uses a short blocking wait when actively playing to absorb network jitter:
-        // at ~20ms/packet, any gap >1 packet duration risks I2S underrun without this.
-        // Subsequent iterations drain the rest of the queue immediately (waitTime=0).
-        {
-            TickType_t waitTime = (isPlayingResponse && !recordingActive) ? pdMS_TO_TICKS(25) : 0;
-            while (xQueueReceive(audioOutputQueue, &playbackChunk, waitTime) == pdTRUE) {
-                waitTime = 0;  // only block on first receive; drain remainder immediately
-                processedAudio = true;
-            
-            // Raw PCM from server (24kHz, 16-bit mono, little-endian)
-            // Convert bytes to 16-bit samples
-            int numSamples = playbackChunk.length / 2;  // 2 bytes per sample
-            int16_t* pcmSamples = (int16_t*)playbackChunk.data;
-            
-            if (numSamples > 0 && numSamples <= 960) {  // Max 960 samples (stereo buffer holds 960 stereo pairs)
-                // Calculate audio level
-                int32_t sum = 0;
-                for (int i = 0; i < numSamples; i++) {
-                    sum += abs(pcmSamples[i]);
-                }
-                int instantLevel = sum / numSamples;
-                
-                // Update LED sync buffer
-                audioLevelBuffer[audioBufferIndex] = instantLevel;
-                audioBufferIndex = (audioBufferIndex + 1) % AUDIO_DELAY_BUFFER_SIZE;
-                currentAudioLevel = audioLevelBuffer[audioBufferIndex];
-                
-                // Convert mono  stereo with volume
-                for (int i = 0; i < numSamples; i++) {
-                    int32_t sample = (int32_t)(pcmSamples[i] * volumeMultiplier);
-                    if (sample > 32767) sample = 32767;
-                    if (sample < -32768) sample = -32768;
-                    stereoBuffer[i * 2] = (int16_t)sample;
-                    stereoBuffer[i * 2 + 1] = (int16_t)sample;
-                }
-                
-                // Write to I2S - guarded by mutex to prevent race with tone functions on main task
-                size_t bytes_written;
-                if (xSemaphoreTake(i2sSpeakerMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-                    esp_err_t result = i2s_write(I2S_NUM_1, stereoBuffer, numSamples * 4, &bytes_written, pdMS_TO_TICKS(500));
-                    xSemaphoreGive(i2sSpeakerMutex);
-                    if (result != ESP_OK || bytes_written < numSamples * 4) {
-                        Serial.printf("I2S write failed: result=%d, wrote=%u/%u\n", result, bytes_written, numSamples*4);
-                    }
-                } else {
-                    // Mutex held by tone function (e.g. volume chime) - skip this frame
-                    Serial.println("[audioTask] I2S mutex busy - skipping frame");
-                }
-                
-                // Update last audio chunk time to prevent timeout while queue has data
-                lastAudioChunkTime = millis();
-                
-                // Debug periodically
-                static uint32_t lastPlaybackDebug = 0;
-                if (millis() - lastPlaybackDebug > 1000) {
-                    Serial.printf("[PLAYBACK] Raw PCM: %d bytes  %d samples, level=%d, queue=%d\n", 
-                                 playbackChunk.length, numSamples, currentAudioLevel, uxQueueMessagesWaiting(audioOutputQueue));
-                    lastPlaybackDebug = millis();
-                }
-            } else {
-                Serial.printf("Invalid PCM chunk: %d bytes (%d samples)\n", playbackChunk.length, numSamples);
+    while (1) {
+        if (micDmaProfile != requestedDmaProfile && !recordingActive && !conversationMode) {
+            micDmaProfile = requestedDmaProfile;
+            i2s_driver_uninstall(I2S_NUM_0);
+            if (!initI2SMic()) {
+                Serial.println("CRITICAL: Microphone reinit failed after DMA profile change");
             }
+            micCapture.reset();  // audioTask sees the gap in the frame stamps
         }
-        }  // end playback queue scope
+        const size_t bufLen = DMA_PROFILES[micDmaProfile].micBufLen;
         
-        // If we processed audio, yield and check queue again immediately
-        if (processedAudio) {
-            taskYIELD();
+        i2s_event_t evt;
+        if (xQueueReceive(i2sMicEventQueue, &evt, pdMS_TO_TICKS(200)) != pdTRUE) {
+            if (++silentWaits >= 5) {
+                Serial.println("CRITICAL: I2S microphone delivered nothing for 1s - reinitializing");
+                i2s_driver_uninstall(I2S_NUM_0);
+                vTaskDelay(pdMS_TO_TICKS(100));
+                initI2SMic();
+                micCapture.reset();
+                silentWaits = 0;
+            }
             continue;
         }
+        silentWaits = 0;
+        if (evt.type == I2S_EVENT_RX_Q_OVF) {
+            micCapture.overflow(bufLen);
+            continue;
+        }
+        if (evt.type != I2S_EVENT_RX_DONE) continue;
         
-        // PRIORITY 2: Recording (only when not playing)
-        // Hold recordingMutex during entire recording operation to prevent race conditions
-        if (xSemaphoreTake(recordingMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-            if (recordingActive && !isPlayingResponse) {
-                static uint32_t i2sReadErrors = 0;
-                esp_err_t readResult = i2s_read(I2S_NUM_0, inputBuffer, MIC_FRAME_SIZE * sizeof(int16_t), &bytes_read, 100);
-                if (readResult == ESP_OK) {
-                    i2sReadErrors = 0;  // Reset error counter on success
-                    if (bytes_read == MIC_FRAME_SIZE * sizeof(int16_t)) {
-                    // Apply software gain
-                    const int16_t GAIN = 16;
-                    for (size_t i = 0; i < MIC_FRAME_SIZE; i++) {
-                        int32_t amplified = (int32_t)inputBuffer[i] * GAIN;
-                        if (amplified > 32767) amplified = 32767;
-                        if (amplified < -32768) amplified = -32768;
-                        inputBuffer[i] = (int16_t)amplified;
-                    }
-                    
-                    // Calculate amplitude for VAD
-                    int32_t sum = 0;
-                    for (size_t i = 0; i < MIC_FRAME_SIZE; i++) {
-                        sum += abs(inputBuffer[i]);
-                    }
-                    int32_t avgAmplitude = sum / MIC_FRAME_SIZE;
-                    currentAudioLevel = avgAmplitude;
-                    
-                    // VAD check
-                    bool hasVoice = detectVoiceActivity(inputBuffer, MIC_FRAME_SIZE);
-                    
-                    // Debug every 2 seconds
-                    if (millis() - lastDebug > 2000) {
-                        Serial.printf("[AUDIO] Recording: bytes_read=%d, hasVoice=%d, avgAmp=%d, threshold=%d\n", 
-                                      bytes_read, hasVoice, avgAmplitude, VAD_THRESHOLD);
-                        lastDebug = millis();
-                    }
-                    
-                    // On first chunk of each recording, send device state context to server
-                    if (!recordingStartSent) {
-                        recordingStartSent = true;
-                        turnComplete = false;  // New user turn starting - clear previous turn's flag
-                        JsonDocument stateDoc;
-                        stateDoc["type"] = "recordingStart";
-
-                        // Pomodoro state
-                        JsonObject pomDoc = stateDoc["pomodoro"].to<JsonObject>();
-                        pomDoc["active"] = pomodoroState.active;
-                        if (pomodoroState.active) {
-                            const char* sessionName = (pomodoroState.currentSession == PomodoroState::FOCUS) ? "Focus" :
-                                                      (pomodoroState.currentSession == PomodoroState::SHORT_BREAK) ? "Short Break" : "Long Break";
-                            pomDoc["session"] = sessionName;
-                            pomDoc["paused"] = pomodoroState.paused;
-                            uint32_t secsLeft;
-                            if (pomodoroState.paused) {
-                                secsLeft = pomodoroState.pausedTime;
-                            } else if (pomodoroState.startTime > 0) {
-                                uint32_t elapsed = (millis() - pomodoroState.startTime) / 1000;
-                                secsLeft = pomodoroState.totalSeconds > elapsed ? pomodoroState.totalSeconds - elapsed : 0;
-                            } else {
-                                secsLeft = pomodoroState.totalSeconds;
-                            }
-                            pomDoc["secondsRemaining"] = secsLeft;
-                        }
-
-                        // Meditation state
-                        JsonObject medDoc = stateDoc["meditation"].to<JsonObject>();
-                        medDoc["active"] = meditationState.active;
-                        if (meditationState.active) {
-                            medDoc["chakra"] = CHAKRA_NAMES[meditationState.currentChakra];
-                        }
-
-                        // Ambient sound state
-                        JsonObject ambDoc = stateDoc["ambient"].to<JsonObject>();
-                        ambDoc["active"] = ambientSound.active;
-                        if (ambientSound.active) {
-                            ambDoc["sound"] = ambientSound.name;
-                        }
+        // Events still queued are buffers filled after this one
+        int64_t endUs = esp_timer_get_time() -
+                        (int64_t)uxQueueMessagesWaiting(i2sMicEventQueue) * bufLen * 1000000 / AUDIO_SAMPLE_RATE;
+        size_t bytes = 0;
+        if (i2s_read(I2S_NUM_0, dmaWords, bufLen * sizeof(int32_t), &bytes, 0) != ESP_OK) continue;
+        size_t n = bytes / sizeof(int32_t);
+        for (size_t off = 0; off < n;) {
+            off += micCapture.push(dmaWords + off, n - off, endUs);
+            if (micCapture.ready()) {
+                micCapture.next(micRing.write((const uint8_t*)&micCapture.frame(), sizeof(MicFrame), 0));
+            }
+        }
+        
+        if (millis() - lastLog >= 30000) {
+            Serial.printf("[MIC] %u frames, %u dropped, stamp jitter %d us mean / %d us max, ring peak %u frames\n",
+                          micCapture.framesCaptured(), micCapture.framesDropped(),
+                          micCapture.jitterMeanUs(), micCapture.jitterMaxUs(), micRing.maxFramesSeen());
+            micCapture.clearStats();
+            lastLog = millis();
+        }
+    }
+}
 
-                        // Timer state
-                        JsonObject timDoc = stateDoc["timer"].to<JsonObject>();
-                        timDoc["active"] = timerState.active;
-                        if (timerState.active && timerState.startTime > 0) {
-                            uint32_t elapsed = (millis() - timerState.startTime) / 1000;
-                            int remaining = timerState.totalSeconds > (int)elapsed ? timerState.totalSeconds - (int)elapsed : 0;
-                            timDoc["secondsRemaining"] = remaining;
+// ============== AUDIO PROCESSING TASK ==============
+// Handles every frame micCaptureTask commits to micRing, in order: AGC, echo
+// canceller and noise suppressor first (processMicFrame), then the uplink and
+// endpointer while recording, and the conversation VAD, VU meter, pre-roll and
+// wake word otherwise. It never touches I2S, so a slow frame here, or CORE_1
+// busy with the downlink and playback, only lets micRing fill.
+void audioTask(void * parameter) {
+    static MicFrame frame;                // copied out of micRing (static: 1.3KB off the task stack)
+    int16_t inputBuffer[MIC_FRAME_SIZE];  // the frame after processMicFrame (320 samples = 20ms @ 16kHz)
+    int64_t lastEndUs = 0;
+    static uint32_t lastDebug = 0;
+    // VU meter level (persists across frames); MicAgc already levels the input
+    static float vuSmoothedDb = -90.0f;
+    
+    micRing.setConsumer(xTaskGetCurrentTaskHandle());
+    
+    while(1) {
+        if (kwsReloadRequested) {
+            kwsReloadRequested = false;
+            loadWakeWordModel();
+        }
+        
+        size_t len = 0;
+        const uint8_t* p = micRing.peek(&len, pdMS_TO_TICKS(100));
+        if (!p) continue;
+        bool whole = len == sizeof(MicFrame);
+        if (whole) memcpy(&frame, p, sizeof(frame));
+        micRing.release();
+        if (!whole) continue;
+        
+        // A gap in the capture (DMA overflow or reinstall): don't splice across it in the pre-roll
+        if (lastEndUs && frame.endUs - lastEndUs > 2 * MIC_CAPTURE_FRAME_US) preRoll.clear();
+        lastEndUs = frame.endUs;
+        uint32_t captureMs = (uint32_t)(frame.endUs / 1000);  // millis() clock
+        
+        // Ambient sound or the tail of a response may still be playing
+        processMicFrame(frame.raw, inputBuffer, frame.endUs);
+        
+        // PRIORITY 1: Recording (only when not playing)
+        // Hold recordingMutex while the frame is handled so loop() can't stop the
+        // recording halfway through it (micRing holds the frames behind it meanwhile)
+        if (xSemaphoreTake(recordingMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+            if (recordingActive && !isPlayingResponse) {
+                // Calculate amplitude for VAD
+                int32_t sum = 0;
+                for (size_t i = 0; i < MIC_FRAME_SIZE; i++) {
+                    sum += abs(inputBuffer[i]);
+                }
+                int32_t avgAmplitude = sum / MIC_FRAME_SIZE;
+                currentAudioLevel = avgAmplitude;
+                
+                // On first chunk of each recording, send device state context to server
+                if (!recordingStartSent) {
+                    recordingStartSent = true;
+                    turnComplete = false;  // New user turn starting - clear previous turn's flag
+                    resetMicUplinkTurn();
+                    endpointer.beginTurn();
+                    endpointSilenceMs = endpointer.silenceMs();
+                    JsonDocument stateDoc;
+                    stateDoc["type"] = "recordingStart";
+
+                    // Pomodoro state
+                    JsonObject pomDoc = stateDoc["pomodoro"].to<JsonObject>();
+                    pomDoc["active"] = pomodoroState.active;
+                    if (pomodoroState.active) {
+                        const char* sessionName = (pomodoroState.currentSession == PomodoroState::FOCUS) ? "Focus" :
+                                                  (pomodoroState.currentSession == PomodoroState::SHORT_BREAK) ? "Short Break" : "Long Break";
+                        pomDoc["session"] = sessionName;
+                        pomDoc["paused"] = pomodoroState.paused;
+                        uint32_t secsLeft;
+                        if (pomodoroState.paused) {
+                            secsLeft = pomodoroState.pausedTime;
+                        } else if (pomodoroState.startTime > 0) {
+                            uint32_t elapsed = (millis() - pomodoroState.startTime) / 1000;
+                            secsLeft = pomodoroState.totalSeconds > elapsed ? pomodoroState.totalSeconds - elapsed : 0;
+                        } else {
+                            secsLeft = pomodoroState.totalSeconds;
                         }
+                        pomDoc["secondsRemaining"] = secsLeft;
+                    }
 
-                        // Lamp state
-                        JsonObject lamDoc = stateDoc["lamp"].to<JsonObject>();
-                        lamDoc["active"] = lampState.active;
-                        if (lampState.active) {
-                            const char* colorName = "white";
-                            if (lampState.currentColor == LampState::RED) colorName = "red";
-                            else if (lampState.currentColor == LampState::GREEN) colorName = "green";
-                            else if (lampState.currentColor == LampState::BLUE) colorName = "blue";
-                            lamDoc["color"] = colorName;
-                        }
+                    // Meditation state
+                    JsonObject medDoc = stateDoc["meditation"].to<JsonObject>();
+                    medDoc["active"] = meditationState.active;
+                    if (meditationState.active) {
+                        medDoc["chakra"] = CHAKRA_NAMES[meditationState.currentChakra];
+                    }
 
-                        // Radio state
-                        JsonObject radDoc = stateDoc["radio"].to<JsonObject>();
-                        radDoc["active"] = radioState.active;
-                        radDoc["streaming"] = radioState.streaming;
-                        // Include station name whenever active (not just when streaming — Gemini
-                        // needs it when the stream is paused for a voice command too)
-                        if (radioState.active && radioState.stationName[0] != '\0') {
-                            radDoc["station"] = radioState.stationName;
-                        }
+                    // Ambient sound state
+                    JsonObject ambDoc = stateDoc["ambient"].to<JsonObject>();
+                    ambDoc["active"] = ambientSound.active;
+                    if (ambientSound.active) {
+                        ambDoc["sound"] = ambientSound.name;
+                    }
 
-                        // Alarm count (quick summary — full list available via deviceStateRequest)
-                        int activeAlarmCount = 0;
-                        for (int i = 0; i < MAX_ALARMS; i++) {
-                            if (alarms[i].enabled) activeAlarmCount++;
-                        }
-                        stateDoc["alarmCount"] = activeAlarmCount;
+                    // Timer state
+                    JsonObject timDoc = stateDoc["timer"].to<JsonObject>();
+                    timDoc["active"] = timerState.active;
+                    if (timerState.active && timerState.startTime > 0) {
+                        uint32_t elapsed = (millis() - timerState.startTime) / 1000;
+                        int remaining = timerState.totalSeconds > (int)elapsed ? timerState.totalSeconds - (int)elapsed : 0;
+                        timDoc["secondsRemaining"] = remaining;
+                    }
 
-                        String stateMsg;
-                        serializeJson(stateDoc, stateMsg);
-                        wsSendMessage(stateMsg);
-                        Serial.printf("[STATE] recordingStart: %s\n", stateMsg.c_str());
+                    // Lamp state
+                    JsonObject lamDoc = stateDoc["lamp"].to<JsonObject>();
+                    lamDoc["active"] = lampState.active;
+                    if (lampState.active) {
+                        const char* colorName = "white";
+                        if (lampState.currentColor == LampState::RED) colorName = "red";
+                        else if (lampState.currentColor == LampState::GREEN) colorName = "green";
+                        else if (lampState.currentColor == LampState::BLUE) colorName = "blue";
+                        lamDoc["color"] = colorName;
                     }
 
-                    // Re-check recordingActive: loop() may have set it to false and sent
-                    // recordingStop during the 100ms i2s_read block. If so, skip this frame
-                    // to avoid sending audio after activityEnd has already been forwarded.
-                    // NOTE: must be `continue` not `break` — `break` exits the outer while(1)
-                    // which causes audioTask to return, hitting the ILL trap at line 2490.
-                    // With recordingMutex held, this re-check is now redundant (kept for documentation).
-                    if (!recordingActive) {
-                        xSemaphoreGive(recordingMutex);
-                        continue;
+                    // Radio state
+                    JsonObject radDoc = stateDoc["radio"].to<JsonObject>();
+                    radDoc["active"] = radioState.active;
+                    radDoc["streaming"] = radioState.streaming;
+                    // Include station name whenever active (not just when streaming — Gemini
+                    // needs it when the stream is paused for a voice command too)
+                    if (radioState.active && radioState.stationName[0] != '\0') {
+                        radDoc["station"] = radioState.stationName;
                     }
 
-                    // Send raw PCM
-                    sendAudioChunk((uint8_t*)inputBuffer, bytes_read);
-                    
-                    if (hasVoice) {
-                        lastVoiceActivityTime = millis();
+                    // Alarm count (quick summary — full list available via deviceStateRequest)
+                    int activeAlarmCount = 0;
+                    for (int i = 0; i < MAX_ALARMS; i++) {
+                        if (alarms[i].enabled) activeAlarmCount++;
                     }
-                }  // Close bytes_read == MIC_FRAME_SIZE check
-            } else {
-                // I2S read error - increment counter and attempt recovery
-                i2sReadErrors++;
-                Serial.printf("I2S microphone read error: %d (count: %u)\\n", readResult, i2sReadErrors);
-                if (i2sReadErrors > 50) {
-                    Serial.println("CRITICAL: I2S microphone persistent failure - reinitializing");
-                    i2s_driver_uninstall(I2S_NUM_0);
-                    delay(100);
-                    initI2SMic();
-                    i2sReadErrors = 0;
-                }
-            }
-        }  // Close if (recordingActive && !isPlayingResponse)
-        xSemaphoreGive(recordingMutex);
-    }  // Close xSemaphoreTake block
-    
-    // PRIORITY 3: Ambient VU meter and conversation VAD (separate from recording mutex)
-    if (conversationMode || isAmbientVUMode) {
-        // audioTask is the sole reader of I2S_NUM_0. When the main loop opens a
-        // conversation window, or the LED task needs ambient VU levels, this branch
-            // reads the mic and posts results via the two volatile shared values above.
-            // Neither loop() nor ledTask call i2s_read(I2S_NUM_0) directly.
-            static int16_t micBuf[MIC_FRAME_SIZE];  // 320 samples = 20ms at 16kHz
-            
-            // Auto-gain state for VU meter (persists across calls)
-            static float vuAutoGain   = 25.0f;
-            static float vuPeakRMS    = 100.0f;
-            static float vuSmoothedRMS = 0.0f;
-            static uint32_t lastGainAdjust = 0;
-            
-            size_t mic_bytes = 0;
-            if (i2s_read(I2S_NUM_0, micBuf, sizeof(micBuf), &mic_bytes, 0) == ESP_OK && mic_bytes > 0) {
-                size_t samples = mic_bytes / sizeof(int16_t);
-                
-                // Apply gain and accumulate stats in one pass
-                const int16_t GAIN = 16;
-                int64_t sumSq  = 0;
-                int32_t sumAbs = 0;
-                for (size_t i = 0; i < samples; i++) {
-                    int32_t amp = (int32_t)micBuf[i] * GAIN;
-                    if (amp >  32767) amp =  32767;
-                    if (amp < -32768) amp = -32768;
-                    micBuf[i] = (int16_t)amp;
-                    sumSq  += (int64_t)amp * amp;
-                    sumAbs += abs(amp);
-                }
-                
-                // --- Conversation window VAD ---
-                if (conversationMode && samples > 0) {
-                    int32_t avgAmp = sumAbs / samples;
-                    if (avgAmp > VAD_CONVERSATION_THRESHOLD) {
-                        currentAudioLevel = avgAmp;
-                        // Atomic test-and-set: prevents double-set if loop() hasn't cleared yet
-                        if (!conversationVADDetected) {
-                            conversationVADDetected = true;  // loop() checks this flag
+                    stateDoc["alarmCount"] = activeAlarmCount;
+
+                    String stateMsg;
+                    serializeJson(stateDoc, stateMsg);
+                    wsSendMessage(stateMsg);
+                    Serial.printf("[STATE] recordingStart: %s\n", stateMsg.c_str());
+
+                    // Audio from before the trigger goes first, so the first word is complete
+                    static int16_t preRollFrame[MIC_FRAME_SIZE];
+                    uint32_t preRollMs;
+                    size_t preRollFrames = preRoll.beginDrain(captureMs);
+                    while (preRoll.popFrame(preRollFrame, &preRollMs)) {
+                        if (endpointer.process(preRollFrame, MIC_FRAME_SIZE)) {
+                            lastVoiceActivityTime = millis();
                         }
+                        sendAudioChunk((uint8_t*)preRollFrame, sizeof(preRollFrame), preRollMs);
                     }
+                    Serial.printf("[AUDIO] Pre-roll: %u ms sent\n", (unsigned)(preRollFrames * PREROLL_FRAME_MS));
                 }
                 
-                // --- Ambient VU meter ---
-                if (isAmbientVUMode && samples > 0) {
-                    float rms = sqrtf((float)sumSq / samples);
-                    
-                    // Peak tracking + auto-gain
-                    vuPeakRMS = vuPeakRMS * 0.995f + rms * 0.005f;
-                    if (rms > vuPeakRMS) vuPeakRMS = rms;
-                    
-                    uint32_t nowMs = millis();
-                    if (nowMs - lastGainAdjust > 50) {
-                        if (vuPeakRMS < 150  && vuAutoGain < 50.0f) vuAutoGain *= 1.15f;
-                        else if (vuPeakRMS > 2500 && vuAutoGain >  3.0f) vuAutoGain *= 0.85f;
-                        lastGainAdjust = nowMs;
+                // VAD check
+                bool hasVoice = endpointer.process(inputBuffer, MIC_FRAME_SIZE);
+                endpointSilenceMs = endpointer.silenceMs();
+                
+                // Debug every 2 seconds
+                if (millis() - lastDebug > 2000) {
+                    Serial.printf("[AUDIO] Recording: hasVoice=%d, avgAmp=%d, endpoint=%ums (%u pauses learned), mic ring %u frames\n", 
+                                  hasVoice, avgAmplitude, endpointSilenceMs, endpointer.pausesLearned(), micRing.frames());
+                    lastDebug = millis();
+                }
+                
+                // Send raw PCM
+                sendAudioChunk((uint8_t*)inputBuffer, sizeof(inputBuffer), captureMs);
+                
+                if (hasVoice) {
+                    lastVoiceActivityTime = millis();
+                }
+            }
+            xSemaphoreGive(recordingMutex);
+        }
+        
+        // PRIORITY 2: Ambient VU meter, conversation VAD and pre-roll (separate from recording mutex)
+        // The main loop and ledTask read the results through the volatile shared
+        // values above; whenever no recording is running this also fills the
+        // pre-roll (PreRoll.h) and listens for the wake word (KeywordSpotter.h).
+        if (conversationMode || isAmbientVUMode || !recordingActive) {
+            // Stats on what is left once the speaker and the steady noise are taken out
+            int64_t sumSq  = 0;
+            int32_t sumAbs = 0;
+            for (size_t i = 0; i < MIC_FRAME_SIZE; i++) {
+                sumSq  += (int32_t)inputBuffer[i] * inputBuffer[i];
+                sumAbs += abs(inputBuffer[i]);
+            }
+            
+            // --- Pre-roll and wake word (not while the speaker could echo into them) ---
+            // Over a Gemini response the pre-roll keeps filling once the canceller
+            // has converged, so a barge-in starts its turn with its first words.
+            bool geminiSpeaking = isPlayingResponse && !isPlayingAmbient;
+            if (!recordingActive && !isPlayingResponse) {
+                preRoll.push(inputBuffer, MIC_FRAME_SIZE, captureMs);
+                listenForWakeWord(inputBuffer, MIC_FRAME_SIZE);
+            } else if (!recordingActive && geminiSpeaking && echoCanceller.converged()) {
+                preRoll.push(inputBuffer, MIC_FRAME_SIZE, captureMs);
+                pauseWakeWord();
+            } else {
+                preRoll.clear();
+                pauseWakeWord();
+            }
+            
+            // --- Conversation window VAD ---
+            if (conversationMode) {
+                int32_t avgAmp = sumAbs / MIC_FRAME_SIZE;
+                if (avgAmp > VAD_CONVERSATION_THRESHOLD) {
+                    currentAudioLevel = avgAmp;
+                    // Atomic test-and-set: prevents double-set if loop() hasn't cleared yet
+                    if (!conversationVADDetected) {
+                        conversationVADDetected = true;  // loop() checks this flag
                     }
-                    
-                    float gained = rms * vuAutoGain;
-                    if (gained > 1500) gained = 1500 + (gained - 1500) * 0.3f;
-                    vuSmoothedRMS = vuSmoothedRMS * 0.80f + gained * 0.20f;
-                    ambientMicRows = map(constrain((int)vuSmoothedRMS, 150, 1600), 150, 1600, 0, LEDS_PER_COLUMN);
                 }
             }
-            vTaskDelay(pdMS_TO_TICKS(5));  // 5 ms = ~200 Hz mic poll rate (plenty for VAD)
-        } else {
-            // Nothing to do - sleep briefly
-            vTaskDelay(pdMS_TO_TICKS(1));
+            
+            // --- Ambient VU meter ---
+            if (isAmbientVUMode) {
+                // Speech sits near AGC_TARGET_DBFS; the scale tops out 8 dB above it
+                float dbfs = 10.0f * log10f((float)sumSq / MIC_FRAME_SIZE / (32768.0f * 32768.0f) + 1e-9f);
+                vuSmoothedDb = vuSmoothedDb * 0.80f + dbfs * 0.20f;
+                ambientMicRows = map(constrain((int)vuSmoothedDb, -55, AGC_TARGET_DBFS + 8), -55, AGC_TARGET_DBFS + 8, 0, LEDS_PER_COLUMN);
+            }
+        }
+    }
+}
+
+// ============== SPEAKER OUTPUT TASK ==============
+// Sole writer of I2S_NUM_1. The driver posts I2S_EVENT_TX_DONE each time the DMA
+// finishes a buffer (every ~21ms, also while idle since auto-clear keeps TX running),
+// so this task knows exactly how much audio is still queued in the DMA ring:
+//   - TX_DONE: the buffer just played is retired from queued
+//   - refill: mix one block per free DMA buffer — i2s_write never has to wait.
+//     Every write is a whole buffer (short blocks are padded with silence), so
+//     queued is always a whole number of buffers and each TX_DONE retires one.
+// How many buffers are kept filled, and how many are refilled per wakeup, comes from
+// the active DMA profile (see DmaProfiles.h).
+// Other tasks request a DMA zero via i2sZeroSafe(); it is carried out here, between
+// blocks, so it can never race i2s_write.
+void speakerTask(void * parameter) {
+    static int16_t* stereoBuffer = nullptr;
+    if (!stereoBuffer) {
+        stereoBuffer = (int16_t*)heap_caps_malloc(MIX_BLOCK_FRAMES * 2 * sizeof(int16_t), MALLOC_CAP_8BIT);
+        if (!stereoBuffer) {
+            Serial.println("CRITICAL: Failed to allocate stereoBuffer - rebooting");
+            esp_restart();
+        }
+    }
+    // Producer commits on any mixer voice wake this task (see AudioRing::commit)
+    audioMixer.setConsumer(xTaskGetCurrentTaskHandle());
+    const TickType_t bufTicks = pdMS_TO_TICKS(SPK_DMA_BUF_LEN * 1000 / SPEAKER_SAMPLE_RATE);
+    DmaProfileId profileId = DMA_PROFILE_COUNT;  // forces the first apply
+    uint32_t queued = 0;
+    bool flowing = false;  // last refill produced audio (a stream is in progress)
+    uint32_t wakeups = 0, latencySum = 0, latencySamples = 0, lastMeasure = millis();  // dmaMeasure
+    
+    while (1) {
+        if (profileId != requestedDmaProfile) {
+            profileId = requestedDmaProfile;
+            jitterBuffer.setDmaMs(DMA_PROFILES[profileId].spkQueueBufs * SPK_DMA_BUF_LEN * 1000 / SPEAKER_SAMPLE_RATE);
+        }
+        const DmaProfile& profile = DMA_PROFILES[profileId];
+        const uint32_t targetBytes = profile.spkQueueBufs * SPK_DMA_BUF_BYTES;
+        
+        // Batching profiles sleep through the buffers they don't need to refill yet,
+        // then retire all of them at once below
+        uint32_t keepBytes = targetBytes - profile.spkRefillBufs * SPK_DMA_BUF_BYTES;
+        if (profile.spkRefillBufs > 1 && queued > keepBytes + SPK_DMA_BUF_BYTES) {
+            vTaskDelay(bufTicks * ((queued - keepBytes) / SPK_DMA_BUF_BYTES - 1));
+        }
+        
+        // Wait for the DMA to retire a buffer. While idle the ring is empty and the DMA
+        // plays zeros; a producer commit ends the wait early so playback starts at once.
+        i2s_event_t evt;
+        bool late = false;
+        bool retired = false;
+        while (xQueueReceive(i2sSpeakerEventQueue, &evt, (queued && !retired) ? portMAX_DELAY : 0) == pdTRUE) {
+            retired = true;
+            if (evt.type != I2S_EVENT_TX_DONE) continue;
+            uint32_t played = queued < SPK_DMA_BUF_BYTES ? queued : SPK_DMA_BUF_BYTES;
+            late |= queued < SPK_DMA_BUF_BYTES;  // DMA reached a buffer we never filled
+            queued -= played;
+            if (played) {
+                speakerStats.buffersPlayed++;
+                speakerStats.framesPlayed += played / 4;
+            }
+        }
+        if (!retired) {
+            audioMixer.waitForData(pdMS_TO_TICKS(25));
+        }
+        wakeups++;
+        
+        if (audioMixer.takeSilenceRequest()) {
+            i2s_zero_dma_buffer(I2S_NUM_1);
+            echoReference.cut(aecTimelinePos(esp_timer_get_time()));
+            queued = 0;
+            flowing = false;
+        }
+        // Live radio runs on the station's clock — let the ambient resampler track it
+        audioMixer.setDriftControl(radioState.active && radioState.streaming);
+        // Cached alarm / zen bell: while a clip plays this task also produces MIX_ALARM
+        assetPlayer.pump(audioMixer.ring(MIX_ALARM));
+        // Cached soundscape / PSRAM clip: runs until the ambient sequence moves on (stop, mode change, new sound)
+        bool ambientStale = !ambientSound.active || ambientSound.sequence != localAmbientSequence;
+        if (ambientPlayer.active() && ambientStale) ambientPlayer.stop();
+        if (ambientClip.active() && ambientStale) ambientClip.stop();
+        // Both stops (and their ring flushes) land before either player refills the ring
+        ambientPlayer.poll(audioMixer.ring(MIX_AMBIENT));
+        ambientClip.poll(audioMixer.ring(MIX_AMBIENT));
+        ambientPlayer.pump(audioMixer.ring(MIX_AMBIENT));
+        ambientClip.pump(audioMixer.ring(MIX_AMBIENT));
+        
+        // Refill free DMA buffers. Each block is one buffer (MIX_BLOCK_FRAMES), so
+        // i2s_write has room and returns immediately. Gemini voice is gated by the jitter
+        // buffer inside the mixer: a new stream is held until its ring holds
+        // jitterBuffer.targetMs() of audio.
+        bool rendered = false;
+        if (queued == 0) {
+            // Nothing of ours in the DMA: pending TX_DONEs are for silence and must not
+            // be charged against the first blocks we are about to write
+            xQueueReset(i2sSpeakerEventQueue);
+        }
+        bool refill = queued == 0 || queued <= keepBytes;
+        while (refill && queued + SPK_DMA_BUF_BYTES <= targetBytes) {
+            static uint32_t mixCycles = 0;
+            static uint32_t mixSamples = 0;
+            uint32_t levelSum = 0;
+            uint32_t c0 = ESP.getCycleCount();
+            int frames = audioMixer.render(stereoBuffer, MIX_BLOCK_FRAMES, volumeToQ14(volumeMultiplier), &levelSum);
+            if (frames == 0) break;
+            mixCycles += ESP.getCycleCount() - c0;
+            mixSamples += frames;
+            rendered = true;
+            
+            int instantLevel = levelSum / frames;
+            
+            // Update LED sync buffer
+            audioLevelBuffer[audioBufferIndex] = instantLevel;
+            audioBufferIndex = (audioBufferIndex + 1) % AUDIO_DELAY_BUFFER_SIZE;
+            currentAudioLevel = audioLevelBuffer[audioBufferIndex];
+            
+            // Pad a short block (the stream ended mid-block) to a whole DMA buffer. The legacy
+            // driver keeps filling its current buffer from rw_pos, so a short write would leave
+            // the next block straddling two buffers and queued would no longer count whole
+            // buffers for TX_DONE to retire. The padding is what the DMA would play anyway.
+            if (frames < MIX_BLOCK_FRAMES) {
+                memset(stereoBuffer + frames * 2, 0, (MIX_BLOCK_FRAMES - frames) * 2 * sizeof(int16_t));
+            }
+            
+            // The echo canceller's reference: this block is heard once the DMA has played what is queued
+            echoReference.write(stereoBuffer, MIX_BLOCK_FRAMES, aecTimelinePos(esp_timer_get_time() + (int64_t)queued * 1000 / 96));
+            
+            size_t bytes_written = 0;
+            esp_err_t result = i2s_write(I2S_NUM_1, stereoBuffer, SPK_DMA_BUF_BYTES, &bytes_written, pdMS_TO_TICKS(50));
+            if (result != ESP_OK || bytes_written < SPK_DMA_BUF_BYTES) {
+                Serial.printf("I2S write failed: result=%d, wrote=%u/%u\n", result, bytes_written, SPK_DMA_BUF_BYTES);
+            }
+            queued += bytes_written;
+            // Output latency: how long the block just written waits before it is heard
+            latencySum += queued / 96;
+            latencySamples++;
+            
+            // Update last audio chunk time to prevent timeout while rings have data
+            lastAudioChunkTime = millis();
+            
+            // Debug periodically
+            static uint32_t lastPlaybackDebug = 0;
+            if (millis() - lastPlaybackDebug > 1000) {
+                Serial.printf("[PLAYBACK] Mixed %d frames, level=%d, voice=%u ambient=%u alarm=%u frames queued%s%s, mix=%.1f cyc/sample\n", 
+                             frames, currentAudioLevel,
+                             audioMixer.ring(MIX_VOICE).frames(), audioMixer.ring(MIX_AMBIENT).frames(),
+                             audioMixer.ring(MIX_ALARM).frames(),
+                             audioMixer.isToneActive() ? " +tone" : "",
+                             audioMixer.isDucking() ? " (ducking)" : "",
+                             mixSamples ? (float)mixCycles / mixSamples : 0.0f);
+                Serial.printf("[SPEAKER] profile=%s dma=%ums played=%u buffers (%us) underruns=%u\n",
+                             profile.name, queued / 96, speakerStats.buffersPlayed,
+                             speakerStats.framesPlayed / SPEAKER_SAMPLE_RATE, speakerStats.underruns);
+                mixCycles = 0;
+                mixSamples = 0;
+                lastPlaybackDebug = millis();
+            }
+        }
+        
+        // Underrun: the DMA caught up with us in the middle of a stream. Gaps in the
+        // incoming audio itself are the jitter buffer's underruns, not counted here.
+        if (late && flowing && rendered) {
+            speakerStats.underruns++;
+        }
+        flowing = rendered || queued > 0;
+        speakerStats.queuedBytes = queued;
+        
+        if (millis() - lastMeasure >= 1000) {
+            if (dmaMeasure) Serial.printf("[DMA] profile=%s wakeups=%u/s latency=%ums underruns=%u\n",
+                         profile.name, wakeups,
+                         latencySamples ? latencySum / latencySamples : 0, speakerStats.underruns);
+            wakeups = 0;
+            latencySum = 0;
+            latencySamples = 0;
+            lastMeasure = millis();
         }
     }
 }
 
 // ============== AUDIO FEEDBACK ==============
+// Start the alarm sound for checkAlarms() / timerExpired. Callers set isPlayingAlarm
+// and the playback flags first. The cached copy loops from flash until the
+// dismiss handler stops it; otherwise the server loops it until "stopAlarm".
+void startAlarmSound() {
+    AssetEntry alarm;
+    if (assetCache.lookup("alarm", &alarm) && assetPlayer.start(alarm, true)) {
+        Serial.printf("Playing cached alarm sound (v%u, %u bytes)\n", alarm.version, alarm.size);
+        return;
+    }
+    if (ESP.getFreeHeap() < MIN_HEAP_FOR_JSON) { Serial.printf("[JSON] Low heap for alarm: %u\n", ESP.getFreeHeap()); return; }
+    JsonDocument alarmDoc;
+    alarmDoc["action"] = "requestAlarm";
+    String alarmMsg;
+    serializeJson(alarmDoc, alarmMsg);
+    Serial.println("Requesting alarm sound from server");
+    wsSendMessage(alarmMsg);
+}
+
+// Ask the server for ambientSound.name: once into the PSRAM clip store (download),
+// or as the classic endless A5 5A/5B stream.
+static void requestAmbient(bool download) {
+    if (ESP.getFreeHeap() < MIN_HEAP_FOR_JSON) { Serial.printf("[JSON] Low heap for requestAmbient: %u\n", ESP.getFreeHeap()); return; }
+    JsonDocument ambientDoc;
+    ambientDoc["action"] = "requestAmbient";
+    ambientDoc["sound"] = ambientSound.name;
+    ambientDoc["sequence"] = ambientSound.sequence;
+    if (ambientSound.loops) ambientDoc["loops"] = ambientSound.loops;
+    if (download) ambientDoc["download"] = true;
+    String ambientMsg;
+    serializeJson(ambientDoc, ambientMsg);
+    Serial.printf("Ambient audio request: %s (seq %d)\n", ambientMsg.c_str(), ambientSound.sequence);
+    wsSendMessage(ambientMsg);
+}
+
+// Start ambientSound.name (sequence already bumped by the caller), `loops` passes
+// (0 = until stopped). A soundscape cached in flash loops locally; a sound already
+// in the PSRAM clip store replays from there; otherwise it is downloaded into the
+// store once, and only a device without the store has the server stream it.
+void startAmbientSound(uint8_t loops) {
+    AssetEntry sound;
+    ambientSound.loops = loops;
+    localAmbientSequence = ambientSound.sequence;   // before start(), so speakerTask never sees a stale owner
+    if (loops == 0 && assetCache.lookup(ambientSound.name, &sound) && ambientPlayer.start(sound, true)) {
+        Serial.printf("Ambient %s: playing cached copy (v%u, seq %d)\n", ambientSound.name, sound.version, ambientSound.sequence);
+        return;
+    }
+    ambientPlayer.stop();
+    if (ambientClip.holds(ambientSound.name)) {
+        playAmbientClip();
+        return;
+    }
+    if (ambientClip.ready() && ambientClip.active()) {
+        // The old clip still reads the store the download would overwrite: stop it, request from loop()
+        ambientClip.stop();
+        clipDownloadPendingSince = millis();
+        clipDownloadPending = true;
+        return;
+    }
+    clipDownloadPending = false;
+    requestAmbient(ambientClip.ready());
+}
+
+// The clip store holds ambientSound.name: loop it locally (websocketTask or loop)
+void playAmbientClip() {
+    if (!ambientClip.play(ambientSound.loops, ambientSound.sequence)) {
+        requestAmbient(false);
+        return;
+    }
+    Serial.printf("Ambient %s: playing from PSRAM (seq %d, loops %u)\n", ambientSound.name, ambientSound.sequence, ambientSound.loops);
+    // Sync meditation breathing to the start of the sound, as the stream does with its first chunk
+    if (meditationState.active && meditationState.phaseStartTime == 0) {
+        meditationState.phaseStartTime = millis();
+        meditationState.phase = MeditationState::HOLD_BOTTOM;
+        Serial.println("[MEDITATION] Breathing synced to local clip start");
+    }
+}
+
+// A clip download failed or was refused: fall back to the server stream
+void streamAmbientSound() {
+    requestAmbient(false);
+}
+
 void playZenBell() {
-    // Request zen bell sound from server
+    // Cached copy plays straight from flash, even while disconnected
+    AssetEntry bell;
+    if (assetCache.lookup("zen_bell", &bell) && assetPlayer.start(bell, false)) {
+        Serial.println("Playing cached zen bell");
+        return;
+    }
+    
+    // Otherwise request zen bell sound from server
     if (!isWebSocketConnected) {
         Serial.println("Cannot play zen bell - WebSocket not connected");
         return;
@@ -2747,74 +3258,68 @@ void playZenBell() {
     Serial.println("Requesting zen bell from server");
 }
 
+// UI sounds for the mixer's MIX_UI voice (ToneSynth). Master volume is applied
+// at mix time, and playing one only queues a pointer — the caller never waits.
+static const ToneNote SHUTDOWN_NOTES[] = {
+    // Descending C6, G5, E5, C5 (reverse of startup), 120ms each
+    { 1047, 120, 6000 }, { 784, 120, 6000 }, { 659, 120, 6000 }, { 523, 120, 6000 },
+};
+static const ToneSequence SHUTDOWN_MELODY = {
+    SHUTDOWN_NOTES, sizeof(SHUTDOWN_NOTES) / sizeof(SHUTDOWN_NOTES[0]),
+    { 12, 0, 32767, 12 }      // 10% fade in / fade out per note
+};
+
+static const ToneNote VOLUME_CHIME_NOTES[] = {
+    { 1200, 50, 8000 },       // Very short 1.2kHz beep
+};
+static const ToneSequence VOLUME_CHIME = {
+    VOLUME_CHIME_NOTES, 1,
+    { 2, 0, 32767, 3 }        // Just enough ramp to avoid clicks
+};
+
 void playShutdownSound() {
  // Play a descending melody on disconnect (reverse of startup)
- const int sampleRate = 24000;
- const int noteDuration = 120; // 120ms per note
- const int numSamples = (sampleRate * noteDuration) / 1000;
- 
- // Musical notes: C6, G5, E5, C5 (descending - reverse of startup)
- const float frequencies[] = {1046.50f, 783.99f, 659.25f, 523.25f};
- const int numNotes = 4;
- 
- static int16_t toneBuffer[5760]; // 120ms at 24kHz stereo (2880 samples * 2 channels)
- 
- for (int note = 0; note < numNotes; note++) {
- for (int i = 0; i < numSamples; i++) {
- // Generate sine wave with fade-in/fade-out envelope
- float t = (float)i / sampleRate;
- float envelope = 1.0f;
- if (i < numSamples / 10) {
- envelope = (float)i / (numSamples / 10); // Fade in
- } else if (i > numSamples * 9 / 10) {
- envelope = (float)(numSamples - i) / (numSamples / 10); // Fade out
- }
- 
- int16_t sample = (int16_t)(sin(2.0f * PI * frequencies[note] * t) * 6000 * envelope * volumeMultiplier);
- 
- // Stereo output
- toneBuffer[i * 2] = sample;
- toneBuffer[i * 2 + 1] = sample;
- }
- 
- size_t bytes_written;
- if (xSemaphoreTake(i2sSpeakerMutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
-     Serial.println("CRITICAL: i2sSpeakerMutex deadlock in playShutdownSound - rebooting");
-     esp_restart();
- }
- i2s_write(I2S_NUM_1, toneBuffer, numSamples * 4, &bytes_written, pdMS_TO_TICKS(200));
- xSemaphoreGive(i2sSpeakerMutex);
+ if (!audioMixer.playTone(&SHUTDOWN_MELODY)) {
+     Serial.println("Shutdown sound: tone queue full - skipping");
  }
 }
 
 void playVolumeChime() {
- // Play a brief 1kHz tone at the current volume level
- const int sampleRate = 24000;
- const int durationMs = 50; // Very short 50ms beep (reduced from 100ms)
- const int numSamples = (sampleRate * durationMs) / 1000;
- const float frequency = 1200.0f; // 1.2kHz tone (slightly higher pitch)
- 
- static int16_t toneBuffer[2400]; // 50ms at 24kHz stereo (1200 samples * 2 channels)
- 
- for (int i = 0; i < numSamples; i++) {
- // Generate sine wave
- float t = (float)i / sampleRate;
- int16_t sample = (int16_t)(sin(2.0f * PI * frequency * t) * 8000 * volumeMultiplier);
- 
- // Stereo output
- toneBuffer[i * 2] = sample;
- toneBuffer[i * 2 + 1] = sample;
- }
- 
- size_t bytes_written;
- if (xSemaphoreTake(i2sSpeakerMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-     i2s_write(I2S_NUM_1, toneBuffer, numSamples * 4, &bytes_written, pdMS_TO_TICKS(100));
-     xSemaphoreGive(i2sSpeakerMutex);
- }
+ // Play a brief tone at the new volume level
+ audioMixer.playTone(&VOLUME_CHIME);
 }
 
 // ============== WEBSOCKET HANDLERS ==============
-void sendAudioChunk(uint8_t* data, size_t length) {
+static MicUplink micUplink;  // Preallocated binary mic frame (audioTask only, see MicUplink.h)
+static MicDtx micDtx;        // Holds back silent frames when the server takes DTX markers (audioTask only)
+// Uplink cost per 50 mic frames: bytes on the wire, message build (CPU) and socket send time
+static uint32_t statBytes = 0, statBuildUs = 0, statBuildMaxUs = 0, statSendUs = 0;
+
+// Send one sealed uplink frame whose build started at buildStart
+static bool sendUplinkFrame(const uint8_t* frame, size_t len, int64_t buildStart) {
+    int64_t t1 = esp_timer_get_time();
+    bool ok = wsSendBinary(frame, len);
+    statBuildUs += (uint32_t)(t1 - buildStart);
+    statBuildMaxUs = max(statBuildMaxUs, (uint32_t)(t1 - buildStart));
+    statSendUs += (uint32_t)(esp_timer_get_time() - t1);
+    statBytes += len;
+    return ok;
+}
+
+static bool sendCodedFrame(uint8_t codec, const int16_t* pcm, size_t samples, uint32_t captureMs) {
+    int64_t t0 = esp_timer_get_time();
+    size_t payloadLen = micUplink.encode(codec, pcm, samples);
+    size_t len;
+    const uint8_t* frame = micUplink.seal(UPLINK_STREAM_MIC, codec, payloadLen, captureMs, &len);
+    return sendUplinkFrame(frame, len, t0);
+}
+
+// New user turn (audioTask): DTX starts on air and counts afresh
+void resetMicUplinkTurn() {
+    micDtx.reset();
+}
+
+void sendAudioChunk(uint8_t* data, size_t length, uint32_t captureMs) {
     static uint32_t chunkCount = 0;
     static uint32_t lastDebug = 0;
     
@@ -2838,51 +3343,145 @@ void sendAudioChunk(uint8_t* data, size_t length) {
         sendRateCheck = millis();
     }
     
-    chunkCount++;
-    if (chunkCount % 50 == 0) {
-        Serial.printf("[WS] Sent %d audio chunks\n", chunkCount);
+    uint8_t codec = uplinkCodec;
+    bool binary = codec != UPLINK_CODEC_NONE;
+    bool ok = true;
+    if (binary) {
+        // Binary frame: header + coded audio, server decodes and re-wraps it for Gemini (MicUplink.h)
+        const int16_t* pcm = (const int16_t*)data;
+        bool held = false;
+        if (uplinkDtx) {
+            // DTX: quiet frames are held back; a run of them goes out as one silence marker,
+            // and the frames just before an onset go out as audio
+            int64_t t0 = esp_timer_get_time();
+            held = micDtx.hold(pcm, captureMs);
+            uint16_t level;
+            uint32_t firstMs;
+            uint16_t run = micDtx.takeRun(!held, &level, &firstMs);
+            if (run) {
+                size_t len;
+                const uint8_t* marker = micUplink.sealSilence(run, level, firstMs, &len);
+                ok &= sendUplinkFrame(marker, len, t0);
+            }
+            if (!held) {
+                for (int i = 0; i < micDtx.heldFrames(); i++) {
+                    uint32_t heldMs;
+                    const int16_t* frame = micDtx.heldFrame(i, &heldMs);
+                    ok &= sendCodedFrame(codec, frame, MIC_FRAME_SIZE, heldMs);
+                }
+                micDtx.clearHeld();
+            }
+        }
+        if (!held) ok &= sendCodedFrame(codec, pcm, length / sizeof(int16_t), captureMs);
+    } else {
+        // Legacy path for servers without uplinkCodecs: Live API realtimeInput message with Base64 audio
+        int64_t t0 = esp_timer_get_time();
+        JsonDocument doc;
+        
+        // Base64 encode into a pre-allocated static buffer to avoid repeated heap allocations
+        // (the old String += approach allocates/reallocates every character, causing heap fragmentation)
+        // Max mic frame = MIC_FRAME_SIZE * 2 = 640 bytes  Base64 = ceil(640/3)*4 = 856 chars + NUL
+        static char encodedBuf[1024];
+        const char* base64_chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        size_t outPos = 0;
+        int val = 0, valb = -6;
+        for (size_t i = 0; i < length && outPos < sizeof(encodedBuf) - 5; i++) {
+            val = (val << 8) + data[i];
+            valb += 8;
+            while (valb >= 0) {
+                encodedBuf[outPos++] = base64_chars[(val >> valb) & 0x3F];
+                valb -= 6;
+            }
+        }
+        if (valb > -6) encodedBuf[outPos++] = base64_chars[((val << 8) >> (valb + 8)) & 0x3F];
+        while (outPos % 4) encodedBuf[outPos++] = '=';
+        encodedBuf[outPos] = '\0';
+        
+        // Live API format: realtimeInput.audio as Blob
+        JsonObject audio = doc["realtimeInput"]["audio"].to<JsonObject>();
+        audio["data"] = encodedBuf;
+        audio["mimeType"] = "audio/pcm;rate=16000";
+        
+        String output;
+        serializeJson(doc, output);
+        int64_t t1 = esp_timer_get_time();
+        ok = wsSendMessage(output);
+        statBuildUs += (uint32_t)(t1 - t0);
+        statBuildMaxUs = max(statBuildMaxUs, (uint32_t)(t1 - t0));
+        statSendUs += (uint32_t)(esp_timer_get_time() - t1);
+        statBytes += output.length();
     }
     
-    // Create Live API realtimeInput message with Base64 encoded audio
-    JsonDocument doc;
-    
-    // Base64 encode into a pre-allocated static buffer to avoid repeated heap allocations
-    // (the old String += approach allocates/reallocates every character, causing heap fragmentation)
-    // Max mic frame = MIC_FRAME_SIZE * 2 = 640 bytes  Base64 = ceil(640/3)*4 = 856 chars + NUL
-    static char encodedBuf[1024];
-    const char* base64_chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-    size_t outPos = 0;
-    int val = 0, valb = -6;
-    for (size_t i = 0; i < length && outPos < sizeof(encodedBuf) - 5; i++) {
-        val = (val << 8) + data[i];
-        valb += 8;
-        while (valb >= 0) {
-            encodedBuf[outPos++] = base64_chars[(val >> valb) & 0x3F];
-            valb -= 6;
-        }
-    }
-    if (valb > -6) encodedBuf[outPos++] = base64_chars[((val << 8) >> (valb + 8)) & 0x3F];
-    while (outPos % 4) encodedBuf[outPos++] = '=';
-    encodedBuf[outPos] = '\0';
-    
-    // Live API format: realtimeInput.audio as Blob
-    JsonObject audio = doc["realtimeInput"]["audio"].to<JsonObject>();
-    audio["data"] = encodedBuf;
-    audio["mimeType"] = "audio/pcm;rate=16000";
-    
-    String output;
-    serializeJson(doc, output);
-    
-    // Send to WebSocket
-    if (wsSendMessage(output)) {
+    if (ok) {
         lastWebSocketSendTime = millis();
     } else {
-        webSocketSendFailures++;  // wsSendMessage already logged the failure
+        webSocketSendFailures++;  // wsSend* already logged the failure
+    }
+    
+    // Per-frame cost of building the message (CPU) and handing it to the socket, before/after comparable
+    chunkCount++;
+    if (chunkCount % 50 == 0) {
+        Serial.printf("[WS] Sent %d audio chunks (%s: %u B/frame, build %u us avg / %u max, send %u us avg, dtx %u%% this turn)\n",
+                      chunkCount, binary ? uplinkCodecName(codec) : "json", statBytes / 50,
+                      statBuildUs / 50, statBuildMaxUs, statSendUs / 50,
+                      micDtx.framesSeen() ? micDtx.framesSuppressed() * 100 / micDtx.framesSeen() : 0);
+        statBytes = statBuildUs = statBuildMaxUs = statSendUs = 0;
     }
-}// Track WebSocket stats
+}
+
+// Track WebSocket stats
 static uint32_t disconnectCount = 0;
 static uint32_t lastDisconnectTime = 0;
 
+// Decode a coded downlink payload in place of the packet (websocketTask only).
+// PCM passes through untouched; returns false if the packet must be discarded.
+static bool decodeDownlink(uint8_t codec, uint8_t*& payload, size_t& length) {
+    static int16_t decoded[AUDIO_RING_MAX_FRAME / sizeof(int16_t)];
+    if (codec == CODEC_PCM16) return true;
+    if (codec == CODEC_IMA_ADPCM) {
+        int samples = imaAdpcmDecodeBlock(payload, length, decoded, sizeof(decoded) / sizeof(decoded[0]));
+        if (samples < 0) {
+            Serial.printf("Discarding malformed ADPCM block (%u bytes)\n", (unsigned)length);
+            return false;
+        }
+        payload = (uint8_t*)decoded;
+        length = samples * sizeof(int16_t);
+        return true;
+    }
+    static uint32_t lastCodecLog = 0;
+    if ((int32_t)(millis() - lastCodecLog) > 10000) {
+        Serial.printf("Discarding audio chunk with unknown codec %u\n", codec);
+        lastCodecLog = millis();
+    }
+    return false;
+}
+
+// Feed relayed MP3 radio bytes to the decoder and queue every finished frame on
+// MIX_AMBIENT (websocketTask only). A new ambient sequence starts a fresh stream.
+static void feedMp3(const uint8_t* data, size_t length, uint16_t sequence) {
+    static uint16_t mp3Sequence = 0;
+    if (sequence != mp3Sequence) {
+        mp3Stream.reset();
+        mp3Sequence = sequence;
+    }
+    if (!mp3Stream.push(data, length)) {
+        Serial.println("MP3 input overflow - resynchronising");
+    }
+    AudioRing& ring = audioMixer.ring(MIX_AMBIENT);
+    const int16_t* pcm;
+    int samples;
+    while ((samples = mp3Stream.decode(&pcm)) > 0) {
+        // Same 100ms backpressure as the PCM path; a stuck ring drops the frame
+        if (!ring.write((const uint8_t*)pcm, samples * sizeof(int16_t), 100)) {
+            static uint32_t lastDropLog = 0;
+            if ((int32_t)(millis() - lastDropLog) > 2000) {
+                Serial.printf("MP3: ambient ring blocked, dropped %d samples\n", samples);
+                lastDropLog = millis();
+            }
+        }
+    }
+}
+
 void onWebSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
     switch(type) {
         case WStype_CONNECTED:
@@ -2924,14 +3523,8 @@ void onWebSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
                         currentAmbientSoundType = SOUND_FIRE;
                     }
                     
-                    // Request the ambient sound again
-                    JsonDocument ambientDoc;
-                    ambientDoc["action"] = "requestAmbient";
-                    ambientDoc["sound"] = ambientSound.name;
-                    ambientDoc["sequence"] = ambientSound.sequence;
-                    String ambientMsg;
-                    serializeJson(ambientDoc, ambientMsg);
-                    wsSendMessage(ambientMsg);
+                    // Start the ambient sound again
+                    startAmbientSound();
                     
                     isPlayingAmbient = true;
                     firstAudioChunk = true;
@@ -2975,19 +3568,50 @@ void onWebSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
                 if (now - lastBinaryRateLog > 5000) {
                     uint32_t bytesPerSec = binaryBytesReceived / 5;
                     float avgInterval = packetCount > 1 ? 5000.0f / packetCount : 0;
-                    uint32_t queueDepth = uxQueueMessagesWaiting(audioOutputQueue);
-                    Serial.printf("[STREAM] %u packets, %.1fms avg interval, %u fast (<20ms), %u KB/s, queue=%u\n", 
-                                 packetCount, avgInterval, fastPackets, bytesPerSec/1024, queueDepth);
+                    Serial.printf("[STREAM] %u packets, %.1fms avg interval, %u fast (<20ms), %u KB/s, queue voice=%u (peak %u) ambient=%u (peak %u) alarm=%u\n", 
+                                 packetCount, avgInterval, fastPackets, bytesPerSec/1024,
+                                 audioMixer.ring(MIX_VOICE).frames(), audioMixer.ring(MIX_VOICE).maxFramesSeen(),
+                                 audioMixer.ring(MIX_AMBIENT).frames(), audioMixer.ring(MIX_AMBIENT).maxFramesSeen(),
+                                 audioMixer.ring(MIX_ALARM).frames());
+                    if (radioState.streaming) {
+                        Serial.printf("[DRIFT] fill=%.0fms (target %ums) ratio=%+.0fppm\n",
+                                     audioMixer.resampler().fillMs(), (unsigned)DRIFT_TARGET_MS,
+                                     audioMixer.resampler().ppm());
+                    }
+                    Serial.printf("[JITTER] jitter=%.1fms target=%ums buffered=%ums underruns=%u stretch +%u/-%ums concealed=%u gaps/%ums\n",
+                                 jitterBuffer.jitterMs(), jitterBuffer.targetMs(),
+                                 JitterBuffer::bytesToMs(audioMixer.ring(MIX_VOICE).payloadBytes()), jitterBuffer.underruns(),
+                                 jitterBuffer.stretchedInMs(), jitterBuffer.stretchedOutMs(),
+                                 audioMixer.concealer().events(), audioMixer.concealer().concealedMs());
                     packetCount = 0;
                     fastPackets = 0;
                     binaryBytesReceived = 0;
                     lastBinaryRateLog = now;
                 }
                 
+                // Asset download data (A5 5F) goes to flash, never to the speaker
+                if (length >= 2 && payload[0] == ASSET_CHUNK_MAGIC0 && payload[1] == ASSET_CHUNK_MAGIC1) {
+                    assetCache.write(payload + 2, length - 2);
+                    break;
+                }
+                
+                // Ambient clip download data (A5 5E seq) goes to the PSRAM clip store, played after ambientClipEnd
+                if (length >= 4 && payload[0] == AMBIENT_CLIP_MAGIC0 && payload[1] == AMBIENT_CLIP_MAGIC1) {
+                    ambientClip.write(payload[2] | (payload[3] << 8), payload + 4, length - 4);
+                    lastAudioChunkTime = millis();
+                    break;
+                }
+                
                 // Check for ambient magic header + sequence number FIRST
-                // Magic bytes 0xA5 0x5A are very unlikely to appear in PCM audio
-                bool isAmbientPacket = (length >= 4 && payload != nullptr && payload[0] == 0xA5 && payload[1] == 0x5A);
+                // Magic bytes 0xA5 0x5A / 0xA5 0x5B are very unlikely to appear in PCM audio
+                bool isAmbientPacket = (length >= 4 && payload != nullptr && payload[0] == 0xA5 &&
+                                        (payload[1] == AMBIENT_MAGIC_PCM ||
+                                         (payload[1] == AMBIENT_MAGIC_CODEC && length >= 6)));
+                // Coded Gemini speech (A5 5C) — always the voice ring, never mistaken for the alarm stream
+                bool isCodedVoice = (!isAmbientPacket && length >= 4 && payload[0] == 0xA5 &&
+                                     payload[1] == VOICE_MAGIC_CODEC);
                 uint16_t chunkSequence = 0;
+                uint8_t ambientCodec = CODEC_PCM16;
                 
                 if (isAmbientPacket) {
                     // Extract sequence number
@@ -3020,9 +3644,19 @@ void onWebSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
                         break;  // Discard this chunk
                     }
                     
-                    // Valid ambient chunk - strip magic header + sequence
-                    payload += 4;
-                    length -= 4;
+                    // Valid ambient chunk - strip magic header + sequence (+ codec byte)
+                    if (payload[1] == AMBIENT_MAGIC_CODEC) {
+                        ambientCodec = payload[4];
+                        payload += 6;
+                        length -= 6;
+                    } else {
+                        payload += 4;
+                        length -= 4;
+                    }
+                    
+                    // Compressed stream: decode into PCM before it reaches the ring.
+                    // MP3 frames span packets, so those go through feedMp3() below instead.
+                    if (ambientCodec != CODEC_MP3 && !decodeDownlink(ambientCodec, payload, length)) break;
 
                     // Sync meditation breathing animation to first audio chunk
                     if (meditationState.active && meditationState.phaseStartTime == 0) {
@@ -3039,8 +3673,9 @@ void onWebSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
                 }
                 // else: Gemini audio (no magic header) - continue to play
                 
-                // Ignore audio if response was interrupted (but not for ambient/alarm sounds)
-                if (responseInterrupted && !isPlayingAmbient && !isPlayingAlarm) {
+                // Ignore audio if response was interrupted (but not for ambient/alarm sounds).
+                // Coded speech is identifiable, so it is dropped even while ambient or an alarm plays.
+                if (responseInterrupted && (isCodedVoice || (!isPlayingAmbient && !isPlayingAlarm))) {
                     Serial.println("Discarding audio chunk (response was interrupted)");
                     break;
                 }
@@ -3056,6 +3691,16 @@ void onWebSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
                     break;
                 }
                 
+                // Decode speech only once it is known to be wanted (interrupted turns are dropped above)
+                if (isCodedVoice) {
+                    uint8_t codec = payload[2];
+                    bool padded = payload[3] & VOICE_FLAG_PAD;
+                    payload += 4;
+                    length -= 4;
+                    if (!decodeDownlink(codec, payload, length)) break;
+                    if (padded && length >= sizeof(int16_t)) length -= sizeof(int16_t);
+                }
+                
                 // Raw PCM audio data from server (16-bit mono samples)
                 // This handles BOTH Gemini responses and ambient sounds
 
@@ -3080,24 +3725,35 @@ void onWebSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
                     }
                 }
                 
-                // Queue raw PCM chunk for audio task
-                // Use blocking send with timeout to apply backpressure instead of dropping
+                // Copy raw PCM straight from the WebSocket payload into the mixer voice's ring
+                // Use blocking write with timeout to apply backpressure instead of dropping
                 if (length == 0) {
                     // Empty chunk after header strip - silently discard
                     break;
                 }
-                if (length <= sizeof(AudioChunk::data)) {
-                    AudioChunk chunk;
-                    memcpy(chunk.data, payload, length);
-                    chunk.length = length;
-                    
-                    //  DIAGNOSTIC: Track queue depth before send
-                    uint32_t queueBefore = uxQueueMessagesWaiting(audioOutputQueue);
+                // Route: A5 5A/5B packets are ambient/radio/meditation, A5 5C is Gemini speech;
+                // headerless packets are the server's alarm stream while isPlayingAlarm, otherwise
+                // Gemini speech. A cached clip owns MIX_ALARM (speakerTask produces it), so never
+                // write there then.
+                if (isAmbientPacket && (ambientPlayer.active() || ambientClip.active())) {
+                    break;  // A cached soundscape or PSRAM clip owns MIX_AMBIENT (speakerTask produces it)
+                }
+                if (isAmbientPacket && ambientCodec == CODEC_MP3) {
+                    feedMp3(payload, length, chunkSequence);
+                    break;
+                }
+                MixVoice voice = isAmbientPacket ? MIX_AMBIENT
+                               : isCodedVoice ? MIX_VOICE
+                               : ((isPlayingAlarm && !assetPlayer.active()) ? MIX_ALARM : MIX_VOICE);
+                AudioRing& ring = audioMixer.ring(voice);
+                if (length <= AUDIO_RING_MAX_FRAME) {
+                    //  DIAGNOSTIC: Track ring depth before write
+                    uint32_t queueBefore = ring.frames();
                     
-                    // Block up to 100ms if queue is full (applies backpressure to TCP)
+                    // Block up to 100ms if ring is full (applies backpressure to TCP)
                     // This prevents bursting by slowing down the receive rate
                     static uint32_t consecutiveDrops = 0;
-                    if (xQueueSend(audioOutputQueue, &chunk, pdMS_TO_TICKS(100)) != pdTRUE) {
+                    if (!ring.write(payload, length, 100)) {
                         // Only drop if truly stuck (audio system frozen)
                         consecutiveDrops++;
                         static uint32_t lastDropWarning = 0;
@@ -3105,32 +3761,34 @@ void onWebSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
                         dropsince++;
                         if ((int32_t)(millis() - lastDropWarning) > 2000) {
                             if (dropsince > 0) {
-                                Serial.printf("Blocked on queue for 100ms+ (%u times, queue=%u/%u, consecutive=%u) - audio system may be frozen\n", 
-                                             dropsince, queueBefore, AUDIO_QUEUE_SIZE, consecutiveDrops);
+                                Serial.printf("Blocked on ring %d for 100ms+ (%u times, queue=%u, %u/%u B, consecutive=%u) - audio system may be frozen\n", 
+                                             (int)voice, dropsince, queueBefore, ring.bytesUsed(), (unsigned)ring.capacity(), consecutiveDrops);
                                 dropsince = 0;
                             }
                             lastDropWarning = millis();
                         }
-                        // Persistent queue overflow - audioTask may be deadlocked
+                        // Persistent queue overflow - speakerTask may be deadlocked
                         if (consecutiveDrops > 20) {
-                            Serial.println("CRITICAL: Audio queue blocked for 20+ packets - setting LED_ERROR and restarting audioTask");
+                            Serial.println("CRITICAL: Audio ring blocked for 20+ packets - setting LED_ERROR and flushing voice");
                             currentLEDMode = LED_ERROR;
-                            // Don't restart task here - just set error LED and clear queue
+                            // Don't restart task here - just set error LED and flush the stuck voice
                             // Restarting task from ISR context is unsafe
-                            AudioChunk dummy;
-                            while (xQueueReceive(audioOutputQueue, &dummy, 0) == pdTRUE) {}
+                            audioMixer.flush(voice);
                             consecutiveDrops = 0;
                         }
                         break;  // discard this chunk — queue blocked
                     } else {
                         consecutiveDrops = 0;  // Reset counter on successful send
+                        if (voice == MIX_VOICE) {
+                            jitterBuffer.onPacket(now, length);
+                        }
                     }
                 } else {
                     Serial.printf("PCM chunk too large: %d bytes\n", length);
                     break;
                 }
 
-                // Prebuffer check: runs AFTER xQueueSend so queueDepth includes the
+                // Prebuffer check: runs AFTER the ring write so queueDepth includes the
                 // packet we just added. Previously this ran before enqueue, so depth
                 // was always 0 and isPlayingResponse was never set for zen bell / ambient
                 // streams that arrive near their consumption rate.
@@ -3144,16 +3802,18 @@ void onWebSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
                         }
                     }
 
-                    uint32_t queueDepth = uxQueueMessagesWaiting(audioOutputQueue);
+                    uint32_t queueDepth = ring.frames();
                     // MIN_PREBUFFER=3: ~63ms head start before declaring playback active.
                     // Absorbs network jitter for short-burst sounds (zen bell, alarms)
                     // whose packets arrive near their playback rate with zero queue headroom.
+                    // Gemini voice output is additionally held in speakerTask until the jitter
+                    // buffer's measured target is buffered — this only declares the UX state.
                     const uint32_t MIN_PREBUFFER = 3;
 
                     if (queueDepth >= MIN_PREBUFFER) {
                         isPlayingResponse = true;
-                        Serial.printf("[PREBUF] Playback start: queueDepth=%u, turnComplete=%d, convState=%d, waitAge=%dms\n",
-                                     queueDepth, turnComplete, (int)convState,
+                        Serial.printf("[PREBUF] Playback start: queueDepth=%u, jbTarget=%ums, turnComplete=%d, convState=%d, waitAge=%dms\n",
+                                     queueDepth, jitterBuffer.targetMs(), turnComplete, (int)convState,
                                      waitingEnteredAt > 0 ? (int)(millis() - waitingEnteredAt) : -1);
 
                         // NOTE: turnComplete is NOT reset here to avoid a race condition where
@@ -3165,6 +3825,7 @@ void onWebSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
                             recordingActive = false;  // Ensure recording is stopped
                             xSemaphoreGive(recordingMutex);
                         }
+                        updateDmaProfile();
 
                         // Show VU meter during Gemini playback, keep current mode for ambient/alarm
                         if (!ambientSound.active && !isPlayingAlarm) {
@@ -3218,6 +3879,8 @@ void onWebSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
                 Serial.printf("WebSocket Disconnected (#%d) - isPlaying=%d, recording=%d, uptime=%lus\n",
                              disconnectCount, isPlayingResponse, recordingActive, millis()/1000);
                 isWebSocketConnected = false;
+                uplinkCodec = UPLINK_CODEC_NONE;   // renegotiated by the next ready message
+                uplinkDtx = false;
                 
                 // Save state for potential recovery after reconnect
                 bool hadPomodoro = pomodoroState.active;
@@ -3369,7 +4032,9 @@ void websocketTask(void * parameter) {
             if (uptime > 0 && uptime % 3600 == 0) {
                 // Stack watermark monitoring
                 UBaseType_t audioStackHighWater = audioTaskHandle ? uxTaskGetStackHighWaterMark(audioTaskHandle) : 0;
+                UBaseType_t speakerStackHighWater = speakerTaskHandle ? uxTaskGetStackHighWaterMark(speakerTaskHandle) : 0;
                 UBaseType_t ledStackHighWater = ledTaskHandle ? uxTaskGetStackHighWaterMark(ledTaskHandle) : 0;
+                UBaseType_t micStackHighWater = micCaptureTaskHandle ? uxTaskGetStackHighWaterMark(micCaptureTaskHandle) : 0;
                 UBaseType_t wsStackHighWater = uxTaskGetStackHighWaterMark(NULL);  // Current task
                 
                 // Heap fragmentation analysis
@@ -3389,11 +4054,17 @@ void websocketTask(void * parameter) {
                 Serial.printf("Fragmentation: %5.1f%%                \n", fragmentationPercent);
                 Serial.printf("PSRAM Free:    %6u KB                \n", freePsram/1024);
                 Serial.printf("\n");
-                Serial.printf("Stack Free - Audio:%u LED:%u WS:%u bytes\n", 
-                             audioStackHighWater, ledStackHighWater, wsStackHighWater);
+                Serial.printf("Stack Free - Audio:%u Speaker:%u LED:%u WS:%u MicCapture:%u bytes\n", 
+                             audioStackHighWater, speakerStackHighWater, ledStackHighWater, wsStackHighWater,
+                             micStackHighWater);
+                Serial.printf("Speaker: %u buffers played, %u DMA underruns\n",
+                             speakerStats.buffersPlayed, speakerStats.underruns);
                 if (audioStackHighWater < 2048) {
                     Serial.printf("WARNING: audioTask stack nearly exhausted (%u bytes free)\n", audioStackHighWater);
                 }
+                if (micCaptureTaskHandle && micStackHighWater < 512) {
+                    Serial.printf("WARNING: micCaptureTask stack nearly exhausted (%u bytes free)\n", micStackHighWater);
+                }
                 if (fragmentationPercent > 40.0f) {
                     Serial.printf("WARNING: Heap fragmentation high (%.1f%%) - largest block %u KB\n", 
                                  fragmentationPercent, largestBlock/1024);
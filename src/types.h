@@ -7,11 +7,6 @@
 
 #define MAX_ALARMS 10
 
-struct AudioChunk {
-    uint8_t data[2048];
-    size_t length;
-};
-
 enum LEDMode { LED_BOOT, LED_IDLE, LED_RECORDING, LED_PROCESSING, LED_AUDIO_REACTIVE, LED_CONNECTED, LED_ERROR, LED_RECONNECTING, LED_TIDE, LED_TIMER, LED_MOON, LED_AMBIENT_VU, LED_AMBIENT, LED_RADIO, LED_POMODORO, LED_MEDITATION, LED_LAMP, LED_SEA_GOOSEBERRY, LED_EYES, LED_ALARM, LED_CONVERSATION_WINDOW };
 
 // Conversation state machine (main-loop only — not safe to read from other FreeRTOS tasks).
@@ -60,6 +55,7 @@ struct AmbientSound {
     uint16_t sequence;  // Increments each time we request a new sound
     uint16_t discardedCount;  // Count discarded chunks to reduce log spam
     uint32_t drainUntil;  // Timestamp until which we silently drain stale packets
+    uint8_t loops;  // Passes to play before completing (0 = loop until stopped)
 };
 
 // Pomodoro timer state
@@ -94,6 +90,36 @@ struct MeditationState {
     float savedVolume;       // User's volume before meditation
 };
 
+// Speaker DMA output counters (written by speakerTask on I2S_EVENT_TX_DONE, read anywhere)
+struct SpeakerStats {
+    volatile uint32_t buffersPlayed = 0;  // DMA buffers completed that carried audio
+    volatile uint32_t framesPlayed = 0;   // Stereo frames actually clocked out (true playout position)
+    volatile uint32_t underruns = 0;      // DMA reached an unwritten buffer while audio was still flowing
+    volatile uint32_t queuedBytes = 0;    // Written to DMA, not yet played (fill = queuedBytes / 96 ms)
+};
+
+// Cost of one mic-path stage per MIC_FRAME_SIZE frame (audioTask only), logged
+// once per STAGE_STATS_FRAMES. The unit is the caller's: esp_timer µs or CPU cycles.
+#define STAGE_STATS_FRAMES (30 * AUDIO_SAMPLE_RATE / MIC_FRAME_SIZE)   // 30s
+#define MIC_FRAME_US       (MIC_FRAME_SIZE * 1000000LL / AUDIO_SAMPLE_RATE)
+
+struct StageStats {
+    uint64_t total = 0;
+    uint32_t peak = 0;
+    uint32_t frames = 0;
+
+    // Count one frame that cost `used`. True once the window is full: log, then clear().
+    bool add(uint32_t used) {
+        total += used;
+        if (used > peak) peak = used;
+        return ++frames >= STAGE_STATS_FRAMES;
+    }
+    uint32_t mean() const { return frames ? (uint32_t)(total / frames) : 0; }
+    // Share of a core, in percent, when the unit is µs
+    float corePercent() const { return frames ? 100.0f * total / (frames * MIC_FRAME_US) : 0.0f; }
+    void clear() { total = 0; peak = 0; frames = 0; }
+};
+
 // Internet radio mode state
 struct RadioState {
     bool active = false;          // Radio mode entered
@@ -3,10 +3,9 @@
 // ── Shared audio-drain helper ────────────────────────────────────────────────
 // Drain buffered audio, zero I2S DMA, and set a suppression window.
 // Prevents the ~1.2s audio tail that occurs when voice commands stop a stream
-// without touching the local audio queue or DMA buffer.
+// without touching the local audio ring or DMA buffer.
 void drainAudioAndSilence(uint32_t windowMs) {
-    AudioChunk dummy;
-    while (xQueueReceive(audioOutputQueue, &dummy, 0) == pdTRUE) {}
+    audioMixer.flushAll();
     i2sZeroSafe();
     ambientSound.drainUntil = millis() + windowMs;
 }
@@ -31,6 +30,7 @@ void transitionConvState(ConvState newState) {
         default:
             break;  // PLAYING, WINDOW: no universally-required entry actions
     }
+    updateDmaProfile();  // Conversation → TALK buffers; back to STREAM when idle in a streaming mode
 }
 
 // ── Safe WebSocket send with error logging ───────────────────────────────────
@@ -48,6 +48,58 @@ bool wsSendMessage(const String& msg) {
     return ok;
 }
 
+bool wsSendBinary(const uint8_t* data, size_t len) {
+    if (wsSendMutex && xSemaphoreTake(wsSendMutex, pdMS_TO_TICKS(200)) != pdTRUE) {
+        Serial.printf("[WS] send mutex timeout — dropped %u bytes\n", len);
+        return false;
+    }
+    // sendBIN only reads the buffer (headerToPayload = false)
+    bool ok = webSocket.sendBIN(data, len);
+    if (wsSendMutex) xSemaphoreGive(wsSendMutex);
+    if (!ok) Serial.printf("[WS] sendBIN failed (%u bytes)\n", len);
+    return ok;
+}
+
+// ── Ambient track completion ─────────────────────────────────────────────────
+// A finite ambient sound (meditation bell, `loops` passes) has finished, either
+// reported by the server stream (ambientComplete) or by the PSRAM clip player.
+void handleAmbientComplete(const char* soundName, uint16_t sequence) {
+    Serial.printf("Ambient track complete: %s (seq %d)\n", soundName, sequence);
+
+    // Validate: Only process if this completion matches what we're currently playing
+    if (strcmp(ambientSound.name, soundName) != 0) {
+        Serial.printf("Ignoring stale completion: expected '%s', got '%s'\n",
+                      ambientSound.name, soundName);
+        return;
+    }
+
+    // For meditation mode: auto-advance to next chakra
+    if (meditationState.active && currentLEDMode == LED_MEDITATION) {
+        if (meditationState.currentChakra < MeditationState::CROWN) {
+            // Auto-advance to next chakra
+            meditationState.currentChakra = (MeditationState::Chakra)(meditationState.currentChakra + 1);
+            meditationState.phase = MeditationState::HOLD_BOTTOM;
+            meditationState.phaseStartTime = 0; // Will sync to first arriving audio chunk
+            // Start next chakra sound
+            sprintf(ambientSound.name, "bell%03d", meditationState.currentChakra + 1);
+            ambientSound.sequence++;
+            firstAudioChunk = true;
+            lastAudioChunkTime = millis();
+            startAmbientSound(8);
+        } else {
+            // Completed all 7 chakras - return to IDLE
+            Serial.println("Meditation sequence complete - returning to IDLE");
+            meditationState.active = false;
+            isPlayingAmbient = false;
+            isPlayingResponse = false;
+            volumeMultiplier = meditationState.savedVolume;
+            Serial.printf("Volume restored to %.0f%%\n", volumeMultiplier * 100);
+            currentLEDMode = LED_IDLE;
+            updateDmaProfile();
+        }
+    }
+}
+
 void handleWebSocketMessage(uint8_t* payload, size_t length) {
   // Validate payload size before parsing
   if (length > MAX_JSON_SIZE) {
@@ -74,6 +126,28 @@ void handleWebSocketMessage(uint8_t* payload, size_t length) {
  // Handle server ready message
  if (strcmp(msgType, "ready") == 0) {
  Serial.printf("Server: %s\n", doc["message"].as<const char*>());
+ // Mic audio goes up as binary frames in a codec the server can decode (MicUplink.h)
+ uint32_t offered = 0;
+ for (JsonVariant c : doc["uplinkCodecs"].as<JsonArray>()) {
+   uint8_t codec = uplinkCodecFromName(c | "");
+   if (codec != UPLINK_CODEC_NONE) offered |= 1u << codec;
+ }
+ uplinkCodec = uplinkChooseCodec(offered);
+ uplinkDtx = uplinkCodec != UPLINK_CODEC_NONE && (doc["uplinkDtx"] | false);
+ Serial.printf("Mic uplink: %s%s\n", uplinkCodec != UPLINK_CODEC_NONE ? uplinkCodecName(uplinkCodec)
+                                                                       : "JSON (server has no uplinkCodecs)",
+               uplinkDtx ? " + DTX" : "");
+ // Advertise downlink codecs; the server keeps sending plain PCM until it hears this
+ JsonDocument capsDoc;
+ capsDoc["type"] = "capabilities";
+ JsonArray codecs = capsDoc["codecs"].to<JsonArray>();
+ codecs.add("ima-adpcm");
+ if (mp3Stream.ready()) codecs.add("mp3");   // radio only: relayed as the station's own MP3 frames
+ JsonArray voiceCodecs = capsDoc["voiceCodecs"].to<JsonArray>();
+ voiceCodecs.add("ima-adpcm");
+ String capsMsg;
+ serializeJson(capsDoc, capsMsg);
+ wsSendMessage(capsMsg);
  return;
  }
  
@@ -297,17 +371,12 @@ void handleWebSocketMessage(uint8_t* payload, size_t length) {
  alarmState.pulseRadius = 0.0f;
  currentLEDMode = LED_ALARM;
 
- // Start alarm sound (server loops alarm audio until it receives "stopAlarm")
+ // Start alarm sound (cached copy, or the server loops it until it receives "stopAlarm")
  isPlayingAlarm = true;
  isPlayingResponse = true;
  firstAudioChunk = true;
  lastAudioChunkTime = millis();
- if (ESP.getFreeHeap() < MIN_HEAP_FOR_JSON) { Serial.printf("[JSON] Low heap for alarm: %u\n", ESP.getFreeHeap()); return; }
- JsonDocument alarmDoc;
- alarmDoc["action"] = "requestAlarm";
- String alarmMsg;
- serializeJson(alarmDoc, alarmMsg);
- wsSendMessage(alarmMsg);
+ startAlarmSound();
 
  // Suppress thinking animation — timer-expiry Gemini notification should not show waiting state
  transitionConvState(ConvState::IDLE);
@@ -449,53 +518,56 @@ void handleWebSocketMessage(uint8_t* payload, size_t length) {
  return;
  }
  
- // Handle ambient stream completion
- if (strcmp(msgType, "ambientComplete") == 0) {
- String soundName = doc["sound"].as<String>();
- uint16_t sequence = doc["sequence"].as<uint16_t>();
- Serial.printf("Ambient track complete: %s (seq %d)\n", soundName.c_str(), sequence);
- 
- // Validate: Only process if this completion matches what we're currently playing
- if (strcmp(ambientSound.name, soundName.c_str()) != 0) {
- Serial.printf("Ignoring stale completion: expected '%s', got '%s'\n", 
- ambientSound.name, soundName.c_str());
+ // Handle asset manifest (sent on connect): queue downloads for missing/stale assets.
+ // serviceAssetCache() in main.cpp requests them once the device is idle.
+ if (strcmp(msgType, "assetManifest") == 0) {
+ for (JsonObject asset : doc["assets"].as<JsonArray>()) {
+ const char* name = asset["name"] | "";
+ if (name[0] == '\0' || strlen(name) >= ASSET_NAME_LEN) continue;
+#if !KWS_ENABLED
+ if (strcmp(name, KWS_ASSET_NAME) == 0) continue;  // no flash for a model that is never loaded
+#endif
+ assetCache.offer(name, asset["version"] | 0u, asset["size"] | 0u, asset["crc"] | 0u);
+ }
  return;
  }
- 
- // For meditation mode: auto-advance to next chakra
- if (meditationState.active && currentLEDMode == LED_MEDITATION) {
- if (meditationState.currentChakra < MeditationState::CROWN) {
- // Auto-advance to next chakra
- meditationState.currentChakra = (MeditationState::Chakra)(meditationState.currentChakra + 1);
- meditationState.phase = MeditationState::HOLD_BOTTOM;
-        meditationState.phaseStartTime = 0; // Will sync to first arriving audio chunk
- // Request next chakra sound
- if (ESP.getFreeHeap() < MIN_HEAP_FOR_JSON) { Serial.printf("[JSON] Low heap for chakra: %u\n", ESP.getFreeHeap()); return; }
- JsonDocument reqDoc;
- reqDoc["action"] = "requestAmbient";
- char nextSound[16];
- sprintf(nextSound, "bell%03d", meditationState.currentChakra + 1);
- reqDoc["sound"] = nextSound;
- reqDoc["loops"] = 8;
- reqDoc["sequence"] = ++ambientSound.sequence;
- String reqMsg;
- serializeJson(reqDoc, reqMsg);
- wsSendMessage(reqMsg);
- 
- strlcpy(ambientSound.name, nextSound, sizeof(ambientSound.name));
- firstAudioChunk = true;
- lastAudioChunkTime = millis();
- } else {
- // Completed all 7 chakras - return to IDLE
- Serial.println("Meditation sequence complete - returning to IDLE");
- meditationState.active = false;
- isPlayingAmbient = false;
- isPlayingResponse = false;
- volumeMultiplier = meditationState.savedVolume;
- Serial.printf("Volume restored to %.0f%%\n", volumeMultiplier * 100);
- currentLEDMode = LED_IDLE;
+
+ // Handle asset download framing: assetBegin, binary A5 5F chunks, assetEnd
+ if (strcmp(msgType, "assetBegin") == 0) {
+ assetCache.beginWrite(doc["name"] | "", doc["version"] | 0u, doc["size"] | 0u, doc["crc"] | 0u);
+ return;
+ }
+ if (strcmp(msgType, "assetEnd") == 0) {
+ if (assetCache.finishWrite()) {
+#if KWS_ENABLED
+ if (strcmp(doc["name"] | "", KWS_ASSET_NAME) == 0) kwsReloadRequested = true;  // audioTask swaps in the new wake-word model
+#endif
+ }
+ return;
+ }
+
+ // Download-once ambient clip (see AmbientClip.h). A refused or broken download falls back to the stream.
+ if (strcmp(msgType, "ambientClipBegin") == 0) {
+ uint16_t sequence = doc["sequence"] | 0;
+ if (!ambientSound.active || sequence != ambientSound.sequence) return;   // superseded - its data is ignored
+ if (!ambientClip.beginDownload(doc["sound"] | "", sequence, doc["samples"] | 0u, doc["bytes"] | 0u)) {
+ streamAmbientSound();
+ }
+ return;
  }
+ if (strcmp(msgType, "ambientClipEnd") == 0) {
+ uint16_t sequence = doc["sequence"] | 0;
+ if (!ambientClip.downloading() || ambientClip.downloadSequence() != sequence) return;   // refused or aborted
+ bool ok = ambientClip.finishDownload(sequence);
+ if (!ambientSound.active || sequence != ambientSound.sequence) return;
+ if (ok) playAmbientClip();
+ else streamAmbientSound();
+ return;
  }
+
+ // Handle ambient stream completion (a PSRAM clip reports its own, see serviceAmbientClip)
+ if (strcmp(msgType, "ambientComplete") == 0) {
+ handleAmbientComplete(doc["sound"] | "", doc["sequence"] | 0);
  return;
  }
  
@@ -740,28 +812,16 @@ void handleWebSocketMessage(uint8_t* payload, size_t length) {
  ambientSound.sequence++;
  isPlayingAmbient = true;
  isPlayingResponse = false;
+ updateDmaProfile();
  firstAudioChunk = true;
  lastAudioChunkTime = millis();
 
- // Flush any stale Gemini audio still queued to prevent overlap with ambient
- {
- AudioChunk dummy;
- while (xQueueReceive(audioOutputQueue, &dummy, 0) == pdTRUE) {}
- i2sZeroSafe();
- }
+ // Flush the previous ambient stream. Gemini's confirmation keeps playing on
+ // its own mixer voice and ducks the new sound until it finishes.
+ audioMixer.flush(MIX_AMBIENT);
 
- // Request ambient audio from server immediately
- {
- if (ESP.getFreeHeap() < MIN_HEAP_FOR_JSON) { Serial.printf("[JSON] Low heap for requestAmbient: %u\n", ESP.getFreeHeap()); return; }
- JsonDocument ambientDoc;
- ambientDoc["action"] = "requestAmbient";
- ambientDoc["sound"] = ambientSound.name;
- ambientDoc["sequence"] = ambientSound.sequence;
- String ambientMsg;
- serializeJson(ambientDoc, ambientMsg);
- Serial.printf("Ambient audio request: %s (seq %d)\n", ambientMsg.c_str(), ambientSound.sequence);
- wsSendMessage(ambientMsg);
- }
+ // Start ambient audio immediately (flash copy or server stream)
+ startAmbientSound();
  currentLEDMode = LED_AMBIENT;
  return;
  }
@@ -787,6 +847,7 @@ void handleWebSocketMessage(uint8_t* payload, size_t length) {
  meditationState.currentChakra = MeditationState::ROOT;
  meditationState.phase = MeditationState::HOLD_BOTTOM;
  meditationState.active = true;
+ updateDmaProfile();
  meditationState.savedVolume = volumeMultiplier;
  volumeMultiplier = 0.10f; // 10% volume for meditation
 
@@ -806,18 +867,9 @@ void handleWebSocketMessage(uint8_t* payload, size_t length) {
  isPlayingResponse = false;
  firstAudioChunk = true;
  lastAudioChunkTime = millis();
- {
- if (ESP.getFreeHeap() < MIN_HEAP_FOR_JSON) { Serial.printf("[JSON] Low heap for meditation: %u\n", ESP.getFreeHeap()); return; }
- JsonDocument meditationReqDoc;
- meditationReqDoc["action"] = "requestAmbient";
- meditationReqDoc["sound"] = "bell001";
- meditationReqDoc["loops"] = 8;
- meditationReqDoc["sequence"] = ++ambientSound.sequence;
- String meditationReqMsg;
- serializeJson(meditationReqDoc, meditationReqMsg);
- Serial.printf("Meditation starting: %s (seq %d)\n", meditationReqMsg.c_str(), ambientSound.sequence);
- wsSendMessage(meditationReqMsg);
- }
+ ambientSound.sequence++;
+ Serial.printf("Meditation starting: bell001 (seq %d)\n", ambientSound.sequence);
+ startAmbientSound(8);
  meditationState.streaming = true;
  Serial.println("Meditation breathing and audio started (ROOT chakra)");
  }
@@ -849,12 +901,8 @@ void handleWebSocketMessage(uint8_t* payload, size_t length) {
  meditationState.active = false;
  }
 
- // Flush stale audio
- {
- AudioChunk dummy;
- while (xQueueReceive(audioOutputQueue, &dummy, 0) == pdTRUE) {}
- i2sZeroSafe();
- }
+ // Flush the previous ambient/radio stream (Gemini voice is mixed over the new one)
+ audioMixer.flush(MIX_AMBIENT);
 
  // Validate input lengths
  if (strlen(stationName) >= sizeof(radioState.stationName)) {
@@ -867,6 +915,7 @@ void handleWebSocketMessage(uint8_t* payload, size_t length) {
 
  // Set radio state
  radioState.active = true;
+ updateDmaProfile();
  radioState.streaming = false; // will become true after first chunk arrives
  radioState.paused = false;    // clear any pause from a previous conversation
  radioState.isHLS = isHLS;
@@ -926,6 +975,7 @@ void handleWebSocketMessage(uint8_t* payload, size_t length) {
 
  drainAudioAndSilence(2000); // radio stream may have queued chunks; 2s window to flush tail
  currentLEDMode = LED_IDLE;
+ updateDmaProfile();
  return;
  }
 
@@ -952,6 +1002,7 @@ void handleWebSocketMessage(uint8_t* payload, size_t length) {
  volumeMultiplier = meditationState.savedVolume;
  meditationState.active = false;
  }
+ updateDmaProfile();
 
  // Map colour string
  LampState::Color lampColor = LampState::WHITE;
@@ -1027,6 +1078,7 @@ void handleWebSocketMessage(uint8_t* payload, size_t length) {
 
  drainAudioAndSilence(500);
  currentLEDMode = LED_IDLE;
+ updateDmaProfile();
  return;
  }
  
@@ -11,13 +11,20 @@
 #include <time.h>
 #include "Config.h"
 #include "types.h"
+#include "AudioMixer.h"
+#include "AssetCache.h"
+#include "AmbientClip.h"
+#include "AudioCodec.h"
+#include "Mp3Stream.h"
+#include "DmaProfiles.h"
+#include "MicUplink.h"
+#include "KeywordSpotter.h"
 
 // ── Globals defined in main.cpp that handleWebSocketMessage accesses ──
 extern WebSocketsClient        webSocket;
 extern CRGB                    leds[];
 extern SemaphoreHandle_t       ledMutex;
 extern SemaphoreHandle_t       wsSendMutex;
-extern SemaphoreHandle_t       i2sSpeakerMutex;
 
 extern volatile LEDMode    currentLEDMode;
 
@@ -28,11 +35,19 @@ extern bool     isPlayingAlarm;
 extern volatile bool  recordingActive;
 extern volatile bool  isPlayingResponse;
 extern volatile bool  isPlayingAmbient;
+extern volatile uint8_t uplinkCodec;
+extern volatile bool  uplinkDtx;
+extern volatile bool  kwsReloadRequested;
 extern volatile float volumeMultiplier;
 extern volatile uint32_t lastAudioChunkTime;
 extern ConvState convState;
 extern uint32_t waitingEnteredAt;
-extern QueueHandle_t audioOutputQueue;
+extern AudioMixer audioMixer;
+extern AssetCache assetCache;
+extern AssetPlayer assetPlayer;
+extern AssetPlayer ambientPlayer;
+extern AmbientClip ambientClip;
+extern Mp3Stream mp3Stream;
 
 extern TideState       tideState;
 extern DayNightData    dayNightData;
@@ -54,22 +69,28 @@ extern const char* CHAKRA_NAMES[];
 void playVolumeChime();
 void updateDayNightBrightness();
 void playShutdownSound();
+void updateDmaProfile();
+void startAlarmSound();
+void startAmbientSound(uint8_t loops = 0);
+void playAmbientClip();
+void streamAmbientSound();
 
 // ── Function declarations ──
 void handleWebSocketMessage(uint8_t* payload, size_t length);
 
-// Drain audioOutputQueue, zero I2S DMA, and set a drain window.
+// A finite ambient sound finished (server ambientComplete, or the local clip player)
+void handleAmbientComplete(const char* soundName, uint16_t sequence);
+
+// Flush every mixer voice, zero I2S DMA, and set a drain window.
 // Call after sending stopAmbient to prevent audio tail on voice-commanded stops.
 // windowMs: how long to suppress incoming audio (default 500ms, use 2000ms after radio).
 void drainAudioAndSilence(uint32_t windowMs = 500);
 
-// Mutex-guarded i2s_zero_dma_buffer — prevents DMA race with audioTask's i2s_write.
-// Use instead of bare i2s_zero_dma_buffer(I2S_NUM_1) everywhere outside audioTask.
+// Deferred i2s_zero_dma_buffer — speakerTask zeroes the speaker DMA between mixer blocks,
+// so it can never race i2s_write. Use instead of bare i2s_zero_dma_buffer(I2S_NUM_1)
+// everywhere outside speakerTask.
 static inline void i2sZeroSafe() {
-    if (i2sSpeakerMutex && xSemaphoreTake(i2sSpeakerMutex, pdMS_TO_TICKS(200)) == pdTRUE) {
-        i2s_zero_dma_buffer(I2S_NUM_1);
-        xSemaphoreGive(i2sSpeakerMutex);
-    }
+    audioMixer.requestSilence();
 }
 
 // Central ConvState transition function — sets universally-required entry actions.
@@ -78,6 +99,8 @@ void transitionConvState(ConvState newState);
 
 // Safe WebSocket send wrapper — logs on failure, returns sendTXT result.
 bool wsSendMessage(const String& msg);
+// Binary counterpart (mic uplink frames); same mutex, logs on failure.
+bool wsSendBinary(const uint8_t* data, size_t len);
 
 // Alarm persistence to NVS (defined in main.cpp)
 void saveAlarmsToNVS();
@@ -0,0 +1,231 @@
+// ============== ECHO CANCELLER EVALUATION ==============
+//
+// Offline tool: runs the firmware's echo canceller (src/EchoCanceller.h, same
+// reference decimator, delay search and fixed-point filter) over recorded
+// speaker/mic pairs. It reports the echo return loss enhancement (ERLE), the
+// time to converge, the estimated delay, barge-in detections and the CPU per
+// 20ms mic frame.
+//
+// Build and run on the host:
+//
+//   g++ -std=c++17 -O2 -Isrc -o aeceval tools/aeceval.cpp src/EchoCanceller.cpp src/AudioKernels.cpp
+//   ./aeceval [--gain G] [--jitter MS] [--out clean.wav] spk.wav mic.wav [spk2.wav mic2.wav ...]
+//
+// spk.wav is what went to I2S_NUM_1: 24 kHz, mono or stereo, 16-bit, after
+// the volume. mic.wav is the mic over the same time: 16 kHz mono 16-bit. Pass
+// --gain 16 for raw INMP441 captures (MicAgc starts at 16x). The two must
+// start together to within AEC_MIN_DELAY_MS; the delay search finds the rest.
+// Speaker blocks are written MIX_BLOCK_FRAMES at a time, ahead of the mic, as
+// speakerTask does. --jitter adds up to ±MS of noise to every timestamp on
+// both sides.
+//
+// If mic.txt holds Audacity labels, those spans are near-end speech: they
+// are left out of the ERLE. The first barge-in within a span (or its 300ms
+// tail) is a detection, with its latency from the start of the span. A
+// barge-in anywhere else is a false one.
+//
+// =======================================================
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "EchoCanceller.h"
+
+#define MIC_RATE      16000
+#define SPK_RATE      24000
+#define FRAME         320      // MIC_FRAME_SIZE
+#define SPK_BLOCK     512      // MIX_BLOCK_FRAMES
+
+struct Wav {
+    std::vector<int16_t> pcm;
+    int rate = 0, channels = 0;
+};
+
+static bool readWav(const char* path, Wav& w) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    std::vector<uint8_t> d;
+    fseek(f, 0, SEEK_END);
+    d.resize(ftell(f));
+    fseek(f, 0, SEEK_SET);
+    bool ok = fread(d.data(), 1, d.size(), f) == d.size();
+    fclose(f);
+    if (!ok || d.size() < 12 || memcmp(d.data(), "RIFF", 4) || memcmp(d.data() + 8, "WAVE", 4)) {
+        fprintf(stderr, "%s: not a WAV file\n", path);
+        return false;
+    }
+    bool fmtOk = false;
+    for (size_t p = 12; p + 8 <= d.size();) {
+        uint32_t len = d[p + 4] | (d[p + 5] << 8) | (d[p + 6] << 16) | ((uint32_t)d[p + 7] << 24);
+        const uint8_t* c = d.data() + p + 8;
+        if (p + 8 + len > d.size()) len = (uint32_t)(d.size() - p - 8);
+        if (!memcmp(d.data() + p, "fmt ", 4) && len >= 16) {
+            w.channels = c[2] | (c[3] << 8);
+            w.rate = c[4] | (c[5] << 8) | (c[6] << 16) | ((uint32_t)c[7] << 24);
+            fmtOk = (c[0] | (c[1] << 8)) == 1 && (c[14] | (c[15] << 8)) == 16 && (w.channels == 1 || w.channels == 2);
+        } else if (!memcmp(d.data() + p, "data", 4) && fmtOk) {
+            w.pcm.resize(len / 2);
+            memcpy(w.pcm.data(), c, w.pcm.size() * 2);
+            return true;
+        }
+        p += 8 + len + (len & 1);
+    }
+    fprintf(stderr, "%s: need 16-bit PCM, mono or stereo\n", path);
+    return false;
+}
+
+static void writeWav(const char* path, const std::vector<int16_t>& pcm) {
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        perror(path);
+        return;
+    }
+    uint32_t data = (uint32_t)pcm.size() * 2, riff = 36 + data, fmtLen = 16, rate = MIC_RATE, bps = MIC_RATE * 2;
+    uint16_t pcmFmt = 1, ch = 1, align = 2, bits = 16;
+    fwrite("RIFF", 1, 4, f); fwrite(&riff, 4, 1, f); fwrite("WAVEfmt ", 1, 8, f);
+    fwrite(&fmtLen, 4, 1, f); fwrite(&pcmFmt, 2, 1, f); fwrite(&ch, 2, 1, f);
+    fwrite(&rate, 4, 1, f); fwrite(&bps, 4, 1, f); fwrite(&align, 2, 1, f); fwrite(&bits, 2, 1, f);
+    fwrite("data", 1, 4, f); fwrite(&data, 4, 1, f);
+    fwrite(pcm.data(), 2, pcm.size(), f);
+    fclose(f);
+}
+
+// Near-end spans in ms from Audacity labels next to the mic file
+static std::vector<std::pair<double, double>> labels(const char* wavPath) {
+    std::vector<std::pair<double, double>> spans;
+    std::string path(wavPath);
+    path = path.substr(0, path.rfind('.')) + ".txt";
+    FILE* f = fopen(path.c_str(), "r");
+    if (!f) return spans;
+    double a, b;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "%lf %lf", &a, &b) == 2) spans.push_back({a * 1000.0, b * 1000.0});
+    }
+    fclose(f);
+    return spans;
+}
+
+static double db(double num, double den) { return 10.0 * log10((num + 1) / (den + 1)); }
+
+int main(int argc, char** argv) {
+    float gain = 1;
+    int jitterMs = 0;
+    const char* outPath = nullptr;
+    std::vector<const char*> files;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--gain") && i + 1 < argc) gain = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--jitter") && i + 1 < argc) jitterMs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--out") && i + 1 < argc) outPath = argv[++i];
+        else files.push_back(argv[i]);
+    }
+    if (files.empty() || files.size() % 2) {
+        fprintf(stderr, "usage: %s [--gain G] [--jitter MS] [--out clean.wav] spk.wav mic.wav [spk.wav mic.wav ...]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<int16_t> cleaned;
+    std::vector<double> frameUs;
+    double totalMic = 0, totalErr = 0;
+    int detected = 0, spansTotal = 0, falseBarge = 0;
+    srand(1);
+    for (size_t f = 0; f < files.size(); f += 2) {
+        Wav spk, mic;
+        if (!readWav(files[f], spk) || !readWav(files[f + 1], mic)) continue;
+        if (spk.rate != SPK_RATE || mic.rate != MIC_RATE || mic.channels != 1) {
+            fprintf(stderr, "%s / %s: need a 24 kHz speaker and a 16 kHz mono mic\n", files[f], files[f + 1]);
+            continue;
+        }
+        std::vector<int16_t> stereo;
+        if (spk.channels == 2) {
+            stereo = spk.pcm;
+        } else {
+            for (int16_t s : spk.pcm) { stereo.push_back(s); stereo.push_back(s); }
+        }
+        for (int16_t& s : mic.pcm) s = (int16_t)std::max(-32768.0f, std::min(32767.0f, s * gain));
+        auto spans = labels(files[f + 1]);
+        std::vector<bool> spanHit(spans.size(), false);
+        spansTotal += (int)spans.size();
+
+        // Timeline starts at 1s so early positions never wrap below zero
+        const uint32_t origin = MIC_RATE;
+        auto jitter = [&]() { return jitterMs ? (int32_t)(rand() % (2 * jitterMs * 16 + 1)) - jitterMs * 16 : 0; };
+        EchoReference reference;
+        EchoCanceller aec;
+        if (!reference.begin()) return 1;
+        aec.begin(&reference);
+
+        size_t spkFrames = stereo.size() / 2, spkDone = 0;
+        double micE = 0, errE = 0, convergedMs = -1, lastBargeMs = -1e9;
+        std::vector<int16_t> frame(FRAME);
+        for (size_t k = 0; k + FRAME <= mic.pcm.size(); k += FRAME) {
+            double tMs = k * 1000.0 / MIC_RATE;
+            // speakerTask runs ahead of playback: keep ~60ms of reference queued
+            while (spkDone < spkFrames && spkDone * 2 / 3 < k + FRAME + 960) {
+                int n = (int)std::min((size_t)SPK_BLOCK, spkFrames - spkDone);
+                reference.write(&stereo[2 * spkDone], n, origin + (uint32_t)(spkDone * 2 / 3) + jitter());
+                spkDone += n;
+            }
+
+            memcpy(frame.data(), &mic.pcm[k], FRAME * 2);
+            auto t0 = std::chrono::steady_clock::now();
+            aec.process(frame.data(), FRAME, origin + (uint32_t)k + jitter());
+            frameUs.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+            cleaned.insert(cleaned.end(), frame.begin(), frame.end());
+
+            int span = -1, near = -1;   // inside a span / inside or just after one (its tail)
+            for (size_t s = 0; s < spans.size(); s++) {
+                if (tMs + 20 > spans[s].first && tMs < spans[s].second) span = (int)s;
+                if (tMs + 20 > spans[s].first && tMs < spans[s].second + 300) near = (int)s;
+            }
+            if (aec.speakerActive() && span < 0) {
+                for (int i = 0; i < FRAME; i++) {
+                    micE += (double)mic.pcm[k + i] * mic.pcm[k + i];
+                    errE += (double)frame[i] * frame[i];
+                }
+            }
+            if (convergedMs < 0 && aec.converged()) convergedMs = tMs + 20;
+            if (aec.bargeIn() && tMs - lastBargeMs > 1000) {
+                lastBargeMs = tMs;
+                if (near >= 0 && !spanHit[near]) {
+                    spanHit[near] = true;
+                    detected++;
+                    printf("  barge-in %.0f ms into near-end speech at %.2fs\n", tMs + 20 - spans[near].first, spans[near].first / 1000);
+                } else if (near < 0) {
+                    falseBarge++;
+                    printf("  FALSE barge-in at %.2fs\n", (tMs + 20) / 1000);
+                }
+            }
+        }
+        totalMic += micE;
+        totalErr += errE;
+        printf("%s: delay %d ms, ERLE %.1f dB (echo only), converged %s",
+               files[f + 1], aec.delayMs(), db(micE, errE), convergedMs < 0 ? "never" : "");
+        if (convergedMs >= 0) printf("after %.2fs", convergedMs / 1000);
+        printf(", final estimate %.1f dB\n", aec.erleDb());
+    }
+    if (frameUs.empty()) return 1;
+
+    printf("\n");
+    printf("ERLE          %.1f dB over all echo-only audio\n", db(totalMic, totalErr));
+    if (spansTotal) printf("barge-in      %d/%d near-end spans detected, %d false\n", detected, spansTotal, falseBarge);
+    else if (falseBarge) printf("barge-in      %d false (no near-end labels)\n", falseBarge);
+    std::vector<double> sorted = frameUs;
+    std::sort(sorted.begin(), sorted.end());
+    double mean = 0;
+    for (double u : frameUs) mean += u;
+    mean /= frameUs.size();
+    printf("CPU           %.1f us mean, %.1f us p99, %.1f us max per 20ms frame on this host (%.2f%% of real time)\n",
+           mean, sorted[sorted.size() * 99 / 100], sorted.back(), mean / 200.0);
+    if (outPath) writeWav(outPath, cleaned);
+    return 0;
+}
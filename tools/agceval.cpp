@@ -0,0 +1,231 @@
+// ============== MIC AGC EVALUATION ==============
+//
+// Offline tool: drives the firmware's mic AGC (src/MicAgc.h) with synthetic
+// 24-bit signals at known levels and checks the two things it promises: no
+// output sample ever clips, and speech comes out at a steady level whatever
+// level it went in at.
+//
+// Build and run on the host:
+//
+//   g++ -std=c++17 -O2 -Isrc -o agceval tools/agceval.cpp src/MicAgc.cpp src/AudioKernels.cpp
+//   ./agceval [--out dir]
+//
+// Scenarios (speech-like syllables with pauses over a -75 dBFS noise floor,
+// fed as 32-bit I2S words the way initI2SMic delivers them):
+//   sweep   the talker's level glides from -70 to 0 dBFS and back over 80s
+//   steps   8s blocks at -60, -20, -45, -5, -30, -2, -55 dBFS
+//   bangs   a -50 dBFS talker with a 0 dBFS bang every 3s
+//   echo    a -40 dBFS talker, with 6s of loud playback (-10 dBFS) under
+//           hold(), as while the speaker plays
+//
+// For each it prints the clipped samples (beyond AGC_CEILING or at full
+// scale), how often the limiter acted, and the output level of the talker
+// over 0.5s windows of speech. Windows where the talker is below the level
+// the maximum gain can bring up, or in the 2s after a step, are not counted;
+// for the steps it also prints when each one settled within 3 dB of target.
+// --out writes each scenario's output as dir/<name>.wav (16 kHz mono).
+//
+// =================================================
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "MicAgc.h"
+
+#define SAMPLE_RATE 16000
+#define FRAME       320          // MIC_FRAME_SIZE
+#define WINDOW      (SAMPLE_RATE / 2)
+
+static void writeWav(const std::string& path, const std::vector<int16_t>& pcm) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) {
+        perror(path.c_str());
+        return;
+    }
+    uint32_t data = (uint32_t)pcm.size() * 2, riff = 36 + data, fmtLen = 16, rate = SAMPLE_RATE, bps = SAMPLE_RATE * 2;
+    uint16_t pcmFmt = 1, ch = 1, align = 2, bits = 16;
+    fwrite("RIFF", 1, 4, f); fwrite(&riff, 4, 1, f); fwrite("WAVEfmt ", 1, 8, f);
+    fwrite(&fmtLen, 4, 1, f); fwrite(&pcmFmt, 2, 1, f); fwrite(&ch, 2, 1, f);
+    fwrite(&rate, 4, 1, f); fwrite(&bps, 4, 1, f); fwrite(&align, 2, 1, f); fwrite(&bits, 2, 1, f);
+    fwrite("data", 1, 4, f); fwrite(&data, 4, 1, f);
+    fwrite(pcm.data(), 2, pcm.size(), f);
+    fclose(f);
+}
+
+// Unit-RMS speech-like signal: a 150 Hz harmonic series with falling
+// harmonics, in 4 Hz syllables, with a pause of 0.3–1s every couple of
+// seconds. talking[i] says whether the talker is voiced at sample i.
+static std::vector<float> talker(size_t n, std::vector<bool>& talking, std::mt19937& rng) {
+    std::uniform_real_distribution<float> u(0, 1);
+    std::vector<float> x(n);
+    talking.assign(n, false);
+    double ph = 0;
+    size_t next = 0;
+    bool on = true;
+    for (size_t i = 0; i < n; i++) {
+        if (i == next) {
+            on = !on || u(rng) < 0.8f;
+            next = i + (size_t)(SAMPLE_RATE * (on ? 1.5f + 1.5f * u(rng) : 0.3f + 0.7f * u(rng)));
+        }
+        ph += 2 * M_PI * (150 + 20 * sin(2 * M_PI * 0.7 * i / SAMPLE_RATE)) / SAMPLE_RATE;
+        double v = 0;
+        for (int h = 1; h <= 20; h++) v += sin(h * ph) / h;
+        double syllable = 0.5 - 0.5 * cos(2 * M_PI * 4.0 * i / SAMPLE_RATE);
+        x[i] = on ? (float)(v * syllable * 1.6) : 0;
+        talking[i] = on && syllable > 0.2;
+    }
+    return x;
+}
+
+struct Result {
+    size_t clipped = 0, fullScale = 0;
+    std::vector<double> levels;                      // dBFS of counted 0.5s windows
+    std::vector<std::pair<double, double>> windows;  // (start s, dBFS) of every 0.5s window with speech
+};
+
+// Feed 24-bit samples (float, full scale 2^23) through the AGC frame by frame
+static Result run(const std::string& name, const std::vector<float>& in, const std::vector<bool>& talking,
+                  const std::vector<bool>& counted, const std::vector<bool>& holdAt, const char* outDir) {
+    MicAgc agc;
+    agc.begin();
+    std::vector<int16_t> out(in.size() / FRAME * FRAME);
+    std::vector<int32_t> raw(FRAME);
+    uint32_t limitedBefore = agc.limitedFrames();
+    double gMin = 1e9, gMax = -1e9;
+    for (size_t k = 0; k + FRAME <= in.size(); k += FRAME) {
+        for (int i = 0; i < FRAME; i++) {
+            double s = std::max(-8388608.0, std::min(8388607.0, (double)in[k + i]));
+            raw[i] = (int32_t)lrint(s) * 256 + (rand() & 0xFF);   // the undriven low byte is noise
+        }
+        agc.hold(!holdAt.empty() && holdAt[k]);
+        agc.process(raw.data(), &out[k], FRAME);
+        gMin = std::min(gMin, (double)agc.gainDb());
+        gMax = std::max(gMax, (double)agc.gainDb());
+    }
+
+    Result r;
+    for (int16_t s : out) {
+        if (abs(s) > AGC_CEILING) r.clipped++;
+        if (s == 32767 || s == -32768) r.fullScale++;
+    }
+    for (size_t w = 0; w + WINDOW <= out.size(); w += WINDOW) {
+        double e = 0;
+        size_t voiced = 0;
+        bool use = true;
+        for (size_t i = w; i < w + WINDOW; i++) {
+            if (!counted[i]) use = false;
+            if (talking[i]) {
+                e += (double)out[i] * out[i];
+                voiced++;
+            }
+        }
+        if (voiced <= WINDOW / 4) continue;
+        double level = 10 * log10(e / voiced / (32768.0 * 32768.0) + 1e-12);
+        r.windows.push_back({(double)w / SAMPLE_RATE, level});
+        if (use) r.levels.push_back(level);
+    }
+
+    std::vector<double> l = r.levels;
+    std::sort(l.begin(), l.end());
+    double mean = 0, var = 0;
+    for (double v : l) mean += v;
+    mean /= std::max<size_t>(1, l.size());
+    for (double v : l) var += (v - mean) * (v - mean);
+    var /= std::max<size_t>(1, l.size());
+    printf("%-6s clipped %zu, at full scale %zu, limiter %u frames, gain %.1f..%.1f dB\n",
+           name.c_str(), r.clipped, r.fullScale, agc.limitedFrames() - limitedBefore, gMin, gMax);
+    if (!l.empty()) {
+        printf("       talker out %.1f dBFS mean, sd %.1f dB, 5%%..95%% %.1f..%.1f dBFS over %zu windows (target %d)\n",
+               mean, sqrt(var), l[l.size() * 5 / 100], l[l.size() * 95 / 100], l.size(), AGC_TARGET_DBFS);
+    }
+    if (outDir) writeWav(std::string(outDir) + "/" + name + ".wav", out);
+    return r;
+}
+
+int main(int argc, char** argv) {
+    const char* outDir = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--out") && i + 1 < argc) outDir = argv[++i];
+    }
+    std::mt19937 rng(1);
+    std::normal_distribution<float> noise(0, 1);
+    const double fullScale = 8388608.0;
+    const double noiseRms = fullScale * pow(10, -75 / 20.0);
+    // The quietest talker the maximum gain can bring to the target (5 dB of slack)
+    const double reachable = AGC_TARGET_DBFS - AGC_MAX_GAIN_DB - 5;
+    size_t clipped = 0;
+    std::vector<bool> talking, counted, noHold;
+
+    auto build = [&](size_t n, auto levelAt, std::vector<bool>& counted, auto settled) {
+        std::vector<float> x = talker(n, talking, rng);
+        counted.assign(n, false);
+        for (size_t i = 0; i < n; i++) {
+            double lv = levelAt(i);
+            x[i] = (float)(x[i] * fullScale * pow(10, lv / 20) + noiseRms * noise(rng));
+            counted[i] = lv >= reachable && settled(i);
+        }
+        return x;
+    };
+
+    // Sweep: -70 → 0 → -70 dBFS over 80s
+    {
+        size_t n = 80 * SAMPLE_RATE;
+        auto x = build(n, [&](size_t i) { double t = (double)i / n; return -70 + 70 * (1 - fabs(2 * t - 1)); },
+                       counted, [](size_t i) { return i > 2 * SAMPLE_RATE; });
+        clipped += run("sweep", x, talking, counted, noHold, outDir).clipped;
+    }
+    // Steps: 8s blocks, 2s to settle after each
+    {
+        const double steps[] = {-60, -20, -45, -5, -30, -2, -55};
+        size_t block = 8 * SAMPLE_RATE, n = block * 7;
+        auto x = build(n, [&](size_t i) { return steps[i / block]; },
+                       counted, [&](size_t i) { return i % block > 2 * SAMPLE_RATE; });
+        Result r = run("steps", x, talking, counted, noHold, outDir);
+        clipped += r.clipped;
+        // Settled: the first speech window from which the level stays within 3 dB of the target
+        printf("       settled after");
+        for (int b = 0; b < 7; b++) {
+            double from = (double)b * block / SAMPLE_RATE, to = from + (double)block / SAMPLE_RATE, at = -1;
+            for (auto& w : r.windows) {
+                if (w.first < from || w.first >= to) continue;
+                if (fabs(w.second - AGC_TARGET_DBFS) > 3) at = -1;
+                else if (at < 0) at = w.first - from;
+            }
+            if (at < 0) printf(" %.0f dBFS: no,", steps[b]);
+            else printf(" %.0f dBFS: %.1fs,", steps[b], at);
+        }
+        printf("\n");
+    }
+    // Bangs: a quiet talker and a full-scale transient every 3s
+    {
+        size_t n = 30 * SAMPLE_RATE;
+        auto x = build(n, [](size_t) { return -50.0; }, counted, [](size_t i) { return i > 4 * SAMPLE_RATE; });
+        for (size_t t = SAMPLE_RATE; t + 800 < n; t += 3 * SAMPLE_RATE) {
+            for (size_t i = 0; i < 800; i++) x[t + i] += (float)(0.98 * fullScale * exp(-(double)i / 150) * (i & 1 ? 1 : -1));
+            for (size_t i = t; i < t + SAMPLE_RATE / 2; i++) counted[i] = false;
+        }
+        clipped += run("bangs", x, talking, counted, noHold, outDir).clipped;
+    }
+    // Echo: loud playback under hold() must not pull the gain down
+    {
+        size_t n = 24 * SAMPLE_RATE;
+        std::vector<bool> holdAt(n, false);
+        auto x = build(n, [](size_t) { return -40.0; }, counted, [](size_t i) { return i > 4 * SAMPLE_RATE; });
+        std::vector<bool> playing;
+        std::vector<float> music = talker(n, playing, rng);   // talking[] still belongs to the talker
+        for (size_t i = 10 * SAMPLE_RATE; i < 16 * SAMPLE_RATE; i++) {
+            x[i] += (float)(music[i] * fullScale * pow(10, -10 / 20.0));
+            holdAt[i] = true;
+            counted[i] = false;
+        }
+        clipped += run("echo", x, talking, counted, holdAt, outDir).clipped;
+    }
+    printf("\n%s\n", clipped ? "FAIL: clipped samples" : "no clipping");
+    return clipped ? 1 : 0;
+}
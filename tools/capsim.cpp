@@ -0,0 +1,418 @@
+// ============== MIC CAPTURE SIMULATION ==============
+//
+// Offline tool: simulates the firmware's task scheduling on both cores with a
+// saturated downlink, and counts what happens to the mic. It compares the old
+// path, where audioTask read I2S_NUM_0 itself, with micCaptureTask feeding
+// micRing, running the firmware's MicCapture (src/MicCapture.h) for the
+// latter.
+//
+// Build and run on the host:
+//
+//   g++ -std=c++17 -O2 -Isrc -o capsim tools/capsim.cpp src/MicCapture.cpp
+//   ./capsim [--seconds S] [--spk-us U] [--ws-load F] [--proc-us U] [--kws-us U]
+//
+// Model (10us steps, fixed-priority preemption per core, 1ms RTOS tick):
+//   mic DMA   the DMA_PROFILES buffers (TALK 8 x 160 words, STREAM 8 x 512).
+//             The driver keeps count - 1 filled buffers and drops the oldest
+//             beyond that (I2S_EVENT_RX_Q_OVF).
+//   CORE_1    speakerTask (4): --spk-us per 21.3ms speaker DMA buffer
+//             websocketTask (3): the downlink. --ws-load of the core in
+//               slices about 2ms apart, plus a backlog burst every 2s (TCP catching up after a
+//               WiFi stall). The burst length is swept.
+//             audioTask (2): --proc-us per frame (AGC, echo canceller, noise
+//               suppressor), plus --kws-us every 4th frame while the wake word
+//               runs
+//   CORE_0    WiFi/lwIP (20): 150us about every 5ms, every 0.5ms during a burst
+//             micCaptureTask (5): 40us per RX_DONE plus 15us per frame
+//             ledTask (1): 4ms every 33ms
+//   old       audioTask reads I2S_NUM_0 itself: listening polls every 5ms
+//             (vTaskDelay), recording blocks in i2s_read for a whole frame.
+//   new       micCaptureTask -> micRing (MIC_RING_BYTES) -> audioTask.
+//
+// Background intervals vary by +-50% (fixed seed), so nothing phase-locks
+// to the DMA. The costs are estimates, not device measurements; pass measured ones as
+// flags. For each scenario and burst length it prints the mic frames dropped,
+// the error of the frame stamps the echo canceller aligns on (stamp minus the
+// true capture time of the frame's last sample), the stamp jitter
+// (frame-to-frame spread), and how long frames wait before audioTask has
+// processed them.
+//
+// =====================================================
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <queue>
+#include <random>
+#include <vector>
+#include "MicCapture.h"
+
+#define STEP_US        10
+#define TICK_US        1000
+#define RATE           MIC_CAPTURE_RATE
+#define FRAME          MIC_CAPTURE_FRAME
+#define SPK_BUF_US     21333       // 512 frames at 24 kHz
+#define BURST_EVERY_US 2000000
+
+struct Costs {
+    int64_t spk = 700, proc = 2500, kws = 6000;
+    double wsLoad = 0.15;
+};
+
+static int64_t sampleUs(int64_t idx) { return idx * 1000000 / RATE; }
+
+// ---- Scheduler ----
+
+struct Job {
+    int64_t left;
+    std::function<void(int64_t)> done;
+};
+
+struct Task {
+    int core, prio;
+    std::deque<Job> jobs;
+    bool busy() const { return !jobs.empty(); }
+    void add(int64_t cost, std::function<void(int64_t)> done = nullptr) { jobs.push_back({cost, std::move(done)}); }
+};
+
+struct Sim {
+    int64_t now = 0;
+    std::vector<Task*> tasks;
+    std::priority_queue<std::pair<int64_t, int>, std::vector<std::pair<int64_t, int>>, std::greater<>> timers;
+    std::vector<std::function<void(int64_t)>> timerFns;
+
+    void at(int64_t t, std::function<void(int64_t)> fn) {
+        timerFns.push_back(std::move(fn));
+        timers.push({t, (int)timerFns.size() - 1});
+    }
+    void step() {
+        while (!timers.empty() && timers.top().first <= now) {
+            int i = timers.top().second;
+            timers.pop();
+            auto fn = std::move(timerFns[i]);
+            fn(now);
+        }
+        for (int core = 0; core < 2; core++) {
+            Task* run = nullptr;
+            for (Task* t : tasks) {
+                if (t->core == core && t->busy() && (!run || t->prio > run->prio)) run = t;
+            }
+            if (!run) continue;
+            Job& j = run->jobs.front();
+            j.left -= STEP_US;
+            if (j.left <= 0) {
+                auto done = std::move(j.done);
+                run->jobs.pop_front();
+                if (done) done(now + STEP_US);
+            }
+        }
+        now += STEP_US;
+    }
+};
+
+// ---- Mic DMA (legacy I2S RX driver) ----
+
+struct Dma {
+    struct Buf { int64_t first; int words; int used; };
+    int len, count;
+    int64_t next = 0;            // index of the next sample to be captured
+    std::deque<Buf> filled;
+    int64_t lostWords = 0;
+    std::function<void(int64_t, bool)> onDone;   // (now, overflowed)
+
+    int64_t nextDoneUs() const { return sampleUs(next + len); }
+    void complete(int64_t now) {
+        bool ovf = (int)filled.size() >= count - 1;
+        if (ovf) {
+            lostWords += filled.front().words - filled.front().used;
+            filled.pop_front();
+        }
+        filled.push_back({next, len, 0});
+        next += len;
+        if (onDone) onDone(now, ovf);
+    }
+    int available() const {
+        int n = 0;
+        for (auto& b : filled) n += b.words - b.used;
+        return n;
+    }
+    // Copy out up to n words; *lastIdx is the sample index of the last one
+    int read(int n, int64_t* lastIdx) {
+        int got = 0;
+        while (got < n && !filled.empty()) {
+            Buf& b = filled.front();
+            int take = std::min(n - got, b.words - b.used);
+            b.used += take;
+            got += take;
+            *lastIdx = b.first + b.used - 1;
+            if (b.used == b.words) filled.pop_front();
+        }
+        return got;
+    }
+};
+
+// ---- Results ----
+
+struct Stats {
+    int64_t expected = 0, dropped = 0;
+    std::vector<double> stampErr, waitUs;
+    int32_t devJitterMean = -1, devJitterMax = -1;   // MicCapture's own view (new path)
+    size_t ringPeak = 0;                              // micRing high-water mark in frames (new path)
+    std::vector<double> stamps;
+
+    void frame(int64_t stampUs, int64_t lastIdx) {
+        stampErr.push_back((double)(stampUs - sampleUs(lastIdx + 1)));
+        stamps.push_back((double)stampUs);
+    }
+    static double pct(std::vector<double> v, double p) {
+        if (v.empty()) return 0;
+        std::sort(v.begin(), v.end());
+        return v[std::min(v.size() - 1, (size_t)(v.size() * p))];
+    }
+    double jitterSd() const {
+        if (stamps.size() < 3) return 0;
+        double m = 0, s = 0;
+        size_t n = 0;
+        for (size_t i = 1; i < stamps.size(); i++) {
+            double d = stamps[i] - stamps[i - 1];
+            if (d > 1.5 * FRAME * 1e6 / RATE) continue;   // across a gap
+            m += d;
+            s += d * d;
+            n++;
+        }
+        m /= n;
+        return sqrt(std::max(0.0, s / n - m * m));
+    }
+};
+
+enum Mode { LISTEN, RECORD };
+
+struct Scenario {
+    const char* name;
+    int dmaLen, dmaCount;
+    Mode mode;
+    bool kws;
+};
+
+static Stats run(const Scenario& sc, bool newPath, int64_t burstUs, int64_t seconds, const Costs& c) {
+    Sim sim;
+    Task wifi{0, 20, {}}, capture{0, 5, {}}, led{0, 1, {}};
+    Task speaker{1, 4, {}}, ws{1, 3, {}}, audio{1, 2, {}};
+    sim.tasks = {&wifi, &capture, &led, &speaker, &ws, &audio};
+    Dma dma{sc.dmaLen, sc.dmaCount, 0, {}, 0, nullptr};
+    Stats st;
+    std::mt19937 rng(7);
+    auto around = [&](int64_t us) { return us / 2 + (int64_t)(rng() % (uint32_t)us); };
+    const int64_t endUs = seconds * 1000000;
+    const int64_t bufUs = (int64_t)sc.dmaLen * 1000000 / RATE;
+
+    // Background load
+    std::function<void(int64_t)> spkTick = [&](int64_t t) {
+        speaker.add(c.spk);
+        sim.at(t + SPK_BUF_US, spkTick);
+    };
+    sim.at(0, spkTick);
+    std::function<void(int64_t)> wsTick = [&](int64_t t) {
+        ws.add((int64_t)(2000 * c.wsLoad));
+        sim.at(t + around(2000), wsTick);
+    };
+    sim.at(0, wsTick);
+    int64_t burstUntil = -1;
+    std::function<void(int64_t)> burst = [&](int64_t t) {
+        if (burstUs > 0) {
+            ws.add(burstUs);
+            burstUntil = t + burstUs;
+        }
+        sim.at(t + BURST_EVERY_US, burst);
+    };
+    sim.at(BURST_EVERY_US / 2, burst);
+    std::function<void(int64_t)> wifiTick = [&](int64_t t) {
+        wifi.add(150);
+        sim.at(t + around(t < burstUntil ? 500 : 5000), wifiTick);
+    };
+    sim.at(0, wifiTick);
+    std::function<void(int64_t)> ledTick = [&](int64_t t) {
+        led.add(4000);
+        sim.at(t + 33000, ledTick);
+    };
+    sim.at(0, ledTick);
+
+    int frames = 0;
+    auto procCost = [&]() { return c.proc + (sc.kws && (frames++ % 4 == 0) ? c.kws : 0); };
+
+    // micRing capacity in frames: AudioRing rounds down to a power of two and adds a header per frame
+    size_t ringCap = 1;
+    while (ringCap * 2 <= MIC_RING_BYTES) ringCap *= 2;
+    const size_t ringFrames = ringCap / (4 + ((sizeof(MicFrame) + 3) & ~(size_t)3)) - 1;
+    struct Queued { int64_t trueEndUs; };
+    std::deque<Queued> ring;
+    MicCapture cap;
+    // Task state, alive for the whole run: the jobs and timers refer to it
+    std::deque<bool> events;   // micCaptureTask's I2S event queue, true = RX_Q_OVF
+    std::function<void()> drain, readJob;
+    std::function<void(int64_t)> poll;
+    int fill = 0;
+    bool waiting = true, pending = false;
+    int64_t lastIdx = 0;
+
+    // audioTask on the new path: one job per frame in micRing
+    std::function<void()> consume = [&]() {
+        if (audio.busy() || ring.empty()) return;
+        audio.add(procCost(), [&](int64_t t) {
+            st.waitUs.push_back((double)(t - ring.front().trueEndUs));
+            ring.pop_front();
+            consume();
+        });
+    };
+
+    if (newPath) {
+        // micCaptureTask: one RX_DONE / RX_Q_OVF event per DMA completion
+        drain = [&]() {
+            if (capture.busy() || events.empty()) return;
+            capture.add(40, [&](int64_t t) {
+                bool ovf = events.front();
+                events.pop_front();
+                if (ovf) {
+                    cap.overflow(sc.dmaLen);
+                    drain();
+                    return;
+                }
+                static int32_t words[512];   // MIC_DMA_BUF_LEN_MAX
+                int n = dma.read(sc.dmaLen, &lastIdx);
+                int64_t first = lastIdx - n + 1;
+                int64_t stamp = t - (int64_t)events.size() * bufUs;
+                int written = 0;
+                for (int off = 0; off < n;) {
+                    off += (int)cap.push(words + off, n - off, stamp);
+                    if (cap.ready()) {
+                        bool room = ring.size() < ringFrames;
+                        if (room) {
+                            st.frame(cap.frame().endUs, first + off - 1);
+                            ring.push_back({sampleUs(first + off)});
+                            st.ringPeak = std::max(st.ringPeak, ring.size());
+                        }
+                        cap.next(room);
+                        written++;
+                    }
+                }
+                consume();
+                // The ring writes, before the next event
+                capture.add(15 * written, [&](int64_t) { drain(); });
+            });
+        };
+        dma.onDone = [&](int64_t, bool ovf) {
+            if (events.size() < (size_t)sc.dmaCount + 4) {
+                if (ovf) events.push_back(true);
+                events.push_back(false);
+            }
+            drain();
+        };
+    } else if (sc.mode == LISTEN) {
+        // audioTask polls: non-blocking read, process a whole frame, vTaskDelay(5)
+        poll = [&](int64_t) {
+            audio.add(30, [&](int64_t t) {
+                fill += dma.read(FRAME - fill, &lastIdx);
+                auto sleep = [&](int64_t t2) { sim.at((t2 / TICK_US + 5) * TICK_US, poll); };
+                if (fill < FRAME) {
+                    sleep(t);
+                    return;
+                }
+                fill = 0;
+                st.frame(t, lastIdx);
+                int64_t trueEnd = sampleUs(lastIdx + 1);
+                audio.add(procCost(), [&, trueEnd, sleep](int64_t t2) {
+                    st.waitUs.push_back((double)(t2 - trueEnd));
+                    sleep(t2);
+                });
+            });
+        };
+        sim.at(0, poll);
+    } else {
+        // audioTask blocks in i2s_read until a whole frame has arrived
+        readJob = [&]() {
+            if (!waiting || pending || dma.available() == 0) return;
+            pending = true;
+            audio.add(30, [&](int64_t t) {
+                pending = false;
+                fill += dma.read(FRAME - fill, &lastIdx);
+                if (fill < FRAME) {
+                    readJob();
+                    return;
+                }
+                fill = 0;
+                waiting = false;
+                st.frame(t, lastIdx);
+                int64_t trueEnd = sampleUs(lastIdx + 1);
+                audio.add(procCost(), [&, trueEnd](int64_t t2) {
+                    st.waitUs.push_back((double)(t2 - trueEnd));
+                    waiting = true;
+                    readJob();
+                });
+            });
+        };
+        dma.onDone = [&](int64_t, bool) { readJob(); };
+    }
+
+    while (sim.now < endUs) {
+        while (dma.nextDoneUs() <= sim.now) dma.complete(sim.now);
+        sim.step();
+    }
+
+    st.expected = dma.next / FRAME;
+    if (newPath) {
+        st.dropped = cap.framesDropped();
+        st.devJitterMean = cap.jitterMeanUs();
+        st.devJitterMax = cap.jitterMaxUs();
+    } else {
+        st.dropped = (dma.lostWords + FRAME - 1) / FRAME;
+    }
+    return st;
+}
+
+int main(int argc, char** argv) {
+    Costs c;
+    int64_t seconds = 120;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--seconds") && i + 1 < argc) seconds = atoll(argv[++i]);
+        else if (!strcmp(argv[i], "--spk-us") && i + 1 < argc) c.spk = atoll(argv[++i]);
+        else if (!strcmp(argv[i], "--ws-load") && i + 1 < argc) c.wsLoad = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--proc-us") && i + 1 < argc) c.proc = atoll(argv[++i]);
+        else if (!strcmp(argv[i], "--kws-us") && i + 1 < argc) c.kws = atoll(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s [--seconds S] [--spk-us U] [--ws-load F] [--proc-us U] [--kws-us U]\n", argv[0]);
+            return 2;
+        }
+    }
+    const Scenario scenarios[] = {
+        {"listen over a Gemini response (TALK)", 160, 8, LISTEN, false},
+        {"wake word over radio (STREAM)",        512, 8, LISTEN, true},
+        {"recording (TALK)",                     160, 8, RECORD, false},
+    };
+    const int64_t bursts[] = {0, 50, 100, 200, 400};
+    printf("CORE_1: speaker %lld us / 21.3ms, websocket %.0f%% + a burst every 2s, audioTask %lld us / frame (+%lld us KWS every 4th)\n",
+           (long long)c.spk, c.wsLoad * 100, (long long)c.proc, (long long)c.kws);
+    for (const Scenario& sc : scenarios) {
+        printf("\n%s, %llds\n", sc.name, (long long)seconds);
+        printf("  burst   path  dropped frames    stamp error us (mean/p99/max)   jitter sd us   wait to processed ms (p99/max)\n");
+        for (int64_t b : bursts) {
+            for (int np = 0; np < 2; np++) {
+                Stats st = run(sc, np, b * 1000, seconds, c);
+                double mean = 0;
+                for (double e : st.stampErr) mean += e;
+                mean /= std::max<size_t>(1, st.stampErr.size());
+                printf("  %4lldms  %-4s  %6lld (%5.2f%%)   %7.0f / %7.0f / %7.0f        %8.0f      %6.1f / %6.1f",
+                       (long long)b, np ? "new" : "old", (long long)st.dropped, 100.0 * st.dropped / std::max<int64_t>(1, st.expected),
+                       mean, Stats::pct(st.stampErr, 0.99), Stats::pct(st.stampErr, 1.0), st.jitterSd(),
+                       Stats::pct(st.waitUs, 0.99) / 1000, Stats::pct(st.waitUs, 1.0) / 1000);
+                if (np) printf("   (MicCapture %d / %d us, ring peak %zu)", st.devJitterMean, st.devJitterMax, st.ringPeak);
+                printf("\n");
+            }
+        }
+    }
+    return 0;
+}
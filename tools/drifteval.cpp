@@ -0,0 +1,180 @@
+// ============== DRIFT RESAMPLER EVALUATION ==============
+//
+// Offline tool: runs the firmware's DriftResampler (src/DriftResampler.h)
+// against a radio stream whose clock is off from the speaker's, and checks
+// that the ambient ring settles without underruns or overruns.
+//
+// Build and run on the host:
+//
+//   g++ -std=c++17 -O2 -Itools/host -Isrc -o drifteval tools/drifteval.cpp src/DriftResampler.cpp
+//   ./drifteval [--minutes M] [--jitter MS] [--ppm P ...]
+//
+// Model: the station delivers 1024-byte PCM packets (the server's radio
+// CHUNK_SIZE) at 24 kHz x (1 + ppm), each up to --jitter ms late (default
+// 40, uniform); a packet that finds the ring full is an overrun (on the
+// device, websocketTask blocks and TCP backs up). speakerTask takes 512-frame
+// blocks at exactly 24 kHz, steering with the ring fill plus the frame in
+// hand as AudioMixer does; a block the ring cannot fill is an underrun. The
+// ring holds AUDIO_RING_BYTES less the per-packet headers. The stream starts
+// after 150ms of prebuffer.
+//
+// For each drift it runs the controller and, for comparison, the resampler
+// held at 1.0. It prints the fill every 5 minutes, then the fill range and
+// ratio over the part after the first 10 minutes (settled), and the
+// underrun / overrun counts. The default run is +-200 ppm, the requirement;
+// it exits non-zero if the controller has a single underrun or overrun there,
+// or settles more than 100ms off DRIFT_TARGET_MS.
+//
+// ========================================================
+
+#include "DriftResampler.h"
+#include "AudioRing.h"
+
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static const int RATE = 24000;
+static const int BLOCK = 512;
+static const int PACKET_SAMPLES = 512;     // 1024 bytes
+static const int RING_SAMPLES = (AUDIO_RING_BYTES / (PACKET_SAMPLES * 2 + 4)) * PACKET_SAMPLES;
+static const int PREBUFFER_MS = 150;
+
+struct Result {
+    std::vector<float> checkpoints;        // fill (ms) every 5 minutes
+    float settledMin = 1e9f, settledMax = -1e9f;
+    float ppmMin = 1e9f, ppmMax = -1e9f;
+    uint32_t underruns = 0, overruns = 0;
+};
+
+static Result run(double ppm, int minutes, int jitterMs, bool control) {
+    DriftResampler rs;
+    rs.reset();
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<double> late(0.0, jitterMs / 1000.0);
+
+    // Payload stands in for audio; only counts matter here
+    std::vector<int16_t> packet(PACKET_SAMPLES, 1000);
+    std::deque<int> ring;                  // samples per queued packet
+    int ringSamples = 0;
+    int curLeft = 0;                       // samples of the frame in hand
+    int16_t out[BLOCK];
+
+    const double packetPeriod = PACKET_SAMPLES / (RATE * (1.0 + ppm * 1e-6));
+    const double blockPeriod = (double)BLOCK / RATE;
+    const double endS = minutes * 60.0;
+    double nextSend = 0.0;                 // station clock
+    std::deque<double> inFlight;           // arrival times, in order (TCP)
+    double lastArrival = 0.0;
+    double startS = -1.0;
+    double nextCheckpoint = 300.0;
+
+    Result r;
+    for (double t = 0.0; t < endS + blockPeriod; t += blockPeriod) {
+        // Packets that have arrived by now
+        while (nextSend <= t + 1.0) {
+            double a = std::max(lastArrival, nextSend + late(rng));
+            inFlight.push_back(a);
+            lastArrival = a;
+            nextSend += packetPeriod;
+        }
+        while (!inFlight.empty() && inFlight.front() <= t) {
+            inFlight.pop_front();
+            if (ringSamples + PACKET_SAMPLES > RING_SAMPLES) {
+                r.overruns++;
+                continue;
+            }
+            ring.push_back(PACKET_SAMPLES);
+            ringSamples += PACKET_SAMPLES;
+        }
+        if (startS < 0.0) {
+            if (ringSamples < PREBUFFER_MS * RATE / 1000) continue;
+            startS = t;
+        }
+
+        uint32_t fillMs = (uint32_t)((ringSamples + curLeft) / (RATE / 1000));
+        if (control) rs.steer(fillMs, BLOCK);
+        else rs.hold();
+
+        int produced = 0;
+        while (produced < BLOCK) {
+            if (curLeft == 0) {
+                if (ring.empty()) break;
+                curLeft = ring.front();
+                ring.pop_front();
+                ringSamples -= curLeft;
+            }
+            int used = 0;
+            const int16_t* src = packet.data() + (PACKET_SAMPLES - curLeft);
+            produced += rs.process(src, curLeft, out + produced, BLOCK - produced, &used);
+            curLeft -= used;
+        }
+        if (produced < BLOCK) r.underruns++;
+
+        float fill = (float)(ringSamples + curLeft) * 1000.0f / RATE;
+        if (t >= nextCheckpoint) {
+            r.checkpoints.push_back(fill);
+            nextCheckpoint += 300.0;
+        }
+        if (t - startS >= 600.0) {
+            r.settledMin = std::min(r.settledMin, fill);
+            r.settledMax = std::max(r.settledMax, fill);
+            r.ppmMin = std::min(r.ppmMin, rs.ppm());
+            r.ppmMax = std::max(r.ppmMax, rs.ppm());
+        }
+    }
+    return r;
+}
+
+static void print(const char* label, const Result& r) {
+    printf("  %-10s", label);
+    for (float f : r.checkpoints) printf(" %5.0f", f);
+    if (r.settledMax >= r.settledMin) {
+        printf("   settled %4.0f..%4.0fms", r.settledMin, r.settledMax);
+        if (r.ppmMax >= r.ppmMin && (r.ppmMin != 0.0f || r.ppmMax != 0.0f))
+            printf(" at %+5.0f..%+5.0f ppm", r.ppmMin, r.ppmMax);
+    }
+    printf("   under %u  over %u\n", r.underruns, r.overruns);
+}
+
+int main(int argc, char** argv) {
+    int minutes = 60;
+    int jitterMs = 40;
+    std::vector<double> drifts;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--minutes") && i + 1 < argc) minutes = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--jitter") && i + 1 < argc) jitterMs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--ppm") && i + 1 < argc) drifts.push_back(atof(argv[++i]));
+        else {
+            fprintf(stderr, "usage: %s [--minutes M] [--jitter MS] [--ppm P ...]\n", argv[0]);
+            return 2;
+        }
+    }
+    bool requirement = drifts.empty();
+    if (requirement) drifts = { 200.0, -200.0 };
+    if (minutes < 11) minutes = 11;
+
+    printf("ring %d ms, target %d ms, packets %d ms late at most, %d minutes\n",
+           RING_SAMPLES * 1000 / RATE, DRIFT_TARGET_MS, jitterMs, minutes);
+    printf("  %-10s", "fill (ms)");
+    for (int m = 5; m <= minutes; m += 5) printf(" %4dm", m);
+    printf("\n");
+
+    int failures = 0;
+    for (double ppm : drifts) {
+        printf("station %+.0f ppm\n", ppm);
+        Result on = run(ppm, minutes, jitterMs, true);
+        Result off = run(ppm, minutes, jitterMs, false);
+        print("steered", on);
+        print("held 1.0", off);
+        bool ok = on.underruns == 0 && on.overruns == 0 &&
+                  on.settledMin >= DRIFT_TARGET_MS - 100 && on.settledMax <= DRIFT_TARGET_MS + 100;
+        if (requirement && !ok) failures++;
+    }
+    if (requirement) printf("\n+-200 ppm: %s\n", failures ? "FAIL" : "pass");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,188 @@
+// ============== ENDPOINTER EVALUATION ==============
+//
+// Offline tool: replays labeled recordings through the firmware's Endpointer
+// (src/Endpointer.h) and through the fixed rule it replaced. It reports how
+// long after the end of speech each one ends the turn, and how often it ends
+// the turn before the speaker has finished (truncation).
+//
+// Build and run on the host:
+//
+//   g++ -std=c++17 -O2 -Isrc -o epeval tools/epeval.cpp src/Endpointer.cpp
+//   ./epeval [--gain G] [--silence-ms MS] [--threshold T] session1.wav session2.wav ...
+//
+// Each session is one user turn: 16 kHz mono 16-bit WAV, starting when the
+// recording would start and running on for at least 1.5s of room noise after
+// the speaker stops. Next to it, session1.txt holds the speech segments as
+// Audacity labels ("start<TAB>end[<TAB>text]" in seconds, one per line). Only
+// the end of the last segment matters: it is where the turn really ends.
+//
+// Sessions are replayed in order through one Endpointer, so learned pauses
+// carry over as they do on the device. Record with the device's own mic
+// chain, or pass --gain 16 for raw INMP441 captures (MicAgc starts at 16x).
+// --silence-ms and --threshold are VAD_SILENCE_MS and VAD_THRESHOLD.
+//
+// ===================================================
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "Endpointer.h"
+
+static const int SAMPLE_RATE = 16000;
+static const int FRAME = 320;
+
+static bool readWav(const char* path, std::vector<int16_t>& pcm) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    uint8_t hdr[12];
+    bool ok = fread(hdr, 1, 12, f) == 12 && !memcmp(hdr, "RIFF", 4) && !memcmp(hdr + 8, "WAVE", 4);
+    bool fmtOk = false;
+    while (ok) {
+        uint8_t ch[8];
+        if (fread(ch, 1, 8, f) != 8) break;
+        uint32_t len = ch[4] | (ch[5] << 8) | (ch[6] << 16) | ((uint32_t)ch[7] << 24);
+        if (!memcmp(ch, "fmt ", 4)) {
+            std::vector<uint8_t> fmt(len);
+            if (fread(fmt.data(), 1, len, f) != len || len < 16) break;
+            uint16_t format = fmt[0] | (fmt[1] << 8), channels = fmt[2] | (fmt[3] << 8), bits = fmt[14] | (fmt[15] << 8);
+            uint32_t rate = fmt[4] | (fmt[5] << 8) | (fmt[6] << 16) | ((uint32_t)fmt[7] << 24);
+            fmtOk = format == 1 && channels == 1 && bits == 16 && rate == SAMPLE_RATE;
+            if (!fmtOk) {
+                fprintf(stderr, "%s: need 16 kHz mono 16-bit PCM\n", path);
+                break;
+            }
+        } else if (!memcmp(ch, "data", 4) && fmtOk) {
+            pcm.resize(len / 2);
+            size_t got = fread(pcm.data(), 2, pcm.size(), f);
+            pcm.resize(got);
+            fclose(f);
+            return true;
+        } else {
+            fseek(f, len + (len & 1), SEEK_CUR);
+        }
+    }
+    fclose(f);
+    if (!fmtOk) fprintf(stderr, "%s: not a usable WAV file\n", path);
+    return false;
+}
+
+// End of the last labeled speech segment, in ms (-1 if there is none)
+static double speechEndMs(const char* wavPath) {
+    std::string path(wavPath);
+    size_t dot = path.rfind('.');
+    path = path.substr(0, dot) + ".txt";
+    FILE* f = fopen(path.c_str(), "r");
+    if (!f) {
+        perror(path.c_str());
+        return -1;
+    }
+    double end = -1, a, b;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "%lf %lf", &a, &b) == 2) end = std::max(end, b * 1000.0);
+    }
+    fclose(f);
+    return end;
+}
+
+struct Result {
+    double endpointMs = -1;   // -1: never ended inside the recording
+};
+
+struct Summary {
+    const char* name;
+    std::vector<double> delays;
+    int truncated = 0;
+    int missed = 0;
+
+    void add(double endpointMs, double speechEnd) {
+        if (endpointMs < 0) missed++;
+        else if (endpointMs < speechEnd) truncated++;
+        else delays.push_back(endpointMs - speechEnd);
+    }
+    void print(int sessions) {
+        std::sort(delays.begin(), delays.end());
+        double mean = 0;
+        for (double d : delays) mean += d;
+        if (!delays.empty()) mean /= delays.size();
+        printf("%-10s delay mean %5.0f ms  median %5.0f ms  p90 %5.0f ms | truncated %d/%d (%.1f%%) | no endpoint %d\n",
+               name, mean, delays.empty() ? 0.0 : delays[delays.size() / 2],
+               delays.empty() ? 0.0 : delays[delays.size() * 9 / 10], truncated, sessions,
+               100.0 * truncated / sessions, missed);
+    }
+};
+
+int main(int argc, char** argv) {
+    float gain = 1;
+    uint32_t silenceMs = 1200;
+    int threshold = 700;
+    std::vector<const char*> files;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--gain") && i + 1 < argc) gain = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--silence-ms") && i + 1 < argc) silenceMs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--threshold") && i + 1 < argc) threshold = atoi(argv[++i]);
+        else files.push_back(argv[i]);
+    }
+    if (files.empty()) {
+        fprintf(stderr, "usage: %s [--gain G] [--silence-ms MS] [--threshold T] session.wav...\n", argv[0]);
+        return 2;
+    }
+
+    Endpointer ep;
+    ep.begin(silenceMs);
+    Summary fixed{"fixed", {}, 0, 0}, adaptive{"adaptive", {}, 0, 0};
+    int sessions = 0;
+    printf("%-32s %8s %10s %10s %9s\n", "session", "speech", "fixed", "adaptive", "hangover");
+    for (const char* file : files) {
+        std::vector<int16_t> pcm;
+        double speechEnd = speechEndMs(file);
+        if (!readWav(file, pcm) || speechEnd < 0) continue;
+        for (int16_t& s : pcm) s = (int16_t)std::max(-32768.0f, std::min(32767.0f, s * gain));
+
+        // Fixed rule: 3 consecutive frames with mean |sample| > threshold, then silenceMs
+        Result r0, r1;
+        uint32_t lastVoice = 0;
+        int consecutive = 0;
+        for (size_t k = 0; (k + 1) * FRAME <= pcm.size(); k++) {
+            uint32_t t = (k + 1) * 20;
+            int32_t sum = 0;
+            for (int i = 0; i < FRAME; i++) sum += abs(pcm[k * FRAME + i]);
+            consecutive = sum / FRAME > threshold ? consecutive + 1 : 0;
+            if (consecutive >= 3) lastVoice = t;
+            if (t - lastVoice > silenceMs) {
+                r0.endpointMs = t;
+                break;
+            }
+        }
+
+        // Endpointer, exactly as audioTask + loop() use it
+        ep.beginTurn();
+        lastVoice = 0;
+        for (size_t k = 0; (k + 1) * FRAME <= pcm.size(); k++) {
+            uint32_t t = (k + 1) * 20;
+            if (ep.process(&pcm[k * FRAME], FRAME)) lastVoice = t;
+            if (t - lastVoice > ep.silenceMs()) {
+                r1.endpointMs = t;
+                break;
+            }
+        }
+
+        const char* base = strrchr(file, '/') ? strrchr(file, '/') + 1 : file;
+        printf("%-32s %6.0fms %8.0fms %8.0fms %7ums\n", base, speechEnd, r0.endpointMs, r1.endpointMs, ep.hangoverMs());
+        fixed.add(r0.endpointMs, speechEnd);
+        adaptive.add(r1.endpointMs, speechEnd);
+        sessions++;
+    }
+    if (!sessions) return 1;
+    printf("\n%d sessions\n", sessions);
+    fixed.print(sessions);
+    adaptive.print(sessions);
+    return 0;
+}
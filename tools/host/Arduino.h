@@ -0,0 +1,46 @@
+#pragma once
+
+// ============== HOST SHIMS ==============
+//
+// Just enough of Arduino, FreeRTOS and ESP-IDF for the firmware modules that
+// touch them (AudioRing, JitterBuffer) to build into the host tools. Tasks are std::threads,
+// a tick is 1ms, task notifications and queues are a mutex + condition
+// variable. Timing through these is not the ESP32's: tools that use them
+// compare designs against each other on the same host, never to budgets.
+//
+// Add -Itools/host to the tool's build line.
+//
+// ========================================
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+using std::min;
+using std::max;
+
+#define IRAM_ATTR
+
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+
+inline uint32_t millis() {
+    static const auto t0 = std::chrono::steady_clock::now();
+    return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - t0).count();
+}
+
+inline void delay(uint32_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+struct HostSerial {
+    template <typename... A>
+    int printf(const char* fmt, A... a) { return ::printf(fmt, a...); }
+    void println(const char* s) { ::puts(s); }
+};
+inline HostSerial Serial;
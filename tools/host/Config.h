@@ -0,0 +1,5 @@
+#pragma once
+
+// Host shim (see Arduino.h): the example configuration, for modules that read
+// MIC_FRAME_SIZE, VAD_THRESHOLD and friends from Config.h
+#include "../../src/Config.h.example"
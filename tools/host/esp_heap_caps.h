@@ -0,0 +1,11 @@
+#pragma once
+
+// Host shim (see Arduino.h): every capability is plain heap
+#include <stdlib.h>
+
+#define MALLOC_CAP_SPIRAM   (1 << 10)
+#define MALLOC_CAP_8BIT     (1 << 2)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+
+inline void* heap_caps_malloc(size_t size, uint32_t) { return malloc(size); }
+inline void  heap_caps_free(void* p) { free(p); }
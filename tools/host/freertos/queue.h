@@ -0,0 +1,56 @@
+#pragma once
+
+// Host shim (see Arduino.h): a FreeRTOS queue copies items in and out by
+// value, as the real one does
+#include "FreeRTOS.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdlib.h>
+#include <string.h>
+
+struct HostQueue {
+    std::mutex m;
+    std::condition_variable notEmpty, notFull;
+    uint8_t* items;
+    UBaseType_t length, itemSize, head = 0, count = 0;
+};
+typedef HostQueue* QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    QueueHandle_t q = new HostQueue;
+    q->items = (uint8_t*)malloc((size_t)length * itemSize);
+    q->length = length;
+    q->itemSize = itemSize;
+    return q;
+}
+
+inline void vQueueDelete(QueueHandle_t q) { free(q->items); delete q; }
+
+inline BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t wait) {
+    std::unique_lock<std::mutex> lock(q->m);
+    if (!q->notFull.wait_for(lock, std::chrono::milliseconds(wait), [q] { return q->count < q->length; }))
+        return pdFALSE;
+    memcpy(q->items + (size_t)((q->head + q->count) % q->length) * q->itemSize, item, q->itemSize);
+    q->count++;
+    lock.unlock();
+    q->notEmpty.notify_one();
+    return pdTRUE;
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t q, void* item, TickType_t wait) {
+    std::unique_lock<std::mutex> lock(q->m);
+    if (!q->notEmpty.wait_for(lock, std::chrono::milliseconds(wait), [q] { return q->count > 0; }))
+        return pdFALSE;
+    memcpy(item, q->items + (size_t)q->head * q->itemSize, q->itemSize);
+    q->head = (q->head + 1) % q->length;
+    q->count--;
+    lock.unlock();
+    q->notFull.notify_one();
+    return pdTRUE;
+}
+
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) {
+    std::lock_guard<std::mutex> lock(q->m);
+    return q->count;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+// Host shim (see Arduino.h): every std::thread gets a task handle on first
+// use, with a counting notification like xTaskNotifyGive/ulTaskNotifyTake.
+#include "FreeRTOS.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+struct HostTask {
+    std::mutex m;
+    std::condition_variable cv;
+    uint32_t notified = 0;
+};
+typedef HostTask* TaskHandle_t;
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() {
+    static thread_local HostTask self;
+    return &self;
+}
+
+inline TickType_t xTaskGetTickCount() {
+    static const auto t0 = std::chrono::steady_clock::now();
+    return (TickType_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - t0).count();
+}
+
+inline void vTaskDelay(TickType_t ticks) { std::this_thread::sleep_for(std::chrono::milliseconds(ticks)); }
+
+inline BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    {
+        std::lock_guard<std::mutex> lock(task->m);
+        task->notified++;
+    }
+    task->cv.notify_one();
+    return pdPASS;
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t wait) {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    std::unique_lock<std::mutex> lock(self->m);
+    auto ready = [self] { return self->notified != 0; };
+    if (wait == portMAX_DELAY) self->cv.wait(lock, ready);
+    else self->cv.wait_for(lock, std::chrono::milliseconds(wait), ready);
+    uint32_t n = self->notified;
+    if (n) self->notified = clearOnExit ? 0 : n - 1;
+    return n;
+}
@@ -0,0 +1,46 @@
+// ============== IMA-ADPCM SERVER VECTORS ==============
+//
+// Offline tool: encodes a PCM file with the server's own IMA-ADPCM encoder
+// (server/codec.ts, the code main.ts sends ambient, radio and speech with)
+// and decodes the result with the server's decoder (the mic uplink path),
+// for tools/imaeval.cpp to compare against the firmware's codec, bit for bit.
+//
+//   ./imaeval --write /tmp/ima.pcm
+//   deno run --allow-read --allow-write tools/imaencode.ts /tmp/ima.pcm /tmp/ima.blocks [BLOCK_SAMPLES]
+//   ./imaeval --server /tmp/ima.blocks
+//
+// IN is 16-bit LE mono PCM. OUT gets the blocks back to back, one per
+// BLOCK_SAMPLES (default 512, the ambient chunk), with the encoder state
+// carried from block to block as main.ts does; OUT.pcm gets OUT decoded again
+// block by block.
+//
+// =====================================================
+
+import { type ImaState, imaDecodeBlock, imaEncodeBlock } from "../server/codec.ts";
+
+const [inPath, outPath, blockArg] = Deno.args;
+if (!inPath || !outPath) {
+  console.error("usage: imaencode.ts IN.pcm OUT [BLOCK_SAMPLES]");
+  Deno.exit(2);
+}
+const blockBytes = (blockArg ? parseInt(blockArg) : 512) * 2;
+
+const pcm = await Deno.readFile(inPath);
+const state: ImaState = { predictor: 0, index: 0 };
+const blocks: Uint8Array[] = [];
+const decoded: Uint8Array[] = [];
+for (let offset = 0; offset < pcm.length; offset += blockBytes) {
+  const block = imaEncodeBlock(pcm.subarray(offset, Math.min(offset + blockBytes, pcm.length)), state);
+  blocks.push(block);
+  decoded.push(imaDecodeBlock(block)!);
+}
+
+const concat = (parts: Uint8Array[]) => {
+  const out = new Uint8Array(parts.reduce((n, p) => n + p.length, 0));
+  let at = 0;
+  for (const p of parts) { out.set(p, at); at += p.length; }
+  return out;
+};
+await Deno.writeFile(outPath, concat(blocks));
+await Deno.writeFile(outPath + ".pcm", concat(decoded));
+console.log(`${pcm.length >> 1} samples -> ${blocks.length} blocks of ${blockBytes >> 1} samples`);
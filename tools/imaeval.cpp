@@ -0,0 +1,475 @@
+// ============== IMA-ADPCM EVALUATION ==============
+//
+// Offline tool: checks the firmware's IMA-ADPCM codec (src/AudioCodec.h)
+// bit for bit against a reference written separately from the IMA
+// recommended-practice pseudo-code, and against the server's encoder and
+// decoder (server/codec.ts, via tools/imaencode.ts); then times the decoder.
+//
+// Build and run on the host:
+//
+//   g++ -std=c++17 -O2 -Itools/host -Isrc -o imaeval tools/imaeval.cpp src/AudioCodec.cpp
+//   ./imaeval [--block N] [--write FILE.pcm] [--server FILE.blocks] [--speech voice.wav]
+//
+//   check    the test signal (10s of tone sweep, speech-like bursts, noise,
+//            full-scale square and clicks, silence, plus an odd tail) encoded
+//            in --block sample blocks (default 512, the ambient chunk) with
+//            the state carried across blocks: imaAdpcmEncodeBlock must match
+//            the reference encoder byte for byte, and imaAdpcmDecodeBlock
+//            must match the reference decoder on those blocks and on 200k
+//            random blocks (every start index, clamping at both rails)
+//   server   with --server, the blocks imaencode.ts wrote must equal the
+//            firmware encoder's, and FILE.blocks.pcm (the server's decode)
+//            the firmware decoder's. --write saves the test signal as 16-bit
+//            LE PCM for imaencode.ts first:
+//
+//              ./imaeval --write /tmp/ima.pcm
+//              deno run --allow-read --allow-write tools/imaencode.ts /tmp/ima.pcm /tmp/ima.blocks
+//              ./imaeval --server /tmp/ima.blocks
+//
+//   quality  round-trip SNR of each part of the test signal
+//   time     decode (and, for the mic uplink, encode) ns and x86 TSC cycles
+//            per sample, and per second of 24 kHz audio. Host cycles rank
+//            the code, they do not predict the ESP32-S3's.
+//   voice    the Gemini speech path as the server sends it: --speech (24 kHz
+//            mono 16-bit WAV, a real Gemini or other voice recording; the
+//            test signal's voiced part without it) coded in VOICE_BLOCK
+//            sample blocks (40ms, one server chunk) with the state carried
+//            from block to block, then each block decoded on its own and
+//            timed: mean / p99 / max us per block and per 20ms of audio,
+//            bytes per block and the round-trip SNR
+//
+// Exits non-zero on any mismatch.
+//
+// ==================================================
+
+#include "AudioCodec.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+static const int SAMPLE_RATE = 24000;
+static const int VOICE_BLOCK = 960;      // server VOICE_CHUNK_BYTES / 2
+
+// ── Reference ────────────────────────────────────────────────────────────────
+// The recommended-practice loop form: three successive halvings of the step,
+// vpdiff accumulated alongside, index and predictor clamped after each sample.
+
+static const int REF_INDEX[16] = { -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8 };
+static const int REF_STEP[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767
+};
+
+struct RefState { int valprev = 0, index = 0; };
+
+static void refUpdate(RefState& s, int delta, int vpdiff) {
+    s.valprev += (delta & 8) ? -vpdiff : vpdiff;
+    s.valprev = std::max(-32768, std::min(32767, s.valprev));
+    s.index = std::max(0, std::min(88, s.index + REF_INDEX[delta]));
+}
+
+static int refEncode(RefState& s, int val) {
+    int step = REF_STEP[s.index];
+    int diff = val - s.valprev;
+    int sign = diff < 0 ? 8 : 0;
+    if (sign) diff = -diff;
+    int delta = 0, vpdiff = step >> 3;
+    for (int mask = 4; mask; mask >>= 1) {
+        if (diff >= step) {
+            delta |= mask;
+            diff -= step;
+            vpdiff += step;
+        }
+        step >>= 1;
+    }
+    delta |= sign;
+    refUpdate(s, delta, vpdiff);
+    return delta;
+}
+
+static int refDecode(RefState& s, int delta) {
+    int step = REF_STEP[s.index];
+    int vpdiff = step >> 3;
+    for (int mask = 4; mask; mask >>= 1) {
+        if (delta & mask) vpdiff += step;
+        step >>= 1;
+    }
+    refUpdate(s, delta, vpdiff);
+    return s.valprev;
+}
+
+// ── Test signal ──────────────────────────────────────────────────────────────
+
+struct Segment { const char* name; size_t start, end; };
+static std::vector<Segment> segments;
+
+static std::vector<int16_t> testSignal() {
+    std::vector<int16_t> x;
+    auto mark = [&](const char* name, size_t start) { segments.push_back({ name, start, x.size() }); };
+    std::mt19937 rng(11);
+    std::normal_distribution<float> g(0.0f, 1.0f);
+    auto clip = [](float v) { return (int16_t)fmaxf(-32768.0f, fminf(32767.0f, v)); };
+    // 2s exponential sweep 50 Hz..11 kHz
+    double phase = 0.0;
+    for (int i = 0; i < 2 * SAMPLE_RATE; i++) {
+        double f = 50.0 * pow(220.0, (double)i / (2 * SAMPLE_RATE));
+        phase += 2.0 * M_PI * f / SAMPLE_RATE;
+        x.push_back(clip(12000.0f * (float)sin(phase)));
+    }
+    mark("sweep", 0);
+    // 3s speech-like: 150 Hz pulse train through a resonator, 4 Hz bursts
+    float y1 = 0.0f, y2 = 0.0f;
+    for (int i = 0; i < 3 * SAMPLE_RATE; i++) {
+        float pulse = (i % (SAMPLE_RATE / 150)) == 0 ? 1.0f : 0.0f;
+        float y = pulse + 1.9f * y1 - 0.95f * y2;
+        y2 = y1;
+        y1 = y;
+        float env = fmaxf(0.0f, sinf(2.0f * (float)M_PI * 4.0f * i / SAMPLE_RATE));
+        x.push_back(clip(900.0f * y * env));
+    }
+    mark("voiced", 2 * SAMPLE_RATE);
+    // 2s white noise at two levels
+    for (int i = 0; i < 2 * SAMPLE_RATE; i++) x.push_back(clip(g(rng) * (i < SAMPLE_RATE ? 300.0f : 8000.0f)));
+    mark("noise", 5 * SAMPLE_RATE);
+    // 1s full-scale 100 Hz square with clicks (rail clamping, step-index extremes)
+    for (int i = 0; i < SAMPLE_RATE; i++) {
+        int16_t v = ((i / 120) & 1) ? 32767 : -32768;
+        if (i % 2400 == 7) v = -v;
+        x.push_back(v);
+    }
+    mark("square", 7 * SAMPLE_RATE);
+    // 2s silence, then an odd tail so the last block is short and padded
+    x.insert(x.end(), 2 * SAMPLE_RATE, 0);
+    for (int i = 0; i < 301; i++) x.push_back(clip(g(rng) * 2000.0f));
+    return x;
+}
+
+// ── Checks ───────────────────────────────────────────────────────────────────
+
+static int failures = 0;
+
+static void expect(bool ok, const char* what) {
+    printf("  %-62s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+// Firmware encoder over x in block-sample blocks, blocks back to back
+static std::vector<uint8_t> encodeAll(const std::vector<int16_t>& x, int block) {
+    std::vector<uint8_t> out;
+    std::vector<uint8_t> buf(IMA_ADPCM_HEADER_BYTES + (block + 1) / 2);
+    ImaAdpcmState st = { 0, 0 };
+    for (size_t at = 0; at < x.size(); at += block) {
+        size_t n = std::min((size_t)block, x.size() - at);
+        size_t len = imaAdpcmEncodeBlock(&x[at], n, &st, buf.data());
+        out.insert(out.end(), buf.begin(), buf.begin() + len);
+    }
+    return out;
+}
+
+// Block lengths for x.size() samples: full blocks, then the (padded) tail
+static std::vector<size_t> blockLengths(size_t samples, int block) {
+    std::vector<size_t> lens;
+    for (size_t at = 0; at < samples; at += block) {
+        size_t n = std::min((size_t)block, samples - at);
+        lens.push_back(IMA_ADPCM_HEADER_BYTES + (n + 1) / 2);
+    }
+    return lens;
+}
+
+static bool encoderMatchesReference(const std::vector<int16_t>& x, int block, const std::vector<uint8_t>& coded) {
+    RefState s;
+    size_t pos = 0;
+    for (size_t at = 0; at < x.size(); at += block) {
+        size_t n = std::min((size_t)block, x.size() - at);
+        const uint8_t* b = &coded[pos];
+        if ((int16_t)(b[0] | (b[1] << 8)) != s.valprev || b[2] != s.index || b[3] != 0) {
+            printf("  block at sample %zu: header %02X %02X %02X %02X, want state %d/%d\n",
+                   at, b[0], b[1], b[2], b[3], s.valprev, s.index);
+            return false;
+        }
+        for (size_t i = 0; i < (n + 1) / 2 * 2; i++) {
+            int want = refEncode(s, i < n ? x[at + i] : 0);
+            int got = (b[4 + i / 2] >> ((i & 1) * 4)) & 0x0F;
+            if (got != want) {
+                printf("  sample %zu: nibble %X, want %X\n", at + i, got, want);
+                return false;
+            }
+        }
+        pos += IMA_ADPCM_HEADER_BYTES + (n + 1) / 2;
+    }
+    return pos == coded.size();
+}
+
+static bool decoderMatchesReference(const uint8_t* b, size_t len) {
+    static int16_t out[8192];
+    int n = imaAdpcmDecodeBlock(b, len, out, sizeof(out) / sizeof(out[0]));
+    if (n != (int)(len - IMA_ADPCM_HEADER_BYTES) * 2) return false;
+    RefState s;
+    s.valprev = (int16_t)(b[0] | (b[1] << 8));
+    s.index = b[2];
+    for (int i = 0; i < n; i++) {
+        int want = refDecode(s, (b[4 + i / 2] >> ((i & 1) * 4)) & 0x0F);
+        if (out[i] != want) return false;
+    }
+    return true;
+}
+
+static std::vector<int16_t> decodeAll(const std::vector<uint8_t>& coded, const std::vector<size_t>& lens) {
+    std::vector<int16_t> out;
+    int16_t buf[8192];
+    size_t pos = 0;
+    for (size_t len : lens) {
+        int n = imaAdpcmDecodeBlock(&coded[pos], len, buf, sizeof(buf) / sizeof(buf[0]));
+        if (n < 0) return {};
+        out.insert(out.end(), buf, buf + n);
+        pos += len;
+    }
+    return out;
+}
+
+static bool readFile(const char* path, std::vector<uint8_t>& d) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    d.resize(ftell(f));
+    fseek(f, 0, SEEK_SET);
+    bool ok = fread(d.data(), 1, d.size(), f) == d.size();
+    fclose(f);
+    return ok;
+}
+
+static bool readWav(const char* path, std::vector<int16_t>& pcm) {
+    std::vector<uint8_t> d;
+    if (!readFile(path, d)) return false;
+    if (d.size() < 12 || memcmp(d.data(), "RIFF", 4) || memcmp(d.data() + 8, "WAVE", 4)) {
+        fprintf(stderr, "%s: not a WAV file\n", path);
+        return false;
+    }
+    bool fmtOk = false;
+    for (size_t p = 12; p + 8 <= d.size();) {
+        uint32_t len = d[p + 4] | (d[p + 5] << 8) | (d[p + 6] << 16) | ((uint32_t)d[p + 7] << 24);
+        const uint8_t* c = d.data() + p + 8;
+        if (p + 8 + len > d.size()) len = (uint32_t)(d.size() - p - 8);
+        if (!memcmp(d.data() + p, "fmt ", 4) && len >= 16) {
+            uint32_t rate = c[4] | (c[5] << 8) | (c[6] << 16) | ((uint32_t)c[7] << 24);
+            fmtOk = (c[0] | (c[1] << 8)) == 1 && (c[2] | (c[3] << 8)) == 1 && rate == SAMPLE_RATE && (c[14] | (c[15] << 8)) == 16;
+        } else if (!memcmp(d.data() + p, "data", 4) && fmtOk) {
+            pcm.resize(len / 2);
+            memcpy(pcm.data(), c, pcm.size() * 2);
+            return true;
+        }
+        p += 8 + len + (len & 1);
+    }
+    fprintf(stderr, "%s: need 24 kHz mono 16-bit PCM\n", path);
+    return false;
+}
+
+// ── Timing ───────────────────────────────────────────────────────────────────
+
+struct Timing { double nsPerSample, cyclesPerSample; };
+
+template <typename F>
+static Timing timeIt(size_t samples, int reps, F f) {
+    auto t0 = std::chrono::steady_clock::now();
+#ifdef HAVE_TSC
+    uint64_t c0 = __rdtsc();
+#endif
+    for (int r = 0; r < reps; r++) f();
+#ifdef HAVE_TSC
+    double cycles = (double)(__rdtsc() - c0);
+#else
+    double cycles = 0.0;
+#endif
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+    double n = (double)samples * reps;
+    return { ns / n, cycles / n };
+}
+
+static void printTiming(const char* what, Timing t) {
+    printf("  %-7s %6.2f ns/sample  %6.2f cycles/sample   %7.0f us and %5.2f Mcycles per second of audio\n",
+           what, t.nsPerSample, t.cyclesPerSample, t.nsPerSample * SAMPLE_RATE / 1000.0,
+           t.cyclesPerSample * SAMPLE_RATE / 1e6);
+}
+
+// Decode every VOICE_BLOCK block of `speech` on its own, as websocketTask
+// does per chunk, timing each one (best of `reps` passes per block)
+static void voiceTiming(const std::vector<int16_t>& speech, const char* name) {
+    std::vector<uint8_t> coded = encodeAll(speech, VOICE_BLOCK);
+    std::vector<size_t> lens = blockLengths(speech.size(), VOICE_BLOCK);
+    std::vector<int16_t> y = decodeAll(coded, lens);
+    double s = 0, e = 0;
+    for (size_t i = 0; i < speech.size() && i < y.size(); i++) {
+        s += (double)speech[i] * speech[i];
+        e += ((double)speech[i] - y[i]) * ((double)speech[i] - y[i]);
+    }
+    printf("\nvoice (%s: %.1fs, %zu blocks of %d samples)\n", name, (double)speech.size() / SAMPLE_RATE,
+           lens.size(), VOICE_BLOCK);
+    printf("  %d -> %zu bytes per block (%.2f:1), round trip SNR %.1f dB\n", VOICE_BLOCK * 2, lens[0],
+           (double)VOICE_BLOCK * 2 / lens[0], 10.0 * log10((s + 1) / (e + 1)));
+
+    const int reps = 20;
+    int16_t out[VOICE_BLOCK + 2];
+    volatile int keep = 0;
+    std::vector<double> us;
+    size_t pos = 0;
+    for (size_t len : lens) {
+        double best = 1e30;
+        for (int r = 0; r < reps; r++) {
+            auto t0 = std::chrono::steady_clock::now();
+            keep += imaAdpcmDecodeBlock(&coded[pos], len, out, VOICE_BLOCK + 2);
+            best = std::min(best, std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+        }
+        us.push_back(best);
+        pos += len;
+    }
+    std::vector<double> sorted = us;
+    std::sort(sorted.begin(), sorted.end());
+    double mean = 0;
+    for (double u : us) mean += u;
+    mean /= us.size();
+    double p99 = sorted[sorted.size() * 99 / 100], max = sorted.back();
+    printf("  decode  %.2f us mean, %.2f us p99, %.2f us max per 40ms block"
+           " = %.2f / %.2f / %.2f us per 20ms (host)\n", mean, p99, max, mean / 2, p99 / 2, max / 2);
+}
+
+// ── main ─────────────────────────────────────────────────────────────────────
+
+int main(int argc, char** argv) {
+    int block = 512;
+    const char* writePath = nullptr;
+    const char* serverPath = nullptr;
+    const char* speechPath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--block") && i + 1 < argc) block = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--write") && i + 1 < argc) writePath = argv[++i];
+        else if (!strcmp(argv[i], "--server") && i + 1 < argc) serverPath = argv[++i];
+        else if (!strcmp(argv[i], "--speech") && i + 1 < argc) speechPath = argv[++i];
+        else {
+            fprintf(stderr, "usage: %s [--block N] [--write FILE.pcm] [--server FILE.blocks] [--speech voice.wav]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (block < 2 || block > 8192) block = 512;
+
+    std::vector<int16_t> x = testSignal();
+    if (writePath) {
+        FILE* f = fopen(writePath, "wb");
+        if (!f || fwrite(x.data(), sizeof(int16_t), x.size(), f) != x.size()) {
+            perror(writePath);
+            return 1;
+        }
+        fclose(f);
+        printf("wrote %zu samples to %s\n", x.size(), writePath);
+        return 0;
+    }
+
+    printf("check (%zu samples, %d-sample blocks)\n", x.size(), block);
+    std::vector<uint8_t> coded = encodeAll(x, block);
+    std::vector<size_t> lens = blockLengths(x.size(), block);
+    expect(encoderMatchesReference(x, block, coded), "imaAdpcmEncodeBlock == reference encoder");
+
+    bool decOk = true;
+    size_t pos = 0;
+    for (size_t len : lens) {
+        decOk = decOk && decoderMatchesReference(&coded[pos], len);
+        pos += len;
+    }
+    expect(decOk, "imaAdpcmDecodeBlock == reference decoder, test signal");
+
+    std::mt19937 rng(7);
+    std::vector<uint8_t> rnd(4 + 256);
+    int randomBad = 0;
+    for (int b = 0; b < 200000; b++) {
+        for (uint8_t& v : rnd) v = (uint8_t)rng();
+        rnd[2] = (uint8_t)(b % 89);
+        rnd[3] = 0;
+        if (!decoderMatchesReference(rnd.data(), rnd.size())) randomBad++;
+    }
+    expect(randomBad == 0, "imaAdpcmDecodeBlock == reference decoder, 200k random blocks");
+
+    int16_t sink[16];
+    uint8_t bad[8] = { 0, 0, 89, 0, 0, 0, 0, 0 };
+    expect(imaAdpcmDecodeBlock(bad, sizeof(bad), sink, 16) < 0 && imaAdpcmDecodeBlock(bad, 3, sink, 16) < 0 &&
+           imaAdpcmDecodeBlock(rnd.data(), rnd.size(), sink, 16) < 0,
+           "malformed blocks and short output buffers are refused");
+
+    if (serverPath) {
+        printf("\nserver (%s)\n", serverPath);
+        std::vector<uint8_t> ts, tsPcm;
+        std::string pcmPath = std::string(serverPath) + ".pcm";
+        bool read = readFile(serverPath, ts) && readFile(pcmPath.c_str(), tsPcm);
+        expect(read, "imaencode.ts output read");
+        if (read) {
+            size_t firstDiff = 0;
+            while (firstDiff < std::min(ts.size(), coded.size()) && ts[firstDiff] == coded[firstDiff]) firstDiff++;
+            if (ts.size() != coded.size() || firstDiff != coded.size())
+                printf("  %zu vs %zu bytes, first difference at byte %zu\n", ts.size(), coded.size(), firstDiff);
+            expect(ts == coded, "server imaEncodeBlock == firmware imaAdpcmEncodeBlock");
+
+            std::vector<int16_t> dec = decodeAll(coded, lens);
+            expect(tsPcm.size() == dec.size() * 2 && !memcmp(tsPcm.data(), dec.data(), tsPcm.size()),
+                   "server imaDecodeBlock == firmware imaAdpcmDecodeBlock");
+        }
+    }
+
+    printf("\nquality\n");
+    std::vector<int16_t> y = decodeAll(coded, lens);
+    for (const Segment& seg : segments) {
+        double s = 0, e = 0;
+        for (size_t i = seg.start; i < seg.end; i++) {
+            s += (double)x[i] * x[i];
+            e += ((double)x[i] - y[i]) * ((double)x[i] - y[i]);
+        }
+        printf("  %-8s round trip SNR %5.1f dB\n", seg.name, 10.0 * log10(s / e));
+    }
+    printf("  %zu -> %zu bytes (%.2f:1)\n", x.size() * 2, coded.size(), (double)x.size() * 2 / coded.size());
+
+    printf("\ntime (%d-sample blocks)\n", block);
+    std::vector<int16_t> out(block + 2);
+    volatile int keep = 0;
+    Timing dec = timeIt(x.size(), 50, [&] {
+        size_t p = 0;
+        for (size_t len : lens) {
+            keep += imaAdpcmDecodeBlock(&coded[p], len, out.data(), out.size());
+            p += len;
+        }
+    });
+    std::vector<uint8_t> buf(IMA_ADPCM_HEADER_BYTES + (block + 1) / 2);
+    Timing enc = timeIt(x.size(), 20, [&] {
+        ImaAdpcmState st = { 0, 0 };
+        for (size_t at = 0; at < x.size(); at += block)
+            keep += (int)imaAdpcmEncodeBlock(&x[at], std::min((size_t)block, x.size() - at), &st, buf.data());
+    });
+    printTiming("decode", dec);
+    printTiming("encode", enc);
+
+    if (speechPath) {
+        std::vector<int16_t> speech;
+        if (!readWav(speechPath, speech) || speech.empty()) return 1;
+        voiceTiming(speech, speechPath);
+    } else {
+        const Segment& voiced = segments[1];
+        voiceTiming(std::vector<int16_t>(x.begin() + voiced.start, x.begin() + voiced.end), "voiced test signal");
+    }
+
+    printf("\n%s\n", failures ? "CHECK FAILED" : "check passed");
+    return failures ? 1 : 0;
+}
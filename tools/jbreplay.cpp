@@ -0,0 +1,340 @@
+// ============== JITTER BUFFER REPLAY ==============
+//
+// Offline tool: replays packet arrival traces through the firmware's
+// JitterBuffer (src/JitterBuffer.h) and a model of the playout side that
+// drives it — AudioMixer's hold / stretch / concealment calls and a TALK
+// profile speaker DMA queue — in 1ms steps.
+//
+// Build and run on the host:
+//
+//   g++ -std=c++17 -O2 -Itools/host -Isrc -o jbreplay tools/jbreplay.cpp src/JitterBuffer.cpp
+//   ./jbreplay                        # the synthetic scenarios below
+//   ./jbreplay --trace arrivals.txt   # a recorded trace
+//   ./jbreplay --dump wifi            # print a synthetic trace in trace format
+//
+// TRACE FORMAT: one Gemini packet per line, "arrival_ms bytes [level]", in
+// arrival order; '#' starts a comment. bytes is 24 kHz 16-bit mono PCM;
+// level is the packet's mean |sample| (default 2000, speech), which decides
+// whether the buffer may stretch it. A gap over JB_STREAM_GAP_MS starts a new
+// response, as on the device.
+//
+// SYNTHETIC: six 5s responses, 4s apart, in 21ms packets with a 300ms pause
+// every 1.2s. The server sends at --speed x real time; the network adds a
+// random delay (|normal| x sigma) and occasional stalls that release
+// everything held at once, as a WiFi retry storm does. TCP keeps the order.
+//
+//   lan        sigma 3ms, no stalls
+//   wifi       sigma 25ms, a 150ms stall every ~10s
+//   congested  sigma 60ms, a 400ms stall every ~4s
+//   burst      sigma 10ms, server 3x faster than real time
+//
+// Per response it prints: start delay (first arrival to first sample into
+// the DMA), the target the buffer ended on, mean delay from arrival to being
+// heard (with "burst" this is mostly audio that arrived ahead of real time),
+// late packets (arrived after the speaker had run dry), the buffer's own
+// underrun count, the audible gap before those packets (DMA empty,
+// concealment excluded), and the silence stretched in and taken back out.
+//
+// ==================================================
+
+#include "JitterBuffer.h"
+#include "LossConcealer.h"
+
+#include <deque>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+struct Packet {
+    uint32_t arrivalMs;
+    uint32_t bytes;
+    int32_t  level;
+};
+
+// ── Traces ───────────────────────────────────────────────────────────────────
+
+struct Scenario {
+    const char* name;
+    float sigmaMs;
+    uint32_t stallEveryMs;   // mean interval, 0 = none
+    uint32_t stallMs;
+    float speed;
+};
+
+static const Scenario SCENARIOS[] = {
+    { "lan",       3.0f,  0,     0,   1.0f },
+    { "wifi",      25.0f, 10000, 150, 1.0f },
+    { "congested", 60.0f, 4000,  400, 1.0f },
+    { "burst",     10.0f, 0,     0,   3.0f },
+};
+
+static std::vector<Packet> synthesize(const Scenario& sc) {
+    std::mt19937 rng(11);
+    std::normal_distribution<float> net(0.0f, sc.sigmaMs);
+    std::uniform_real_distribution<float> uni(0.0f, 1.0f);
+
+    const uint32_t PACKET_BYTES = 1008;          // 21ms
+    const uint32_t RESPONSE_MS = 5000, IDLE_MS = 4000, BASE_MS = 40;
+    std::vector<Packet> out;
+    uint32_t start = 1000;
+    uint32_t stallFrom = 0, stallTo = 0;
+    uint32_t last = 0;
+
+    for (int r = 0; r < 6; r++) {
+        uint32_t mediaMs = 0;
+        for (int i = 0; mediaMs < RESPONSE_MS; i++) {
+            uint32_t sent = start + (uint32_t)(mediaMs / sc.speed);
+            uint32_t arrival = sent + BASE_MS + (uint32_t)fabsf(net(rng));
+
+            if (sc.stallEveryMs && arrival > stallTo && uni(rng) < 21.0f / sc.stallEveryMs) {
+                stallFrom = arrival;
+                stallTo = arrival + sc.stallMs;
+            }
+            if (arrival >= stallFrom && arrival < stallTo) arrival = stallTo;
+            if (arrival < last) arrival = last;  // TCP: in order
+            last = arrival;
+
+            bool pause = (mediaMs % 1200) >= 900;
+            out.push_back({ arrival, PACKET_BYTES, pause ? 20 : 2000 });
+            mediaMs += PACKET_BYTES / 48;
+        }
+        start = last + IDLE_MS;
+    }
+    return out;
+}
+
+static bool loadTrace(const char* path, std::vector<Packet>& out) {
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        char* hash = strchr(line, '#');
+        if (hash) *hash = 0;
+        unsigned ms, bytes;
+        int level = 2000;
+        int n = sscanf(line, "%u %u %d", &ms, &bytes, &level);
+        if (n < 2) continue;
+        out.push_back({ ms, bytes, level });
+    }
+    fclose(f);
+    return true;
+}
+
+// ── Playout model ────────────────────────────────────────────────────────────
+
+// speakerTask in the TALK profile: 4 DMA buffers of MIX_BLOCK_FRAMES at 24 kHz,
+// refilled as soon as one is free
+static const int BLOCK = 512;
+static const int DMA_BLOCKS = 4;
+static const int PLC_SAMPLES = (PLC_HOLD_MS + PLC_FADE_MS) * 24;
+
+struct Response {
+    uint32_t firstArrival = 0, lastArrival = 0;
+    int32_t  startDelay = -1;
+    uint32_t targetEnd = 0;
+    uint32_t packets = 0, late = 0;
+    uint32_t underruns = 0;
+    uint32_t gapMs = 0;
+    uint32_t inMs = 0, outMs = 0;
+    double   delaySum = 0;
+    uint32_t delayCount = 0;
+};
+
+struct Queued {
+    uint32_t arrivalMs;
+    int samples;
+    int32_t level;
+};
+
+static std::vector<Response> replay(const std::vector<Packet>& trace) {
+    JitterBuffer jb;
+    jb.setDmaMs(DMA_BLOCKS * BLOCK * 1000 / 24000);
+
+    std::vector<Response> resp;
+    std::deque<Queued> ring;
+    uint32_t ringBytes = 0;
+    int curLeft = 0, padLeft = 0, plcLeft = 0;
+    int dmaSamples = 0;               // queued in the DMA
+    uint32_t dryMs = 0;               // DMA empty since the last audio of this response
+    bool waitedFor = false;           // a packet already arrived during this dry spell
+    size_t next = 0;
+
+    if (trace.empty()) return resp;
+    uint32_t endMs = trace.back().arrivalMs + 2000;
+
+    for (uint32_t now = trace.front().arrivalMs; now <= endMs; now++) {
+        // websocketTask
+        while (next < trace.size() && trace[next].arrivalMs <= now) {
+            const Packet& p = trace[next++];
+            bool newStream = resp.empty() || (now - resp.back().lastArrival) > JB_STREAM_GAP_MS;
+            if (newStream) {
+                if (!resp.empty()) {
+                    resp.back().targetEnd = jb.targetMs();
+                }
+                resp.emplace_back();
+                resp.back().firstArrival = now;
+            }
+            Response& r = resp.back();
+            uint32_t underrunsBefore = jb.underruns();
+            if (newStream) {
+                dryMs = 0;
+            } else if (dryMs && !waitedFor) {
+                // Late: the speaker ran dry waiting for this packet
+                r.late++;
+                waitedFor = true;
+            }
+            jb.onPacket(now, p.bytes);
+            r.underruns += jb.underruns() - underrunsBefore;
+            r.lastArrival = now;
+            r.packets++;
+            ring.push_back({ now, (int)(p.bytes / 2), p.level });
+            ringBytes += p.bytes;
+        }
+        Response* r = resp.empty() ? nullptr : &resp.back();
+
+        // speakerTask: refill free DMA buffers
+        while (dmaSamples + BLOCK <= DMA_BLOCKS * BLOCK) {
+            int avail;
+            if (curLeft == 0 && padLeft == 0 && ringBytes == 0) {
+                jb.onEmpty(now);
+                avail = jb.isPlaying() ? plcLeft : 0;
+            } else if (jb.hold(now, JitterBuffer::bytesToMs(ringBytes))) {
+                avail = 0;
+            } else {
+                avail = curLeft + padLeft + (int)(ringBytes / 2);
+            }
+            if (avail == 0) break;
+
+            int produced = 0;
+            uint32_t inBefore = jb.stretchedInMs(), outBefore = jb.stretchedOutMs();
+            while (produced < BLOCK) {
+                if (curLeft > 0) {
+                    int take = min(curLeft, BLOCK - produced);
+                    curLeft -= take;
+                    produced += take;
+                    plcLeft = PLC_SAMPLES;
+                    continue;
+                }
+                if (padLeft > 0) {
+                    int take = min(padLeft, BLOCK - produced);
+                    padLeft -= take;
+                    produced += take;
+                    continue;
+                }
+                if (!ring.empty()) {
+                    Queued q = ring.front();
+                    ring.pop_front();
+                    ringBytes -= q.samples * 2;
+                    if (r) {
+                        // Heard once the DMA ahead of it has played
+                        uint32_t heard = now + (dmaSamples + produced) / 24;
+                        r->delaySum += heard - q.arrivalMs;
+                        r->delayCount++;
+                        if (r->startDelay < 0) r->startDelay = (int32_t)(now - r->firstArrival);
+                    }
+                    curLeft = q.samples;
+                    int adj = jb.stretch(JitterBuffer::bytesToMs(ringBytes), q.level, curLeft);
+                    if (adj < 0) curLeft += adj;
+                    else         padLeft = adj;
+                    continue;
+                }
+                if (plcLeft > 0) {
+                    int take = min(plcLeft, BLOCK - produced);
+                    plcLeft -= take;
+                    produced += take;
+                    continue;
+                }
+                break;
+            }
+            if (produced == 0) break;
+            jb.onPlayed(now, produced);
+            if (r) {
+                // A dry spell only counts as a gap once more of the response is heard
+                r->gapMs += dryMs;
+                dryMs = 0;
+                waitedFor = false;
+                r->inMs += jb.stretchedInMs() - inBefore;
+                r->outMs += jb.stretchedOutMs() - outBefore;
+            }
+            // A render always fills its whole DMA buffer; the tail past `produced` is silence
+            dmaSamples += BLOCK;
+        }
+
+        // The DMA plays one millisecond
+        if (dmaSamples == 0 && r && r->startDelay >= 0) dryMs++;
+        dmaSamples = max(0, dmaSamples - 24);
+    }
+    if (!resp.empty()) resp.back().targetEnd = jb.targetMs();
+    return resp;
+}
+
+// ── Report ───────────────────────────────────────────────────────────────────
+
+static void report(const char* name, const std::vector<Response>& resp) {
+    printf("%s\n", name);
+    printf("  %4s %8s %7s %7s %9s %6s %6s %8s %7s %7s\n",
+           "resp", "packets", "start", "target", "delay", "late", "under", "gap", "in", "out");
+    Response sum;
+    for (size_t i = 0; i < resp.size(); i++) {
+        const Response& r = resp[i];
+        double delay = r.delayCount ? r.delaySum / r.delayCount : 0;
+        printf("  %4zu %8u %5dms %5ums %7.0fms %6u %6u %6ums %5ums %5ums\n",
+               i + 1, r.packets, r.startDelay, r.targetEnd, delay, r.late, r.underruns, r.gapMs, r.inMs, r.outMs);
+        sum.packets += r.packets;
+        sum.late += r.late;
+        sum.underruns += r.underruns;
+        sum.gapMs += r.gapMs;
+        sum.inMs += r.inMs;
+        sum.outMs += r.outMs;
+        sum.delaySum += r.delaySum;
+        sum.delayCount += r.delayCount;
+    }
+    printf("  %4s %8u %7s %7s %7.0fms %6u %6u %6ums %5ums %5ums\n\n",
+           "all", sum.packets, "", "", sum.delayCount ? sum.delaySum / sum.delayCount : 0,
+           sum.late, sum.underruns, sum.gapMs, sum.inMs, sum.outMs);
+}
+
+int main(int argc, char** argv) {
+    const char* tracePath = nullptr;
+    const char* dump = nullptr;
+    float speed = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--trace") && i + 1 < argc) tracePath = argv[++i];
+        else if (!strcmp(argv[i], "--dump") && i + 1 < argc) dump = argv[++i];
+        else if (!strcmp(argv[i], "--speed") && i + 1 < argc) speed = atof(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s [--trace FILE | --dump SCENARIO] [--speed X]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (tracePath) {
+        std::vector<Packet> trace;
+        if (!loadTrace(tracePath, trace) || trace.empty()) {
+            fprintf(stderr, "cannot read a trace from %s\n", tracePath);
+            return 1;
+        }
+        report(tracePath, replay(trace));
+        return 0;
+    }
+
+    for (const Scenario& base : SCENARIOS) {
+        Scenario sc = base;
+        if (speed > 0) sc.speed = speed;
+        if (dump) {
+            if (strcmp(dump, sc.name)) continue;
+            printf("# %s: sigma %.0fms, stall %ums every ~%ums, speed %.1fx\n",
+                   sc.name, sc.sigmaMs, sc.stallMs, sc.stallEveryMs, sc.speed);
+            for (const Packet& p : synthesize(sc)) printf("%u %u %d\n", p.arrivalMs, p.bytes, p.level);
+            return 0;
+        }
+        report(sc.name, replay(synthesize(sc)));
+    }
+    if (dump) {
+        fprintf(stderr, "no scenario named %s\n", dump);
+        return 1;
+    }
+    return 0;
+}
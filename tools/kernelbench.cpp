@@ -0,0 +1,105 @@
+// ============== AUDIO KERNEL BENCHMARK ==============
+//
+// Offline tool: checks the firmware's monoToStereoQ14 (src/AudioKernels.h)
+// against its formula, bit for bit, and times it on the host.
+//
+// Build and run on the host:
+//
+//   g++ -std=c++17 -O2 -Itools/host -Isrc -o kernelbench tools/kernelbench.cpp src/AudioKernels.cpp
+//   ./kernelbench
+//
+// CHECK: every int16 input at gains 0, 1, 0.5, unity, unity + 1 LSB, 1.5,
+// the 2.0 ceiling (32767), and each volumeToQ14() step of 0.01 from 0 to 2.0:
+// both stereo lanes must equal sat16((x * g + 2^13) >> 14) computed in int64,
+// and the returned level must be sum |x|. Odd lengths and a length of 0 are
+// included. Exits non-zero on any mismatch.
+//
+// TIME: ns and (x86) TSC cycles per sample over 512-frame blocks, the
+// speaker block size. Host cycles do not predict the ESP32-S3's; on the
+// device the [PLAYBACK] log's mix= figure is the measurement. The header
+// explains why the kernel has no PIE version.
+//
+// ====================================================
+
+#include "AudioKernels.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+static int16_t reference(int16_t x, int16_t g) {
+    int64_t y = ((int64_t)x * g + (1 << 13)) >> 14;
+    if (y > 32767) y = 32767;
+    if (y < -32768) y = -32768;
+    return (int16_t)y;
+}
+
+static int checkGain(const std::vector<int16_t>& in, int16_t g) {
+    std::vector<int16_t> out(2 * in.size() + 2, 0x7777);
+    uint32_t level = monoToStereoQ14(in.data(), out.data(), (int)in.size(), g);
+    uint32_t wantLevel = 0;
+    int bad = 0;
+    for (size_t i = 0; i < in.size(); i++) {
+        int16_t want = reference(in[i], g);
+        wantLevel += (uint32_t)abs(in[i]);
+        if (out[2 * i] != want || out[2 * i + 1] != want) {
+            if (bad < 3) printf("  gain %d: x=%d -> %d/%d, want %d\n", g, in[i], out[2 * i], out[2 * i + 1], want);
+            bad++;
+        }
+    }
+    if (out[2 * in.size()] != 0x7777) {
+        printf("  gain %d: wrote past 2n samples\n", g);
+        bad++;
+    }
+    if (level != wantLevel) {
+        printf("  gain %d: level %u, want %u\n", g, level, wantLevel);
+        bad++;
+    }
+    return bad;
+}
+
+int main() {
+    std::vector<int16_t> all(65536);
+    for (int i = 0; i < 65536; i++) all[i] = (int16_t)(i - 32768);
+
+    std::vector<int16_t> gains = { 0, 1, 8192, 16384, 16385, 24576, 32767 };
+    for (int v = 0; v <= 200; v++) gains.push_back(volumeToQ14(v / 100.0f));
+
+    int bad = 0;
+    for (int16_t g : gains) bad += checkGain(all, g);
+    // Short and odd lengths
+    for (int n : { 0, 1, 7, 511 }) {
+        std::vector<int16_t> part(all.begin(), all.begin() + n);
+        bad += checkGain(part, 32767);
+    }
+    printf("check: %zu gains x 65536 inputs, plus short lengths: %s\n",
+           gains.size(), bad ? "MISMATCH" : "bit-exact");
+
+    const int BLOCK = 512, BLOCKS = 200000;
+    std::vector<int16_t> in(BLOCK), out(2 * BLOCK);
+    srand(1);
+    for (int i = 0; i < BLOCK; i++) in[i] = (int16_t)(rand() % 20000 - 10000);
+
+    volatile uint32_t sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+#ifdef HAVE_TSC
+    uint64_t c0 = __rdtsc();
+#endif
+    for (int b = 0; b < BLOCKS; b++) sink += monoToStereoQ14(in.data(), out.data(), BLOCK, (int16_t)(20000 + (b & 7)));
+#ifdef HAVE_TSC
+    uint64_t c1 = __rdtsc();
+#endif
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+    double samples = (double)BLOCK * BLOCKS;
+    printf("time: %.2f ns/sample", ns / samples);
+#ifdef HAVE_TSC
+    printf(", %.2f TSC cycles/sample", (c1 - c0) / samples);
+#endif
+    printf(" (host, %d-frame blocks)\n", BLOCK);
+    return bad ? 1 : 0;
+}
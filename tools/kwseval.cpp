@@ -0,0 +1,183 @@
+// ============== WAKE WORD EVALUATION ==============
+//
+// Offline tool: runs the firmware's keyword spotter (src/KeywordSpotter.h,
+// same frontend and int8 engine) over a WAV corpus and reports false rejects,
+// false accepts per hour, detection latency and the compute per second of
+// audio. It can also dump the frontend's int8 features, so a model is trained
+// on exactly what the device computes.
+//
+// Build and run on the host:
+//
+//   g++ -std=c++17 -O2 -Isrc -o kwseval tools/kwseval.cpp src/KeywordSpotter.cpp src/AudioKernels.cpp
+//   ./kwseval model.jbk [--gain G] --pos kw1.wav kw2.wav ... --neg talk.wav tv.wav ...
+//   ./kwseval model.jbk [--gain G] --dump-features out.f8 clip.wav
+//
+// Clips are 16 kHz mono 16-bit WAV files, played back to back as one
+// continuous mic stream (the spotter is never reset between them).
+//   --pos  each clip holds the wake word once, with at least 0.5s after it.
+//          A clip without a detection is a false reject. If clip.txt holds
+//          Audacity labels, the end of the last one is where the word ends,
+//          and the time from there to the detection is its latency.
+//   --neg  anything but the wake word. Every detection is a false accept.
+// Record with the device's own mic chain, or pass --gain 16 for raw INMP441
+// captures (MicAgc starts at 16x).
+//
+// --dump-features writes one row of bands() int8 values per 20ms hop.
+//
+// ===================================================
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "KeywordSpotter.h"
+
+static bool readFile(const char* path, std::vector<uint8_t>& out) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    out.resize(ftell(f));
+    fseek(f, 0, SEEK_SET);
+    bool ok = fread(out.data(), 1, out.size(), f) == out.size();
+    fclose(f);
+    return ok;
+}
+
+static bool readWav(const char* path, std::vector<int16_t>& pcm) {
+    std::vector<uint8_t> d;
+    if (!readFile(path, d)) return false;
+    if (d.size() < 12 || memcmp(d.data(), "RIFF", 4) || memcmp(d.data() + 8, "WAVE", 4)) {
+        fprintf(stderr, "%s: not a WAV file\n", path);
+        return false;
+    }
+    bool fmtOk = false;
+    for (size_t p = 12; p + 8 <= d.size();) {
+        uint32_t len = d[p + 4] | (d[p + 5] << 8) | (d[p + 6] << 16) | ((uint32_t)d[p + 7] << 24);
+        const uint8_t* c = d.data() + p + 8;
+        if (p + 8 + len > d.size()) len = (uint32_t)(d.size() - p - 8);
+        if (!memcmp(d.data() + p, "fmt ", 4) && len >= 16) {
+            uint32_t rate = c[4] | (c[5] << 8) | (c[6] << 16) | ((uint32_t)c[7] << 24);
+            fmtOk = (c[0] | (c[1] << 8)) == 1 && (c[2] | (c[3] << 8)) == 1 && (c[14] | (c[15] << 8)) == 16 &&
+                    rate == KWS_SAMPLE_RATE;
+        } else if (!memcmp(d.data() + p, "data", 4) && fmtOk) {
+            pcm.resize(len / 2);
+            memcpy(pcm.data(), c, pcm.size() * 2);
+            return true;
+        }
+        p += 8 + len + (len & 1);
+    }
+    fprintf(stderr, "%s: need 16 kHz mono 16-bit PCM\n", path);
+    return false;
+}
+
+// End of the last labeled segment in ms, or -1
+static double labelEndMs(const char* wavPath) {
+    std::string path(wavPath);
+    path = path.substr(0, path.rfind('.')) + ".txt";
+    FILE* f = fopen(path.c_str(), "r");
+    if (!f) return -1;
+    double end = -1, a, b;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "%lf %lf", &a, &b) == 2) end = std::max(end, b * 1000.0);
+    }
+    fclose(f);
+    return end;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s model.jbk [--gain G] --pos clip.wav... --neg clip.wav...\n"
+                        "       %s model.jbk [--gain G] --dump-features out.f8 clip.wav...\n", argv[0], argv[0]);
+        return 2;
+    }
+    std::vector<uint8_t> blob;
+    if (!readFile(argv[1], blob)) return 1;
+    KeywordSpotter kws;
+    if (!kws.load(blob.data(), blob.size())) {
+        fprintf(stderr, "%s: %s\n", argv[1], kws.error());
+        return 1;
+    }
+
+    float gain = 1;
+    const char* dumpPath = nullptr;
+    std::vector<std::pair<const char*, bool>> clips;   // path, positive
+    bool positive = false;
+    for (int i = 2; i < argc; i++) {
+        if (!strcmp(argv[i], "--gain") && i + 1 < argc) gain = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--dump-features") && i + 1 < argc) dumpPath = argv[++i];
+        else if (!strcmp(argv[i], "--pos")) positive = true;
+        else if (!strcmp(argv[i], "--neg")) positive = false;
+        else clips.push_back({argv[i], positive});
+    }
+    FILE* dump = dumpPath ? fopen(dumpPath, "wb") : nullptr;
+    if (dumpPath && !dump) {
+        perror(dumpPath);
+        return 1;
+    }
+
+    printf("model \"%s\": %u MACs per inference, one every %d ms\n",
+           kws.keyword(), kws.macs(), KWS_INFER_EVERY * KWS_HOP * 1000 / KWS_SAMPLE_RATE);
+
+    int pos = 0, rejects = 0, accepts = 0;
+    double negMs = 0, audioMs = 0, busyUs = 0;
+    std::vector<double> latencies;
+    for (auto& clip : clips) {
+        std::vector<int16_t> pcm;
+        if (!readWav(clip.first, pcm)) continue;
+        for (int16_t& s : pcm) s = (int16_t)std::max(-32768.0f, std::min(32767.0f, s * gain));
+        double endMs = clip.second ? labelEndMs(clip.first) : -1;
+
+        int detections = 0;
+        double firstMs = -1;
+        for (size_t k = 0; k + KWS_HOP <= pcm.size(); k += KWS_HOP) {
+            auto t0 = std::chrono::steady_clock::now();
+            bool hit = kws.push(&pcm[k], KWS_HOP);
+            busyUs += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+            if (dump) fwrite(kws.lastFeatures(), 1, kws.bands(), dump);
+            if (hit) {
+                double t = (k + KWS_HOP) * 1000.0 / KWS_SAMPLE_RATE;
+                if (!detections) firstMs = t;
+                detections++;
+            }
+        }
+        double clipMs = pcm.size() * 1000.0 / KWS_SAMPLE_RATE;
+        audioMs += clipMs;
+
+        const char* base = strrchr(clip.first, '/') ? strrchr(clip.first, '/') + 1 : clip.first;
+        if (clip.second) {
+            pos++;
+            if (!detections) rejects++;
+            else if (endMs >= 0) latencies.push_back(firstMs - endMs);
+            printf("  pos %-32s %s", base, detections ? "detected" : "MISSED");
+            if (detections && endMs >= 0) printf(" %+.0f ms after the word", firstMs - endMs);
+            printf("\n");
+        } else {
+            negMs += clipMs;
+            accepts += detections;
+            if (detections) printf("  neg %-32s %d false accept(s)\n", base, detections);
+        }
+    }
+    if (dump) fclose(dump);
+
+    printf("\n");
+    if (pos) printf("false reject  %d/%d (%.1f%%)\n", rejects, pos, 100.0 * rejects / pos);
+    if (negMs > 0) printf("false accept  %d in %.1f min (%.2f per hour)\n", accepts, negMs / 60000, accepts * 3600000.0 / negMs);
+    if (!latencies.empty()) {
+        std::sort(latencies.begin(), latencies.end());
+        printf("latency       median %.0f ms, max %.0f ms after the end of the word\n",
+               latencies[latencies.size() / 2], latencies.back());
+    }
+    if (audioMs > 0) {
+        printf("compute       %.2f ms per second of audio on this host, %.1f M MAC/s\n",
+               busyUs / audioMs, kws.macs() * (1000.0 / (KWS_INFER_EVERY * 20)) / 1e6);
+    }
+    return 0;
+}
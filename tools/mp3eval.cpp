@@ -0,0 +1,277 @@
+// ============== MP3 STREAM EVALUATION ==============
+//
+// Offline tool: runs the firmware's Mp3Stream (src/Mp3Stream.h) over MP3
+// files fed in radio packets, checks its output bit for bit against a
+// reference decode, and measures its real-time factor on the host.
+//
+// Build against arduino-libhelix (the decoder sources are C; compile them
+// as C):
+//
+//   git clone https://github.com/pschatzmann/arduino-libhelix /tmp/helix
+//   gcc -O2 -c -I/tmp/helix/src/libhelix-mp3 /tmp/helix/src/libhelix-mp3/*.c
+//   g++ -std=c++17 -O2 -Itools/host -Isrc -I/tmp/helix/src -o mp3eval tools/mp3eval.cpp src/Mp3Stream.cpp *.o
+//   ./mp3eval [--packet N] [--ref REF.s16] station.mp3 ...
+//
+// REFERENCE: Helix run directly over the whole file (one decoder, no packet
+// boundaries, the same frame-skipping rules), downmixed (L+R)>>1, then the
+// 32-tap/64-phase converter described in Mp3Stream.h applied to the whole
+// signal at once: output k reads input (k * step) >> 16 with phase from the
+// top 6 fraction bits. Mp3Stream must produce exactly that.
+//
+//   packets   --packet byte packets (default 1024, the server's CHUNK_SIZE)
+//   random    packets of 1..2048 bytes
+//   reset     half of the file from its middle (a stream joined mid-frame,
+//             with a bit reservoir from frames never seen), reset(), then
+//             the whole file: must match a fresh decoder, so nothing of the
+//             old stream leaks through reset()
+//   ref       with --ref (24 kHz mono s16le, e.g. ffmpeg -i station.mp3 -ac 1
+//             -ar 24000 -f s16le REF.s16), SNR against it after aligning
+//             within +-50ms: a sanity check against another decoder and
+//             resampler, not bit-exact
+//   time      ms per second of audio and the real-time factor; host numbers
+//             only rank changes, the device's cost is in Mp3Stream.h
+//
+// Exits non-zero if any output differs from the reference.
+//
+// ===================================================
+
+#include "Mp3Stream.h"
+#include "libhelix-mp3/mp3dec.h"
+
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static const int OUT_RATE = 24000;
+
+static bool readFile(const char* path, std::vector<uint8_t>& d) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    d.resize(ftell(f));
+    fseek(f, 0, SEEK_SET);
+    bool ok = fread(d.data(), 1, d.size(), f) == d.size();
+    fclose(f);
+    return ok;
+}
+
+// ── Reference ────────────────────────────────────────────────────────────────
+
+// Mono input at the station's rate; rate 0 if no frame decoded
+static std::vector<int16_t> helixMono(const std::vector<uint8_t>& file, uint32_t* rate) {
+    std::vector<int16_t> mono;
+    std::vector<uint8_t> data(file);
+    static short pcm[2 * MP3_MAX_FRAME_SAMPLES];
+    HMP3Decoder h = MP3InitDecoder();
+    *rate = 0;
+    unsigned char* p = data.data();
+    unsigned char* end = data.data() + data.size();
+    while (p < end) {
+        int sync = MP3FindSyncWord(p, (int)(end - p));
+        if (sync < 0) break;
+        p += sync;
+        unsigned char* at = p;
+        int left = (int)(end - p);
+        int err = MP3Decode(h, &p, &left, pcm, 0);
+        if (err == ERR_MP3_INDATA_UNDERFLOW) break;
+        if (err == ERR_MP3_MAINDATA_UNDERFLOW) continue;
+        if (err != ERR_MP3_NONE) {
+            p = at + 1;
+            continue;
+        }
+        MP3FrameInfo info;
+        MP3GetLastFrameInfo(h, &info);
+        if (info.samprate < 16000 || info.nChans < 1 || info.nChans > 2) continue;
+        if (*rate == 0) *rate = info.samprate;
+        if ((uint32_t)info.samprate != *rate) {
+            fprintf(stderr, "  sample rate changes mid-file; the reference covers the first %u Hz part only\n", *rate);
+            break;
+        }
+        int n = info.outputSamps / info.nChans;
+        if (n > MP3_MAX_FRAME_SAMPLES) continue;
+        for (int i = 0; i < n; i++)
+            mono.push_back(info.nChans == 2 ? (int16_t)(((int32_t)pcm[2 * i] + pcm[2 * i + 1]) >> 1) : pcm[i]);
+    }
+    MP3FreeDecoder(h);
+    return mono;
+}
+
+// The converter of Mp3Stream.h over the whole signal at once
+static std::vector<int16_t> referenceResample(const std::vector<int16_t>& x, uint32_t rate) {
+    if (rate == (uint32_t)OUT_RATE) return x;
+    static int16_t coeffs[MP3_RS_PHASES][MP3_RS_TAPS];
+    const float fc = 0.45f * (float)std::min(rate, (uint32_t)OUT_RATE) / (float)rate;
+    const float center = MP3_RS_TAPS / 2 - 1;
+    for (int p = 0; p < MP3_RS_PHASES; p++) {
+        float taps[MP3_RS_TAPS];
+        float sum = 0;
+        for (int k = 0; k < MP3_RS_TAPS; k++) {
+            float t = k - center - (float)p / MP3_RS_PHASES;
+            float v = 2.0f * fc * t;
+            float sinc = fabsf(v) < 1e-6f ? 1.0f : sinf(PI * v) / (PI * v);
+            float w = 0.42f + 0.5f * cosf(PI * t / (MP3_RS_TAPS / 2)) + 0.08f * cosf(2.0f * PI * t / (MP3_RS_TAPS / 2));
+            taps[k] = sinc * w;
+            sum += taps[k];
+        }
+        for (int k = 0; k < MP3_RS_TAPS; k++) coeffs[p][k] = (int16_t)lrintf(taps[k] / sum * 16384.0f);
+    }
+    const uint64_t step = ((uint64_t)rate << 16) / OUT_RATE;
+    std::vector<int16_t> y;
+    for (uint64_t t = 0;; t += step) {
+        size_t i = (size_t)(t >> 16);
+        if (i + MP3_RS_TAPS > x.size()) break;
+        const int16_t* c = coeffs[(t & 0xFFFF) >> 10];
+        int32_t acc = 0;
+        for (int k = 0; k < MP3_RS_TAPS; k++) acc += c[k] * x[i + k];
+        acc = (acc + (1 << 13)) >> 14;
+        y.push_back((int16_t)std::max(-32768, std::min(32767, acc)));
+    }
+    return y;
+}
+
+// ── Mp3Stream runs ───────────────────────────────────────────────────────────
+
+static void feed(Mp3Stream& s, const uint8_t* data, size_t len, std::vector<int16_t>& out) {
+    s.push(data, len);
+    const int16_t* pcm;
+    int n;
+    while ((n = s.decode(&pcm)) > 0) out.insert(out.end(), pcm, pcm + n);
+}
+
+static std::vector<int16_t> runPackets(Mp3Stream& s, const std::vector<uint8_t>& file, size_t packet) {
+    std::vector<int16_t> out;
+    for (size_t at = 0; at < file.size(); at += packet)
+        feed(s, &file[at], std::min(packet, file.size() - at), out);
+    return out;
+}
+
+static std::vector<int16_t> runRandom(Mp3Stream& s, const std::vector<uint8_t>& file, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<size_t> size(1, 2048);
+    std::vector<int16_t> out;
+    for (size_t at = 0; at < file.size();) {
+        size_t n = std::min(size(rng), file.size() - at);
+        feed(s, &file[at], n, out);
+        at += n;
+    }
+    return out;
+}
+
+// ── Checks ───────────────────────────────────────────────────────────────────
+
+static int failures = 0;
+
+static void expectSame(const std::vector<int16_t>& got, const std::vector<int16_t>& want, const char* what) {
+    size_t first = 0;
+    while (first < std::min(got.size(), want.size()) && got[first] == want[first]) first++;
+    bool ok = got.size() == want.size() && first == want.size();
+    printf("  %-46s %s", what, ok ? "ok" : "FAIL");
+    if (!ok) printf("  (%zu vs %zu samples, first difference at %zu)", got.size(), want.size(), first);
+    printf("\n");
+    if (!ok) failures++;
+}
+
+static double snrAligned(const std::vector<int16_t>& y, const std::vector<int16_t>& ref, int* lagOut) {
+    const int maxLag = OUT_RATE / 20;
+    double best = -1e9;
+    for (int lag = -maxLag; lag <= maxLag; lag++) {
+        double s = 0, e = 0;
+        for (size_t i = 0; i < y.size(); i++) {
+            long j = (long)i + lag;
+            if (j < 0 || j >= (long)ref.size()) continue;
+            s += (double)ref[j] * ref[j];
+            e += ((double)ref[j] - y[i]) * ((double)ref[j] - y[i]);
+        }
+        double snr = e > 0 ? 10.0 * log10(s / e) : 99.0;
+        if (snr > best) {
+            best = snr;
+            *lagOut = lag;
+        }
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    size_t packet = 1024;
+    const char* refPath = nullptr;
+    std::vector<const char*> files;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--packet") && i + 1 < argc) packet = (size_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--ref") && i + 1 < argc) refPath = argv[++i];
+        else if (argv[i][0] != '-') files.push_back(argv[i]);
+        else {
+            files.clear();
+            break;
+        }
+    }
+    if (files.empty() || packet == 0 || packet > MP3_INBUF_BYTES / 2) {
+        fprintf(stderr, "usage: %s [--packet N] [--ref REF.s16] station.mp3 ...\n", argv[0]);
+        return 2;
+    }
+
+    Mp3Stream stream;   // one instance throughout: begin() once, reset() between runs
+    if (!stream.begin()) return 1;
+
+    for (const char* path : files) {
+        std::vector<uint8_t> file;
+        if (!readFile(path, file)) return 1;
+        uint32_t rate;
+        std::vector<int16_t> mono = helixMono(file, &rate);
+        if (rate == 0) {
+            fprintf(stderr, "%s: no MP3 frames\n", path);
+            failures++;
+            continue;
+        }
+        std::vector<int16_t> want = referenceResample(mono, rate);
+        double seconds = (double)want.size() / OUT_RATE;
+        printf("%s: %u Hz, %.1fs, %zu bytes\n", path, rate, seconds, file.size());
+
+        stream.reset();
+        uint32_t frames0 = stream.framesDecoded(), errors0 = stream.decodeErrors();   // lifetime counters
+        std::vector<int16_t> got = runPackets(stream, file, packet);
+        char what[64];
+        snprintf(what, sizeof(what), "packets of %zu bytes == reference", packet);
+        expectSame(got, want, what);
+        printf("    %u frames, %u decode errors, %u channel(s)\n",
+               stream.framesDecoded() - frames0, stream.decodeErrors() - errors0, stream.sourceChannels());
+
+        stream.reset();
+        expectSame(runRandom(stream, file, 3), want, "packets of 1..2048 bytes == reference");
+
+        stream.reset();
+        std::vector<uint8_t> tail(file.begin() + file.size() / 2, file.end());
+        runPackets(stream, tail, packet);
+        stream.reset();
+        expectSame(runPackets(stream, file, packet), want, "mid-stream start, reset(), whole == reference");
+
+        if (refPath) {
+            std::vector<uint8_t> raw;
+            if (readFile(refPath, raw)) {
+                std::vector<int16_t> ref(raw.size() / 2);
+                memcpy(ref.data(), raw.data(), ref.size() * 2);
+                int lag = 0;
+                double snr = snrAligned(want, ref, &lag);
+                printf("    vs %s: %.1f dB SNR at %+d samples\n", refPath, snr, lag);
+            }
+        }
+
+        const int reps = 5;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < reps; r++) {
+            stream.reset();
+            runPackets(stream, file, packet);
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() / reps;
+        printf("    time: %.2f ms per second of audio, %.0fx real time\n", ms / seconds, seconds * 1000.0 / ms);
+    }
+
+    printf("\n%s\n", failures ? "CHECK FAILED" : "check passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,216 @@
+// ============== NOISE SUPPRESSOR EVALUATION ==============
+//
+// Offline tool: runs the firmware's noise suppressor (src/NoiseSuppressor.h)
+// over clean speech mixed with recorded noise. It reports the SNR gain, how
+// much the noise drops in speech pauses, how much the speech loses, how often
+// the pauses would still trip the conversation VAD, and the cycles per 20ms
+// frame.
+//
+// Build and run on the host:
+//
+//   g++ -std=c++17 -O2 -Isrc -o nseval tools/nseval.cpp src/NoiseSuppressor.cpp src/AudioKernels.cpp
+//   ./nseval [--gain G] [--snr DB] [--vad N] [--out out.wav] speech.wav noise.wav [speech2.wav noise2.wav ...]
+//
+// All files are 16 kHz mono 16-bit. Record both at the device's level, or
+// pass --gain 16 for raw INMP441 captures (MicAgc starts at 16x). The noise
+// is looped to the length of the speech and added as recorded, or scaled to
+// --snr dB (over the whole file) if given. Speech pauses are the frames where
+// the clean speech is 30 dB below its mean.
+//
+// SNR out counts everything that is not the clean speech as noise, speech
+// distortion included. --vad is VAD_CONVERSATION_THRESHOLD (mean absolute
+// sample value of a 20ms frame, 650 in Config.h.example). --out writes the
+// suppressed mix of every pair back to back.
+//
+// =========================================================
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "NoiseSuppressor.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+#define SAMPLE_RATE   16000
+#define FRAME         NS_FRAME   // MIC_FRAME_SIZE
+#define WARMUP_FRAMES 75         // 1.5s for the first minimum search
+
+static bool readWav(const char* path, std::vector<int16_t>& pcm) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    std::vector<uint8_t> d;
+    fseek(f, 0, SEEK_END);
+    d.resize(ftell(f));
+    fseek(f, 0, SEEK_SET);
+    bool ok = fread(d.data(), 1, d.size(), f) == d.size();
+    fclose(f);
+    if (!ok || d.size() < 12 || memcmp(d.data(), "RIFF", 4) || memcmp(d.data() + 8, "WAVE", 4)) {
+        fprintf(stderr, "%s: not a WAV file\n", path);
+        return false;
+    }
+    bool fmtOk = false;
+    for (size_t p = 12; p + 8 <= d.size();) {
+        uint32_t len = d[p + 4] | (d[p + 5] << 8) | (d[p + 6] << 16) | ((uint32_t)d[p + 7] << 24);
+        const uint8_t* c = d.data() + p + 8;
+        if (p + 8 + len > d.size()) len = (uint32_t)(d.size() - p - 8);
+        if (!memcmp(d.data() + p, "fmt ", 4) && len >= 16) {
+            uint32_t rate = c[4] | (c[5] << 8) | (c[6] << 16) | ((uint32_t)c[7] << 24);
+            fmtOk = (c[0] | (c[1] << 8)) == 1 && (c[2] | (c[3] << 8)) == 1 && rate == SAMPLE_RATE && (c[14] | (c[15] << 8)) == 16;
+        } else if (!memcmp(d.data() + p, "data", 4) && fmtOk) {
+            pcm.resize(len / 2);
+            memcpy(pcm.data(), c, pcm.size() * 2);
+            return true;
+        }
+        p += 8 + len + (len & 1);
+    }
+    fprintf(stderr, "%s: need 16 kHz mono 16-bit PCM\n", path);
+    return false;
+}
+
+static void writeWav(const char* path, const std::vector<int16_t>& pcm) {
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        perror(path);
+        return;
+    }
+    uint32_t data = (uint32_t)pcm.size() * 2, riff = 36 + data, fmtLen = 16, rate = SAMPLE_RATE, bps = SAMPLE_RATE * 2;
+    uint16_t pcmFmt = 1, ch = 1, align = 2, bits = 16;
+    fwrite("RIFF", 1, 4, f); fwrite(&riff, 4, 1, f); fwrite("WAVEfmt ", 1, 8, f);
+    fwrite(&fmtLen, 4, 1, f); fwrite(&pcmFmt, 2, 1, f); fwrite(&ch, 2, 1, f);
+    fwrite(&rate, 4, 1, f); fwrite(&bps, 4, 1, f); fwrite(&align, 2, 1, f); fwrite(&bits, 2, 1, f);
+    fwrite("data", 1, 4, f); fwrite(&data, 4, 1, f);
+    fwrite(pcm.data(), 2, pcm.size(), f);
+    fclose(f);
+}
+
+static double db(double num, double den) { return 10.0 * log10((num + 1) / (den + 1)); }
+
+static int16_t clip16(double v) { return (int16_t)std::max(-32768.0, std::min(32767.0, v)); }
+
+int main(int argc, char** argv) {
+    double gain = 1, snr = NAN;
+    int vad = 650;
+    const char* outPath = nullptr;
+    std::vector<const char*> files;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--gain") && i + 1 < argc) gain = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--snr") && i + 1 < argc) snr = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--vad") && i + 1 < argc) vad = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--out") && i + 1 < argc) outPath = argv[++i];
+        else files.push_back(argv[i]);
+    }
+    if (files.empty() || files.size() % 2) {
+        fprintf(stderr, "usage: %s [--gain G] [--snr DB] [--vad N] [--out out.wav] speech.wav noise.wav [speech.wav noise.wav ...]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<int16_t> written;
+    std::vector<double> frameUs, frameCycles;
+    double allIn = 0, allOut = 0;
+    int pairs = 0;
+    for (size_t f = 0; f < files.size(); f += 2) {
+        std::vector<int16_t> speech, noise;
+        if (!readWav(files[f], speech) || !readWav(files[f + 1], noise) || noise.empty()) continue;
+        size_t n = speech.size() / FRAME * FRAME;
+        std::vector<double> s(n), v(n);
+        double sE = 0, vE = 0;
+        for (size_t i = 0; i < n; i++) {
+            s[i] = speech[i] * gain;
+            v[i] = noise[i % noise.size()] * gain;
+            sE += s[i] * s[i];
+            vE += v[i] * v[i];
+        }
+        if (!std::isnan(snr)) {
+            double scale = sqrt(sE / (vE + 1) / pow(10.0, snr / 10));
+            for (double& x : v) x *= scale;
+        }
+
+        NoiseSuppressor ns;
+        ns.begin();
+        std::vector<int16_t> mix(n), out(n);
+        for (size_t i = 0; i < n; i++) mix[i] = clip16(s[i] + v[i]);
+        for (size_t k = 0; k < n; k += FRAME) {
+            int16_t frame[FRAME];
+            memcpy(frame, &mix[k], sizeof(frame));
+            auto t0 = std::chrono::steady_clock::now();
+#ifdef HAVE_TSC
+            uint64_t c0 = __rdtsc();
+#endif
+            ns.process(frame);
+#ifdef HAVE_TSC
+            frameCycles.push_back((double)(__rdtsc() - c0));
+#endif
+            frameUs.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+            memcpy(&out[k], frame, sizeof(frame));
+        }
+        written.insert(written.end(), out.begin() + NS_HOP, out.end());
+
+        // The output runs NS_HOP behind: compare out[i + NS_HOP] with the input at i
+        double meanFrameE = sE / (n / FRAME);
+        double inNoise = 0, outNoise = 0, cleanE = 0;
+        double pauseIn = 0, pauseOut = 0, speechIn = 0, speechOut = 0;
+        int pauseFrames = 0, vadIn = 0, vadOut = 0;
+        for (size_t k = WARMUP_FRAMES * FRAME; k + FRAME + NS_HOP <= n; k += FRAME) {
+            double fs = 0, fIn = 0, fOut = 0, absIn = 0, absOut = 0;
+            for (size_t i = k; i < k + FRAME; i++) {
+                double o = out[i + NS_HOP];
+                fs += s[i] * s[i];
+                fIn += (double)mix[i] * mix[i];
+                fOut += o * o;
+                absIn += fabs((double)mix[i]);
+                absOut += fabs(o);
+                inNoise += (mix[i] - s[i]) * (mix[i] - s[i]);
+                outNoise += (o - s[i]) * (o - s[i]);
+            }
+            cleanE += fs;
+            if (fs < meanFrameE / 1000) {
+                pauseFrames++;
+                pauseIn += fIn;
+                pauseOut += fOut;
+                vadIn += absIn / FRAME > vad;
+                vadOut += absOut / FRAME > vad;
+            } else if (fs > meanFrameE) {
+                speechIn += fs;
+                speechOut += fOut;
+            }
+        }
+        allIn += inNoise;
+        allOut += outNoise;
+        pairs++;
+        printf("%s + %s: SNR %.1f -> %.1f dB (%+.1f), pauses %.1f dB quieter, speech %+.1f dB, VAD in pauses %d -> %d of %d frames, noise level %d\n",
+               files[f], files[f + 1], db(cleanE, inNoise), db(cleanE, outNoise), db(inNoise, outNoise),
+               db(pauseIn, pauseOut), db(speechOut, speechIn), vadIn, vadOut, pauseFrames, ns.noiseLevel());
+    }
+    if (frameUs.empty()) return 1;
+
+    std::vector<double> sorted = frameUs;
+    std::sort(sorted.begin(), sorted.end());
+    double mean = 0;
+    for (double u : frameUs) mean += u;
+    mean /= frameUs.size();
+    printf("\n");
+    if (pairs > 1) printf("SNR gain      %+.1f dB over all pairs\n", db(allIn, allOut));
+    printf("CPU           %.1f us mean, %.1f us p99 per 20ms frame on this host (%.2f%% of real time)\n",
+           mean, sorted[sorted.size() * 99 / 100], mean / 200.0);
+#ifdef HAVE_TSC
+    std::sort(frameCycles.begin(), frameCycles.end());
+    double meanCycles = 0;
+    for (double c : frameCycles) meanCycles += c;
+    meanCycles /= frameCycles.size();
+    printf("cycles        %.0f mean, %.0f p99 per frame (host TSC; device budget NS_CYCLE_BUDGET = %d)\n",
+           meanCycles, frameCycles[frameCycles.size() * 99 / 100], NS_CYCLE_BUDGET);
+#endif
+    if (outPath) writeWav(outPath, written);
+    return 0;
+}
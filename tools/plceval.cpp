@@ -0,0 +1,264 @@
+// ============== LOSS CONCEALER EVALUATION ==============
+//
+// Offline tool: drops packets from a 24 kHz voice signal by a loss pattern
+// and fills the holes two ways — with silence (PLC off) and with the
+// firmware's LossConcealer (src/LossConcealer.h, PLC on), calling it the way
+// AudioMixer does: conceal() for a missing packet, then blend() on a copy of
+// the first real samples and push() of every real sample. It reports the SNR
+// against the original over the whole signal and over the damaged stretches
+// alone (each lost packet plus the crossfade after it).
+//
+// Build and run on the host:
+//
+//   g++ -std=c++17 -O2 -Itools/host -Isrc -o plceval tools/plceval.cpp src/LossConcealer.cpp
+//   ./plceval [--packet-ms MS] [--seed N] [speech.wav ...]
+//
+// Without files it uses synthetic signals: "voiced" (a 110-180 Hz pulse
+// train gliding through three formant resonators, 4 Hz syllables with short
+// pauses), a steady 220 Hz "tone" with harmonics, and white "noise" (nothing
+// periodic to extend; concealment should not help there). WAV files must be
+// 24 kHz mono 16-bit, like Gemini's output.
+//
+// Loss patterns over --packet-ms packets (default 20ms):
+//   single     one packet every 200ms
+//   random2    2% independent loss
+//   random5    5%
+//   random10   10%
+//   bursty     Gilbert-Elliott: 3% chance to enter loss, 50% to leave it
+//              (mean burst two packets; beyond PLC_HOLD_MS + PLC_FADE_MS the
+//              concealment has faded to silence anyway)
+//
+// Losing a packet here means its audio is gone, as on a lossy link. On the
+// device a late packet is played afterwards instead; the concealment itself
+// (what fills the hole and how it blends back) is the same.
+//
+// =======================================================
+
+#include "LossConcealer.h"
+
+#include <cmath>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static const int SAMPLE_RATE = 24000;
+
+static bool readWav(const char* path, std::vector<int16_t>& pcm) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    std::vector<uint8_t> d;
+    fseek(f, 0, SEEK_END);
+    d.resize(ftell(f));
+    fseek(f, 0, SEEK_SET);
+    bool ok = fread(d.data(), 1, d.size(), f) == d.size();
+    fclose(f);
+    if (!ok || d.size() < 12 || memcmp(d.data(), "RIFF", 4) || memcmp(d.data() + 8, "WAVE", 4)) {
+        fprintf(stderr, "%s: not a WAV file\n", path);
+        return false;
+    }
+    bool fmtOk = false;
+    for (size_t p = 12; p + 8 <= d.size();) {
+        uint32_t len = d[p + 4] | (d[p + 5] << 8) | (d[p + 6] << 16) | ((uint32_t)d[p + 7] << 24);
+        const uint8_t* c = d.data() + p + 8;
+        if (p + 8 + len > d.size()) len = (uint32_t)(d.size() - p - 8);
+        if (!memcmp(d.data() + p, "fmt ", 4) && len >= 16) {
+            uint32_t rate = c[4] | (c[5] << 8) | (c[6] << 16) | ((uint32_t)c[7] << 24);
+            fmtOk = (c[0] | (c[1] << 8)) == 1 && (c[2] | (c[3] << 8)) == 1 && rate == SAMPLE_RATE && (c[14] | (c[15] << 8)) == 16;
+        } else if (!memcmp(d.data() + p, "data", 4) && fmtOk) {
+            pcm.resize(len / 2);
+            memcpy(pcm.data(), c, pcm.size() * 2);
+            return true;
+        }
+        p += 8 + len + (len & 1);
+    }
+    fprintf(stderr, "%s: need 24 kHz mono 16-bit PCM\n", path);
+    return false;
+}
+
+// ── Synthetic signals (10s each) ─────────────────────────────────────────────
+
+static std::vector<int16_t> voiced() {
+    const int N = 10 * SAMPLE_RATE;
+    const float formants[3] = { 700.0f, 1200.0f, 2600.0f };
+    const float widths[3] = { 90.0f, 110.0f, 160.0f };
+    float y1[3] = {0}, y2[3] = {0};
+    std::vector<int16_t> out(N);
+    float phase = 0.0f;
+    for (int i = 0; i < N; i++) {
+        float t = (float)i / SAMPLE_RATE;
+        float f0 = 145.0f + 35.0f * sinf(2.0f * (float)M_PI * 0.3f * t);
+        phase += f0 / SAMPLE_RATE;
+        float pulse = 0.0f;
+        if (phase >= 1.0f) {
+            phase -= 1.0f;
+            pulse = 1.0f;
+        }
+        float s = 0.0f;
+        for (int k = 0; k < 3; k++) {
+            float r = expf(-(float)M_PI * widths[k] / SAMPLE_RATE);
+            float a1 = 2.0f * r * cosf(2.0f * (float)M_PI * formants[k] / SAMPLE_RATE);
+            float y = pulse + a1 * y1[k] - r * r * y2[k];
+            y2[k] = y1[k];
+            y1[k] = y;
+            s += y;
+        }
+        // 4 Hz syllables, the last 60ms of every 250ms silent
+        float ph = fmodf(t * 4.0f, 1.0f);
+        float env = ph < 0.76f ? sinf((float)M_PI * ph / 0.76f) : 0.0f;
+        out[i] = (int16_t)fmaxf(-32000.0f, fminf(32000.0f, 1500.0f * s * env));
+    }
+    return out;
+}
+
+static std::vector<int16_t> tone() {
+    const int N = 10 * SAMPLE_RATE;
+    std::vector<int16_t> out(N);
+    for (int i = 0; i < N; i++) {
+        float t = (float)i / SAMPLE_RATE;
+        float s = 6000.0f * sinf(2.0f * (float)M_PI * 220.0f * t)
+                + 3000.0f * sinf(2.0f * (float)M_PI * 440.0f * t + 1.0f)
+                + 1500.0f * sinf(2.0f * (float)M_PI * 660.0f * t + 2.0f);
+        out[i] = (int16_t)s;
+    }
+    return out;
+}
+
+static std::vector<int16_t> noise() {
+    const int N = 10 * SAMPLE_RATE;
+    std::mt19937 rng(3);
+    std::normal_distribution<float> g(0.0f, 3000.0f);
+    std::vector<int16_t> out(N);
+    for (int i = 0; i < N; i++) out[i] = (int16_t)fmaxf(-32000.0f, fminf(32000.0f, g(rng)));
+    return out;
+}
+
+// ── Loss patterns ────────────────────────────────────────────────────────────
+
+static std::vector<bool> pattern(const char* name, int packets, int packetMs, uint32_t seed) {
+    std::vector<bool> lost(packets, false);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> uni(0.0f, 1.0f);
+    if (!strcmp(name, "single")) {
+        int every = 200 / packetMs;
+        for (int p = every / 2; p < packets; p += every) lost[p] = true;
+    } else if (!strncmp(name, "random", 6)) {
+        float rate = atoi(name + 6) / 100.0f;
+        for (int p = 0; p < packets; p++) lost[p] = uni(rng) < rate;
+    } else if (!strcmp(name, "bursty")) {
+        bool bad = false;
+        for (int p = 0; p < packets; p++) {
+            bad = bad ? uni(rng) >= 0.5f : uni(rng) < 0.03f;
+            lost[p] = bad;
+        }
+    }
+    // The concealer needs history: never lose the first 100ms
+    for (int p = 0; p < packets && p * packetMs < 100; p++) lost[p] = false;
+    return lost;
+}
+
+// ── Evaluation ───────────────────────────────────────────────────────────────
+
+struct Result {
+    double snrAll, snrHit;
+    int lostPackets;
+};
+
+static Result run(const std::vector<int16_t>& x, const std::vector<bool>& lost, int packet, bool plcOn) {
+    static LossConcealer plc;
+    plc.reset();
+    std::vector<int16_t> y(x.size(), 0);
+    std::vector<bool> hit(x.size(), false);
+    int16_t copy[PLC_XFADE_SAMPLES];
+    int lostPackets = 0;
+
+    for (size_t p = 0; p * packet < x.size(); p++) {
+        size_t at = p * packet;
+        int n = (int)std::min((size_t)packet, x.size() - at);
+        if (lost[p]) {
+            lostPackets++;
+            int made = plcOn ? plc.conceal(&y[at], n) : 0;
+            for (int i = made; i < n; i++) y[at + i] = 0;
+            for (int i = 0; i < n; i++) hit[at + i] = true;
+            // The crossfade back into real audio belongs to the damage too
+            for (int i = 0; i < PLC_XFADE_SAMPLES && at + n + i < x.size(); i++) hit[at + n + i] = true;
+            continue;
+        }
+        memcpy(&y[at], &x[at], n * sizeof(int16_t));
+        if (!plcOn) continue;
+        int done = 0;
+        if (plc.pendingBlend()) {
+            int take = std::min(n, PLC_XFADE_SAMPLES);
+            memcpy(copy, &y[at], take * sizeof(int16_t));
+            plc.blend(copy, take);
+            memcpy(&y[at], copy, take * sizeof(int16_t));
+            plc.push(copy, take);
+            done = take;
+        }
+        plc.push(&y[at + done], n - done);
+    }
+
+    double sAll = 0, eAll = 0, sHit = 0, eHit = 0;
+    for (size_t i = 0; i < x.size(); i++) {
+        double s = (double)x[i] * x[i];
+        double e = (double)(x[i] - y[i]) * (x[i] - y[i]);
+        sAll += s;
+        eAll += e;
+        if (hit[i]) {
+            sHit += s;
+            eHit += e;
+        }
+    }
+    auto db = [](double s, double e) { return e > 0 ? 10.0 * log10(s / e) : 99.0; };
+    return { db(sAll, eAll), db(sHit, eHit), lostPackets };
+}
+
+int main(int argc, char** argv) {
+    int packetMs = 20;
+    uint32_t seed = 1;
+    std::vector<const char*> files;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--packet-ms") && i + 1 < argc) packetMs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) seed = (uint32_t)atoi(argv[++i]);
+        else if (argv[i][0] == '-') {
+            fprintf(stderr, "usage: %s [--packet-ms MS] [--seed N] [speech.wav ...]\n", argv[0]);
+            return 2;
+        }
+        else files.push_back(argv[i]);
+    }
+    if (packetMs <= 0) packetMs = 20;
+    const int packet = packetMs * SAMPLE_RATE / 1000;
+
+    struct Signal { std::string name; std::vector<int16_t> pcm; };
+    std::vector<Signal> signals;
+    if (files.empty()) {
+        signals.push_back({ "voiced", voiced() });
+        signals.push_back({ "tone", tone() });
+        signals.push_back({ "noise", noise() });
+    }
+    for (const char* f : files) {
+        Signal s{ f, {} };
+        if (readWav(f, s.pcm) && !s.pcm.empty()) signals.push_back(std::move(s));
+    }
+    if (signals.empty()) return 1;
+
+    const char* patterns[] = { "single", "random2", "random5", "random10", "bursty" };
+    printf("%d ms packets; SNR vs the original, dB (whole signal | damaged stretches only)\n\n", packetMs);
+    printf("%-12s %-9s %6s   %15s   %15s   %7s\n", "signal", "loss", "lost", "PLC off", "PLC on", "gain");
+    for (const Signal& s : signals) {
+        int packets = (int)((s.pcm.size() + packet - 1) / packet);
+        for (const char* pat : patterns) {
+            std::vector<bool> lost = pattern(pat, packets, packetMs, seed);
+            Result off = run(s.pcm, lost, packet, false);
+            Result on = run(s.pcm, lost, packet, true);
+            printf("%-12.12s %-9s %6d   %6.1f | %6.1f   %6.1f | %6.1f   %+6.1f\n",
+                   s.name.c_str(), pat, off.lostPackets, off.snrAll, off.snrHit, on.snrAll, on.snrHit,
+                   on.snrHit - off.snrHit);
+        }
+    }
+    return 0;
+}
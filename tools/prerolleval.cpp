@@ -0,0 +1,380 @@
+// ============== PRE-ROLL EVALUATION ==============
+//
+// Offline tool: plays a labelled speech onset through the firmware's PreRoll
+// (src/PreRoll.h), Endpointer and DTX uplink (MicDtx + MicUplink) the way
+// audioTask does, with the recording triggered some time after the speaker
+// started (the touch pad's debounce, the wake word's detection delay), and
+// checks that the first syllable still reaches the uplink.
+//
+// Build and run on the host:
+//
+//   g++ -std=c++17 -O2 -Itools/host -Isrc -o prerolleval tools/prerolleval.cpp src/PreRoll.cpp src/Endpointer.cpp src/MicUplink.cpp src/AudioCodec.cpp
+//   ./prerolleval [--latency MS ...] [session.wav ...]
+//
+// Sessions: 16 kHz mono 16-bit WAV with Audacity labels next to it
+// (session.txt, "start<TAB>end" in seconds) as for epeval; the first label is
+// the first syllable. Without files a synthetic one is used: room noise, a
+// soft 60ms consonant (below the DTX threshold) and voiced syllables over
+// the same room noise.
+//
+// Per frame, like audioTask: before the trigger every frame is pushed into
+// the pre-roll (cleared instead while a response plays). The first frame
+// captured after the trigger starts the turn: MicDtx::reset(),
+// Endpointer::beginTurn(), the pre-roll drained through the endpointer and
+// sendAudioChunk()'s DTX path, then the live frame. Live frames follow until
+// the endpointer ends the turn. The uplink uses pcm16 so payloads compare
+// exactly.
+//
+// For each --latency (trigger this long after the labelled onset; default
+// 0..460ms, all inside PREROLL_MS, and 600 and 800 beyond it, reported only):
+//
+//   seam      the frames on the uplink are consecutive 20ms captures: no gap
+//             or repeat where the pre-roll hands over to the live frames
+//   content   each audio payload is exactly the audio captured at its t
+//   syllable  every sample of the first syllable went out as audio (not a
+//             DTX marker, not lost before the pre-roll)
+//   endpoint  the turn does not end before the labelled speech does
+//
+// Then two cases around a response: one that ended 100ms before the onset
+// (the pre-roll was cleared while it played, so none of its frames may be
+// sent) and a pre-roll that stopped filling PREROLL_STALE_MS + 100ms before
+// the trigger (must be discarded).
+//
+// Exits non-zero on any failed check.
+//
+// =================================================
+
+#include "PreRoll.h"
+#include "Endpointer.h"
+#include "MicUplink.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+static const int SAMPLE_RATE = AUDIO_SAMPLE_RATE;
+static const int FRAME = MIC_FRAME_SIZE;
+static const int FRAME_MS = PREROLL_FRAME_MS;
+static const uint32_t T0 = 50000;            // capture ms of sample 0 (any value)
+
+struct Session {
+    std::string name;
+    std::vector<int16_t> pcm;
+    double onsetMs, syllableEndMs, speechEndMs;
+};
+
+// ── Input ────────────────────────────────────────────────────────────────────
+
+static bool readWav(const char* path, std::vector<int16_t>& pcm) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    std::vector<uint8_t> d;
+    fseek(f, 0, SEEK_END);
+    d.resize(ftell(f));
+    fseek(f, 0, SEEK_SET);
+    bool ok = fread(d.data(), 1, d.size(), f) == d.size();
+    fclose(f);
+    if (!ok || d.size() < 12 || memcmp(d.data(), "RIFF", 4) || memcmp(d.data() + 8, "WAVE", 4)) {
+        fprintf(stderr, "%s: not a WAV file\n", path);
+        return false;
+    }
+    bool fmtOk = false;
+    for (size_t p = 12; p + 8 <= d.size();) {
+        uint32_t len = d[p + 4] | (d[p + 5] << 8) | (d[p + 6] << 16) | ((uint32_t)d[p + 7] << 24);
+        const uint8_t* c = d.data() + p + 8;
+        if (p + 8 + len > d.size()) len = (uint32_t)(d.size() - p - 8);
+        if (!memcmp(d.data() + p, "fmt ", 4) && len >= 16) {
+            uint32_t rate = c[4] | (c[5] << 8) | (c[6] << 16) | ((uint32_t)c[7] << 24);
+            fmtOk = (c[0] | (c[1] << 8)) == 1 && (c[2] | (c[3] << 8)) == 1 && rate == SAMPLE_RATE && (c[14] | (c[15] << 8)) == 16;
+        } else if (!memcmp(d.data() + p, "data", 4) && fmtOk) {
+            pcm.resize(len / 2);
+            memcpy(pcm.data(), c, pcm.size() * 2);
+            return true;
+        }
+        p += 8 + len + (len & 1);
+    }
+    fprintf(stderr, "%s: need 16 kHz mono 16-bit PCM\n", path);
+    return false;
+}
+
+static bool readSession(const char* wavPath, Session& s) {
+    std::string path(wavPath);
+    path = path.substr(0, path.rfind('.')) + ".txt";
+    FILE* f = fopen(path.c_str(), "r");
+    if (!f) {
+        perror(path.c_str());
+        return false;
+    }
+    s.onsetMs = -1;
+    s.speechEndMs = -1;
+    double a, b;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "%lf %lf", &a, &b) != 2) continue;
+        if (s.onsetMs < 0) {
+            s.onsetMs = a * 1000.0;
+            s.syllableEndMs = b * 1000.0;
+        }
+        s.speechEndMs = std::max(s.speechEndMs, b * 1000.0);
+    }
+    fclose(f);
+    const char* base = strrchr(wavPath, '/') ? strrchr(wavPath, '/') + 1 : wavPath;
+    s.name = base;
+    return s.onsetMs >= 0 && readWav(wavPath, s.pcm);
+}
+
+static void speech(std::vector<int16_t>& x, int ms) {
+    const float formants[3] = { 700.0f, 1200.0f, 2600.0f };
+    const float widths[3] = { 90.0f, 110.0f, 160.0f };
+    float y1[3] = {0}, y2[3] = {0};
+    float phase = 0.0f;
+    for (int i = 0; i < ms * SAMPLE_RATE / 1000; i++) {
+        float t = (float)i / SAMPLE_RATE;
+        phase += (145.0f + 35.0f * sinf(2.0f * (float)M_PI * 0.3f * t)) / SAMPLE_RATE;
+        float pulse = 0.0f;
+        if (phase >= 1.0f) {
+            phase -= 1.0f;
+            pulse = 1.0f;
+        }
+        float s = 0.0f;
+        for (int k = 0; k < 3; k++) {
+            float r = expf(-(float)M_PI * widths[k] / SAMPLE_RATE);
+            float y = pulse + 2.0f * r * cosf(2.0f * (float)M_PI * formants[k] / SAMPLE_RATE) * y1[k] - r * r * y2[k];
+            y2[k] = y1[k];
+            y1[k] = y;
+            s += y;
+        }
+        float ph = fmodf(t * 4.0f, 1.0f);
+        float env = ph < 0.85f ? sinf((float)M_PI * ph / 0.85f) : 0.0f;
+        x.push_back((int16_t)fmaxf(-32000.0f, fminf(32000.0f, 2500.0f * s * env)));
+    }
+}
+
+static void noise(std::vector<int16_t>& x, int ms, int level, std::mt19937& rng) {
+    std::uniform_real_distribution<float> u(-2.0f * level, 2.0f * level);
+    for (int i = 0; i < ms * SAMPLE_RATE / 1000; i++) x.push_back((int16_t)lrintf(u(rng)));
+}
+
+// Room noise under the last `ms` of x (a recording never has digital silence between syllables)
+static void underlay(std::vector<int16_t>& x, int ms, int level, std::mt19937& rng) {
+    std::uniform_real_distribution<float> u(-2.0f * level, 2.0f * level);
+    for (size_t i = x.size() - ms * SAMPLE_RATE / 1000; i < x.size(); i++)
+        x[i] = (int16_t)fmaxf(-32768.0f, fminf(32767.0f, x[i] + u(rng)));
+}
+
+// 1.5s room, a 60ms soft consonant, 1s of syllables (the first one is labelled), 4s room
+static Session synthetic() {
+    std::mt19937 rng(5);
+    Session s;
+    s.name = "synthetic";
+    noise(s.pcm, 1500, 30, rng);
+    s.onsetMs = 1500;
+    noise(s.pcm, 60, 45, rng);
+    speech(s.pcm, 1000);
+    underlay(s.pcm, 1000, 30, rng);
+    s.syllableEndMs = 1500 + 60 + 250 * 0.85;
+    s.speechEndMs = 2560;
+    noise(s.pcm, 4000, 30, rng);
+    return s;
+}
+
+// ── audioTask model ──────────────────────────────────────────────────────────
+
+struct Sent {
+    int      frame;           // capture frame index (from the header's t)
+    int      frames;          // a marker's run, else 1
+    bool     marker;
+    bool     exact;           // payload == captured audio
+};
+
+struct Run {
+    std::vector<Sent> sent;
+    int firstLive = -1;
+    int preRollFrames = 0;
+    double endpointMs = -1;
+};
+
+static PreRoll preRoll;
+static Endpointer endpointer;
+static MicUplink uplink;
+static MicDtx dtx;
+
+// Frame k covers samples [k*FRAME, (k+1)*FRAME); its capture time is that of its last sample
+static uint32_t frameMs(int k) { return T0 + (uint32_t)(k + 1) * FRAME_MS; }
+
+// triggerMs: recording starts with the first frame captured after it.
+// Frames in [clearFrom, clearTo) play a response (pre-roll cleared);
+// frames in [skipFrom, skipTo) are never read (a stall before the trigger).
+static Run run(const Session& s, double triggerMs, int clearFrom = -1, int clearTo = -1,
+               int skipFrom = -1, int skipTo = -1) {
+    Run r;
+    preRoll.clear();
+    const int frames = (int)(s.pcm.size() / FRAME);
+    size_t len;
+
+    auto record = [&](const uint8_t* f, const int16_t* expect) {
+        Sent x;
+        uint32_t t = f[6] | (f[7] << 8) | (f[8] << 16) | ((uint32_t)f[9] << 24);
+        x.marker = f[3] == UPLINK_SILENCE;
+        x.frames = x.marker ? (f[10] | (f[11] << 8)) : 1;
+        x.frame = (int)(t - T0) / FRAME_MS - 1;   // a marker's t is its first frame's
+        x.exact = !x.marker && expect && memcmp(f + UPLINK_HEADER_BYTES, expect, FRAME * sizeof(int16_t)) == 0;
+        r.sent.push_back(x);
+    };
+    // sendAudioChunk()'s binary path with DTX on
+    auto send = [&](const int16_t* pcm, uint32_t ms) {
+        bool held = dtx.hold(pcm, ms);
+        uint16_t level;
+        uint32_t firstMs;
+        uint16_t n = dtx.takeRun(!held, &level, &firstMs);
+        if (n) record(uplink.sealSilence(n, level, firstMs, &len), nullptr);
+        auto coded = [&](const int16_t* p, uint32_t at) {
+            size_t payload = uplink.encode(CODEC_PCM16, p, FRAME);
+            const uint8_t* f = uplink.seal(UPLINK_STREAM_MIC, CODEC_PCM16, payload, at, &len);
+            int k = (int)(at - T0) / FRAME_MS - 1;
+            record(f, k >= 0 && k < frames ? &s.pcm[k * FRAME] : nullptr);
+        };
+        if (!held) {
+            for (int h = 0; h < dtx.heldFrames(); h++) {
+                uint32_t at;
+                const int16_t* f = dtx.heldFrame(h, &at);
+                coded(f, at);
+            }
+            dtx.clearHeld();
+            coded(pcm, ms);
+        }
+    };
+
+    uint32_t lastVoice = 0;
+    for (int k = 0; k < frames; k++) {
+        if (k >= skipFrom && k < skipTo) continue;
+        const int16_t* pcm = &s.pcm[k * FRAME];
+        uint32_t ms = frameMs(k);
+        if (r.firstLive < 0) {
+            if ((double)(ms - T0) <= triggerMs) {
+                if (k >= clearFrom && k < clearTo) preRoll.clear();
+                else preRoll.push(pcm, FRAME, ms);
+                continue;
+            }
+            r.firstLive = k;
+            dtx.reset();
+            endpointer.beginTurn();
+            lastVoice = ms;
+            static int16_t pre[FRAME];
+            uint32_t preMs;
+            r.preRollFrames = (int)preRoll.beginDrain(ms);
+            while (preRoll.popFrame(pre, &preMs)) {
+                if (endpointer.process(pre, FRAME)) lastVoice = ms;
+                send(pre, preMs);
+            }
+        }
+        if (endpointer.process(pcm, FRAME)) lastVoice = ms;
+        send(pcm, ms);
+        if (ms - lastVoice > endpointer.silenceMs()) {
+            r.endpointMs = ms - T0;
+            break;
+        }
+    }
+    return r;
+}
+
+// ── Checks ───────────────────────────────────────────────────────────────────
+
+static int failures = 0;
+
+static void expect(bool ok, const char* what) {
+    printf("  %-62s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+struct Verdict {
+    bool seam, content;
+    double syllablePct;       // of the first syllable's samples sent as audio
+    int firstSent;            // first capture frame on the uplink
+};
+
+static Verdict judge(const Session& s, const Run& r) {
+    Verdict v = { true, true, 0.0, r.sent.empty() ? -1 : r.sent[0].frame };
+    for (size_t i = 0; i < r.sent.size(); i++) {
+        const Sent& x = r.sent[i];
+        if (i > 0 && x.frame != r.sent[i - 1].frame + r.sent[i - 1].frames) v.seam = false;
+        if (!x.marker && !x.exact) v.content = false;
+    }
+    int from = (int)(s.onsetMs * SAMPLE_RATE / 1000), to = (int)(s.syllableEndMs * SAMPLE_RATE / 1000);
+    int covered = 0;
+    for (const Sent& x : r.sent) {
+        if (x.marker) continue;
+        int a = std::max(from, x.frame * FRAME), b = std::min(to, (x.frame + 1) * FRAME);
+        if (b > a) covered += b - a;
+    }
+    v.syllablePct = to > from ? 100.0 * covered / (to - from) : 100.0;
+    return v;
+}
+
+int main(int argc, char** argv) {
+    std::vector<int> latencies;
+    std::vector<Session> sessions;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--latency") && i + 1 < argc) latencies.push_back(atoi(argv[++i]));
+        else if (argv[i][0] != '-') {
+            Session s;
+            if (readSession(argv[i], s)) sessions.push_back(std::move(s));
+            else return 1;
+        } else {
+            fprintf(stderr, "usage: %s [--latency MS ...] [session.wav ...]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (latencies.empty()) latencies = { 0, 100, 200, 300, 400, 460, 600, 800 };
+    if (sessions.empty()) sessions.push_back(synthetic());
+
+    if (!preRoll.begin()) return 1;
+    endpointer.begin(VAD_SILENCE_MS);
+
+    printf("pre-roll %d ms, stale after %d ms; DTX onset hold %d frames\n", PREROLL_MS, PREROLL_STALE_MS, DTX_ONSET_FRAMES);
+    for (const Session& s : sessions) {
+        printf("\n%s: first syllable %.0f-%.0f ms, speech ends %.0f ms\n", s.name.c_str(), s.onsetMs, s.syllableEndMs, s.speechEndMs);
+        for (int latency : latencies) {
+            Run r = run(s, s.onsetMs + latency);
+            Verdict v = judge(s, r);
+            // The syllable must be whole if the pre-roll reaches back to its onset
+            bool required = latency + FRAME_MS <= PREROLL_MS;
+            printf("trigger onset+%dms: pre-roll %d frames from %d ms, endpoint %.0f ms\n",
+                   latency, r.preRollFrames, v.firstSent * FRAME_MS, r.endpointMs);
+            expect(v.seam, "seam: consecutive captures on the uplink");
+            expect(v.content, "content: payloads are the audio captured at their t");
+            char what[96];
+            snprintf(what, sizeof(what), "syllable: %.0f%% sent as audio%s", v.syllablePct, required ? "" : " (beyond PREROLL_MS)");
+            if (required) expect(v.syllablePct >= 100.0, what);
+            else printf("  %s\n", what);
+            snprintf(what, sizeof(what), "endpoint: not before the end of speech (%.0f ms)", s.speechEndMs);
+            expect(r.endpointMs < 0 || r.endpointMs >= s.speechEndMs, what);
+        }
+
+        // A response that ended 100ms before the onset: none of it may be sent
+        int onsetFrame = (int)(s.onsetMs / FRAME_MS);
+        int responseEnd = std::max(0, onsetFrame - 100 / FRAME_MS);
+        Run r = run(s, s.onsetMs + 200, 0, responseEnd);
+        Verdict v = judge(s, r);
+        printf("response until onset-100ms, trigger onset+200ms: pre-roll %d frames\n", r.preRollFrames);
+        expect(v.firstSent >= responseEnd && v.seam, "nothing captured during the response is sent");
+        expect(v.syllablePct >= 100.0, "the syllable still goes out whole");
+
+        // No frames for PREROLL_STALE_MS + 100 before the trigger: the pre-roll is stale
+        int trigger = onsetFrame + 200 / FRAME_MS;
+        r = run(s, s.onsetMs + 200, -1, -1, trigger - (PREROLL_STALE_MS + 100) / FRAME_MS, trigger + 1);
+        printf("capture stalled %d ms before the trigger: pre-roll %d frames\n", PREROLL_STALE_MS + 100, r.preRollFrames);
+        expect(r.preRollFrames == 0, "stale pre-roll discarded");
+    }
+
+    printf("\n%s\n", failures ? "CHECK FAILED" : "check passed");
+    return failures ? 1 : 0;
+}
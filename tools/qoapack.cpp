@@ -0,0 +1,200 @@
+// ============== QOA ASSET PACKER ==============
+//
+// Offline tool: packs a 24kHz mono 16-bit PCM file (server/audio/*.pcm) into
+// the QOA asset format the firmware caches in its "assets" flash partition
+// (see AssetCache.h, FORMATS):
+//
+//   "JBQ1" | loopStart | loopEnd | reserved   (uint32 LE, samples; loopEnd 0 = end)
+//   standard mono QOA file (qoaformat.org)
+//
+// Build and run on the host:
+//
+//   g++ -std=c++17 -O2 -o qoapack tools/qoapack.cpp
+//   ./qoapack server/audio/rain.pcm server/audio/rain.qoa [--loop START_S [END_S]]
+//
+// The loop start is rounded down to a QOA frame (5120 samples, ~213ms) so the
+// device can seek to it with one frame-header read. The server offers every
+// .qoa named in DEVICE_ASSETS (server/main.ts) in its asset manifest.
+//
+// The encoder is the reference brute-force search: each 20-sample slice tries
+// all 16 scalefactors, starting from the previous one, and keeps the one with
+// the least squared error.
+//
+// ==============================================
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static const int SAMPLE_RATE = 24000;
+static const int SLICE_LEN = 20;
+static const int SLICES_PER_FRAME = 256;
+static const int FRAME_LEN = SLICE_LEN * SLICES_PER_FRAME;
+
+static const int SCALEFACTOR_TAB[16] = {1, 7, 21, 45, 84, 138, 211, 304, 421, 562, 731, 928, 1157, 1419, 1715, 2048};
+static const int RECIPROCAL_TAB[16] = {65536, 9363, 3121, 1457, 781, 475, 311, 216, 156, 117, 90, 71, 57, 47, 39, 32};
+static const int QUANT_TAB[17] = {7, 7, 7, 5, 5, 3, 3, 1, 0, 0, 2, 2, 4, 4, 6, 6, 6};   // residual -8..8
+static const double DEQUANT[8] = {0.75, -0.75, 2.5, -2.5, 4.5, -4.5, 7, -7};
+
+static int dequantTab[16][8];
+
+struct Lms {
+    int history[4];
+    int weights[4];
+};
+
+static int clampInt(int v, int lo, int hi) { return v < lo ? lo : (v > hi ? hi : v); }
+
+static int predict(const Lms& l) {
+    int p = 0;
+    for (int i = 0; i < 4; i++) p += l.weights[i] * l.history[i];
+    return p >> 13;
+}
+
+static void update(Lms& l, int sample, int residual) {
+    int delta = residual >> 4;
+    for (int i = 0; i < 4; i++) l.weights[i] += l.history[i] < 0 ? -delta : delta;
+    for (int i = 0; i < 3; i++) l.history[i] = l.history[i + 1];
+    l.history[3] = sample;
+}
+
+// residual / scalefactor, rounded away from zero
+static int divide(int v, int sf) {
+    int n = (v * RECIPROCAL_TAB[sf] + (1 << 15)) >> 16;
+    return n + ((v > 0) - (v < 0)) - ((n > 0) - (n < 0));
+}
+
+static void putBE64(std::vector<uint8_t>& out, uint64_t v) {
+    for (int i = 7; i >= 0; i--) out.push_back((uint8_t)(v >> (i * 8)));
+}
+
+static void putLE32(std::vector<uint8_t>& out, uint32_t v) {
+    for (int i = 0; i < 4; i++) out.push_back((uint8_t)(v >> (i * 8)));
+}
+
+static void encode(const std::vector<int16_t>& pcm, std::vector<uint8_t>& out) {
+    Lms lms = {{0, 0, 0, 0}, {0, 0, -(1 << 13), 1 << 14}};
+    int prevSf = 0;
+
+    putBE64(out, ((uint64_t)0x716f6166 << 32) | (uint32_t)pcm.size());   // "qoaf" + samples
+    for (size_t start = 0; start < pcm.size(); start += FRAME_LEN) {
+        int frameLen = (int)std::min((size_t)FRAME_LEN, pcm.size() - start);
+        int slices = (frameLen + SLICE_LEN - 1) / SLICE_LEN;
+        uint32_t frameBytes = 8 + 16 + slices * 8;
+        putBE64(out, ((uint64_t)1 << 56) | ((uint64_t)SAMPLE_RATE << 32) | ((uint64_t)frameLen << 16) | frameBytes);
+
+        // The decoder reads history/weights as int16: encode from exactly what it will see
+        uint64_t h = 0, w = 0;
+        for (int i = 0; i < 4; i++) {
+            lms.history[i] = (int16_t)lms.history[i];
+            lms.weights[i] = (int16_t)lms.weights[i];
+            h = (h << 16) | (uint16_t)lms.history[i];
+            w = (w << 16) | (uint16_t)lms.weights[i];
+        }
+        putBE64(out, h);
+        putBE64(out, w);
+
+        for (int s = 0; s < slices; s++) {
+            int sliceStart = s * SLICE_LEN;
+            int sliceLen = std::min(SLICE_LEN, frameLen - sliceStart);
+            const int16_t* src = &pcm[start + sliceStart];
+
+            uint64_t bestError = UINT64_MAX, bestSlice = 0;
+            Lms bestLms = lms;
+            int bestSf = 0;
+            for (int k = 0; k < 16; k++) {
+                int sf = (k + prevSf) % 16;
+                Lms trial = lms;
+                uint64_t slice = sf, err = 0;
+                for (int i = 0; i < sliceLen; i++) {
+                    int predicted = predict(trial);
+                    int quantized = QUANT_TAB[clampInt(divide(src[i] - predicted, sf), -8, 8) + 8];
+                    int dequantized = dequantTab[sf][quantized];
+                    int reconstructed = clampInt(predicted + dequantized, -32768, 32767);
+                    int64_t e = src[i] - reconstructed;
+                    err += (uint64_t)(e * e);
+                    if (err > bestError) break;
+                    update(trial, reconstructed, dequantized);
+                    slice = (slice << 3) | quantized;
+                }
+                if (err < bestError) {
+                    bestError = err;
+                    bestSlice = slice;
+                    bestLms = trial;
+                    bestSf = sf;
+                }
+            }
+            prevSf = bestSf;
+            lms = bestLms;
+            bestSlice <<= (SLICE_LEN - sliceLen) * 3;   // short last slice: pad with zero codes
+            putBE64(out, bestSlice);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc != 3 && argc != 5 && argc != 6) {
+        fprintf(stderr, "usage: %s in.pcm out.qoa [--loop START_S [END_S]]\n", argv[0]);
+        return 2;
+    }
+    double loopStartS = 0, loopEndS = 0;
+    if (argc >= 5) {
+        if (strcmp(argv[3], "--loop") != 0) {
+            fprintf(stderr, "unknown option %s\n", argv[3]);
+            return 2;
+        }
+        loopStartS = atof(argv[4]);
+        if (argc == 6) loopEndS = atof(argv[5]);
+    }
+
+    for (int s = 0; s < 16; s++) {
+        for (int q = 0; q < 8; q++) {
+            double v = SCALEFACTOR_TAB[s] * DEQUANT[q];
+            dequantTab[s][q] = (int)(v < 0 ? v - 0.5 : v + 0.5);
+        }
+    }
+
+    FILE* in = fopen(argv[1], "rb");
+    if (!in) {
+        perror(argv[1]);
+        return 1;
+    }
+    std::vector<int16_t> pcm;
+    int16_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, sizeof(int16_t), 4096, in)) > 0) pcm.insert(pcm.end(), buf, buf + n);
+    fclose(in);
+    if (pcm.empty()) {
+        fprintf(stderr, "%s: no samples\n", argv[1]);
+        return 1;
+    }
+
+    uint32_t loopStart = (uint32_t)(loopStartS * SAMPLE_RATE) / FRAME_LEN * FRAME_LEN;
+    uint32_t loopEnd = loopEndS > 0 ? (uint32_t)(loopEndS * SAMPLE_RATE) : 0;
+    if (loopEnd > pcm.size()) loopEnd = 0;
+    if (loopStart >= (loopEnd ? loopEnd : pcm.size())) {
+        fprintf(stderr, "loop start is past the loop end\n");
+        return 1;
+    }
+
+    std::vector<uint8_t> out;
+    out.insert(out.end(), {'J', 'B', 'Q', '1'});
+    putLE32(out, loopStart);
+    putLE32(out, loopEnd);
+    putLE32(out, 0);
+    encode(pcm, out);
+
+    FILE* f = fopen(argv[2], "wb");
+    if (!f || fwrite(out.data(), 1, out.size(), f) != out.size()) {
+        perror(argv[2]);
+        return 1;
+    }
+    fclose(f);
+    printf("%s: %zu samples (%.1fs), %zu -> %zu bytes (%.1f:1), loop %u-%u\n", argv[2], pcm.size(),
+           pcm.size() / (double)SAMPLE_RATE, pcm.size() * 2, out.size(), pcm.size() * 2.0 / out.size(),
+           loopStart, loopEnd ? loopEnd : (uint32_t)pcm.size());
+    return 0;
+}
@@ -0,0 +1,250 @@
+// ============== AUDIO RING BENCHMARK ==============
+//
+// Offline tool: measures the firmware's AudioRing (src/AudioRing.h) against
+// the FreeRTOS queue of 2 KB AudioChunk slots it replaced, on the host, with
+// std::threads standing in for websocketTask and speakerTask (tools/host/).
+//
+// Build and run on the host:
+//
+//   g++ -std=c++17 -O2 -Itools/host -Isrc -o ringbench tools/ringbench.cpp src/AudioRing.cpp -lpthread
+//   ./ringbench [--packets N]
+//
+//   check      flush() accounting: frames(), bytesUsed() and payloadBytes()
+//              must drop the flushed frames before the consumer applies the
+//              flush, and keep what is committed after it
+//   copy       producer and consumer flat out, for the downlink's packet
+//              sizes: ns per packet and MB/s through each design. The queue
+//              path copies payload -> stack chunk -> queue -> consumer chunk,
+//              the ring copies payload -> ring and is read in place.
+//   wake       the ring kept full while the consumer frees one frame every
+//              5ms: how long a blocked write() takes to notice. "poll" is the
+//              old write(), retrying every 2ms; "notify" is the current one.
+//   footprint  bytes held per second of 24 kHz PCM at each packet size
+//
+// Host mutexes are not FreeRTOS critical sections, so the copy figures rank
+// the designs, they do not predict the ESP32's numbers. Exits non-zero if the
+// check fails.
+//
+// ==================================================
+
+#include "AudioRing.h"
+#include <freertos/queue.h>
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+// The old downlink queue (main.cpp before AudioRing)
+struct AudioChunk {
+    uint8_t data[2048];
+    size_t length;
+};
+static const int AUDIO_QUEUE_SIZE = 30;
+
+static int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int failures = 0;
+
+static void expect(bool ok, const char* what) {
+    printf("  %-58s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+// ── check ────────────────────────────────────────────────────────────────────
+
+static void checkFlush() {
+    printf("check\n");
+    AudioRing ring;
+    ring.begin(16 * 1024);
+    uint8_t pkt[960] = {0};
+
+    for (int i = 0; i < 5; i++) ring.write(pkt, sizeof(pkt), 0);
+    expect(ring.frames() == 5 && ring.payloadBytes() == 5 * 960, "5 frames committed");
+
+    ring.flush();
+    expect(ring.frames() == 0, "frames() is 0 right after flush()");
+    expect(ring.payloadBytes() == 0, "payloadBytes() is 0 right after flush()");
+    expect(ring.bytesUsed() == 0, "bytesUsed() is 0 right after flush()");
+
+    ring.write(pkt, 480, 0);
+    ring.write(pkt, 480, 0);
+    expect(ring.frames() == 2 && ring.payloadBytes() == 960, "frames committed after the flush are counted");
+
+    size_t len = 0;
+    const uint8_t* p = ring.peek(&len);
+    expect(p && len == 480, "consumer applies the flush and sees the new frame");
+    ring.release();
+    expect(ring.frames() == 1 && ring.payloadBytes() == 480, "counts agree once the flush is applied");
+
+    // Fill to the brim, flush, and refill: space comes back only when applied,
+    // but the counters must not go negative in between
+    while (ring.write(pkt, sizeof(pkt), 0)) {}
+    ring.flush();
+    expect(ring.frames() == 0 && ring.bytesUsed() == 0, "full ring reads empty after flush()");
+    p = ring.peek(&len);
+    expect(p == nullptr && ring.frames() == 0, "empty after the consumer applies it");
+}
+
+// ── copy ─────────────────────────────────────────────────────────────────────
+
+struct CopyResult { double nsPerPacket; double mbPerS; };
+
+static CopyResult copyQueue(int packets, size_t size) {
+    QueueHandle_t q = xQueueCreate(AUDIO_QUEUE_SIZE, sizeof(AudioChunk));
+    std::vector<uint8_t> payload(size, 0x5A);
+    std::atomic<uint32_t> sink{0};
+
+    int64_t t0 = nowNs();
+    std::thread consumer([&] {
+        AudioChunk chunk;
+        uint32_t acc = 0;
+        for (int i = 0; i < packets; i++) {
+            xQueueReceive(q, &chunk, portMAX_DELAY);
+            acc += chunk.data[chunk.length - 1];
+        }
+        sink = acc;
+    });
+    for (int i = 0; i < packets; i++) {
+        AudioChunk chunk;
+        memcpy(chunk.data, payload.data(), size);
+        chunk.length = size;
+        xQueueSend(q, &chunk, portMAX_DELAY);
+    }
+    consumer.join();
+    int64_t dt = nowNs() - t0;
+    vQueueDelete(q);
+    return { (double)dt / packets, (double)packets * size / (dt / 1e9) / 1e6 };
+}
+
+static CopyResult copyRing(int packets, size_t size) {
+    AudioRing ring;
+    ring.begin(AUDIO_RING_BYTES);
+    std::vector<uint8_t> payload(size, 0x5A);
+    std::atomic<bool> ready{false};
+    std::atomic<uint32_t> sink{0};
+
+    int64_t t0 = nowNs();
+    std::thread consumer([&] {
+        ring.setConsumer(xTaskGetCurrentTaskHandle());
+        ready = true;
+        uint32_t acc = 0;
+        for (int i = 0; i < packets; ) {
+            size_t len;
+            const uint8_t* p = ring.peek(&len, pdMS_TO_TICKS(10));
+            if (!p) continue;
+            acc += p[len - 1];
+            ring.release();
+            i++;
+        }
+        sink = acc;
+    });
+    while (!ready) std::this_thread::yield();
+    for (int i = 0; i < packets; i++) {
+        while (!ring.write(payload.data(), size, 100)) {}
+    }
+    consumer.join();
+    int64_t dt = nowNs() - t0;
+    return { (double)dt / packets, (double)packets * size / (dt / 1e9) / 1e6 };
+}
+
+// ── wake ─────────────────────────────────────────────────────────────────────
+
+// The pre-notification write(): retry every 2ms until it fits
+static bool pollWrite(AudioRing& ring, const uint8_t* data, size_t len, uint32_t timeoutMs) {
+    uint32_t start = millis();
+    while (true) {
+        uint8_t* dst = ring.reserve(len);
+        if (dst) {
+            memcpy(dst, data, len);
+            ring.commit(len);
+            return true;
+        }
+        if ((millis() - start) >= timeoutMs) return false;
+        vTaskDelay(pdMS_TO_TICKS(2));
+    }
+}
+
+static void wake(bool poll, int releases, size_t size) {
+    AudioRing ring;
+    ring.begin(16 * 1024);
+    std::vector<uint8_t> payload(size, 0);
+    while (ring.write(payload.data(), size, 0)) {}
+
+    std::atomic<int64_t> releasedAt{0};
+    std::atomic<bool> done{false};
+    std::thread consumer([&] {
+        ring.setConsumer(xTaskGetCurrentTaskHandle());
+        for (int i = 0; i < releases; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            size_t len;
+            if (!ring.peek(&len, pdMS_TO_TICKS(10))) continue;
+            releasedAt = nowNs();
+            ring.release();
+        }
+        done = true;
+    });
+
+    int64_t sum = 0, worst = 0;
+    int n = 0;
+    while (!done) {
+        bool ok = poll ? pollWrite(ring, payload.data(), size, 20)
+                       : ring.write(payload.data(), size, 20);
+        if (!ok) continue;
+        int64_t lat = nowNs() - releasedAt.load();
+        if (releasedAt.load() && lat >= 0 && lat < 20000000) {
+            sum += lat;
+            if (lat > worst) worst = lat;
+            n++;
+        }
+    }
+    consumer.join();
+    printf("  %-8s %5d writes unblocked   mean %7.1f us   worst %7.1f us\n",
+           poll ? "poll" : "notify", n, n ? sum / n / 1000.0 : 0.0, worst / 1000.0);
+}
+
+// ── main ─────────────────────────────────────────────────────────────────────
+
+int main(int argc, char** argv) {
+    int packets = 200000;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--packets") && i + 1 < argc) packets = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s [--packets N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    checkFlush();
+
+    printf("\ncopy (%d packets, producer and consumer flat out)\n", packets);
+    printf("  %6s  %22s  %22s\n", "bytes", "queue ns/pkt   MB/s", "ring ns/pkt   MB/s");
+    const size_t sizes[] = { 480, 960, 1024, 2048 };
+    for (size_t size : sizes) {
+        CopyResult q = copyQueue(packets, size);
+        CopyResult r = copyRing(packets, size);
+        printf("  %6zu  %12.0f %9.0f  %12.0f %9.0f\n", size, q.nsPerPacket, q.mbPerS, r.nsPerPacket, r.mbPerS);
+    }
+
+    printf("\nwake (ring full, one frame freed every 5ms)\n");
+    wake(true, 200, 960);
+    wake(false, 200, 960);
+
+    printf("\nfootprint (bytes held per second of 24 kHz mono PCM)\n");
+    for (size_t size : sizes) {
+        size_t perSec = 48000;
+        size_t pkts = (perSec + size - 1) / size;
+        size_t queueBytes = pkts * sizeof(AudioChunk);
+        size_t ringBytes = pkts * (4 + ((size + 3) & ~(size_t)3));
+        printf("  %6zu B packets   queue %7zu   ring %7zu\n", size, queueBytes, ringBytes);
+    }
+
+    printf("\n%s\n", failures ? "CHECK FAILED" : "check passed");
+    return failures ? 1 : 0;
+}
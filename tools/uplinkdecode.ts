@@ -0,0 +1,67 @@
+// ============== MIC UPLINK SERVER DECODE ==============
+//
+// Offline tool: runs binary mic uplink frames through the server's own
+// decoder (server/uplink.ts, what handleMicFrame() in main.ts calls), one turn
+// at a time, for tools/uplinkeval.cpp to check against the capture timeline.
+//
+//   ./uplinkeval --write /tmp/uplink.frames
+//   deno run --allow-read --allow-write tools/uplinkdecode.ts /tmp/uplink.frames /tmp/uplink.out
+//   ./uplinkeval --server /tmp/uplink.out
+//
+// IN: per frame u16 LE length + frame bytes; length 0 starts a turn (fresh
+// state, as handleTypeRecordingStart() clears it). OUT: per turn u32 LE
+// samples, frames lost, audio frames, DTX-suppressed frames, then the PCM
+// that would have gone to Gemini, in order.
+//
+// ======================================================
+
+import { decodeMicFrame, type MicUplinkState } from "../server/uplink.ts";
+
+const [inPath, outPath] = Deno.args;
+if (!inPath || !outPath) {
+  console.error("usage: uplinkdecode.ts IN.frames OUT");
+  Deno.exit(2);
+}
+
+const input = await Deno.readFile(inPath);
+const out: Uint8Array[] = [];
+let state: MicUplinkState | null = null;
+let pcm: Uint8Array[] = [];
+let turns = 0;
+
+const endTurn = () => {
+  if (!state) return;
+  const samples = pcm.reduce((n, p) => n + p.length, 0) >> 1;
+  const header = new Uint8Array(16);
+  const view = new DataView(header.buffer);
+  view.setUint32(0, samples, true);
+  view.setUint32(4, state.micFramesLost || 0, true);
+  view.setUint32(8, state.micTurnFrames || 0, true);
+  view.setUint32(12, state.micTurnSuppressed || 0, true);
+  out.push(header, ...pcm);
+  turns++;
+};
+
+for (let at = 0; at + 2 <= input.length;) {
+  const len = input[at] | (input[at + 1] << 8);
+  at += 2;
+  if (len === 0) {
+    endTurn();
+    state = { deviceId: "uplinkdecode", micTurnFrames: 0, micTurnSuppressed: 0 };
+    pcm = [];
+    continue;
+  }
+  const frame = input.subarray(at, at + len);
+  at += len;
+  if (state && !decodeMicFrame(frame, state, (p) => pcm.push(p.slice()))) {
+    console.error(`not a mic uplink frame at byte ${at - len}`);
+    Deno.exit(1);
+  }
+}
+endTurn();
+
+const result = new Uint8Array(out.reduce((n, p) => n + p.length, 0));
+let pos = 0;
+for (const p of out) { result.set(p, pos); pos += p.length; }
+await Deno.writeFile(outPath, result);
+console.log(`${turns} turns decoded`);
@@ -0,0 +1,527 @@
+// ============== MIC UPLINK EVALUATION ==============
+//
+// Offline tool: builds binary mic uplink frames with the firmware's MicUplink
+// and MicDtx (src/MicUplink.h), calling them exactly as sendAudioChunk() does,
+// drops some of them, and checks what the server's decoder (server/uplink.ts,
+// the code handleMicFrame() runs, via tools/uplinkdecode.ts) makes of what is
+// left: the audio Gemini hears must keep the capture timing.
+//
+// Build and run on the host:
+//
+//   g++ -std=c++17 -O2 -Itools/host -Isrc -o uplinkeval tools/uplinkeval.cpp src/MicUplink.cpp src/AudioCodec.cpp
+//   ./uplinkeval [--write FILE.frames] [--server FILE.out]
+//
+// Turns (16 kHz, one MicDtx::reset() each, one MicUplink throughout; the
+// sequence starts 40 frames short of the wrap so the first turn crosses it):
+//
+//   gaps        speech, no DTX, in each codec; frames 10, 30-34 (5, the
+//               server's concealment limit), 60-65 (6, beyond it), 80 and 82
+//               lost
+//   dtx         speech, room noise, speech, a pause longer than
+//               DTX_MAX_RUN_FRAMES, a soft 2-frame onset (below the DTX
+//               threshold) into speech, room noise; nothing lost
+//   dtx-loss    the same with the first silence marker, the 2 frames before
+//               the second, the 6 before the third and the first onset frame
+//               lost
+//   long-onset  a 5-frame soft onset: only DTX_ONSET_FRAMES can be held back
+//
+// DEVICE (always): every frame's header names its capture frame (t) and its
+// sequence number, and a marker stands for `frames` of them. Per turn the
+// frames must cover the capture timeline in order with no overlap, sequence
+// numbers must equal capture frame numbers (so a marker consumes exactly its
+// run), audio payloads must code their own capture frame (re-encoded from
+// the state in the block header, byte for byte), and a labelled
+// onset must go out as audio. Only the frames still held when the turn ends
+// may be missing.
+//
+// SERVER (with --server): --write saves the frames, uplinkdecode.ts runs them
+// through decodeMicFrame() turn by turn, and the output must be, in order:
+// each delivered audio frame decoded bit for bit, each delivered marker as
+// comfort noise at its level, and in front of each delivered frame the
+// frames lost before it as silence, or as comfort noise in front of a
+// marker, if there are at most 5 (a longer gap is only counted). Lost counts
+// must match. A labelled onset must land at its capture time.
+//
+//   ./uplinkeval --write /tmp/uplink.frames
+//   deno run --allow-read --allow-write tools/uplinkdecode.ts /tmp/uplink.frames /tmp/uplink.out
+//   ./uplinkeval --server /tmp/uplink.out
+//
+// TIMING (always): 10 s of speech through MicUplink::encode() in each codec,
+// frame by frame as sendAudioChunk() calls it; reports bytes per frame
+// (header included) and encode us per 20ms frame on the host, best of 20
+// passes per frame.
+//
+// Exits non-zero on any failed check.
+//
+// ===================================================
+
+#include "MicUplink.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static const int SAMPLE_RATE = 16000;
+static const int FRAME = MIC_FRAME_SIZE;
+static const int FRAME_MS = FRAME * 1000 / SAMPLE_RATE;
+static const int CONCEAL_FRAMES = 5;          // server UPLINK_MAX_CONCEAL_FRAMES
+static const uint32_t T0 = 100000;            // capture ms of frame 0 (any value)
+
+// ── Signals ──────────────────────────────────────────────────────────────────
+
+// Voiced speech: a 110-180 Hz pulse train through three formants, 4 Hz syllables
+static void speech(std::vector<int16_t>& x, int ms) {
+    const float formants[3] = { 700.0f, 1200.0f, 2600.0f };
+    const float widths[3] = { 90.0f, 110.0f, 160.0f };
+    float y1[3] = {0}, y2[3] = {0};
+    float phase = 0.0f;
+    int n = ms * SAMPLE_RATE / 1000;
+    for (int i = 0; i < n; i++) {
+        float t = (float)i / SAMPLE_RATE;
+        phase += (145.0f + 35.0f * sinf(2.0f * (float)M_PI * 0.3f * t)) / SAMPLE_RATE;
+        float pulse = 0.0f;
+        if (phase >= 1.0f) {
+            phase -= 1.0f;
+            pulse = 1.0f;
+        }
+        float s = 0.0f;
+        for (int k = 0; k < 3; k++) {
+            float r = expf(-(float)M_PI * widths[k] / SAMPLE_RATE);
+            float y = pulse + 2.0f * r * cosf(2.0f * (float)M_PI * formants[k] / SAMPLE_RATE) * y1[k] - r * r * y2[k];
+            y2[k] = y1[k];
+            y1[k] = y;
+            s += y;
+        }
+        float ph = fmodf(t * 4.0f, 1.0f);
+        float env = ph < 0.85f ? 0.3f + 0.7f * sinf((float)M_PI * ph / 0.85f) : 0.3f;
+        x.push_back((int16_t)fmaxf(-32000.0f, fminf(32000.0f, 2500.0f * s * env)));
+    }
+}
+
+// Uniform noise with mean |sample| = level
+static void noise(std::vector<int16_t>& x, int ms, int level, std::mt19937& rng) {
+    std::uniform_real_distribution<float> u(-2.0f * level, 2.0f * level);
+    for (int i = 0; i < ms * SAMPLE_RATE / 1000; i++) x.push_back((int16_t)lrintf(u(rng)));
+}
+
+// ── Device side ──────────────────────────────────────────────────────────────
+
+struct Msg {
+    std::vector<uint8_t> bytes;
+    uint16_t seq;
+    uint8_t  codec;
+    int      first;           // capture frame, from the header's t
+    int      frames;          // 1, or a marker's run
+    uint16_t level;           // marker only
+    bool     lost = false;
+};
+
+struct Turn {
+    const char* name;
+    uint8_t codec;
+    bool dtx;
+    std::vector<int16_t> pcm;                     // whole frames
+    int onset = -1, onsetLen = 0;                 // labelled soft onset (capture frames)
+    std::function<bool(const Msg&, const Turn&)> lose;
+    std::vector<Msg> msgs;
+
+    Turn(const char* name, uint8_t codec, bool dtx) : name(name), codec(codec), dtx(dtx) {}
+};
+
+static Msg parse(const uint8_t* frame, size_t len) {
+    Msg m;
+    m.bytes.assign(frame, frame + len);
+    m.codec = frame[3];
+    m.seq = frame[4] | (frame[5] << 8);
+    uint32_t t = frame[6] | (frame[7] << 8) | (frame[8] << 16) | ((uint32_t)frame[9] << 24);
+    m.first = (int)(t - T0) / FRAME_MS;
+    m.frames = 1;
+    m.level = 0;
+    if (m.codec == UPLINK_SILENCE) {
+        const uint8_t* p = frame + UPLINK_HEADER_BYTES;
+        m.frames = p[0] | (p[1] << 8);
+        m.level = p[2] | (p[3] << 8);
+    }
+    return m;
+}
+
+// sendAudioChunk()'s binary path, frame by frame
+static void build(Turn& turn, MicUplink& up, MicDtx& dtx) {
+    dtx.reset();
+    size_t len = 0;
+    auto sendCoded = [&](const int16_t* pcm, uint32_t ms) {
+        size_t payload = up.encode(turn.codec, pcm, FRAME);
+        const uint8_t* f = up.seal(UPLINK_STREAM_MIC, turn.codec, payload, ms, &len);
+        turn.msgs.push_back(parse(f, len));
+    };
+    for (size_t i = 0; i * FRAME < turn.pcm.size(); i++) {
+        const int16_t* pcm = &turn.pcm[i * FRAME];
+        uint32_t ms = T0 + (uint32_t)i * FRAME_MS;
+        bool held = false;
+        if (turn.dtx) {
+            held = dtx.hold(pcm, ms);
+            uint16_t level;
+            uint32_t firstMs;
+            uint16_t run = dtx.takeRun(!held, &level, &firstMs);
+            if (run) {
+                const uint8_t* marker = up.sealSilence(run, level, firstMs, &len);
+                turn.msgs.push_back(parse(marker, len));
+            }
+            if (!held) {
+                for (int h = 0; h < dtx.heldFrames(); h++) {
+                    uint32_t heldMs;
+                    const int16_t* frame = dtx.heldFrame(h, &heldMs);
+                    sendCoded(frame, heldMs);
+                }
+                dtx.clearHeld();
+            }
+        }
+        if (!held) sendCoded(pcm, ms);
+    }
+    for (Msg& m : turn.msgs) m.lost = turn.lose && turn.lose(m, turn);
+}
+
+static void decodePayload(const Msg& m, int16_t* out) {
+    const uint8_t* p = m.bytes.data() + UPLINK_HEADER_BYTES;
+    size_t n = m.bytes.size() - UPLINK_HEADER_BYTES;
+    memset(out, 0, FRAME * sizeof(int16_t));
+    if (m.codec == CODEC_IMA_ADPCM) {
+        imaAdpcmDecodeBlock(p, n, out, FRAME);
+    } else if (m.codec == CODEC_MULAW) {
+        for (size_t i = 0; i < n && i < (size_t)FRAME; i++) {
+            int u = ~p[i] & 0xFF;
+            int magnitude = ((((u & 0x0F) << 3) + 0x84) << ((u >> 4) & 7)) - 0x84;
+            out[i] = (int16_t)((u & 0x80) ? -magnitude : magnitude);
+        }
+    } else {
+        memcpy(out, p, std::min(n, (size_t)FRAME * sizeof(int16_t)));
+    }
+}
+
+// The payload `m` carries, if it is `pcm` coded from the state in its own header
+static bool codes(const Msg& m, const int16_t* pcm) {
+    const uint8_t* p = m.bytes.data() + UPLINK_HEADER_BYTES;
+    size_t n = m.bytes.size() - UPLINK_HEADER_BYTES;
+    uint8_t ref[UPLINK_MAX_PAYLOAD];
+    size_t len;
+    if (m.codec == CODEC_IMA_ADPCM) {
+        ImaAdpcmState st = { (int16_t)(p[0] | (p[1] << 8)), p[2] };
+        len = imaAdpcmEncodeBlock(pcm, FRAME, &st, ref);
+    } else if (m.codec == CODEC_MULAW) {
+        mulawEncode(pcm, FRAME, ref);
+        len = FRAME;
+    } else {
+        memcpy(ref, pcm, FRAME * sizeof(int16_t));
+        len = FRAME * sizeof(int16_t);
+    }
+    return len == n && memcmp(ref, p, n) == 0;
+}
+
+static int failures = 0;
+
+static void expect(bool ok, const char* what) {
+    printf("  %-62s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+static void checkDevice(const Turn& turn) {
+    const int total = (int)(turn.pcm.size() / FRAME);
+    const std::vector<Msg>& msgs = turn.msgs;
+    int markers = 0, suppressed = 0;
+    size_t bytes = 0;
+    bool contiguous = !msgs.empty() && msgs[0].first == 0;
+    bool seqOk = true, contentOk = true;
+    for (size_t k = 0; k < msgs.size(); k++) {
+        const Msg& m = msgs[k];
+        bytes += m.bytes.size();
+        if (m.codec == UPLINK_SILENCE) {
+            markers++;
+            suppressed += m.frames;
+        } else if (m.first < 0 || m.first >= total || !codes(m, &turn.pcm[m.first * FRAME])) {
+            contentOk = false;
+        }
+        if (k > 0 && m.first != msgs[k - 1].first + msgs[k - 1].frames) contiguous = false;
+        if ((uint16_t)(m.seq - m.first) != (uint16_t)(msgs[0].seq - msgs[0].first)) seqOk = false;
+    }
+    int covered = msgs.empty() ? 0 : msgs.back().first + msgs.back().frames;
+    int tail = total - covered;
+
+    printf("%s (%s%s): %d frames -> %zu messages, %d markers for %d frames, %zu bytes, %d held at the end\n",
+           turn.name, uplinkCodecName(turn.codec), turn.dtx ? ", dtx" : "", total, msgs.size(), markers,
+           suppressed, bytes, tail);
+    expect(contiguous, "frames cover the capture timeline in order, no overlap");
+    expect(seqOk, "sequence number == capture frame (markers consume their run)");
+    expect(contentOk, "audio payloads code their own capture frame");
+    char what[96];
+    expect(tail >= 0 && tail <= (turn.dtx ? DTX_MAX_RUN_FRAMES + DTX_ONSET_FRAMES : 0),
+           "only frames still held at the end are missing");
+    if (turn.onset >= 0) {
+        int asAudio = 0;
+        for (const Msg& m : msgs) {
+            if (m.codec != UPLINK_SILENCE && m.first >= turn.onset && m.first < turn.onset + turn.onsetLen) asAudio++;
+        }
+        snprintf(what, sizeof(what), "onset frames %d-%d: %d of %d sent as audio",
+                 turn.onset, turn.onset + turn.onsetLen - 1, asAudio, turn.onsetLen);
+        expect(asAudio >= std::min(turn.onsetLen, DTX_ONSET_FRAMES), what);
+    }
+}
+
+// ── Server side ──────────────────────────────────────────────────────────────
+
+struct Decoded {
+    std::vector<int16_t> pcm;
+    uint32_t lost, frames, suppressed;
+};
+
+static void checkServer(const Turn& turn, const Decoded& d) {
+    enum Kind { AUDIO, ZERO, NOISE };
+    struct Segment { Kind kind; int frames; const Msg* msg; };
+    std::vector<Segment> want;
+    uint32_t lost = 0, frames = 0, suppressed = 0;
+    int prevEnd = -1;
+    for (const Msg& m : turn.msgs) {
+        if (m.lost) continue;
+        int gap = prevEnd < 0 ? 0 : m.first - prevEnd;
+        int conceal = gap <= CONCEAL_FRAMES ? gap : 0;   // longer gaps are only counted
+        lost += gap;
+        if (m.codec == UPLINK_SILENCE) {
+            want.push_back({ NOISE, conceal + m.frames, &m });
+            suppressed += m.frames;
+        } else {
+            if (conceal) want.push_back({ ZERO, conceal, &m });
+            want.push_back({ AUDIO, 1, &m });
+            frames++;
+        }
+        prevEnd = m.first + m.frames;
+    }
+
+    size_t expected = 0;
+    for (const Segment& s : want) expected += (size_t)s.frames * FRAME;
+    char what[96];
+    snprintf(what, sizeof(what), "server: %zu samples (want %zu), lost %u/%u, audio %u/%u, dtx %u/%u",
+             d.pcm.size(), expected, d.lost, lost, d.frames, frames, d.suppressed, suppressed);
+    expect(d.pcm.size() == expected && d.lost == lost && d.frames == frames && d.suppressed == suppressed, what);
+    if (d.pcm.size() != expected) return;
+
+    size_t at = 0;
+    bool audioOk = true, zeroOk = true, noiseOk = true;
+    int onsetFrame = -1, onsetAt = -1;   // first onset frame that went out as audio
+    for (const Segment& s : want) {
+        const int16_t* y = &d.pcm[at];
+        int n = s.frames * FRAME;
+        if (s.kind == AUDIO) {
+            int16_t ref[FRAME];
+            decodePayload(*s.msg, ref);
+            if (memcmp(ref, y, sizeof(ref)) != 0) audioOk = false;
+            if (onsetFrame < 0 && s.msg->first >= turn.onset && s.msg->first < turn.onset + turn.onsetLen) {
+                onsetFrame = s.msg->first;
+                onsetAt = (int)(at / FRAME);
+            }
+        } else if (s.kind == ZERO) {
+            for (int i = 0; i < n; i++) zeroOk &= y[i] == 0;
+        } else {
+            double sum = 0;
+            int peak = 0;
+            for (int i = 0; i < n; i++) {
+                sum += abs(y[i]);
+                peak = std::max(peak, abs(y[i]));
+            }
+            double mean = sum / n, level = s.msg->level;
+            if (fabs(mean - level) > 0.2 * level + 1.0 || peak > 2 * level + 1) noiseOk = false;
+        }
+        at += n;
+    }
+    expect(audioOk, "server: audio frames decoded bit for bit, in place");
+    expect(zeroOk, "server: lost frames (up to 5) as silence in front of audio");
+    expect(noiseOk, "server: markers (and losses before them) as noise at their level");
+    if (turn.onset >= 0) {
+        // Nothing lost before the onset: it must land exactly at its capture time
+        bool clean = true;
+        for (const Msg& m : turn.msgs) clean &= !(m.lost && m.first < turn.onset);
+        if (clean) {
+            snprintf(what, sizeof(what), "server: onset frame %d at %d ms of output (captured at %d ms)",
+                     onsetFrame, onsetAt * FRAME_MS, onsetFrame * FRAME_MS);
+            expect(onsetFrame >= 0 && onsetAt == onsetFrame, what);
+        }
+    }
+}
+
+// ── Files ────────────────────────────────────────────────────────────────────
+// FILE.frames: per frame u16 length + bytes; length 0 starts a turn.
+// FILE.out (uplinkdecode.ts): per turn u32 samples, lost, frames, suppressed, then the samples.
+
+static bool writeFrames(const char* path, const std::vector<Turn>& turns) {
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    for (const Turn& t : turns) {
+        uint8_t zero[2] = { 0, 0 };
+        fwrite(zero, 1, 2, f);
+        for (const Msg& m : t.msgs) {
+            if (m.lost) continue;
+            uint8_t len[2] = { (uint8_t)(m.bytes.size() & 0xFF), (uint8_t)(m.bytes.size() >> 8) };
+            fwrite(len, 1, 2, f);
+            fwrite(m.bytes.data(), 1, m.bytes.size(), f);
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+static bool readDecoded(const char* path, size_t turns, std::vector<Decoded>& out) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    for (size_t t = 0; t < turns; t++) {
+        uint32_t h[4];
+        if (fread(h, sizeof(uint32_t), 4, f) != 4) break;
+        Decoded d;
+        d.pcm.resize(h[0]);
+        d.lost = h[1];
+        d.frames = h[2];
+        d.suppressed = h[3];
+        if (fread(d.pcm.data(), sizeof(int16_t), h[0], f) != h[0]) break;
+        out.push_back(std::move(d));
+    }
+    fclose(f);
+    if (out.size() != turns) {
+        fprintf(stderr, "%s: %zu of %zu turns\n", path, out.size(), turns);
+        return false;
+    }
+    return true;
+}
+
+// Encode cost and size per codec. Every pass starts a fresh MicUplink, so
+// each frame is coded from the same state every time.
+static void encodeTiming(const std::vector<int16_t>& pcm) {
+    const int reps = 20;
+    const size_t frames = pcm.size() / FRAME;
+    printf("\nencode (%.1fs of speech, %zu frames of %d samples)\n", (double)pcm.size() / SAMPLE_RATE, frames, FRAME);
+    for (uint8_t codec : { CODEC_IMA_ADPCM, CODEC_MULAW, CODEC_PCM16 }) {
+        std::vector<double> us(frames, 1e30);
+        size_t bytes = 0;
+        for (int r = 0; r < reps; r++) {
+            MicUplink up;
+            for (size_t i = 0; i < frames; i++) {
+                auto t0 = std::chrono::steady_clock::now();
+                size_t payload = up.encode(codec, &pcm[i * FRAME], FRAME);
+                us[i] = std::min(us[i], std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+                if (r == 0) bytes += UPLINK_HEADER_BYTES + payload;
+            }
+        }
+        std::vector<double> sorted = us;
+        std::sort(sorted.begin(), sorted.end());
+        double mean = 0;
+        for (double u : us) mean += u;
+        mean /= frames;
+        double perFrame = (double)bytes / frames;
+        printf("  %-10s %6.1f bytes/frame (%5.1f kbps)   %.2f us mean, %.2f us p99, %.2f us max per frame (host)\n",
+               uplinkCodecName(codec), perFrame, perFrame * 8 / FRAME_MS, mean, sorted[frames * 99 / 100],
+               sorted.back());
+    }
+}
+
+int main(int argc, char** argv) {
+    const char* writePath = nullptr;
+    const char* serverPath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--write") && i + 1 < argc) writePath = argv[++i];
+        else if (!strcmp(argv[i], "--server") && i + 1 < argc) serverPath = argv[++i];
+        else {
+            fprintf(stderr, "usage: %s [--write FILE.frames] [--server FILE.out]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::mt19937 rng(11);
+    std::vector<Turn> turns;
+
+    auto lostFrames = [](std::vector<int> lost) {
+        return [lost](const Msg& m, const Turn&) {
+            for (int f : lost) if (m.first == f) return true;
+            return false;
+        };
+    };
+    for (uint8_t codec : { CODEC_IMA_ADPCM, CODEC_MULAW, CODEC_PCM16 }) {
+        Turn t("gaps", codec, false);
+        speech(t.pcm, 2000);
+        t.lose = lostFrames({ 10, 30, 31, 32, 33, 34, 60, 61, 62, 63, 64, 65, 80, 82 });
+        turns.push_back(std::move(t));
+    }
+
+    auto dtxSignal = [&](Turn& t, int onsetFrames) {
+        noise(t.pcm, 300, 30, rng);
+        speech(t.pcm, 600);
+        noise(t.pcm, 1600, 30, rng);
+        speech(t.pcm, 600);
+        noise(t.pcm, 2500, 30, rng);
+        t.onset = (int)(t.pcm.size() / FRAME);
+        t.onsetLen = onsetFrames;
+        noise(t.pcm, onsetFrames * FRAME_MS, 45, rng);   // soft consonant: above the room, under 2x its floor
+        speech(t.pcm, 600);
+        noise(t.pcm, 500, 30, rng);
+    };
+    {
+        Turn t("dtx", CODEC_IMA_ADPCM, true);
+        dtxSignal(t, 2);
+        turns.push_back(std::move(t));
+    }
+    {
+        Turn t("dtx-loss", CODEC_IMA_ADPCM, true);
+        dtxSignal(t, 2);
+        t.lose = [](const Msg& m, const Turn& turn) {
+            if (m.first == turn.onset && m.codec != UPLINK_SILENCE) return true;
+            // Marker 0 itself, the 2 frames before marker 1, the 6 before marker 2
+            const int before[3] = { 0, 2, 6 };
+            int k = (int)(&m - turn.msgs.data()), marker = 0;
+            for (int j = 0; j < (int)turn.msgs.size() && marker < 3; j++) {
+                if (turn.msgs[j].codec != UPLINK_SILENCE) continue;
+                if (marker == 0 ? k == j : (k < j && k >= j - before[marker])) return true;
+                marker++;
+            }
+            return false;
+        };
+        turns.push_back(std::move(t));
+    }
+    {
+        Turn t("long-onset", CODEC_IMA_ADPCM, true);
+        dtxSignal(t, 5);
+        turns.push_back(std::move(t));
+    }
+
+    MicUplink up;
+    size_t len;
+    for (int i = 0; i < 65536 - 40; i++) up.seal(UPLINK_STREAM_MIC, CODEC_PCM16, 0, 0, &len);
+    MicDtx dtx;
+    for (Turn& t : turns) build(t, up, dtx);
+
+    if (writePath) {
+        if (!writeFrames(writePath, turns)) return 1;
+        printf("wrote %zu turns to %s\n", turns.size(), writePath);
+        return 0;
+    }
+
+    std::vector<Decoded> decoded;
+    if (serverPath && !readDecoded(serverPath, turns.size(), decoded)) return 1;
+    for (size_t i = 0; i < turns.size(); i++) {
+        checkDevice(turns[i]);
+        if (serverPath) checkServer(turns[i], decoded[i]);
+    }
+
+    std::vector<int16_t> voice;
+    speech(voice, 10000);
+    encodeTiming(voice);
+
+    printf("\n%s\n", failures ? "CHECK FAILED" : "check passed");
+    return failures ? 1 : 0;
+}